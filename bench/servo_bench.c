@@ -0,0 +1,836 @@
+/**
+ * @defgroup servo_bench Benchmarks
+ *
+ * @brief Benchmark executable: measures the protocol kernels and the servo transactions without hardware.
+ *
+ * Usage: servo_bench [options]
+ *   -t, --time MS              Minimum measuring time of every benchmark (20).
+ *   -f, --filter TEXT          Run only the benchmarks whose name contains the text.
+ *   -l, --label TEXT           Label stored in the results (e.g. commit or machine name).
+ *   -o, --output FILE          Write the results to the file instead of stdout.
+ *   -c, --capture FILE         Capture file (@see serial_capture) decoded by the replay benchmark.
+ *
+ * Benchmarks:
+ * - crc/ENGINE/BYTES: CRC-16 of a message with every supported kernel;
+ * - lrc/BYTES: LRC of a message;
+ * - hex/ENGINE/encode|decode/BYTES: hex codec of a message with every supported kernel;
+ * - frame/MODE/read|write/WORDS: servo_nwords_read() and servo_nwords_write() for every word count, the bus
+ *   answers with a prepared frame, so only the request build, frame encoding, answer decoding and parsing
+ *   are measured (CRC in RTU mode, LRC and hex codec in ASCII mode);
+ * - frame_cxx/MODE/read|write|write_one/WORDS: the same frames handled by the C++ codecs (@see servo_bench_cxx.h),
+ *   when built with SERVO_BENCH_CXX;
+ * - transaction/MODE/OPERATION/WORDS: complete transactions over an in-memory loopback bus, the requests are
+ *   decoded, served by the simulated servo (@see servo_sim) and the answers are encoded for every transaction;
+ * - replay/MODE: answers of a recorded session read from the capture file (@see serial_replay) and decoded,
+ *   one operation is the whole file, so recorded traffic of the field can be measured (Linux only).
+ *
+ * Results are printed as a JSON object with the CPU, compiler and selected kernels, so runs can be compared
+ * across commits and machines:
+ * @code
+ * {
+ *   "label": "", "cpu": "...", "compiler": "...", "crc_engine": "clmul", "hex_engine": "avx2", "min_time_ms": 20,
+ *   "results": [
+ *     { "name": "crc/table/256", "iterations": 1048576, "ns_per_op": 160.2, "ops_per_second": 6242197.3,
+ *       "bytes_per_second": 1598002496.0 },
+ *     ...
+ *   ]
+ * }
+ * @endcode
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "modbus/modbus_crc.h"
+#include "modbus/modbus_hex.h"
+#include "modbus/modbus_protocol.h"
+#include "modbus/modbus_protocol_rtu.h"
+#include "modbus/modbus_protocol_ascii.h"
+#include "servo/servo_driver.h"
+#include "sim/servo_sim.h"
+#if SERVO_BENCH_REPLAY
+#include "serial/serial_replay.h"
+#endif
+#if SERVO_BENCH_CXX
+#include "servo_bench_cxx.h"
+#endif
+
+#define BENCH_MIN_TIME_MS_DEFAULT    (20)
+#define BENCH_MESSAGE_SIZE           (256)
+#define BENCH_AXIS                   (1)
+#define BENCH_ADDRESS                (0x0000)
+
+/**@brief Benchmark function.
+ *
+ * @param[in] arg        Benchmark argument.
+ * @param[in] iterations Number of operations to perform.
+ *
+ * @retval true if all operations succeeded.
+ */
+typedef bool (*bench_function_t)(void * arg, uint64_t iterations);
+
+/**@brief Benchmark settings and output state. */
+typedef struct
+{
+    uint64_t min_time_ns;                               /**< Minimum measuring time of every benchmark. */
+    const char * filter;                                /**< Name filter (NULL - all benchmarks). */
+    FILE * output;                                      /**< Results output. */
+    uint32_t results;                                   /**< Number of printed results. */
+} bench_t;
+
+/**@brief In-memory bus: requests are served by the simulator or answered with the prepared answer. */
+typedef struct
+{
+    modbus_mode_t mode;                                 /**< Modbus mode. */
+    servo_sim_t * sim;                                  /**< Simulator serving the requests. */
+    bool prepared;                                      /**< Answer every request with the last answer of the simulator. */
+    uint8_t buffer[SERVO_SIM_FRAME_SIZE];               /**< Request frame storage. */
+    modbus_frame_t frame;                               /**< Request frame. */
+    uint8_t answer[SERVO_SIM_FRAME_SIZE];               /**< Encoded answer. */
+    uint16_t answer_length;                             /**< Length of the encoded answer. */
+    uint16_t answer_offset;                             /**< Bytes of the answer already read. */
+} loopback_t;
+
+/**@brief Servo operations. */
+typedef enum
+{
+    BENCH_OPERATION_READ,                               /**< servo_nwords_read(). */
+    BENCH_OPERATION_WRITE,                              /**< servo_nwords_write(). */
+    BENCH_OPERATION_WRITE_ONE                           /**< servo_oneword_write(). */
+} bench_operation_t;
+
+/**@brief Servo transaction benchmark. */
+typedef struct
+{
+    modbus_ctx_t ctx;                                   /**< Modbus context on the loopback bus. */
+    loopback_t loopback;                                /**< Loopback bus. */
+    bench_operation_t operation;                        /**< Performed operation. */
+    uint16_t words_num;                                 /**< Number of words. */
+    uint16_t words[SERVO_READ_WORDS_MAX];               /**< Read or written words. */
+} transaction_bench_t;
+
+/**@brief Message kernel benchmark. */
+typedef struct
+{
+    uint8_t bytes[BENCH_MESSAGE_SIZE];                  /**< Message. */
+    uint8_t chars[2 * BENCH_MESSAGE_SIZE];              /**< Hex characters of the message. */
+    uint16_t length;                                    /**< Message length in bytes. */
+    uint16_t crc;                                       /**< Result sink. */
+} kernel_bench_t;
+
+#if SERVO_BENCH_REPLAY
+/**@brief Capture file replay benchmark. */
+typedef struct
+{
+    serial_replay_t replay;                             /**< Replayed capture file. */
+    uint8_t buffer[SERVO_SIM_FRAME_SIZE];               /**< Answer frame storage. */
+    modbus_frame_t frame;                               /**< Answer frame. */
+    modbus_ascii_receiver_t receiver;                   /**< Answer receiver (ASCII mode). */
+    uint16_t length;                                    /**< Length of the answer collected so far (RTU mode). */
+    uint32_t rx_bytes;                                  /**< Answer bytes of the file. */
+    uint32_t answers;                                   /**< Result sink: decoded answers. */
+} replay_bench_t;
+#endif
+
+static const char * const crc_engine_names[] = { "table", "slice8", "slice16", "clmul" };
+static const char * const hex_engine_names[] = { "lut", "sse2", "avx2", "neon" };
+static const modbus_mode_t modes[] = { MODBUS_PROTOCOL_MODE_RTU, MODBUS_PROTOCOL_MODE_ASCII };
+static const char * const operation_names[] = { "read", "write", "write_one" };
+
+static bench_t bench;
+static servo_sim_t sim;
+static transaction_bench_t transaction_bench;
+static kernel_bench_t kernel_bench;
+#if SERVO_BENCH_REPLAY
+static replay_bench_t replay_bench;
+#endif
+
+/**@brief Get monotonic time in nanoseconds.
+ */
+static uint64_t time_ns(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**@brief Print string as a JSON string.
+ */
+static void json_string_print(FILE * output, const char * string)
+{
+    fputc('"', output);
+    for (; *string != '\0'; string++)
+    {
+        const unsigned char c = (unsigned char)*string;
+        if ((c == '"') || (c == '\\'))
+        {
+            fprintf(output, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(output, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, output);
+        }
+    }
+    fputc('"', output);
+}
+
+/**@brief Get CPU model name.
+ */
+static void cpu_name_get(char * name, size_t name_size)
+{
+    char line[256];
+    FILE * const cpuinfo = fopen("/proc/cpuinfo", "r");
+    
+    snprintf(name, name_size, "unknown");
+    if (cpuinfo == NULL)
+    {
+        return;
+    }
+    
+    while (fgets(line, sizeof(line), cpuinfo) != NULL)
+    {
+        const char * const colon = strchr(line, ':');
+        if ((colon != NULL) && (strncmp(line, "model name", 10) == 0))
+        {
+            snprintf(name, name_size, "%s", colon + 2);
+            name[strcspn(name, "\n")] = '\0';
+            break;
+        }
+    }
+    
+    fclose(cpuinfo);
+}
+
+/**@brief Measure benchmark and print the result. The number of iterations is raised until the measuring
+ *        takes at least the minimum time.
+ *
+ * @param[in] name     Benchmark name.
+ * @param[in] function Benchmark function.
+ * @param[in] arg      Benchmark argument.
+ * @param[in] bytes    Bytes processed by one operation (0 if not applicable).
+ *
+ * @retval true if the benchmark succeeded or is filtered out.
+ */
+static bool bench_run(const char * name, bench_function_t function, void * arg, uint32_t bytes)
+{
+    uint64_t iterations = 1;
+    uint64_t elapsed_ns;
+    
+    if ((bench.filter != NULL) && (strstr(name, bench.filter) == NULL))
+    {
+        return true;
+    }
+    
+    for (;;)
+    {
+        const uint64_t start_ns = time_ns();
+        if (!function(arg, iterations))
+        {
+            fprintf(stderr, "%s: operation failed\n", name);
+            return false;
+        }
+        elapsed_ns = time_ns() - start_ns;
+        
+        if (elapsed_ns >= bench.min_time_ns)
+        {
+            break;
+        }
+        
+        //Aim slightly above the minimum time to finish with the next measuring
+        iterations = (elapsed_ns < bench.min_time_ns / 16) ? iterations * 16 :
+                iterations * (bench.min_time_ns + bench.min_time_ns / 8) / elapsed_ns + 1;
+    }
+    
+    const double ns_per_op = (double)elapsed_ns / (double)iterations;
+    fprintf(bench.output, "%s    { \"name\": ", (bench.results != 0) ? ",\n" : "");
+    json_string_print(bench.output, name);
+    fprintf(bench.output, ", \"iterations\": %llu, \"ns_per_op\": %.1f, \"ops_per_second\": %.1f", 
+            (unsigned long long)iterations, ns_per_op, 1e9 / ns_per_op);
+    if (bytes != 0)
+    {
+        fprintf(bench.output, ", \"bytes_per_second\": %.1f", 1e9 * bytes / ns_per_op);
+    }
+    fprintf(bench.output, " }");
+    bench.results++;
+    
+    return true;
+}
+
+/**@brief Loopback write callback: the request is decoded and served by the simulator, or the prepared answer is kept.
+ */
+static modbus_callback_result_t loopback_write(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+{
+    loopback_t * const loopback = (loopback_t *)user_data;
+    const bool rtu = (loopback->mode == MODBUS_PROTOCOL_MODE_RTU);
+    uint16_t length;
+    
+    (void)timeout_ms;
+    
+    loopback->answer_offset = 0;
+    if (loopback->prepared)
+    {
+        return MODBUS_CALLBACK_RESULT_SUCCESS;
+    }
+    
+    const uint16_t offset = rtu ? MODBUS_FRAME_RTU_OFFSET : MODBUS_FRAME_ASCII_OFFSET;
+    if (offset + data_length > sizeof(loopback->buffer))
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    memcpy(&loopback->buffer[offset], data, data_length);
+    
+    modbus_frame_t * const frame = &loopback->frame;
+    const modbus_protocol_result_t result = rtu ? modbus_protocol_rtu_frame_decode(frame, data_length) :
+                                                  modbus_protocol_ascii_frame_decode(frame, data_length);
+    if (result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    frame->pdu_length = servo_sim_pdu_process(loopback->sim, MODBUS_FRAME_PDU(frame), frame->pdu_length);
+    loopback->answer_length = 0;
+    if (frame->pdu_length == 0)
+    {
+        //Broadcast request is not answered
+        return MODBUS_CALLBACK_RESULT_SUCCESS;
+    }
+    
+    const uint8_t * const adu = rtu ? modbus_protocol_rtu_frame_encode(frame, &length) :
+                                      modbus_protocol_ascii_frame_encode(frame, &length);
+    if (adu == NULL)
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    memcpy(loopback->answer, adu, length);
+    loopback->answer_length = length;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Loopback read callback: serves the answer to the last request.
+ */
+static modbus_callback_result_t loopback_read(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+{
+    loopback_t * const loopback = (loopback_t *)user_data;
+    
+    (void)timeout_ms;
+    
+    if (loopback->answer_length - loopback->answer_offset < data_length)
+    {
+        loopback->answer_offset = loopback->answer_length;
+        return MODBUS_CALLBACK_RESULT_TIMEOUT;
+    }
+    
+    memcpy(data, &loopback->answer[loopback->answer_offset], data_length);
+    loopback->answer_offset += data_length;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Loopback idle callback: frames are delimited by the callbacks, no silent interval is needed.
+ */
+static void loopback_idle(void * user_data, uint16_t data_length)
+{
+    (void)user_data;
+    (void)data_length;
+}
+
+/**@brief Initialize servo transaction benchmark on the loopback bus.
+ */
+static void transaction_bench_initialize(transaction_bench_t * transaction, modbus_mode_t mode)
+{
+    loopback_t * const loopback = &transaction->loopback;
+    const modbus_params_t modbus_params = 
+    {
+        .mode = mode,
+        .write = loopback_write,
+        .read = loopback_read,
+        .idle = loopback_idle,
+        .writev = NULL,
+        .receive = NULL,
+        .delay = NULL,
+        .clock = NULL,
+        .user_data = loopback,
+        .timeout_ms = MODBUS_PROTOCOL_BUS_TIMEOUT_MS,
+        .baud_rate = 0,
+        .retries = 0
+    };
+    
+    memset(loopback, 0, sizeof(*loopback));
+    loopback->mode = mode;
+    loopback->sim = &sim;
+    loopback->frame.buffer = loopback->buffer;
+    loopback->frame.size = sizeof(loopback->buffer);
+    
+    modbus_protocol_initialize(&transaction->ctx, &modbus_params);
+}
+
+/**@brief Servo transactions.
+ */
+static bool transaction_run(void * arg, uint64_t iterations)
+{
+    transaction_bench_t * const transaction = (transaction_bench_t *)arg;
+    
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        bool success;
+        switch (transaction->operation)
+        {
+            case BENCH_OPERATION_READ:
+                success = servo_nwords_read(&transaction->ctx, BENCH_AXIS, BENCH_ADDRESS, 
+                                            transaction->words, transaction->words_num);
+                break;
+                
+            case BENCH_OPERATION_WRITE:
+                success = servo_nwords_write(&transaction->ctx, BENCH_AXIS, BENCH_ADDRESS, 
+                                             transaction->words, transaction->words_num);
+                break;
+                
+            default:
+                success = servo_oneword_write(&transaction->ctx, BENCH_AXIS, BENCH_ADDRESS, transaction->words[0]);
+                break;
+        }
+        
+        if (!success)
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**@brief Measure servo transaction, either with the prepared answer or served by the simulator.
+ */
+static bool transaction_bench_run(const char * group, 
+                                  modbus_mode_t mode, 
+                                  bench_operation_t operation, 
+                                  uint16_t words_num, 
+                                  bool prepared)
+{
+    transaction_bench_t * const transaction = &transaction_bench;
+    char name[64];
+    
+    const char * const mode_name = (mode == MODBUS_PROTOCOL_MODE_RTU) ? "rtu" : "ascii";
+    snprintf(name, sizeof(name), "%s/%s/%s/%u", group, mode_name, operation_names[operation], (unsigned)words_num);
+    transaction->operation = operation;
+    transaction->words_num = words_num;
+    for (uint16_t i = 0; i < words_num; i++)
+    {
+        transaction->words[i] = (uint16_t)(0x1234 + i);
+    }
+    
+    //The answer is prepared by the simulator with the first transaction
+    transaction->loopback.prepared = false;
+    if (prepared && !transaction_run(transaction, 1))
+    {
+        fprintf(stderr, "%s: operation failed\n", name);
+        return false;
+    }
+    transaction->loopback.prepared = prepared;
+    
+    return bench_run(name, transaction_run, transaction, 0);
+}
+
+/**@brief CRC kernel.
+ */
+static bool crc_run(void * arg, uint64_t iterations)
+{
+    kernel_bench_t * const kernel = (kernel_bench_t *)arg;
+    uint16_t crc = 0;
+    
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        crc ^= modbus_crc_update(MODBUS_CRC_INITIAL, kernel->bytes, kernel->length);
+    }
+    kernel->crc = crc;
+    
+    return true;
+}
+
+/**@brief LRC kernel.
+ */
+static bool lrc_run(void * arg, uint64_t iterations)
+{
+    kernel_bench_t * const kernel = (kernel_bench_t *)arg;
+    uint8_t lrc = 0;
+    
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        lrc ^= modbus_protocol_ascii_lrc_calculate(kernel->bytes, kernel->length);
+    }
+    kernel->crc = lrc;
+    
+    return true;
+}
+
+/**@brief Hex encoding kernel.
+ */
+static bool hex_encode_run(void * arg, uint64_t iterations)
+{
+    kernel_bench_t * const kernel = (kernel_bench_t *)arg;
+    
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        modbus_hex_encode(kernel->chars, kernel->bytes, kernel->length);
+        kernel->bytes[0] = kernel->chars[i & 1];
+    }
+    
+    return true;
+}
+
+/**@brief Hex decoding kernel.
+ */
+static bool hex_decode_run(void * arg, uint64_t iterations)
+{
+    kernel_bench_t * const kernel = (kernel_bench_t *)arg;
+    
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        if (!modbus_hex_decode(kernel->bytes, kernel->chars, kernel->length))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**@brief Measure CRC and hex codec kernels with every supported engine and the LRC.
+ */
+static bool kernels_run(void)
+{
+    static const uint16_t lengths[] = { 8, 64, 256 };
+    kernel_bench_t * const kernel = &kernel_bench;
+    const modbus_crc_engine_t crc_engine = modbus_crc_engine_get();
+    const modbus_hex_engine_t hex_engine = modbus_hex_engine_get();
+    char name[64];
+    bool success = true;
+    
+    for (uint16_t i = 0; i < sizeof(kernel->bytes); i++)
+    {
+        kernel->bytes[i] = (uint8_t)(i * 167 + 13);
+    }
+    
+    for (uint8_t engine = 0; success && (engine < sizeof(crc_engine_names) / sizeof(crc_engine_names[0])); engine++)
+    {
+        if (!modbus_crc_engine_select((modbus_crc_engine_t)engine))
+        {
+            continue;
+        }
+        for (uint8_t i = 0; success && (i < sizeof(lengths) / sizeof(lengths[0])); i++)
+        {
+            kernel->length = lengths[i];
+            snprintf(name, sizeof(name), "crc/%s/%u", crc_engine_names[engine], (unsigned)lengths[i]);
+            success = bench_run(name, crc_run, kernel, lengths[i]);
+        }
+    }
+    modbus_crc_engine_select(crc_engine);
+    
+    for (uint8_t i = 0; success && (i < sizeof(lengths) / sizeof(lengths[0])); i++)
+    {
+        kernel->length = lengths[i];
+        snprintf(name, sizeof(name), "lrc/%u", (unsigned)lengths[i]);
+        success = bench_run(name, lrc_run, kernel, lengths[i]);
+    }
+    
+    for (uint8_t engine = 0; success && (engine < sizeof(hex_engine_names) / sizeof(hex_engine_names[0])); engine++)
+    {
+        if (!modbus_hex_engine_select((modbus_hex_engine_t)engine))
+        {
+            continue;
+        }
+        for (uint8_t i = 0; success && (i < sizeof(lengths) / sizeof(lengths[0])); i++)
+        {
+            kernel->length = lengths[i];
+            snprintf(name, sizeof(name), "hex/%s/encode/%u", hex_engine_names[engine], (unsigned)lengths[i]);
+            success = bench_run(name, hex_encode_run, kernel, lengths[i]);
+            
+            modbus_hex_encode(kernel->chars, kernel->bytes, kernel->length);
+            snprintf(name, sizeof(name), "hex/%s/decode/%u", hex_engine_names[engine], (unsigned)lengths[i]);
+            success = success && bench_run(name, hex_decode_run, kernel, lengths[i]);
+        }
+    }
+    modbus_hex_engine_select(hex_engine);
+    
+    return success;
+}
+
+/**@brief Measure servo frame handling for every word count and complete transactions, in both Modbus modes.
+ */
+static bool transactions_run(void)
+{
+    static const struct
+    {
+        bench_operation_t operation;
+        uint16_t words_num;
+    } transactions[] = 
+    {
+        { BENCH_OPERATION_READ,      1 }, 
+        { BENCH_OPERATION_READ,      SERVO_READ_WORDS_MAX }, 
+        { BENCH_OPERATION_WRITE_ONE, 1 }, 
+        { BENCH_OPERATION_WRITE,     SERVO_WRITE_WORDS_MAX }
+    };
+    const servo_sim_config_t config = { .mode = MODBUS_PROTOCOL_MODE_RTU, .seed = 1 };
+    bool success = true;
+    
+    servo_sim_initialize(&sim, &config);
+    servo_sim_axis_add(&sim, BENCH_AXIS);
+    
+    for (uint8_t m = 0; success && (m < sizeof(modes) / sizeof(modes[0])); m++)
+    {
+        const modbus_mode_t mode = modes[m];
+        transaction_bench_initialize(&transaction_bench, mode);
+        
+        for (uint16_t words_num = 1; success && (words_num <= SERVO_READ_WORDS_MAX); words_num++)
+        {
+            success = transaction_bench_run("frame", mode, BENCH_OPERATION_READ, words_num, true);
+        }
+        for (uint16_t words_num = 1; success && (words_num <= SERVO_WRITE_WORDS_MAX); words_num++)
+        {
+            success = transaction_bench_run("frame", mode, BENCH_OPERATION_WRITE, words_num, true);
+        }
+        
+        for (uint8_t i = 0; success && (i < sizeof(transactions) / sizeof(transactions[0])); i++)
+        {
+            success = transaction_bench_run("transaction", mode, transactions[i].operation, 
+                                            transactions[i].words_num, false);
+        }
+    }
+    
+#if SERVO_BENCH_CXX
+    size_t cxx_count = 0;
+    const servo_bench_cxx_t * const cxx = success ? servo_bench_cxx_get(&sim, BENCH_AXIS, &cxx_count) : NULL;
+    if (success && (cxx == NULL))
+    {
+        fprintf(stderr, "frame_cxx: operation failed\n");
+        success = false;
+    }
+    for (size_t i = 0; success && (i < cxx_count); i++)
+    {
+        success = bench_run(cxx[i].name, cxx[i].function, cxx[i].arg, 0);
+    }
+#endif
+    
+    return success;
+}
+
+#if SERVO_BENCH_REPLAY
+/**@brief Decode the answer collected from the RTU answer records, if any.
+ */
+static void replay_answer_decode(replay_bench_t * replay)
+{
+    if ((replay->length != 0) && 
+        (modbus_protocol_rtu_frame_decode(&replay->frame, replay->length) == MODBUS_PROTOCOL_RESULT_SUCCESS))
+    {
+        replay->answers++;
+    }
+    replay->length = 0;
+}
+
+/**@brief Capture file replay: the answer records are collected and decoded, a request record ends the answer.
+ */
+static bool replay_run(void * arg, uint64_t iterations)
+{
+    replay_bench_t * const replay = (replay_bench_t *)arg;
+    const bool rtu = (replay->replay.mode == MODBUS_PROTOCOL_MODE_RTU);
+    modbus_capture_record_t record;
+    const uint8_t * data;
+    uint16_t consumed;
+    
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        serial_replay_rewind(&replay->replay);
+        modbus_protocol_ascii_receiver_reset(&replay->receiver);
+        replay->length = 0;
+        
+        while (serial_replay_record_next(&replay->replay, &record, &data))
+        {
+            if (record.type != MODBUS_CAPTURE_RX)
+            {
+                if (rtu && (record.type == MODBUS_CAPTURE_TX))
+                {
+                    replay_answer_decode(replay);
+                }
+                continue;
+            }
+            
+            if (rtu)
+            {
+                //Answer longer than the frame storage is cut and fails to decode
+                const uint16_t space = (uint16_t)(sizeof(replay->buffer) - MODBUS_FRAME_RTU_OFFSET - replay->length);
+                const uint16_t length = (record.length < space) ? record.length : space;
+                memcpy(&replay->buffer[MODBUS_FRAME_RTU_OFFSET + replay->length], data, length);
+                replay->length += length;
+                continue;
+            }
+            
+            for (uint16_t offset = 0; offset < record.length; offset += consumed)
+            {
+                const modbus_ascii_receiver_status_t status = 
+                        modbus_protocol_ascii_receiver_feed(&replay->receiver, &data[offset], record.length - offset, &consumed);
+                if (status == MODBUS_ASCII_RECEIVER_STATUS_COMPLETE)
+                {
+                    replay->answers++;
+                }
+            }
+        }
+        
+        if (rtu)
+        {
+            replay_answer_decode(replay);
+        }
+    }
+    
+    return true;
+}
+
+/**@brief Measure capture file replay.
+ */
+static bool replay_bench_run(const char * path)
+{
+    replay_bench_t * const replay = &replay_bench;
+    modbus_capture_record_t record;
+    const uint8_t * data;
+    char name[64];
+    
+    if (!serial_replay_open(&replay->replay, path, SERIAL_REPLAY_FAST))
+    {
+        perror(path);
+        return false;
+    }
+    
+    replay->frame.buffer = replay->buffer;
+    replay->frame.size = sizeof(replay->buffer);
+    modbus_protocol_ascii_receiver_initialize(&replay->receiver, &replay->frame, false);
+    replay->rx_bytes = 0;
+    while (serial_replay_record_next(&replay->replay, &record, &data))
+    {
+        replay->rx_bytes += (record.type == MODBUS_CAPTURE_RX) ? record.length : 0;
+    }
+    
+    const char * const mode_name = (replay->replay.mode == MODBUS_PROTOCOL_MODE_RTU) ? "rtu" : "ascii";
+    snprintf(name, sizeof(name), "replay/%s", mode_name);
+    const bool success = bench_run(name, replay_run, replay, replay->rx_bytes);
+    
+    serial_replay_close(&replay->replay);
+    
+    return success;
+}
+#endif
+
+static void usage_print(const char * program)
+{
+    fprintf(stderr, "Usage: %s [-t MIN_TIME_MS] [-f FILTER] [-l LABEL] [-o OUTPUT] [-c CAPTURE]\n", program);
+}
+
+int main(int argc, char * argv[])
+{
+    static const struct option options[] = 
+    {
+        { "time",    required_argument, NULL, 't' }, 
+        { "filter",  required_argument, NULL, 'f' }, 
+        { "label",   required_argument, NULL, 'l' }, 
+        { "output",  required_argument, NULL, 'o' }, 
+        { "capture", required_argument, NULL, 'c' }, 
+        { NULL,      0,                 NULL, 0   }
+    };
+    unsigned long min_time_ms = BENCH_MIN_TIME_MS_DEFAULT;
+    const char * label = "";
+    const char * output = NULL;
+    const char * capture = NULL;
+    char cpu_name[128];
+    int option;
+    
+    while ((option = getopt_long(argc, argv, "t:f:l:o:c:", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 't':
+                min_time_ms = strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'f':
+                bench.filter = optarg;
+                break;
+                
+            case 'l':
+                label = optarg;
+                break;
+                
+            case 'o':
+                output = optarg;
+                break;
+                
+            case 'c':
+                capture = optarg;
+                break;
+                
+            default:
+                usage_print(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    
+#if !SERVO_BENCH_REPLAY
+    if (capture != NULL)
+    {
+        fprintf(stderr, "%s: capture file replay is not supported\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+#endif
+    
+    if (min_time_ms == 0)
+    {
+        usage_print(argv[0]);
+        return EXIT_FAILURE;
+    }
+    bench.min_time_ns = (uint64_t)min_time_ms * 1000000ULL;
+    
+    bench.output = (output != NULL) ? fopen(output, "w") : stdout;
+    if (bench.output == NULL)
+    {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+    
+    modbus_crc_initialize();
+    modbus_hex_initialize();
+    cpu_name_get(cpu_name, sizeof(cpu_name));
+    
+    fprintf(bench.output, "{\n    \"label\": ");
+    json_string_print(bench.output, label);
+    fprintf(bench.output, ",\n    \"cpu\": ");
+    json_string_print(bench.output, cpu_name);
+    fprintf(bench.output, ",\n    \"compiler\": ");
+#if defined(__VERSION__)
+    json_string_print(bench.output, __VERSION__);
+#else
+    json_string_print(bench.output, "unknown");
+#endif
+    fprintf(bench.output, ",\n    \"crc_engine\": \"%s\",\n    \"hex_engine\": \"%s\",\n    \"min_time_ms\": %lu,\n", 
+            crc_engine_names[modbus_crc_engine_get()], hex_engine_names[modbus_hex_engine_get()], min_time_ms);
+    fprintf(bench.output, "    \"results\": [\n");
+    
+    bool success = kernels_run() && transactions_run();
+#if SERVO_BENCH_REPLAY
+    success = success && ((capture == NULL) || replay_bench_run(capture));
+#endif
+    
+    fprintf(bench.output, "\n    ]\n}\n");
+    if ((bench.output != stdout) && (fclose(bench.output) != 0))
+    {
+        perror(output);
+        return EXIT_FAILURE;
+    }
+    
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,207 @@
+/**
+ * @ingroup servo_bench
+ *
+ * @brief Benchmarks of the C++ codecs: the word counts are template parameters, every benchmark is
+ * a separate instantiation of the codec with its own loopback bus.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "servo_bench_cxx.h"
+#include "modbus/modbus.hpp"
+
+namespace
+{
+
+constexpr uint16_t bench_address = 0x0000;
+constexpr std::size_t benches_num = 18;
+
+/**@brief Servo operations. */
+enum class operation
+{
+    read,                                               /**< Read Holding Registers (0x03). */
+    write,                                              /**< Write Multiple Registers (0x10). */
+    write_one                                           /**< Write Single Register (0x06). */
+};
+
+/**@brief In-memory bus: the request is served by the simulator once, then answered with the prepared answer. */
+struct loopback
+{
+    modbus_mode_t mode;                                 /**< Modbus mode. */
+    servo_sim_t * sim;                                  /**< Simulator serving the requests. */
+    bool prepared;                                      /**< Answer every request with the prepared answer. */
+    uint8_t buffer[SERVO_SIM_FRAME_SIZE];               /**< Request frame storage. */
+    modbus_frame_t frame;                               /**< Request frame. */
+    uint8_t answer[SERVO_SIM_FRAME_SIZE];               /**< Encoded answer. */
+    std::size_t answer_length;                          /**< Length of the encoded answer. */
+    std::size_t answer_offset;                          /**< Bytes of the answer already read. */
+};
+
+/**@brief Transport policy over the loopback bus. */
+struct loopback_transport
+{
+    loopback * bus;                                     /**< Loopback bus. */
+    
+    modbus_callback_result_t write(const uint8_t * data, std::size_t length)
+    {
+        bus->answer_offset = 0;
+        if (bus->prepared)
+        {
+            return MODBUS_CALLBACK_RESULT_SUCCESS;
+        }
+        
+        //Requests of the C++ codecs are checked by the C frame decoder
+        const bool rtu = (bus->mode == MODBUS_PROTOCOL_MODE_RTU);
+        const std::size_t offset = rtu ? MODBUS_FRAME_RTU_OFFSET : MODBUS_FRAME_ASCII_OFFSET;
+        uint16_t answer_length;
+        
+        if (offset + length > sizeof(bus->buffer))
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+        std::memcpy(&bus->buffer[offset], data, length);
+        
+        modbus_frame_t * const frame = &bus->frame;
+        frame->buffer = bus->buffer;
+        frame->size = sizeof(bus->buffer);
+        const modbus_protocol_result_t result = rtu ? modbus_protocol_rtu_frame_decode(frame, (uint16_t)length) :
+                                                      modbus_protocol_ascii_frame_decode(frame, (uint16_t)length);
+        if (result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+        
+        frame->pdu_length = servo_sim_pdu_process(bus->sim, MODBUS_FRAME_PDU(frame), frame->pdu_length);
+        const uint8_t * const adu = (frame->pdu_length == 0) ? nullptr :
+                                    rtu ? modbus_protocol_rtu_frame_encode(frame, &answer_length) :
+                                          modbus_protocol_ascii_frame_encode(frame, &answer_length);
+        if (adu == nullptr)
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+        std::memcpy(bus->answer, adu, answer_length);
+        bus->answer_length = answer_length;
+        
+        return MODBUS_CALLBACK_RESULT_SUCCESS;
+    }
+    
+    modbus_callback_result_t read(uint8_t * data, std::size_t length)
+    {
+        if (bus->answer_length - bus->answer_offset < length)
+        {
+            bus->answer_offset = bus->answer_length;
+            return MODBUS_CALLBACK_RESULT_TIMEOUT;
+        }
+        
+        std::memcpy(data, &bus->answer[bus->answer_offset], length);
+        bus->answer_offset += length;
+        
+        return MODBUS_CALLBACK_RESULT_SUCCESS;
+    }
+    
+    void idle(std::size_t)
+    {
+    }
+};
+
+/**@brief Benchmark of the operation on Count words. */
+template <modbus_mode_t Mode, operation Operation, uint16_t Count>
+struct bench
+{
+    static inline loopback bus;
+    static inline uint8_t axis;
+    static inline std::array<uint16_t, Count> words;
+    
+    static bool run(void *, uint64_t iterations)
+    {
+        modbus::client<Mode, loopback_transport> client{ loopback_transport{ &bus } };
+        
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            modbus_protocol_result_t result;
+            if constexpr (Operation == operation::read)
+            {
+                result = client.read_registers(axis, bench_address, words);
+            }
+            else if constexpr (Operation == operation::write)
+            {
+                result = client.write_registers(axis, bench_address, words);
+            }
+            else
+            {
+                result = client.write_register(axis, bench_address, words[0]);
+            }
+            
+            if (result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+};
+
+servo_bench_cxx_t benches[benches_num];
+std::size_t benches_count;
+
+/**@brief Prepare the answer of the benchmark with the first transaction and add it. */
+template <modbus_mode_t Mode, operation Operation, uint16_t Count>
+bool bench_add(servo_sim_t * sim, uint8_t axis)
+{
+    using bench_type = bench<Mode, Operation, Count>;
+    static const char * const operation_names[] = { "read", "write", "write_one" };
+    
+    bench_type::bus.mode = Mode;
+    bench_type::bus.sim = sim;
+    bench_type::bus.prepared = false;
+    bench_type::axis = axis;
+    for (uint16_t i = 0; i < Count; i++)
+    {
+        bench_type::words[i] = (uint16_t)(0x1234 + i);
+    }
+    
+    if ((benches_count == benches_num) || !bench_type::run(nullptr, 1))
+    {
+        return false;
+    }
+    bench_type::bus.prepared = true;
+    
+    servo_bench_cxx_t & entry = benches[benches_count++];
+    std::snprintf(entry.name, sizeof(entry.name), "frame_cxx/%s/%s/%u", 
+                  (Mode == MODBUS_PROTOCOL_MODE_RTU) ? "rtu" : "ascii", operation_names[(int)Operation], (unsigned)Count);
+    entry.function = bench_type::run;
+    entry.arg = nullptr;
+    
+    return true;
+}
+
+/**@brief Add the benchmarks of the mode. */
+template <modbus_mode_t Mode>
+bool mode_benches_add(servo_sim_t * sim, uint8_t axis)
+{
+    return bench_add<Mode, operation::read, 1>(sim, axis) && 
+           bench_add<Mode, operation::read, 16>(sim, axis) && 
+           bench_add<Mode, operation::read, 64>(sim, axis) && 
+           bench_add<Mode, operation::read, 125>(sim, axis) && 
+           bench_add<Mode, operation::write_one, 1>(sim, axis) && 
+           bench_add<Mode, operation::write, 1>(sim, axis) && 
+           bench_add<Mode, operation::write, 16>(sim, axis) && 
+           bench_add<Mode, operation::write, 64>(sim, axis) && 
+           bench_add<Mode, operation::write, 123>(sim, axis);
+}
+
+} //namespace
+
+const servo_bench_cxx_t * servo_bench_cxx_get(servo_sim_t * sim, uint8_t axis, size_t * count)
+{
+    benches_count = 0;
+    if (!mode_benches_add<MODBUS_PROTOCOL_MODE_RTU>(sim, axis) || !mode_benches_add<MODBUS_PROTOCOL_MODE_ASCII>(sim, axis))
+    {
+        return nullptr;
+    }
+    
+    *count = benches_count;
+    
+    return benches;
+}
@@ -0,0 +1,50 @@
+/**
+ * @ingroup servo_bench
+ *
+ * @brief Benchmarks of the C++ codecs (@see modbus_cxx), built when a C++17 compiler is available.
+ *
+ * - frame_cxx/MODE/read|write|write_one/WORDS: the transactions of the frame benchmarks performed by
+ *   modbus::client over the same prepared answers, so both layers are measured on identical frames.
+ *
+ * @{
+ */
+
+#ifndef _SERVO_BENCH_CXX_H_
+#define _SERVO_BENCH_CXX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "sim/servo_sim.h"
+
+/**@brief C++ benchmark. */
+typedef struct
+{
+    char name[48];                                      /**< Benchmark name. */
+    bool (*function)(void * arg, uint64_t iterations);  /**< Benchmark function, @see bench_function_t. */
+    void * arg;                                         /**< Benchmark argument. */
+} servo_bench_cxx_t;
+
+/**@brief Prepare C++ benchmarks. The answers are prepared by the simulator from the requests built by
+ *        the C++ codecs, decoded and encoded by the C frame codecs.
+ *
+ * @param[in]  sim   Pointer to the simulator with the benchmark servo.
+ * @param[in]  axis  Communication address of the benchmark servo.
+ * @param[out] count Number of benchmarks.
+ *
+ * @return Benchmarks, NULL if the C++ and C codecs disagree.
+ */
+const servo_bench_cxx_t * servo_bench_cxx_get(servo_sim_t * sim, uint8_t axis, size_t * count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/** @} */
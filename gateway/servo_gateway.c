@@ -0,0 +1,648 @@
+#include "servo_gateway.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define GATEWAY_POLL_PERIOD_MS    (100)   /**< Longest wait, the running flag is checked this often. */
+#define GATEWAY_LISTEN_BACKLOG    (8)
+
+/**@brief Check if the request is a read which may be shared with other clients.
+ */
+static bool request_shareable(const uint8_t * pdu, uint16_t pdu_length)
+{
+    return (pdu_length == SERVO_GATEWAY_KEY_SIZE) && (pdu[0] != MODBUS_ADDRESS_BROADCAST) && 
+           (pdu[1] >= 0x01) && (pdu[1] <= 0x04);
+}
+
+/**@brief Get expected answer PDU length, the largest one for unknown functions.
+ */
+static uint16_t answer_length(const uint8_t * pdu, uint16_t pdu_length)
+{
+    const uint16_t quantity = (pdu_length >= 6) ? (uint16_t)((pdu[4] << 8) | pdu[5]) : 0;
+    uint32_t length;
+    
+    switch (pdu[1])
+    {
+        case 0x01:
+        case 0x02:
+            length = 3 + (quantity + 7) / 8;
+            break;
+            
+        case 0x03:
+        case 0x04:
+        case 0x17:
+            length = 3 + 2 * (uint32_t)quantity;
+            break;
+            
+        case 0x05:
+        case 0x06:
+        case 0x0F:
+        case 0x10:
+            length = 6;
+            break;
+            
+        default:
+            length = MODBUS_PDU_LENGTH_MAX;
+            break;
+    }
+    
+    //Quantity out of range is answered with an exception
+    return (length > MODBUS_PDU_LENGTH_MAX) ? MODBUS_PDU_LENGTH_MAX : (uint16_t)length;
+}
+
+/**@brief Queue answer to the client, the answer PDU is stored in the frame.
+ */
+static void answer_send(servo_gateway_client_t * client, modbus_frame_t * frame, uint16_t transaction_id)
+{
+    uint16_t length;
+    
+    //Room for the answers of all pending requests is reserved before a request is accepted
+    const uint8_t * adu = modbus_protocol_tcp_frame_encode(frame, transaction_id, &length);
+    if ((adu != NULL) && (client->output_length + length <= sizeof(client->output)))
+    {
+        memcpy(&client->output[client->output_length], adu, length);
+        client->output_length += length;
+    }
+}
+
+/**@brief Queue exception answer to the client, the answer PDU is built in the frame.
+ */
+static void exception_send(servo_gateway_t * gateway, 
+                           servo_gateway_client_t * client, 
+                           modbus_frame_t * frame, 
+                           uint8_t address, 
+                           uint8_t function, 
+                           modbus_exception_t exception, 
+                           uint16_t transaction_id)
+{
+    uint8_t * const pdu = MODBUS_FRAME_PDU(frame);
+    
+    pdu[0] = address;
+    pdu[1] = function | 0x80;
+    pdu[2] = (uint8_t)exception;
+    frame->pdu_length = 3;
+    
+    gateway->stats.failures++;
+    answer_send(client, frame, transaction_id);
+}
+
+/**@brief Find fresh cached answer to the read.
+ */
+static const servo_gateway_cache_entry_t * cache_find(const servo_gateway_t * gateway, const uint8_t * key, uint32_t now_us)
+{
+    const uint32_t ttl_us = gateway->config.cache_ttl_ms * 1000;
+    
+    for (uint8_t i = 0; i < SERVO_GATEWAY_CACHE_NUM; i++)
+    {
+        const servo_gateway_cache_entry_t * const entry = &gateway->cache[i];
+        if (entry->valid && (memcmp(entry->key, key, SERVO_GATEWAY_KEY_SIZE) == 0))
+        {
+            return ((uint32_t)(now_us - entry->stored_us) < ttl_us) ? entry : NULL;
+        }
+    }
+    
+    return NULL;
+}
+
+/**@brief Store answer to the read, replacing the previous answer to the same read, a free entry or the oldest one.
+ */
+static void cache_store(servo_gateway_t * gateway, 
+                        const uint8_t * key, 
+                        const uint8_t * pdu, 
+                        uint16_t pdu_length, 
+                        uint32_t now_us)
+{
+    servo_gateway_cache_entry_t * entry = NULL;
+    uint32_t oldest_age_us = 0;
+    
+    for (uint8_t i = 0; i < SERVO_GATEWAY_CACHE_NUM; i++)
+    {
+        servo_gateway_cache_entry_t * const candidate = &gateway->cache[i];
+        if (candidate->valid && (memcmp(candidate->key, key, SERVO_GATEWAY_KEY_SIZE) == 0))
+        {
+            entry = candidate;
+            break;
+        }
+        
+        const uint32_t age_us = candidate->valid ? now_us - candidate->stored_us : UINT32_MAX;
+        if ((entry == NULL) || (age_us > oldest_age_us))
+        {
+            entry = candidate;
+            oldest_age_us = age_us;
+        }
+    }
+    
+    memcpy(entry->key, key, SERVO_GATEWAY_KEY_SIZE);
+    memcpy(entry->pdu, pdu, pdu_length);
+    entry->pdu_length = pdu_length;
+    entry->stored_us = now_us;
+    entry->valid = true;
+}
+
+/**@brief Drop cached answers of the server and stop sharing of its queued reads (all servers for broadcast).
+ */
+static void server_invalidate(servo_gateway_t * gateway, uint8_t address)
+{
+    const bool broadcast = (address == MODBUS_ADDRESS_BROADCAST);
+    
+    for (uint8_t i = 0; i < SERVO_GATEWAY_CACHE_NUM; i++)
+    {
+        if (broadcast || (gateway->cache[i].key[0] == address))
+        {
+            gateway->cache[i].valid = false;
+        }
+    }
+    
+    for (uint8_t i = 0; i < SERVO_GATEWAY_REQUESTS_NUM; i++)
+    {
+        servo_gateway_request_t * const request = &gateway->requests[i];
+        if (request->queued && (broadcast || (request->key[0] == address)))
+        {
+            request->shared = false;
+        }
+    }
+}
+
+/**@brief Find queued read identical to the request.
+ */
+static servo_gateway_request_t * request_find(servo_gateway_t * gateway, const uint8_t * key)
+{
+    for (uint8_t i = 0; i < SERVO_GATEWAY_REQUESTS_NUM; i++)
+    {
+        servo_gateway_request_t * const request = &gateway->requests[i];
+        if (request->queued && request->shared && (memcmp(request->key, key, SERVO_GATEWAY_KEY_SIZE) == 0))
+        {
+            return request;
+        }
+    }
+    
+    return NULL;
+}
+
+/**@brief Bus transaction completion, answers all waiting client requests.
+ */
+static void request_complete(modbus_transaction_t * transaction, modbus_protocol_result_t result)
+{
+    servo_gateway_request_t * const request = (servo_gateway_request_t *)transaction->user_data;
+    servo_gateway_t * const gateway = request->gateway;
+    modbus_frame_t * const frame = &transaction->frame;
+    const uint8_t * pdu = MODBUS_FRAME_PDU(frame);
+    
+    bool answered = (result == MODBUS_PROTOCOL_RESULT_SUCCESS) || (result == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+    if (answered && ((pdu[1] & 0x7F) != request->key[1]))
+    {
+        answered = false;
+    }
+    
+    //Reads sharing is stopped by later requests to the server, their answers may be outdated
+    if (answered && (result == MODBUS_PROTOCOL_RESULT_SUCCESS) && request->shared && (gateway->config.cache_ttl_ms != 0))
+    {
+        cache_store(gateway, request->key, pdu, frame->pdu_length, gateway->ctx->clock(gateway->ctx->user_data));
+    }
+    
+    servo_gateway_waiter_t * waiter = request->waiters;
+    while (waiter != NULL)
+    {
+        servo_gateway_waiter_t * const next = waiter->next;
+        servo_gateway_client_t * const client = waiter->client;
+        
+        if (client != NULL)
+        {
+            if (answered)
+            {
+                answer_send(client, frame, waiter->transaction_id);
+            }
+            else
+            {
+                exception_send(gateway, client, frame, request->key[0], request->key[1], 
+                               MODBUS_EXCEPTION_GATEWAY_TARGET_FAILED, waiter->transaction_id);
+            }
+            client->pending--;
+        }
+        
+        waiter->client = NULL;
+        waiter->next = gateway->free_waiters;
+        gateway->free_waiters = waiter;
+        waiter = next;
+    }
+    
+    request->waiters = NULL;
+    request->queued = false;
+    request->next = gateway->free_requests;
+    gateway->free_requests = request;
+}
+
+/**@brief Queue the request onto the bus.
+ *
+ * @return Pointer to the queued request, NULL if there is no free slot.
+ */
+static servo_gateway_request_t * request_submit(servo_gateway_t * gateway, const modbus_frame_t * frame, bool shareable)
+{
+    const uint8_t * pdu = MODBUS_FRAME_PDU(frame);
+    servo_gateway_request_t * const request = gateway->free_requests;
+    
+    if (request == NULL)
+    {
+        return NULL;
+    }
+    
+    modbus_transaction_t * const transaction = &request->transaction;
+    transaction->frame.buffer = request->buffer;
+    transaction->frame.size = sizeof(request->buffer);
+    transaction->frame.pdu_length = frame->pdu_length;
+    transaction->answer_length = answer_length(pdu, frame->pdu_length);
+    transaction->complete = request_complete;
+    transaction->user_data = request;
+    memcpy(MODBUS_FRAME_PDU(&transaction->frame), pdu, frame->pdu_length);
+    
+    if (!modbus_async_submit(&gateway->async, transaction))
+    {
+        return NULL;
+    }
+    
+    gateway->free_requests = request->next;
+    memcpy(request->key, pdu, shareable ? SERVO_GATEWAY_KEY_SIZE : 2);
+    request->shared = shareable;
+    request->queued = true;
+    request->waiters = NULL;
+    gateway->stats.bus_requests++;
+    
+    return request;
+}
+
+/**@brief Check if the client may send one more request: it is below the pending requests limit
+ *        and its output has room for the answers of all pending requests.
+ */
+static bool client_ready(const servo_gateway_client_t * client)
+{
+    return ((size_t)client->output_length + (size_t)(client->pending + 1) * SERVO_GATEWAY_ADU_SIZE <= sizeof(client->output));
+}
+
+/**@brief Close client connection, answers to its pending requests are dropped.
+ */
+static void client_close(servo_gateway_t * gateway, servo_gateway_client_t * client)
+{
+    for (uint16_t i = 0; i < SERVO_GATEWAY_CLIENTS_NUM * SERVO_GATEWAY_PENDING_MAX; i++)
+    {
+        if (gateway->waiters[i].client == client)
+        {
+            gateway->waiters[i].client = NULL;
+        }
+    }
+    
+    close(client->fd);
+    client->fd = -1;
+}
+
+/**@brief Feed received bytes of the client to its receiver while it may send requests.
+ */
+static void client_process(servo_gateway_t * gateway, servo_gateway_client_t * client, uint32_t now_us)
+{
+    while ((client->input_offset < client->input_length) && client_ready(client))
+    {
+        uint16_t consumed;
+        const modbus_tcp_receiver_status_t status = 
+                modbus_protocol_tcp_receiver_feed(&client->receiver, 
+                                                  &client->input[client->input_offset], 
+                                                  client->input_length - client->input_offset, 
+                                                  &consumed);
+        client->input_offset += consumed;
+        
+        switch (status)
+        {
+            case MODBUS_TCP_RECEIVER_STATUS_HEADER:
+                modbus_protocol_tcp_receiver_accept(&client->receiver, &client->frame);
+                break;
+                
+            case MODBUS_TCP_RECEIVER_STATUS_COMPLETE:
+                servo_gateway_request_handle(gateway, client, &client->frame, 
+                                             modbus_protocol_tcp_receiver_id(&client->receiver), now_us);
+                break;
+                
+            case MODBUS_TCP_RECEIVER_STATUS_CORRUPTED:
+                //Stream is out of sync, the client reconnects
+                client_close(gateway, client);
+                return;
+                
+            default:
+                break;
+        }
+    }
+}
+
+/**@brief Receive bytes from the client.
+ */
+static void client_receive(servo_gateway_t * gateway, servo_gateway_client_t * client, uint32_t now_us)
+{
+    if (client->input_offset == client->input_length)
+    {
+        const ssize_t result = recv(client->fd, client->input, sizeof(client->input), 0);
+        if ((result < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+        {
+            return;
+        }
+        if (result <= 0)
+        {
+            client_close(gateway, client);
+            return;
+        }
+        
+        client->input_offset = 0;
+        client->input_length = (uint16_t)result;
+    }
+    
+    client_process(gateway, client, now_us);
+}
+
+/**@brief Send queued answers to the client.
+ */
+static void client_send(servo_gateway_t * gateway, servo_gateway_client_t * client)
+{
+    //Closed connection is reported as an error instead of SIGPIPE
+    const ssize_t result = send(client->fd, client->output, client->output_length, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (result < 0)
+    {
+        if ((errno != EAGAIN) && (errno != EINTR))
+        {
+            client_close(gateway, client);
+        }
+        return;
+    }
+    
+    client->output_length -= (uint16_t)result;
+    memmove(client->output, &client->output[result], client->output_length);
+}
+
+/**@brief Accept pending connection.
+ */
+static void client_accept(servo_gateway_t * gateway, int listen_fd)
+{
+    const int enable = 1;
+    
+    const int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+    
+    //Answers are small, they must not wait for more data to fill a segment
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    servo_gateway_client_add(gateway, fd);
+}
+
+void servo_gateway_initialize(servo_gateway_t * gateway, modbus_ctx_t * ctx, const servo_gateway_config_t * config)
+{
+    memset(gateway, 0, sizeof(*gateway));
+    gateway->config = *config;
+    gateway->ctx = ctx;
+    modbus_async_initialize(&gateway->async, ctx);
+    
+    for (uint8_t i = 0; i < SERVO_GATEWAY_CLIENTS_NUM; i++)
+    {
+        gateway->clients[i].fd = -1;
+    }
+    
+    for (uint16_t i = 0; i < SERVO_GATEWAY_CLIENTS_NUM * SERVO_GATEWAY_PENDING_MAX; i++)
+    {
+        gateway->waiters[i].next = gateway->free_waiters;
+        gateway->free_waiters = &gateway->waiters[i];
+    }
+    
+    for (uint8_t i = 0; i < SERVO_GATEWAY_REQUESTS_NUM; i++)
+    {
+        gateway->requests[i].gateway = gateway;
+        gateway->requests[i].next = gateway->free_requests;
+        gateway->free_requests = &gateway->requests[i];
+    }
+}
+
+bool servo_gateway_client_add(servo_gateway_t * gateway, int fd)
+{
+    for (uint8_t i = 0; i < SERVO_GATEWAY_CLIENTS_NUM; i++)
+    {
+        servo_gateway_client_t * const client = &gateway->clients[i];
+        if (client->fd >= 0)
+        {
+            continue;
+        }
+        
+        client->fd = fd;
+        client->frame.buffer = client->buffer;
+        client->frame.size = sizeof(client->buffer);
+        client->frame.pdu_length = 0;
+        client->input_offset = 0;
+        client->input_length = 0;
+        client->output_length = 0;
+        client->pending = 0;
+        modbus_protocol_tcp_receiver_initialize(&client->receiver);
+        gateway->stats.clients++;
+        
+        return true;
+    }
+    
+    close(fd);
+    
+    return false;
+}
+
+void servo_gateway_request_handle(servo_gateway_t * gateway, 
+                                  servo_gateway_client_t * client, 
+                                  modbus_frame_t * frame, 
+                                  uint16_t transaction_id, 
+                                  uint32_t now_us)
+{
+    uint8_t * const pdu = MODBUS_FRAME_PDU(frame);
+    const uint8_t address = pdu[0];
+    const uint8_t function = pdu[1];
+    
+    gateway->stats.requests++;
+    
+    if (address > SERVO_GATEWAY_ADDRESS_MAX)
+    {
+        exception_send(gateway, client, frame, address, function, MODBUS_EXCEPTION_GATEWAY_PATH_UNAVAILABLE, transaction_id);
+        return;
+    }
+    
+    const bool shareable = request_shareable(pdu, frame->pdu_length);
+    if (shareable)
+    {
+        const servo_gateway_cache_entry_t * const entry = cache_find(gateway, pdu, now_us);
+        if (entry != NULL)
+        {
+            memcpy(pdu, entry->pdu, entry->pdu_length);
+            frame->pdu_length = entry->pdu_length;
+            gateway->stats.cache_hits++;
+            answer_send(client, frame, transaction_id);
+            return;
+        }
+    }
+    else
+    {
+        //Values changed by the request must not be served from the answers to the earlier reads
+        server_invalidate(gateway, address);
+    }
+    
+    //Broadcast request is not answered
+    const bool answer = (address != MODBUS_ADDRESS_BROADCAST);
+    if (answer && ((gateway->free_waiters == NULL) || !client_ready(client)))
+    {
+        exception_send(gateway, client, frame, address, function, MODBUS_EXCEPTION_SERVER_DEVICE_BUSY, transaction_id);
+        return;
+    }
+    
+    servo_gateway_request_t * request = (shareable && !gateway->config.no_deduplicate) ? request_find(gateway, pdu) : NULL;
+    if (request != NULL)
+    {
+        gateway->stats.deduplicated++;
+    }
+    else
+    {
+        request = request_submit(gateway, frame, shareable);
+        if (request == NULL)
+        {
+            if (answer)
+            {
+                exception_send(gateway, client, frame, address, function, MODBUS_EXCEPTION_SERVER_DEVICE_BUSY, transaction_id);
+            }
+            return;
+        }
+    }
+    
+    if (answer)
+    {
+        servo_gateway_waiter_t * const waiter = gateway->free_waiters;
+        gateway->free_waiters = waiter->next;
+        waiter->client = client;
+        waiter->transaction_id = transaction_id;
+        waiter->next = request->waiters;
+        request->waiters = waiter;
+        client->pending++;
+    }
+}
+
+bool servo_gateway_serve(servo_gateway_t * gateway, int listen_fd, int bus_fd, const volatile sig_atomic_t * running)
+{
+    modbus_ctx_t * const ctx = gateway->ctx;
+    struct pollfd fds[SERVO_GATEWAY_CLIENTS_NUM + 2];
+    servo_gateway_client_t * polled[SERVO_GATEWAY_CLIENTS_NUM];
+    
+    while (*running)
+    {
+        uint32_t now_us = ctx->clock(ctx->user_data);
+        modbus_async_poll(&gateway->async, now_us);
+        
+        //Answers completed by the bus are sent, requests held back by the full output are fed
+        for (uint8_t i = 0; i < SERVO_GATEWAY_CLIENTS_NUM; i++)
+        {
+            servo_gateway_client_t * const client = &gateway->clients[i];
+            if ((client->fd >= 0) && (client->output_length != 0))
+            {
+                client_send(gateway, client);
+            }
+            if (client->fd >= 0)
+            {
+                client_process(gateway, client, now_us);
+            }
+        }
+        
+        nfds_t count = 0;
+        fds[count++] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        fds[count++] = (struct pollfd){ .fd = bus_fd, .events = (gateway->async.state == MODBUS_ASYNC_STATE_WAIT_ANSWER) ? POLLIN : 0 };
+        for (uint8_t i = 0; i < SERVO_GATEWAY_CLIENTS_NUM; i++)
+        {
+            servo_gateway_client_t * const client = &gateway->clients[i];
+            if (client->fd < 0)
+            {
+                continue;
+            }
+            
+            const bool readable = (client->input_offset == client->input_length) && client_ready(client);
+            polled[count - 2] = client;
+            fds[count++] = (struct pollfd)
+            {
+                .fd = client->fd,
+                .events = (readable ? POLLIN : 0) | ((client->output_length != 0) ? POLLOUT : 0)
+            };
+        }
+        
+        const uint32_t wait_us = modbus_async_timeout_us(&gateway->async, now_us);
+        const int timeout_ms = (wait_us < GATEWAY_POLL_PERIOD_MS * 1000) ? (int)((wait_us + 999) / 1000) : GATEWAY_POLL_PERIOD_MS;
+        const int ready = poll(fds, count, timeout_ms);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        
+        now_us = ctx->clock(ctx->user_data);
+        for (nfds_t i = 2; i < count; i++)
+        {
+            servo_gateway_client_t * const client = polled[i - 2];
+            if ((client->fd >= 0) && (fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                client_receive(gateway, client, now_us);
+            }
+        }
+        
+        if (fds[0].revents & POLLIN)
+        {
+            client_accept(gateway, listen_fd);
+        }
+    }
+    
+    return true;
+}
+
+int servo_gateway_listen(const char * host, uint16_t * port)
+{
+    const struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE };
+    struct sockaddr_storage address;
+    socklen_t address_length = sizeof(address);
+    struct addrinfo * addresses;
+    const int enable = 1;
+    char service[8];
+    int fd = -1;
+    
+    snprintf(service, sizeof(service), "%u", *port);
+    if (getaddrinfo(host, service, &hints, &addresses) != 0)
+    {
+        errno = EADDRNOTAVAIL;
+        return -1;
+    }
+    
+    for (const struct addrinfo * candidate = addresses; (candidate != NULL) && (fd < 0); candidate = candidate->ai_next)
+    {
+        fd = socket(candidate->ai_family, candidate->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, candidate->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if ((bind(fd, candidate->ai_addr, candidate->ai_addrlen) != 0) || (listen(fd, GATEWAY_LISTEN_BACKLOG) != 0))
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    
+    if ((fd >= 0) && (getsockname(fd, (struct sockaddr *)&address, &address_length) == 0))
+    {
+        *port = (address.ss_family == AF_INET6) ? 
+                ntohs(((struct sockaddr_in6 *)&address)->sin6_port) :
+                ntohs(((struct sockaddr_in *)&address)->sin_port);
+    }
+    
+    return fd;
+}
@@ -0,0 +1,187 @@
+/**
+ * @defgroup servo_gateway Modbus TCP to serial line gateway
+ *
+ * @brief Gateway sharing one RTU or ASCII bus between several Modbus TCP clients (HMI, loggers,
+ * motion supervisors), so the serial port is opened by one process only.
+ *
+ * Requests of all clients are queued onto the bus in the order of arrival (@see modbus_async),
+ * the unit identifier of a request is the server address on the bus. Each client may have several
+ * requests in flight, answers repeat their transaction identifiers.
+ *
+ * Reads (functions 0x01-0x04) which are likely to be polled by several clients at once are shared:
+ * - a read identical to the one already queued or on the bus is not sent again, it waits for
+ *   the answer of the queued one (deduplication);
+ * - a successful answer is kept for the cache lifetime and served to identical reads without
+ *   accessing the bus.
+ * Any other request to a server (writes, unknown functions) invalidates the cached answers of this
+ * server and stops sharing of its reads queued before the request, so a client never sees a value
+ * older than its own write. Broadcast requests invalidate all servers.
+ *
+ * Requests left without answer are completed with MODBUS_EXCEPTION_GATEWAY_TARGET_FAILED,
+ * requests to addresses beyond the bus with MODBUS_EXCEPTION_GATEWAY_PATH_UNAVAILABLE and requests
+ * over the gateway capacity with MODBUS_EXCEPTION_SERVER_DEVICE_BUSY.
+ *
+ * @{
+ */
+
+#ifndef _SERVO_GATEWAY_H_
+#define _SERVO_GATEWAY_H_
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+#include "modbus/modbus_protocol_tcp.h"
+#include "modbus/modbus_async.h"
+
+#define SERVO_GATEWAY_CLIENTS_NUM      (16)     /**< Maximum number of connected clients. */
+#define SERVO_GATEWAY_PENDING_MAX      (8)      /**< Maximum number of requests in flight of one client. */
+#define SERVO_GATEWAY_REQUESTS_NUM     (32)     /**< Maximum number of unique requests queued onto the bus. */
+#define SERVO_GATEWAY_CACHE_NUM        (64)     /**< Number of cached read answers. */
+#define SERVO_GATEWAY_KEY_SIZE         (6)      /**< Shared read request PDU: address, function, starting address, quantity. */
+#define SERVO_GATEWAY_ADDRESS_MAX      (247)    /**< Highest server address on the bus. */
+#define SERVO_GATEWAY_ADU_SIZE         (MODBUS_TCP_HEADER_SIZE + MODBUS_PDU_LENGTH_MAX)
+#define SERVO_GATEWAY_OUTPUT_SIZE      (SERVO_GATEWAY_PENDING_MAX * SERVO_GATEWAY_ADU_SIZE)
+#define SERVO_GATEWAY_FRAME_SIZE       MODBUS_FRAME_SIZE(MODBUS_PDU_LENGTH_MAX)
+
+typedef struct servo_gateway_s servo_gateway_t;
+typedef struct servo_gateway_client_s servo_gateway_client_t;
+typedef struct servo_gateway_waiter_s servo_gateway_waiter_t;
+typedef struct servo_gateway_request_s servo_gateway_request_t;
+
+/**@brief Gateway configuration. */
+typedef struct
+{
+    uint32_t cache_ttl_ms;                              /**< Lifetime of the cached read answers (0 - no caching). */
+    bool no_deduplicate;                                /**< Send every read to the bus, even if an identical one is queued. */
+} servo_gateway_config_t;
+
+/**@brief Gateway statistics. */
+typedef struct
+{
+    uint32_t clients;                                   /**< Accepted connections. */
+    uint32_t requests;                                  /**< Received client requests. */
+    uint32_t bus_requests;                              /**< Requests sent to the bus. */
+    uint32_t deduplicated;                              /**< Reads answered by an identical queued read. */
+    uint32_t cache_hits;                                /**< Reads answered from the cache. */
+    uint32_t failures;                                  /**< Requests completed with a gateway exception. */
+} servo_gateway_stats_t;
+
+/**@brief Connected client. */
+struct servo_gateway_client_s
+{
+    int fd;                                             /**< Socket file descriptor, -1 if the slot is free. */
+    modbus_tcp_receiver_t receiver;                     /**< Request receiver. */
+    uint8_t buffer[MODBUS_FRAME_RTU_SIZE(MODBUS_PDU_LENGTH_MAX)]; /**< Frame storage of the received request. */
+    modbus_frame_t frame;                               /**< Received request. */
+    uint8_t input[SERVO_GATEWAY_ADU_SIZE];              /**< Received bytes not fed to the receiver yet. */
+    uint16_t input_offset;                              /**< Offset of the first byte not fed to the receiver. */
+    uint16_t input_length;                              /**< Number of received bytes. */
+    uint8_t output[SERVO_GATEWAY_OUTPUT_SIZE];          /**< Answers not sent yet. */
+    uint16_t output_length;                             /**< Number of bytes of the answers not sent yet. */
+    uint8_t pending;                                    /**< Number of requests waiting for the bus. */
+};
+
+/**@brief Client request waiting for the answer from the bus. */
+struct servo_gateway_waiter_s
+{
+    servo_gateway_client_t * client;                    /**< Client (NULL if the slot is free or the client is gone). */
+    uint16_t transaction_id;                            /**< Transaction identifier of the client request. */
+    servo_gateway_waiter_t * next;                      /**< Next waiter of the same request, next free slot. */
+};
+
+/**@brief Unique request queued onto the bus. */
+struct servo_gateway_request_s
+{
+    modbus_transaction_t transaction;                   /**< Bus transaction. */
+    uint8_t buffer[SERVO_GATEWAY_FRAME_SIZE];           /**< Frame storage of the transaction. */
+    servo_gateway_t * gateway;                          /**< Gateway owning the request. */
+    bool queued;                                        /**< Request is queued or on the bus, the slot is in use. */
+    uint8_t key[SERVO_GATEWAY_KEY_SIZE];                /**< Request PDU of the shared read, address and function of others. */
+    bool shared;                                        /**< Identical reads may wait for the answer, the answer may be cached. */
+    servo_gateway_waiter_t * waiters;                   /**< Client requests waiting for the answer. */
+    servo_gateway_request_t * next;                     /**< Next free slot. */
+};
+
+/**@brief Cached read answer. */
+typedef struct
+{
+    uint8_t key[SERVO_GATEWAY_KEY_SIZE];                /**< Read request PDU. */
+    bool valid;                                         /**< Entry holds an answer. */
+    uint32_t stored_us;                                 /**< Time the answer was received. */
+    uint16_t pdu_length;                                /**< Answer PDU length in bytes. */
+    uint8_t pdu[MODBUS_PDU_LENGTH_MAX];                 /**< Answer PDU. */
+} servo_gateway_cache_entry_t;
+
+/**@brief Gateway. */
+struct servo_gateway_s
+{
+    servo_gateway_config_t config;                      /**< Configuration. */
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus. */
+    modbus_async_t async;                               /**< Bus transactions queue. */
+    servo_gateway_client_t clients[SERVO_GATEWAY_CLIENTS_NUM]; /**< Client slots. */
+    servo_gateway_waiter_t waiters[SERVO_GATEWAY_CLIENTS_NUM * SERVO_GATEWAY_PENDING_MAX]; /**< Waiter slots. */
+    servo_gateway_waiter_t * free_waiters;              /**< Free waiter slots. */
+    servo_gateway_request_t requests[SERVO_GATEWAY_REQUESTS_NUM]; /**< Request slots. */
+    servo_gateway_request_t * free_requests;            /**< Free request slots. */
+    servo_gateway_cache_entry_t cache[SERVO_GATEWAY_CACHE_NUM]; /**< Cached read answers. */
+    servo_gateway_stats_t stats;                        /**< Statistics. */
+};
+
+/**@brief Initialize gateway.
+ *
+ * @param[out] gateway Pointer to the gateway.
+ * @param[in]  ctx     Pointer to the modbus context of the bus (RTU or ASCII mode, receive and clock callbacks are required).
+ * @param[in]  config  Pointer to the configuration.
+ */
+void servo_gateway_initialize(servo_gateway_t * gateway, modbus_ctx_t * ctx, const servo_gateway_config_t * config);
+
+/**@brief Add connected client.
+ *
+ * @param[in] gateway Pointer to the gateway.
+ * @param[in] fd      Socket file descriptor, owned by the gateway from now on.
+ *
+ * @retval true if added, false if there are too many clients (the socket is closed).
+ */
+bool servo_gateway_client_add(servo_gateway_t * gateway, int fd);
+
+/**@brief Handle client request.
+ *
+ * The request is answered at once (from the cache or with an exception), joined to an identical
+ * queued read or queued onto the bus.
+ *
+ * @param[in]     gateway        Pointer to the gateway.
+ * @param[in]     client         Pointer to the client.
+ * @param[in,out] frame          Pointer to the frame with the request PDU, may be used to build the answer.
+ * @param[in]     transaction_id Transaction identifier of the request.
+ * @param[in]     now_us         Current time in microseconds (clock callback of the bus).
+ */
+void servo_gateway_request_handle(servo_gateway_t * gateway, 
+                                  servo_gateway_client_t * client, 
+                                  modbus_frame_t * frame, 
+                                  uint16_t transaction_id, 
+                                  uint32_t now_us);
+
+/**@brief Serve clients until the running flag is cleared.
+ *
+ * @param[in] gateway   Pointer to the gateway.
+ * @param[in] listen_fd Listening socket, @see servo_gateway_listen().
+ * @param[in] bus_fd    File descriptor of the bus to wait for the answers.
+ * @param[in] running   Pointer to the running flag (may be cleared by a signal handler).
+ *
+ * @retval true if stopped by the flag, false on I/O error of the listening socket.
+ */
+bool servo_gateway_serve(servo_gateway_t * gateway, int listen_fd, int bus_fd, const volatile sig_atomic_t * running);
+
+/**@brief Create listening socket.
+ *
+ * @param[in]     host Address to listen on (NULL - all interfaces).
+ * @param[in,out] port TCP port (0 - any free port), the bound port on return.
+ *
+ * @return Socket file descriptor, -1 on error (errno is set).
+ */
+int servo_gateway_listen(const char * host, uint16_t * port);
+
+#endif
+
+/** @} */
@@ -0,0 +1,209 @@
+/**
+ * @ingroup servo_gateway
+ *
+ * @brief Gateway executable: shares the serial line between Modbus TCP clients.
+ *
+ * Usage: servo_gateway -D DEVICE [options]
+ *   -D, --device PATH          Serial port the servos are connected to.
+ *   -m, --mode MODE            Modbus mode on the serial line: rtu or ascii (rtu).
+ *   -b, --baud RATE            Baud rate (19200).
+ *   -P, --parity PARITY        Parity: none, even or odd (even).
+ *   -r, --rs485                Enable RS-485 mode with RTS direction control.
+ *   -H, --host ADDRESS         Address to listen on (all interfaces).
+ *   -p, --port PORT            TCP port (502, 0 - any free port).
+ *   -t, --ttl MS               Lifetime of the cached read answers (50, 0 - no caching).
+ *   -n, --no-deduplicate       Send every read to the bus, even if an identical one is queued.
+ *
+ * The listening address is printed to stdout, statistics are printed to stderr on exit (SIGINT, SIGTERM).
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "servo_gateway.h"
+#include "serial/serial_linux.h"
+
+#define GATEWAY_BAUD_RATE_DEFAULT    (19200)
+#define GATEWAY_CACHE_TTL_DEFAULT    (50)   /**< Shorter than a typical polling period of a HMI. */
+
+static volatile sig_atomic_t running = 1;
+
+static void signal_handle(int signal_number)
+{
+    (void)signal_number;
+    running = 0;
+}
+
+static void usage_print(const char * program)
+{
+    fprintf(stderr, 
+            "Usage: %s -D DEVICE [-m rtu|ascii] [-b BAUD] [-P none|even|odd] [-r] [-H ADDRESS] [-p PORT] "
+            "[-t TTL_MS] [-n]\n", 
+            program);
+}
+
+int main(int argc, char * argv[])
+{
+    static const struct option options[] = 
+    {
+        { "device",         required_argument, NULL, 'D' },
+        { "mode",           required_argument, NULL, 'm' },
+        { "baud",           required_argument, NULL, 'b' },
+        { "parity",         required_argument, NULL, 'P' },
+        { "rs485",          no_argument,       NULL, 'r' },
+        { "host",           required_argument, NULL, 'H' },
+        { "port",           required_argument, NULL, 'p' },
+        { "ttl",            required_argument, NULL, 't' },
+        { "no-deduplicate", no_argument,       NULL, 'n' },
+        { NULL,             0,                 NULL, 0   }
+    };
+    static servo_gateway_t gateway;
+    static serial_port_t port;
+    static modbus_ctx_t ctx;
+    servo_gateway_config_t config = 
+    {
+        .cache_ttl_ms = GATEWAY_CACHE_TTL_DEFAULT
+    };
+    modbus_mode_t mode = MODBUS_PROTOCOL_MODE_RTU;
+    serial_parity_t parity = SERIAL_PARITY_EVEN;
+    uint32_t baud_rate = GATEWAY_BAUD_RATE_DEFAULT;
+    const char * device = NULL;
+    const char * host = NULL;
+    uint16_t tcp_port = MODBUS_TCP_PORT;
+    bool rs485 = false;
+    int option;
+    
+    while ((option = getopt_long(argc, argv, "D:m:b:P:rH:p:t:n", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'D':
+                device = optarg;
+                break;
+                
+            case 'm':
+                if (strcmp(optarg, "rtu") == 0)
+                {
+                    mode = MODBUS_PROTOCOL_MODE_RTU;
+                }
+                else if (strcmp(optarg, "ascii") == 0)
+                {
+                    mode = MODBUS_PROTOCOL_MODE_ASCII;
+                }
+                else
+                {
+                    usage_print(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+                
+            case 'b':
+                baud_rate = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'P':
+                if (strcmp(optarg, "none") == 0)
+                {
+                    parity = SERIAL_PARITY_NONE;
+                }
+                else if (strcmp(optarg, "even") == 0)
+                {
+                    parity = SERIAL_PARITY_EVEN;
+                }
+                else if (strcmp(optarg, "odd") == 0)
+                {
+                    parity = SERIAL_PARITY_ODD;
+                }
+                else
+                {
+                    usage_print(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+                
+            case 'r':
+                rs485 = true;
+                break;
+                
+            case 'H':
+                host = optarg;
+                break;
+                
+            case 'p':
+                tcp_port = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 't':
+                config.cache_ttl_ms = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'n':
+                config.no_deduplicate = true;
+                break;
+                
+            default:
+                usage_print(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    
+    if (device == NULL)
+    {
+        usage_print(argv[0]);
+        return EXIT_FAILURE;
+    }
+    
+    if (!serial_port_open(&port, device, baud_rate, parity, mode, rs485))
+    {
+        perror("serial_port_open");
+        return EXIT_FAILURE;
+    }
+    
+    const modbus_params_t modbus_params = 
+    {
+        .mode = mode,
+        .write = serial_port_write,
+        .read = serial_port_read,
+        .idle = serial_port_idle,
+        .writev = serial_port_writev,
+        .receive = serial_port_receive,
+        .delay = serial_port_delay,
+        .clock = serial_port_clock,
+        .baud_rate = port.baud_rate,
+        .user_data = &port,
+        .timeout_ms = MODBUS_PROTOCOL_BUS_TIMEOUT_MS,
+        .retries = 0
+    };
+    modbus_protocol_initialize(&ctx, &modbus_params);
+    servo_gateway_initialize(&gateway, &ctx, &config);
+    
+    const int fd = servo_gateway_listen(host, &tcp_port);
+    if (fd < 0)
+    {
+        perror("servo_gateway_listen");
+        serial_port_close(&port);
+        return EXIT_FAILURE;
+    }
+    
+    printf("%s:%u\n", (host != NULL) ? host : "*", (unsigned)tcp_port);
+    fflush(stdout);
+    
+    signal(SIGINT, signal_handle);
+    signal(SIGTERM, signal_handle);
+    //Client closing the connection while the answer is written must not stop the gateway
+    signal(SIGPIPE, SIG_IGN);
+    
+    const bool success = servo_gateway_serve(&gateway, fd, port.fd, &running);
+    close(fd);
+    serial_port_close(&port);
+    
+    fprintf(stderr, 
+            "clients %u, requests %u, bus requests %u, deduplicated %u, cache hits %u, failures %u\n", 
+            (unsigned)gateway.stats.clients, (unsigned)gateway.stats.requests, (unsigned)gateway.stats.bus_requests, 
+            (unsigned)gateway.stats.deduplicated, (unsigned)gateway.stats.cache_hits, (unsigned)gateway.stats.failures);
+    
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
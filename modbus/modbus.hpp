@@ -0,0 +1,636 @@
+/**
+ * @ingroup modbus_protocol
+ *
+ * @defgroup modbus_cxx C++ fixed-shape codecs
+ *
+ * @brief Header-only C++17 layer over the protocol layer for transactions whose shape is known at compile time.
+ *
+ * The Modbus mode, the function and the number of registers are template parameters, so the frame lengths
+ * are constants: requests and answers are built in std::array frames of the exact wire length, without
+ * headroom, zeroing, mode dispatch or run-time bounds checks. CRC, LRC and hex conversions use tables
+ * generated by constexpr functions. The bus is a transport policy class whose calls are inlined instead
+ * of the callbacks of modbus_ctx_t:
+ * @code
+ * struct transport
+ * {
+ *     modbus_callback_result_t write(const uint8_t * data, std::size_t length);
+ *     modbus_callback_result_t read(uint8_t * data, std::size_t length);
+ *     void idle(std::size_t length);                   //Inter-frame silence (RTU framing only)
+ * };
+ * @endcode
+ *
+ * Results and exception codes are the ones of the C API. ctx_transport runs the codecs over the callbacks
+ * of an existing modbus context, the C API itself is unchanged and remains the way for variable-shape
+ * transactions, adaptive timeouts, retries and the asynchronous queue:
+ * @code
+ * modbus::client<MODBUS_PROTOCOL_MODE_RTU, modbus::ctx_transport> client{ modbus::ctx_transport{ &ctx } };
+ * std::array<uint16_t, 4> words;
+ * if (client.read_registers(1, 0x0800, words) == MODBUS_PROTOCOL_RESULT_SUCCESS) ...
+ * @endcode
+ *
+ * @{
+ */
+
+#ifndef _MODBUS_HPP_
+#define _MODBUS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+extern "C"
+{
+#include "modbus_crc.h"
+#include "modbus_protocol.h"
+}
+
+namespace modbus
+{
+
+/**@brief Generate CRC-16-MODBUS lookup table (reflected polynomial 0xA001). */
+constexpr std::array<uint16_t, 256> crc_table_generate()
+{
+    std::array<uint16_t, 256> table{};
+
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        uint16_t crc = i;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+        }
+        table[i] = crc;
+    }
+
+    return table;
+}
+
+/**@brief Generate hex digit values, 0xFF for characters which are not hex digits. */
+constexpr std::array<uint8_t, 256> hex_table_generate()
+{
+    std::array<uint8_t, 256> table{};
+
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        table[i] = ((i >= '0') && (i <= '9')) ? (uint8_t)(i - '0') :
+                   ((i >= 'A') && (i <= 'F')) ? (uint8_t)(i - 'A' + 10) :
+                   ((i >= 'a') && (i <= 'f')) ? (uint8_t)(i - 'a' + 10) : 0xFF;
+    }
+
+    return table;
+}
+
+inline constexpr std::array<uint16_t, 256> crc_table = crc_table_generate();
+inline constexpr std::array<uint8_t, 256> hex_table = hex_table_generate();
+inline constexpr std::array<uint8_t, 16> hex_digits = 
+{
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+/**@brief Update CRC, @see modbus_crc_update(). Evaluated at compile time for constant data.
+ */
+constexpr uint16_t crc_update(uint16_t crc, const uint8_t * data, std::size_t data_length)
+{
+    for (std::size_t i = 0; i < data_length; i++)
+    {
+        crc = (uint16_t)((crc >> 8) ^ crc_table[(crc ^ data[i]) & 0xFF]);
+    }
+
+    return crc;
+}
+
+/**@brief Calculate LRC (two's complement of the sum of the bytes).
+ */
+constexpr uint8_t lrc_calculate(const uint8_t * data, std::size_t data_length)
+{
+    uint8_t sum = 0;
+
+    for (std::size_t i = 0; i < data_length; i++)
+    {
+        sum = (uint8_t)(sum + data[i]);
+    }
+
+    return (uint8_t)-sum;
+}
+
+/**@brief Longest frame checked by the inlined table loop, longer frames use the selected CRC kernel. */
+inline constexpr std::size_t crc_inline_max = 32;
+
+/**@brief Calculate CRC of a frame: the inlined table loop for short frames, the CRC kernel for long ones.
+ *        The branch is resolved at compile time as the frame lengths are constants.
+ */
+inline uint16_t crc_calculate(const uint8_t * data, std::size_t data_length)
+{
+    if (data_length <= crc_inline_max)
+    {
+        return crc_update(MODBUS_CRC_INITIAL, data, data_length);
+    }
+
+    return modbus_crc_update(MODBUS_CRC_INITIAL, data, data_length);
+}
+
+namespace detail
+{
+
+inline constexpr uint8_t crc_check_pdu[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x01 };
+static_assert(crc_update(MODBUS_CRC_INITIAL, crc_check_pdu, sizeof(crc_check_pdu)) == 0x0A84, "CRC table");
+static_assert(lrc_calculate(crc_check_pdu, sizeof(crc_check_pdu)) == 0xFB, "LRC");
+
+/**@brief Store 16-bit value, high byte first. */
+inline void word_store(uint8_t * data, uint16_t value)
+{
+    data[0] = (uint8_t)(value >> 8);
+    data[1] = (uint8_t)(value & 0xFF);
+}
+
+/**@brief Load 16-bit value, high byte first. */
+inline uint16_t word_load(const uint8_t * data)
+{
+    return (uint16_t)((data[0] << 8) | data[1]);
+}
+
+} //namespace detail
+
+/**@brief Wire framing of the mode.
+ *
+ * - length(): frame length of the PDU;
+ * - pdu_offset(): position to build the request PDU at, encode() completes the frame around it in place;
+ * - answer_length(): frame length from the first exception_length bytes of the answer (0 if corrupted);
+ * - decode(): check the frame, returns the position of the decoded PDU (nullptr if corrupted).
+ */
+template <modbus_mode_t Mode>
+struct framing;
+
+/**@brief RTU framing: PDU followed by CRC. */
+template <>
+struct framing<MODBUS_PROTOCOL_MODE_RTU>
+{
+    static constexpr std::size_t length(std::size_t pdu_length)
+    {
+        return pdu_length + 2;
+    }
+
+    static constexpr std::size_t pdu_offset(std::size_t)
+    {
+        return 0;
+    }
+
+    static void encode(uint8_t * adu, std::size_t pdu_length, uint16_t)
+    {
+        const uint16_t crc = crc_calculate(adu, pdu_length);
+        adu[pdu_length] = (uint8_t)(crc & 0xFF);
+        adu[pdu_length + 1] = (uint8_t)(crc >> 8);
+    }
+
+    static std::size_t answer_length(const uint8_t * adu, std::size_t expected)
+    {
+        return (adu[1] & 0x80) ? length(3) : expected;
+    }
+
+    static uint8_t * decode(uint8_t * adu, std::size_t length, uint16_t)
+    {
+        //CRC of a frame including its own CRC is zero
+        return (crc_calculate(adu, length) == 0) ? adu : nullptr;
+    }
+};
+
+/**@brief RTU frames passed over TCP unchanged. */
+template <>
+struct framing<MODBUS_PROTOCOL_MODE_RTU_OVER_TCP> : framing<MODBUS_PROTOCOL_MODE_RTU>
+{
+};
+
+/**@brief ASCII framing: start character, hex characters of the PDU and LRC, CR LF. */
+template <>
+struct framing<MODBUS_PROTOCOL_MODE_ASCII>
+{
+    static constexpr std::size_t length(std::size_t pdu_length)
+    {
+        return 2 * pdu_length + 5;
+    }
+
+    //PDU bytes at the end of the frame are expanded to characters from its start
+    static constexpr std::size_t pdu_offset(std::size_t pdu_length)
+    {
+        return pdu_length + 5;
+    }
+
+    static void encode(uint8_t * adu, std::size_t pdu_length, uint16_t)
+    {
+        const uint8_t * const pdu = &adu[pdu_offset(pdu_length)];
+        const uint8_t lrc = lrc_calculate(pdu, pdu_length);
+
+        adu[0] = ':';
+        for (std::size_t i = 0; i < pdu_length; i++)
+        {
+            const uint8_t value = pdu[i];
+            adu[2 * i + 1] = hex_digits[value >> 4];
+            adu[2 * i + 2] = hex_digits[value & 0x0F];
+        }
+        adu[2 * pdu_length + 1] = hex_digits[lrc >> 4];
+        adu[2 * pdu_length + 2] = hex_digits[lrc & 0x0F];
+        adu[2 * pdu_length + 3] = '\r';
+        adu[2 * pdu_length + 4] = '\n';
+    }
+
+    static std::size_t answer_length(const uint8_t * adu, std::size_t expected)
+    {
+        //High digit of the function code is 8 or above for exceptions
+        return (hex_table[adu[3]] >= 8) ? length(3) : expected;
+    }
+
+    static uint8_t * decode(uint8_t * adu, std::size_t length, uint16_t)
+    {
+        const std::size_t pairs = (length - 3) / 2;
+        uint8_t invalid = 0;
+        uint8_t sum = 0;
+
+        if ((adu[0] != ':') || (adu[length - 2] != '\r') || (adu[length - 1] != '\n'))
+        {
+            return nullptr;
+        }
+
+        //Bytes shrink in place towards the start, LRC included
+        for (std::size_t i = 0; i < pairs; i++)
+        {
+            const uint8_t high = hex_table[adu[2 * i + 1]];
+            const uint8_t low = hex_table[adu[2 * i + 2]];
+            invalid |= (uint8_t)(high | low);
+            adu[i] = (uint8_t)((high << 4) | (low & 0x0F));
+            sum = (uint8_t)(sum + adu[i]);
+        }
+
+        return (((invalid & 0xF0) == 0) && (sum == 0)) ? adu : nullptr;
+    }
+};
+
+/**@brief TCP framing: MBAP header followed by the PDU. */
+template <>
+struct framing<MODBUS_PROTOCOL_MODE_TCP>
+{
+    static constexpr std::size_t header_length = 6;
+
+    static constexpr std::size_t length(std::size_t pdu_length)
+    {
+        return pdu_length + header_length;
+    }
+
+    static constexpr std::size_t pdu_offset(std::size_t)
+    {
+        return header_length;
+    }
+
+    static void encode(uint8_t * adu, std::size_t pdu_length, uint16_t transaction_id)
+    {
+        detail::word_store(&adu[0], transaction_id);
+        detail::word_store(&adu[2], 0);
+        detail::word_store(&adu[4], (uint16_t)pdu_length);
+    }
+
+    static std::size_t answer_length(const uint8_t * adu, std::size_t expected)
+    {
+        //Length is taken from the header, it must match either the expected answer or the exception
+        const std::size_t frame_length = length(detail::word_load(&adu[4]));
+        return ((frame_length == expected) || (frame_length == length(3))) ? frame_length : 0;
+    }
+
+    static uint8_t * decode(uint8_t * adu, std::size_t length, uint16_t transaction_id)
+    {
+        const bool valid = (detail::word_load(&adu[0]) == transaction_id) && (detail::word_load(&adu[2]) == 0) && 
+                           (header_length + detail::word_load(&adu[4]) == length);
+
+        return valid ? &adu[header_length] : nullptr;
+    }
+};
+
+/**@brief Read Holding Registers (0x03) of Count registers. */
+template <uint16_t Count>
+struct read_registers
+{
+    static_assert((Count >= 1) && (Count <= 125), "1-125 registers can be read");
+
+    static constexpr uint8_t function = 0x03;
+    static constexpr std::size_t request_length = 6;
+    static constexpr std::size_t answer_length = 3 + 2 * Count;
+
+    static void request_build(uint8_t * pdu, uint8_t unit, uint16_t address)
+    {
+        pdu[0] = unit;
+        pdu[1] = function;
+        detail::word_store(&pdu[2], address);
+        detail::word_store(&pdu[4], Count);
+    }
+
+    static bool answer_parse(const uint8_t * pdu, std::array<uint16_t, Count> & words)
+    {
+        for (uint16_t i = 0; i < Count; i++)
+        {
+            words[i] = detail::word_load(&pdu[3 + 2 * i]);
+        }
+
+        return (pdu[2] == 2 * Count);
+    }
+};
+
+/**@brief Write Single Register (0x06). */
+struct write_register
+{
+    static constexpr uint8_t function = 0x06;
+    static constexpr std::size_t request_length = 6;
+    static constexpr std::size_t answer_length = 6;
+
+    static void request_build(uint8_t * pdu, uint8_t unit, uint16_t address, uint16_t value)
+    {
+        pdu[0] = unit;
+        pdu[1] = function;
+        detail::word_store(&pdu[2], address);
+        detail::word_store(&pdu[4], value);
+    }
+
+    static bool answer_parse(const uint8_t * pdu, uint16_t address, uint16_t value)
+    {
+        return (detail::word_load(&pdu[2]) == address) && (detail::word_load(&pdu[4]) == value);
+    }
+};
+
+/**@brief Write Multiple Registers (0x10) of Count registers. */
+template <uint16_t Count>
+struct write_registers
+{
+    static_assert((Count >= 1) && (Count <= 123), "1-123 registers can be written");
+
+    static constexpr uint8_t function = 0x10;
+    static constexpr std::size_t request_length = 7 + 2 * Count;
+    static constexpr std::size_t answer_length = 6;
+
+    static void request_build(uint8_t * pdu, uint8_t unit, uint16_t address, const std::array<uint16_t, Count> & words)
+    {
+        pdu[0] = unit;
+        pdu[1] = function;
+        detail::word_store(&pdu[2], address);
+        detail::word_store(&pdu[4], Count);
+        pdu[6] = (uint8_t)(2 * Count);
+        for (uint16_t i = 0; i < Count; i++)
+        {
+            detail::word_store(&pdu[7 + 2 * i], words[i]);
+        }
+    }
+
+    static bool answer_parse(const uint8_t * pdu, uint16_t address)
+    {
+        return (detail::word_load(&pdu[2]) == address) && (detail::word_load(&pdu[4]) == Count);
+    }
+};
+
+/**@brief Read/Write Multiple Registers (0x17) of ReadCount and WriteCount registers. */
+template <uint16_t ReadCount, uint16_t WriteCount>
+struct read_write_registers
+{
+    static_assert((ReadCount >= 1) && (ReadCount <= 125), "1-125 registers can be read");
+    static_assert((WriteCount >= 1) && (WriteCount <= 121), "1-121 registers can be written");
+
+    static constexpr uint8_t function = 0x17;
+    static constexpr std::size_t request_length = 11 + 2 * WriteCount;
+    static constexpr std::size_t answer_length = 3 + 2 * ReadCount;
+
+    static void request_build(uint8_t * pdu, 
+                              uint8_t unit, 
+                              uint16_t read_address, 
+                              uint16_t write_address, 
+                              const std::array<uint16_t, WriteCount> & write_words)
+    {
+        pdu[0] = unit;
+        pdu[1] = function;
+        detail::word_store(&pdu[2], read_address);
+        detail::word_store(&pdu[4], ReadCount);
+        detail::word_store(&pdu[6], write_address);
+        detail::word_store(&pdu[8], WriteCount);
+        pdu[10] = (uint8_t)(2 * WriteCount);
+        for (uint16_t i = 0; i < WriteCount; i++)
+        {
+            detail::word_store(&pdu[11 + 2 * i], write_words[i]);
+        }
+    }
+
+    static bool answer_parse(const uint8_t * pdu, std::array<uint16_t, ReadCount> & read_words)
+    {
+        return read_registers<ReadCount>::answer_parse(pdu, read_words);
+    }
+};
+
+/**@brief Frames of the function in the mode. */
+template <modbus_mode_t Mode, class Function>
+struct codec
+{
+    using framing_type = framing<Mode>;
+    using request_frame = std::array<uint8_t, framing_type::length(Function::request_length)>;
+    using answer_frame = std::array<uint8_t, framing_type::length(Function::answer_length)>;
+
+    /**@brief Length of the exception answer, the shortest answer, read first to learn the answer length. */
+    static constexpr std::size_t exception_length = framing_type::length(3);
+    static_assert(exception_length <= framing_type::length(Function::answer_length), "answer is shorter than exception");
+
+    /**@brief Position to build the request PDU at. */
+    static uint8_t * request_pdu(request_frame & frame)
+    {
+        return &frame[framing_type::pdu_offset(Function::request_length)];
+    }
+
+    /**@brief Complete the request frame around the built PDU. */
+    static void request_encode(request_frame & frame, uint16_t transaction_id)
+    {
+        framing_type::encode(frame.data(), Function::request_length, transaction_id);
+    }
+
+    /**@brief Check the answer frame of the given length (answer_frame().size() or exception_length).
+     *
+     * @param[out] pdu Position of the answer PDU.
+     *
+     * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer to the request received.
+     * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received, the code is pdu[2].
+     * @retval MODBUS_PROTOCOL_RESULT_CORRUPTED Frame is corrupted or does not belong to the request.
+     */
+    static modbus_protocol_result_t answer_decode(answer_frame & frame, 
+                                                  std::size_t length, 
+                                                  uint8_t unit, 
+                                                  uint16_t transaction_id, 
+                                                  const uint8_t *& pdu)
+    {
+        pdu = framing_type::decode(frame.data(), length, transaction_id);
+        if ((pdu == nullptr) || (pdu[0] != unit))
+        {
+            return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+        }
+
+        if (length == exception_length)
+        {
+            return (pdu[1] == (Function::function | 0x80)) ? MODBUS_PROTOCOL_RESULT_EXCEPTION : MODBUS_PROTOCOL_RESULT_CORRUPTED;
+        }
+
+        return (pdu[1] == Function::function) ? MODBUS_PROTOCOL_RESULT_SUCCESS : MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+};
+
+/**@brief Transport over the callbacks of a modbus context. */
+struct ctx_transport
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus. */
+
+    modbus_callback_result_t write(const uint8_t * data, std::size_t length)
+    {
+        return ctx->write(ctx->user_data, const_cast<uint8_t *>(data), (uint16_t)length, ctx->timeout_ms);
+    }
+
+    modbus_callback_result_t read(uint8_t * data, std::size_t length)
+    {
+        return ctx->read(ctx->user_data, data, (uint16_t)length, ctx->timeout_ms);
+    }
+
+    void idle(std::size_t length)
+    {
+        if (ctx->idle != nullptr)
+        {
+            ctx->idle(ctx->user_data, (uint16_t)length);
+        }
+    }
+};
+
+/**@brief Client performing fixed-shape transactions over the transport, one at a time. */
+template <modbus_mode_t Mode, class Transport>
+class client
+{
+public:
+    explicit client(Transport transport) : transport_(transport)
+    {
+    }
+
+    /**@brief Read Count holding registers, @see read_registers. */
+    template <std::size_t Count>
+    modbus_protocol_result_t read_registers(uint8_t unit, uint16_t address, std::array<uint16_t, Count> & words)
+    {
+        using function = modbus::read_registers<(uint16_t)Count>;
+        return transact<function>(unit, 
+                                  [&](uint8_t * pdu) { function::request_build(pdu, unit, address); }, 
+                                  [&](const uint8_t * pdu) { return function::answer_parse(pdu, words); });
+    }
+
+    /**@brief Write single register, @see write_register. */
+    modbus_protocol_result_t write_register(uint8_t unit, uint16_t address, uint16_t value)
+    {
+        using function = modbus::write_register;
+        return transact<function>(unit, 
+                                  [&](uint8_t * pdu) { function::request_build(pdu, unit, address, value); }, 
+                                  [&](const uint8_t * pdu) { return function::answer_parse(pdu, address, value); });
+    }
+
+    /**@brief Write Count registers, @see write_registers. */
+    template <std::size_t Count>
+    modbus_protocol_result_t write_registers(uint8_t unit, uint16_t address, const std::array<uint16_t, Count> & words)
+    {
+        using function = modbus::write_registers<(uint16_t)Count>;
+        return transact<function>(unit, 
+                                  [&](uint8_t * pdu) { function::request_build(pdu, unit, address, words); }, 
+                                  [&](const uint8_t * pdu) { return function::answer_parse(pdu, address); });
+    }
+
+    /**@brief Write WriteCount registers, then read ReadCount registers, @see read_write_registers. */
+    template <std::size_t ReadCount, std::size_t WriteCount>
+    modbus_protocol_result_t read_write_registers(uint8_t unit, 
+                                                  uint16_t read_address, 
+                                                  std::array<uint16_t, ReadCount> & read_words, 
+                                                  uint16_t write_address, 
+                                                  const std::array<uint16_t, WriteCount> & write_words)
+    {
+        using function = modbus::read_write_registers<(uint16_t)ReadCount, (uint16_t)WriteCount>;
+        return transact<function>(unit, 
+                                  [&](uint8_t * pdu) { function::request_build(pdu, unit, read_address, write_address, write_words); }, 
+                                  [&](const uint8_t * pdu) { return function::answer_parse(pdu, read_words); });
+    }
+
+    /**@brief Get exception code of the last exception answer. */
+    modbus_exception_t exception() const
+    {
+        return exception_;
+    }
+
+    /**@brief Get transport. */
+    Transport & transport()
+    {
+        return transport_;
+    }
+
+private:
+    /**@brief Perform transaction: build and send the request, receive and check the answer.
+     *        Broadcast requests are not answered.
+     */
+    template <class Function, class Build, class Parse>
+    modbus_protocol_result_t transact(uint8_t unit, Build build, Parse parse)
+    {
+        using codec_type = codec<Mode, Function>;
+        typename codec_type::request_frame request;
+        typename codec_type::answer_frame answer;
+        modbus_callback_result_t callback_result;
+        const uint8_t * pdu;
+
+        build(codec_type::request_pdu(request));
+        codec_type::request_encode(request, ++transaction_id_);
+        exception_ = MODBUS_EXCEPTION_NONE;
+
+        if constexpr (MODBUS_MODE_RTU_FRAMING(Mode))
+        {
+            transport_.idle(request.size());
+        }
+        callback_result = transport_.write(request.data(), request.size());
+        if constexpr (MODBUS_MODE_RTU_FRAMING(Mode))
+        {
+            transport_.idle(request.size());
+        }
+        if ((callback_result != MODBUS_CALLBACK_RESULT_SUCCESS) || (unit == MODBUS_ADDRESS_BROADCAST))
+        {
+            return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        }
+
+        //The shortest answer is read first, it tells the length of the answer
+        callback_result = transport_.read(answer.data(), codec_type::exception_length);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        }
+
+        const std::size_t length = codec_type::framing_type::answer_length(answer.data(), answer.size());
+        if (length == 0)
+        {
+            return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+        }
+        if (length > codec_type::exception_length)
+        {
+            callback_result = transport_.read(&answer[codec_type::exception_length], length - codec_type::exception_length);
+            if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+            {
+                return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+            }
+        }
+
+        const modbus_protocol_result_t protocol_result = codec_type::answer_decode(answer, length, unit, transaction_id_, pdu);
+        if (protocol_result == MODBUS_PROTOCOL_RESULT_EXCEPTION)
+        {
+            exception_ = (modbus_exception_t)pdu[2];
+        }
+        if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+        {
+            return protocol_result;
+        }
+
+        return parse(pdu) ? MODBUS_PROTOCOL_RESULT_SUCCESS : MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+
+    Transport transport_;                               /**< Bus. */
+    uint16_t transaction_id_ = 0;                       /**< Transaction identifier of the last request (MODBUS_PROTOCOL_MODE_TCP). */
+    modbus_exception_t exception_ = MODBUS_EXCEPTION_NONE; /**< Exception code of the last exception answer. */
+};
+
+} //namespace modbus
+
+#endif
+
+/** @} */
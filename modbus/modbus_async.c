@@ -0,0 +1,626 @@
+#include "modbus_async.h"
+#include "modbus_protocol_ascii.h"
+#include "modbus_metrics.h"
+
+#define ASYNC_RECEIVE_CHUNK_SIZE    (64)
+
+/**@brief Get time until the bus is free for the next request.
+ *
+ * Elapsed time since the release is compared instead of absolute times, so the first request and 
+ * requests after a long idle period are not delayed by the wrap-around of the time counter.
+ */
+static uint32_t bus_wait_us(const modbus_async_t * async, uint32_t now_us)
+{
+    const uint32_t elapsed_us = now_us - async->bus_released_us;
+    
+    return (elapsed_us < async->bus_guard_us) ? async->bus_guard_us - elapsed_us : 0;
+}
+
+/**@brief Unlink the transaction from the queue.
+ */
+static void transaction_remove(modbus_async_t * async, modbus_transaction_t * transaction)
+{
+    modbus_transaction_t * previous = NULL;
+    
+    for (modbus_transaction_t * entry = async->head; entry != transaction; entry = entry->next)
+    {
+        previous = entry;
+    }
+    
+    if (previous == NULL)
+    {
+        async->head = transaction->next;
+    }
+    else
+    {
+        previous->next = transaction->next;
+    }
+    if (async->tail == transaction)
+    {
+        async->tail = previous;
+    }
+    transaction->next = NULL;
+}
+
+/**@brief Record the completed transaction and call its completion callback.
+ */
+static void transaction_finish(modbus_async_t * async, 
+                               modbus_transaction_t * transaction, 
+                               modbus_protocol_result_t result)
+{
+    async->ctx->exception = (result == MODBUS_PROTOCOL_RESULT_EXCEPTION) ? 
+            (modbus_exception_t)MODBUS_FRAME_PDU(&transaction->frame)[2] : MODBUS_EXCEPTION_NONE;
+    MODBUS_METRICS_RECORD(async->ctx, modbus_metrics_transaction_completed(async->ctx, result));
+    
+    transaction->complete(transaction, result);
+}
+
+/**@brief Complete the active transaction and release the bus.
+ */
+static void transaction_complete(modbus_async_t * async, modbus_protocol_result_t result, uint32_t now_us)
+{
+    modbus_transaction_t * transaction = async->head;
+    
+    transaction_remove(async, transaction);
+    
+    async->state = MODBUS_ASYNC_STATE_IDLE;
+    async->bus_released_us = now_us;
+    async->bus_guard_us = async->receiver.t35_us;
+    
+    transaction_finish(async, transaction, result);
+}
+
+/**@brief Discard bytes received while no answer is expected (late answers, bytes following a completed answer).
+ */
+static modbus_callback_result_t input_flush(modbus_ctx_t * ctx)
+{
+    modbus_callback_result_t callback_result;
+    uint8_t chunk[ASYNC_RECEIVE_CHUNK_SIZE];
+    uint16_t received;
+    
+    do
+    {
+        callback_result = ctx->receive(ctx->user_data, chunk, sizeof(chunk), &received);
+    } while ((callback_result == MODBUS_CALLBACK_RESULT_SUCCESS) && (received == sizeof(chunk)));
+    
+    return callback_result;
+}
+
+/**@brief Send request of the active transaction.
+ *
+ * @retval true if the request is sent, false if the transaction is completed (error or broadcast request).
+ */
+static bool request_send(modbus_async_t * async, uint32_t now_us)
+{
+    modbus_ctx_t * const ctx = async->ctx;
+    modbus_transaction_t * const transaction = async->head;
+    modbus_callback_result_t callback_result;
+    uint16_t length;
+    
+    async->address = MODBUS_FRAME_PDU(&transaction->frame)[0];
+    ctx->request_address = async->address;
+    ctx->request_us = now_us;
+    const uint32_t wire_time_us = modbus_wire_time_us(ctx, transaction->frame.pdu_length);
+    const uint32_t timeout_us = modbus_unit_timeout_us(ctx, async->address, transaction->frame.pdu_length, 
+                                                       transaction->answer_length, 0);
+    
+    if ((async->address != MODBUS_ADDRESS_BROADCAST) && !modbus_unit_available(ctx, async->address, now_us))
+    {
+        transaction_complete(async, MODBUS_PROTOCOL_RESULT_OFFLINE, now_us);
+        async->bus_guard_us = 0;
+        return false;
+    }
+    
+    uint8_t * adu = MODBUS_MODE_RTU_FRAMING(ctx->mode) ? 
+            modbus_protocol_rtu_frame_encode(&transaction->frame, &length) : 
+            modbus_protocol_ascii_frame_encode(&transaction->frame, &length);
+    
+    //Answer must be the first byte received after the request
+    callback_result = input_flush(ctx);
+    if (callback_result == MODBUS_CALLBACK_RESULT_SUCCESS)
+    {
+        callback_result = ctx->write(ctx->user_data, adu, length, ctx->timeout_ms);
+    }
+    if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+    {
+        transaction_complete(async, MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result), now_us);
+        return false;
+    }
+    
+    //The request is transmitted in the background
+    MODBUS_METRICS_RECORD(ctx, modbus_metrics_request_sent(ctx, length, now_us + wire_time_us));
+    
+    if (async->address == MODBUS_ADDRESS_BROADCAST)
+    {
+        //Broadcast request is not answered, the bus is free after the turnaround delay
+        transaction_complete(async, MODBUS_PROTOCOL_RESULT_SUCCESS, now_us);
+        async->bus_guard_us = wire_time_us + ctx->turnaround_ms * 1000;
+        return false;
+    }
+    
+    modbus_protocol_rtu_receiver_reset(&async->receiver);
+    async->receiver.frame = &transaction->frame;
+    modbus_protocol_ascii_receiver_reset(&async->ascii_receiver);
+    async->ascii_receiver.frame = &transaction->frame;
+    ctx->request_wire_us = wire_time_us;
+    async->deadline_us = now_us + timeout_us;
+    async->state = MODBUS_ASYNC_STATE_WAIT_ANSWER;
+    
+    return true;
+}
+
+/**@brief Check if the answer being received is completed by the t3.5 silence only (unknown function code).
+ *
+ * Received bytes are stamped with the poll time, not with their arrival time, so a late poll looks like 
+ * a silence on the bus. It is trusted only when the length of the answer can't be inferred, answers 
+ * of known length wait for all their bytes or the transaction deadline.
+ */
+static bool answer_silence_delimited(const modbus_rtu_receiver_t * receiver)
+{
+    return (receiver->length != 0) && (modbus_protocol_rtu_receiver_needed(receiver) == 0);
+}
+
+/**@brief Receive answer of the active transaction.
+ *
+ * @retval true if the transaction is completed.
+ */
+static bool answer_receive(modbus_async_t * async, uint32_t now_us)
+{
+    modbus_ctx_t * const ctx = async->ctx;
+    modbus_transaction_t * const transaction = async->head;
+    modbus_protocol_result_t protocol_result = MODBUS_PROTOCOL_RESULT_TIMEOUT;
+    modbus_callback_result_t callback_result;
+    uint8_t chunk[ASYNC_RECEIVE_CHUNK_SIZE];
+    uint16_t received;
+    bool completed = false;
+    
+    do
+    {
+        callback_result = ctx->receive(ctx->user_data, chunk, sizeof(chunk), &received);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            transaction_complete(async, MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result), now_us);
+            return true;
+        }
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_answer_received(ctx, received));
+        
+        if (MODBUS_MODE_RTU_FRAMING(ctx->mode))
+        {
+            //Answer of known length continues the received bytes, the poll delay is not a gap on the bus
+            modbus_rtu_receiver_t * const receiver = &async->receiver;
+            const uint32_t timestamp_us = ((receiver->length == 0) || answer_silence_delimited(receiver)) ? now_us : 
+                                          receiver->timestamp_us + receiver->char_us;
+            const modbus_rtu_receiver_status_t status = 
+                    modbus_protocol_rtu_receiver_feed(receiver, chunk, received, timestamp_us, NULL);
+            if (status != MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE)
+            {
+                protocol_result = (status == MODBUS_RTU_RECEIVER_STATUS_COMPLETE) ? 
+                        MODBUS_PROTOCOL_RESULT_SUCCESS : MODBUS_PROTOCOL_RESULT_CORRUPTED;
+                completed = true;
+            }
+        }
+        else
+        {
+            const modbus_ascii_receiver_status_t status = 
+                    modbus_protocol_ascii_receiver_feed(&async->ascii_receiver, chunk, received, NULL);
+            if (status != MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE)
+            {
+                protocol_result = (status == MODBUS_ASCII_RECEIVER_STATUS_COMPLETE) ? 
+                        MODBUS_PROTOCOL_RESULT_SUCCESS : MODBUS_PROTOCOL_RESULT_CORRUPTED;
+                completed = true;
+            }
+        }
+    } while (!completed && (received == sizeof(chunk)));
+    
+    if (!completed && MODBUS_MODE_RTU_FRAMING(ctx->mode) && answer_silence_delimited(&async->receiver))
+    {
+        //Answer with unknown function code is completed by silence
+        const modbus_rtu_receiver_status_t status = modbus_protocol_rtu_receiver_poll(&async->receiver, now_us);
+        if (status != MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE)
+        {
+            protocol_result = (status == MODBUS_RTU_RECEIVER_STATUS_COMPLETE) ? 
+                    MODBUS_PROTOCOL_RESULT_SUCCESS : MODBUS_PROTOCOL_RESULT_CORRUPTED;
+            completed = true;
+        }
+    }
+    
+    if (completed)
+    {
+        const uint8_t * pdu = MODBUS_FRAME_PDU(&transaction->frame);
+        if (async->receiver.checksum_failed || async->ascii_receiver.checksum_failed)
+        {
+            MODBUS_METRICS_RECORD(ctx, modbus_metrics_checksum_failed(ctx));
+        }
+        if (protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS)
+        {
+            if (pdu[0] != async->address)
+            {
+                protocol_result = MODBUS_PROTOCOL_RESULT_CORRUPTED;
+            }
+            else if (pdu[1] & 0x80)
+            {
+                protocol_result = MODBUS_PROTOCOL_RESULT_EXCEPTION;
+            }
+        }
+        
+        //Any answer shows the server is alive, only valid answers are sampled
+        const uint32_t wire_us = ctx->request_wire_us + modbus_wire_time_us(ctx, transaction->frame.pdu_length);
+        const uint32_t round_trip_us = now_us - ctx->request_us;
+        modbus_unit_answered(ctx, async->address, (round_trip_us > wire_us) ? round_trip_us - wire_us : 0, 
+                             protocol_result != MODBUS_PROTOCOL_RESULT_CORRUPTED);
+    }
+    else if ((int32_t)(now_us - async->deadline_us) < 0)
+    {
+        return false;
+    }
+    else
+    {
+        modbus_unit_failed(ctx, async->address, now_us);
+    }
+    
+    transaction_complete(async, protocol_result, now_us);
+    
+    return true;
+}
+
+/**@brief Complete the transaction of the pipelined queue (MODBUS_PROTOCOL_MODE_TCP).
+ *
+ * @param[in] sent          true if the request is in flight.
+ * @param[in] answer_length Length of the received answer frame (0 if not answered).
+ */
+static void tcp_transaction_complete(modbus_async_t * async, 
+                                     modbus_transaction_t * transaction, 
+                                     modbus_protocol_result_t result, 
+                                     bool sent, 
+                                     uint16_t answer_length)
+{
+    modbus_ctx_t * const ctx = async->ctx;
+    
+    transaction_remove(async, transaction);
+    if (sent)
+    {
+        async->in_flight--;
+    }
+    if (async->receiving == transaction)
+    {
+        //Rest of the answer is skipped
+        async->receiving = NULL;
+        async->tcp_receiver.frame = NULL;
+    }
+    
+    //Several requests are in flight, the context describes the completed one
+    ctx->request_address = transaction->address;
+    ctx->request_us = transaction->request_us;
+    MODBUS_METRICS_RECORD(ctx, modbus_metrics_transaction_select(ctx, transaction->request_us, async->answer_us, answer_length));
+    
+    transaction_finish(async, transaction, result);
+}
+
+/**@brief Complete all requests in flight, the connection failed or lost the frame boundaries.
+ */
+static void tcp_in_flight_fail(modbus_async_t * async, modbus_protocol_result_t result)
+{
+    while (async->in_flight != 0)
+    {
+        tcp_transaction_complete(async, async->head, result, true, 0);
+    }
+}
+
+/**@brief Send queued requests while the window allows.
+ */
+static void tcp_requests_send(modbus_async_t * async, uint32_t now_us)
+{
+    modbus_ctx_t * const ctx = async->ctx;
+    modbus_callback_result_t callback_result;
+    uint16_t length;
+    
+    while (async->in_flight < async->window)
+    {
+        modbus_transaction_t * transaction = async->head;
+        for (uint8_t i = 0; (transaction != NULL) && (i < async->in_flight); i++)
+        {
+            transaction = transaction->next;
+        }
+        if (transaction == NULL)
+        {
+            return;
+        }
+        
+        transaction->address = MODBUS_FRAME_PDU(&transaction->frame)[0];
+        transaction->request_us = now_us;
+        if ((transaction->address != MODBUS_ADDRESS_BROADCAST) && !modbus_unit_available(ctx, transaction->address, now_us))
+        {
+            tcp_transaction_complete(async, transaction, MODBUS_PROTOCOL_RESULT_OFFLINE, false, 0);
+            continue;
+        }
+        
+        ctx->transaction_id++;
+        transaction->id = ctx->transaction_id;
+        transaction->deadline_us = now_us + modbus_unit_timeout_us(ctx, transaction->address, transaction->frame.pdu_length, 
+                                                                   transaction->answer_length, 0);
+        uint8_t * adu = modbus_protocol_tcp_frame_encode(&transaction->frame, transaction->id, &length);
+        
+        callback_result = ctx->write(ctx->user_data, adu, length, ctx->timeout_ms);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            tcp_transaction_complete(async, transaction, MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result), false, 0);
+            continue;
+        }
+        
+        ctx->request_address = transaction->address;
+        ctx->request_us = now_us;
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_request_sent(ctx, length, now_us));
+        
+        if (transaction->address == MODBUS_ADDRESS_BROADCAST)
+        {
+            //Broadcast request is not answered, the gateway provides the turnaround delay
+            tcp_transaction_complete(async, transaction, MODBUS_PROTOCOL_RESULT_SUCCESS, false, 0);
+            continue;
+        }
+        
+        async->in_flight++;
+    }
+}
+
+/**@brief Select the transaction of the answer by its transaction identifier.
+ */
+static void tcp_answer_select(modbus_async_t * async, uint32_t now_us)
+{
+    const uint16_t id = modbus_protocol_tcp_receiver_id(&async->tcp_receiver);
+    modbus_transaction_t * transaction = async->head;
+    
+    for (uint8_t i = 0; (i < async->in_flight) && (transaction->id != id); i++)
+    {
+        transaction = transaction->next;
+    }
+    
+    //Late answer to a timed out transaction is skipped
+    async->receiving = ((transaction != NULL) && (transaction->id == id)) ? transaction : NULL;
+    async->answer_us = now_us;
+    modbus_protocol_tcp_receiver_accept(&async->tcp_receiver, 
+                                        (async->receiving != NULL) ? &async->receiving->frame : NULL);
+}
+
+/**@brief Complete the transaction of the received answer.
+ */
+static void tcp_answer_complete(modbus_async_t * async, uint32_t now_us)
+{
+    modbus_ctx_t * const ctx = async->ctx;
+    modbus_transaction_t * const transaction = async->receiving;
+    modbus_protocol_result_t protocol_result = MODBUS_PROTOCOL_RESULT_SUCCESS;
+    
+    if (transaction == NULL)
+    {
+        return;
+    }
+    async->receiving = NULL;
+    
+    const uint8_t * pdu = MODBUS_FRAME_PDU(&transaction->frame);
+    if ((async->tcp_receiver.frame == NULL) || (pdu[0] != transaction->address))
+    {
+        //Answer does not fit into the frame or comes from another server
+        protocol_result = MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    else if (pdu[1] & 0x80)
+    {
+        protocol_result = MODBUS_PROTOCOL_RESULT_EXCEPTION;
+    }
+    
+    //There is no wire time, the answer delay includes the wait behind other requests at the server
+    modbus_unit_answered(ctx, transaction->address, now_us - transaction->request_us, 
+                         protocol_result != MODBUS_PROTOCOL_RESULT_CORRUPTED);
+    tcp_transaction_complete(async, transaction, protocol_result, true, 
+                             MODBUS_TCP_HEADER_SIZE + async->tcp_receiver.pdu_length);
+}
+
+/**@brief Receive answers of the requests in flight.
+ */
+static void tcp_answers_receive(modbus_async_t * async, uint32_t now_us)
+{
+    modbus_ctx_t * const ctx = async->ctx;
+    modbus_callback_result_t callback_result;
+    uint8_t chunk[ASYNC_RECEIVE_CHUNK_SIZE];
+    uint16_t received;
+    
+    do
+    {
+        callback_result = ctx->receive(ctx->user_data, chunk, sizeof(chunk), &received);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            tcp_in_flight_fail(async, MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result));
+            return;
+        }
+        
+        for (uint16_t offset = 0; offset < received; )
+        {
+            uint16_t consumed;
+            const modbus_tcp_receiver_status_t status = 
+                    modbus_protocol_tcp_receiver_feed(&async->tcp_receiver, &chunk[offset], received - offset, &consumed);
+            offset += consumed;
+            
+            if (status == MODBUS_TCP_RECEIVER_STATUS_HEADER)
+            {
+                tcp_answer_select(async, now_us);
+            }
+            else if (status == MODBUS_TCP_RECEIVER_STATUS_COMPLETE)
+            {
+                tcp_answer_complete(async, now_us);
+            }
+            else if (status == MODBUS_TCP_RECEIVER_STATUS_CORRUPTED)
+            {
+                tcp_in_flight_fail(async, MODBUS_PROTOCOL_RESULT_CORRUPTED);
+                return;
+            }
+        }
+    } while (received == sizeof(chunk));
+}
+
+/**@brief Complete the requests in flight which passed their deadlines.
+ */
+static void tcp_timeouts_check(modbus_async_t * async, uint32_t now_us)
+{
+    bool expired;
+    
+    do
+    {
+        expired = false;
+        modbus_transaction_t * transaction = async->head;
+        for (uint8_t i = 0; i < async->in_flight; i++, transaction = transaction->next)
+        {
+            if ((int32_t)(now_us - transaction->deadline_us) >= 0)
+            {
+                modbus_unit_failed(async->ctx, transaction->address, now_us);
+                tcp_transaction_complete(async, transaction, MODBUS_PROTOCOL_RESULT_TIMEOUT, true, 0);
+                expired = true;
+                break;
+            }
+        }
+    } while (expired);
+}
+
+/**@brief Advance the pipelined queue (MODBUS_PROTOCOL_MODE_TCP).
+ */
+static void tcp_poll(modbus_async_t * async, uint32_t now_us)
+{
+    if (async->in_flight != 0)
+    {
+        tcp_answers_receive(async, now_us);
+    }
+    tcp_timeouts_check(async, now_us);
+    tcp_requests_send(async, now_us);
+}
+
+/**@brief Get time until the pipelined queue has to be polled again (MODBUS_PROTOCOL_MODE_TCP).
+ */
+static uint32_t tcp_timeout_us(const modbus_async_t * async, uint32_t now_us)
+{
+    const modbus_transaction_t * transaction = async->head;
+    uint32_t timeout_us = UINT32_MAX;
+    
+    for (uint8_t i = 0; i < async->in_flight; i++, transaction = transaction->next)
+    {
+        const uint32_t left_us = ((int32_t)(transaction->deadline_us - now_us) > 0) ? transaction->deadline_us - now_us : 0;
+        if (left_us < timeout_us)
+        {
+            timeout_us = left_us;
+        }
+    }
+    
+    //Queued request is sent as soon as the window allows
+    return ((transaction != NULL) && (async->in_flight < async->window)) ? 0 : timeout_us;
+}
+
+void modbus_async_initialize(modbus_async_t * async, modbus_ctx_t * ctx)
+{
+    async->ctx = ctx;
+    async->state = MODBUS_ASYNC_STATE_IDLE;
+    async->head = NULL;
+    async->tail = NULL;
+    async->bus_released_us = 0;
+    async->bus_guard_us = 0;
+    async->receiving = NULL;
+    async->answer_us = 0;
+    async->window = (ctx->mode == MODBUS_PROTOCOL_MODE_TCP) ? MODBUS_ASYNC_TCP_WINDOW : 1;
+    async->in_flight = 0;
+    
+    modbus_protocol_rtu_receiver_initialize(&async->receiver, NULL, 
+                                            MODBUS_MODE_RTU_FRAMING(ctx->mode) ? ctx->baud_rate : 0, 
+                                            false);
+    modbus_protocol_ascii_receiver_initialize(&async->ascii_receiver, NULL, false);
+    modbus_protocol_tcp_receiver_initialize(&async->tcp_receiver);
+}
+
+void modbus_async_window_set(modbus_async_t * async, uint8_t window)
+{
+    if (async->ctx->mode != MODBUS_PROTOCOL_MODE_TCP)
+    {
+        return;
+    }
+    
+    async->window = (window != 0) ? window : MODBUS_ASYNC_TCP_WINDOW;
+}
+
+bool modbus_async_submit(modbus_async_t * async, modbus_transaction_t * transaction)
+{
+    const modbus_mode_t mode = async->ctx->mode;
+    
+    //Answers of all modes are decoded straight into the PDU
+    if (MODBUS_FRAME_MODE_SIZE(mode, transaction->frame.pdu_length) > transaction->frame.size || 
+        MODBUS_FRAME_RTU_SIZE(transaction->answer_length) > transaction->frame.size)
+    {
+        return false;
+    }
+    
+    transaction->next = NULL;
+    if (async->tail == NULL)
+    {
+        async->head = transaction;
+    }
+    else
+    {
+        async->tail->next = transaction;
+    }
+    async->tail = transaction;
+    
+    return true;
+}
+
+void modbus_async_poll(modbus_async_t * async, uint32_t now_us)
+{
+    if (async->ctx->mode == MODBUS_PROTOCOL_MODE_TCP)
+    {
+        tcp_poll(async, now_us);
+        return;
+    }
+    
+    while (async->head != NULL)
+    {
+        if (async->state == MODBUS_ASYNC_STATE_IDLE)
+        {
+            if (bus_wait_us(async, now_us) != 0)
+            {
+                return;
+            }
+            
+            if (!request_send(async, now_us))
+            {
+                continue;
+            }
+        }
+        
+        if (!answer_receive(async, now_us))
+        {
+            return;
+        }
+    }
+}
+
+uint32_t modbus_async_timeout_us(const modbus_async_t * async, uint32_t now_us)
+{
+    if (async->head == NULL)
+    {
+        return UINT32_MAX;
+    }
+    
+    if (async->ctx->mode == MODBUS_PROTOCOL_MODE_TCP)
+    {
+        return tcp_timeout_us(async, now_us);
+    }
+    
+    uint32_t timeout_us = (async->state == MODBUS_ASYNC_STATE_IDLE) ? bus_wait_us(async, now_us) : 
+            ((int32_t)(async->deadline_us - now_us) > 0) ? async->deadline_us - now_us : 0;
+    
+    if ((async->state == MODBUS_ASYNC_STATE_WAIT_ANSWER) && answer_silence_delimited(&async->receiver) && 
+        (async->receiver.t35_us < timeout_us))
+    {
+        //Answer with unknown function code is completed by silence
+        timeout_us = async->receiver.t35_us;
+    }
+    
+    return timeout_us;
+}
+
+bool modbus_async_busy(const modbus_async_t * async)
+{
+    return async->head != NULL;
+}
@@ -0,0 +1,149 @@
+/**
+ * @ingroup modbus_protocol
+ *
+ * @defgroup modbus_async Modbus asynchronous transactions
+ *
+ * @brief Non-blocking request/answer transactions.
+ *
+ * Transactions are submitted to the queue of a bus and completed by a callback. The queue is 
+ * advanced by modbus_async_poll(), which never waits: it sends the next request when the bus 
+ * is free, collects the received bytes via the bus receive callback and checks timeouts. 
+ * One thread can therefore serve many buses from an event loop.
+ *
+ * The bus write callback must only hand the frame to the transmitter and return without 
+ * waiting for the transmission to complete.
+ *
+ * Broadcast transactions are completed as soon as the request is sent, the next request is 
+ * delayed by the turnaround delay.
+ *
+ * Received bytes are handled at the poll time, so RTU answers whose length is known from the function code 
+ * and the byte count may arrive in pieces with any delay between them (USB serial adapters, busy event loops), 
+ * they are completed by their length or the answer timeout. Only answers with unknown function codes end 
+ * by the t3.5 silence. Bytes received before a request is sent (late answers, bytes following a completed 
+ * answer) are discarded.
+ *
+ * Answer timeouts adapt to the measured answer delay of each server (@see modbus_unit_timeout_us()), 
+ * transactions to offline servers are completed with MODBUS_PROTOCOL_RESULT_OFFLINE until their probe 
+ * is due. Time passed to the queue must use the same time base as the clock callback of the context.
+ * Transactions are not retried, the completion callback may submit the transaction again.
+ *
+ * In MODBUS_PROTOCOL_MODE_TCP requests are pipelined: up to the window of requests are in flight 
+ * on the connection, answers are matched to them by the transaction identifier and may arrive 
+ * in any order. Each transaction has its own deadline, late answers to timed out transactions are skipped. 
+ * Other modes (including MODBUS_PROTOCOL_MODE_RTU_OVER_TCP) keep one request on the bus.
+ *
+ * @{
+ */
+
+#ifndef _MODBUS_ASYNC_H_
+#define _MODBUS_ASYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus_protocol.h"
+#include "modbus_protocol_rtu.h"
+#include "modbus_protocol_ascii.h"
+#include "modbus_protocol_tcp.h"
+
+#define MODBUS_ASYNC_TCP_WINDOW    (8)  /**< Default number of requests in flight in MODBUS_PROTOCOL_MODE_TCP. */
+
+typedef struct modbus_transaction_s modbus_transaction_t;
+
+/**@brief Transaction completion callback.
+ *
+ * @param[in] transaction Pointer to the completed transaction, answer PDU is available in its frame.
+ * @param[in] result      Transaction result, @see modbus_protocol_result_t.
+ */
+typedef void (*modbus_completion_callback_t)(modbus_transaction_t * transaction, 
+                                             modbus_protocol_result_t result);
+
+/**@brief Modbus transaction. Owned by the caller until completion. */
+struct modbus_transaction_s
+{
+    modbus_frame_t frame;                               /**< Frame with the request PDU, holds the answer PDU on completion. */
+    uint16_t answer_length;                             /**< Expected answer PDU length in bytes. */
+    modbus_completion_callback_t complete;              /**< Completion callback. */
+    void * user_data;                                   /**< User data of the transaction. */
+    uint16_t id;                                        /**< Transaction identifier of the sent request (internal, MODBUS_PROTOCOL_MODE_TCP). */
+    uint8_t address;                                    /**< Server address of the sent request (internal, MODBUS_PROTOCOL_MODE_TCP). */
+    uint32_t request_us;                                /**< Time the request was sent (internal, MODBUS_PROTOCOL_MODE_TCP). */
+    uint32_t deadline_us;                               /**< Answer deadline (internal, MODBUS_PROTOCOL_MODE_TCP). */
+    modbus_transaction_t * next;                        /**< Next transaction in the queue (internal). */
+};
+
+/**@brief Asynchronous transaction states. */
+typedef enum
+{
+    MODBUS_ASYNC_STATE_IDLE,                            /**< No request is on the bus. */
+    MODBUS_ASYNC_STATE_WAIT_ANSWER                      /**< Request is sent, waiting for the answer. */
+} modbus_async_state_t;
+
+/**@brief Asynchronous transactions queue of a bus. */
+typedef struct
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus. */
+    modbus_async_state_t state;                         /**< Current state. */
+    modbus_transaction_t * head;                        /**< Active (first) transaction, the first in_flight ones in MODBUS_PROTOCOL_MODE_TCP. */
+    modbus_transaction_t * tail;                        /**< Last transaction. */
+    modbus_rtu_receiver_t receiver;                     /**< Answer receiver (MODBUS_PROTOCOL_MODE_RTU). */
+    modbus_ascii_receiver_t ascii_receiver;             /**< Answer receiver (MODBUS_PROTOCOL_MODE_ASCII). */
+    modbus_tcp_receiver_t tcp_receiver;                 /**< Answer receiver (MODBUS_PROTOCOL_MODE_TCP). */
+    modbus_transaction_t * receiving;                   /**< Transaction of the answer being received (MODBUS_PROTOCOL_MODE_TCP, NULL if it is skipped). */
+    uint32_t answer_us;                                 /**< Time the answer being received started (MODBUS_PROTOCOL_MODE_TCP). */
+    uint8_t window;                                     /**< Maximum number of requests in flight. */
+    uint8_t in_flight;                                  /**< Number of sent requests waiting for answers (MODBUS_PROTOCOL_MODE_TCP). */
+    uint8_t address;                                    /**< Server address of the active request. */
+    uint32_t deadline_us;                               /**< Answer deadline. */
+    uint32_t bus_released_us;                           /**< Time the bus was released by the last transaction. */
+    uint32_t bus_guard_us;                              /**< Silence required after the bus release before the next request. */
+} modbus_async_t;
+
+/**@brief Initialize asynchronous transactions queue.
+ *
+ * @param[out] async Pointer to the queue.
+ * @param[in]  ctx   Pointer to the modbus context of the bus (receive callback is required).
+ */
+void modbus_async_initialize(modbus_async_t * async, modbus_ctx_t * ctx);
+
+/**@brief Set maximum number of requests in flight. Applies to MODBUS_PROTOCOL_MODE_TCP only, 
+ *        servers (or gateways) limit the number of requests they queue.
+ *
+ * @param[in] async  Pointer to the queue.
+ * @param[in] window Number of requests (1 disables pipelining, 0 restores MODBUS_ASYNC_TCP_WINDOW).
+ */
+void modbus_async_window_set(modbus_async_t * async, uint8_t window);
+
+/**@brief Submit transaction. The request PDU must be built at MODBUS_FRAME_PDU(&transaction->frame).
+ *
+ * @param[in] async       Pointer to the queue.
+ * @param[in] transaction Pointer to the transaction.
+ *
+ * @retval true if submitted, false if the frame storage is too small for the request or the answer.
+ */
+bool modbus_async_submit(modbus_async_t * async, modbus_transaction_t * transaction);
+
+/**@brief Advance the queue. Completion callbacks are called from this function.
+ *
+ * @param[in] async  Pointer to the queue.
+ * @param[in] now_us Current time in microseconds.
+ */
+void modbus_async_poll(modbus_async_t * async, uint32_t now_us);
+
+/**@brief Get time until the queue has to be polled again if no bytes are received.
+ *
+ * @param[in] async  Pointer to the queue.
+ * @param[in] now_us Current time in microseconds.
+ *
+ * @return Time in microseconds, UINT32_MAX if the queue is empty.
+ */
+uint32_t modbus_async_timeout_us(const modbus_async_t * async, uint32_t now_us);
+
+/**@brief Check if the queue has pending transactions.
+ *
+ * @param[in] async Pointer to the queue.
+ */
+bool modbus_async_busy(const modbus_async_t * async);
+
+#endif
+
+/** @} */
@@ -0,0 +1,436 @@
+#include "modbus_capture.h"
+
+#include <string.h>
+
+#define CAPTURE_FILE_MAGIC    "MBCP"
+
+/**@brief Copy data into the ring at the given position.
+ */
+static void ring_write(modbus_capture_t * capture, uint32_t pos, const uint8_t * data, uint16_t length)
+{
+    const uint32_t offset = pos & capture->mask;
+    const uint32_t first = (capture->mask + 1 - offset < length) ? capture->mask + 1 - offset : length;
+    
+    memcpy(&capture->storage[offset], data, first);
+    memcpy(capture->storage, &data[first], length - first);
+}
+
+/**@brief Copy data from the ring at the given position.
+ */
+static void ring_read(const modbus_capture_t * capture, uint32_t pos, uint8_t * data, uint16_t length)
+{
+    const uint32_t offset = pos & capture->mask;
+    const uint32_t first = (capture->mask + 1 - offset < length) ? capture->mask + 1 - offset : length;
+    
+    memcpy(data, &capture->storage[offset], first);
+    memcpy(&data[first], capture->storage, length - first);
+}
+
+/**@brief Write record header to the ring at the given position.
+ */
+static void header_write(modbus_capture_t * capture, 
+                         uint32_t pos, 
+                         modbus_capture_type_t type, 
+                         uint32_t length, 
+                         uint32_t timestamp_us)
+{
+    //Header: type, reserved, length (LE), timestamp (LE)
+    const uint8_t header[MODBUS_CAPTURE_RING_HEADER_SIZE] =
+    {
+        (uint8_t)type, 0, (uint8_t)length, (uint8_t)(length >> 8), 
+        (uint8_t)timestamp_us, (uint8_t)(timestamp_us >> 8), (uint8_t)(timestamp_us >> 16), (uint8_t)(timestamp_us >> 24)
+    };
+    
+    ring_write(capture, pos, header, sizeof(header));
+}
+
+/**@brief Get time from the captured bus clock, 0 if there is no clock.
+ */
+static uint32_t clock_get(const modbus_capture_t * capture)
+{
+    return (capture->clock != NULL) ? capture->clock(capture->user_data) : 0;
+}
+
+/**@brief Store record in the ring, report the dropped records before it.
+ *
+ * @param[in] capture   Pointer to the capture.
+ * @param[in] type      Record type.
+ * @param[in] length    Record length, @see modbus_capture_type_t.
+ * @param[in] iov       Data of the record (TX and RX only).
+ * @param[in] iov_count Number of data elements.
+ */
+static void record_push(modbus_capture_t * capture, 
+                        modbus_capture_type_t type, 
+                        uint32_t length, 
+                        const modbus_iovec_t * iov, 
+                        uint8_t iov_count)
+{
+    const uint32_t timestamp_us = clock_get(capture);
+    const uint32_t tail = atomic_load_explicit(&capture->tail, memory_order_acquire);
+    uint32_t head = atomic_load_explicit(&capture->head, memory_order_relaxed);
+    uint32_t free_size = capture->mask + 1 - (head - tail);
+    const uint32_t data_length = (iov_count != 0) ? length : 0;
+    
+    if ((capture->pending_lost != 0) && (free_size >= 2 * MODBUS_CAPTURE_RING_HEADER_SIZE + data_length))
+    {
+        header_write(capture, head, MODBUS_CAPTURE_LOST, capture->pending_lost, timestamp_us);
+        head += MODBUS_CAPTURE_RING_HEADER_SIZE;
+        free_size -= MODBUS_CAPTURE_RING_HEADER_SIZE;
+        capture->pending_lost = 0;
+    }
+    
+    if ((capture->pending_lost != 0) || (data_length > MODBUS_CAPTURE_DATA_MAX) || 
+        (free_size < MODBUS_CAPTURE_RING_HEADER_SIZE + data_length))
+    {
+        atomic_fetch_add_explicit(&capture->lost, 1, memory_order_relaxed);
+        if (capture->pending_lost < UINT16_MAX)
+        {
+            capture->pending_lost++;
+        }
+        return;
+    }
+    
+    header_write(capture, head, type, length, timestamp_us);
+    head += MODBUS_CAPTURE_RING_HEADER_SIZE;
+    for (uint8_t i = 0; i < iov_count; i++)
+    {
+        ring_write(capture, head, iov[i].data, iov[i].data_length);
+        head += iov[i].data_length;
+    }
+    
+    //Records are visible to the consumer only when they are complete
+    atomic_store_explicit(&capture->head, head, memory_order_release);
+}
+
+/**@brief Bus write callback of the capture.
+ */
+static modbus_callback_result_t capture_write(void * user_data, 
+                                              uint8_t * data, 
+                                              uint16_t data_length, 
+                                              uint32_t timeout_ms)
+{
+    modbus_capture_t * const capture = (modbus_capture_t *)user_data;
+    
+    const modbus_callback_result_t callback_result = capture->write(capture->user_data, data, data_length, timeout_ms);
+    if (callback_result == MODBUS_CALLBACK_RESULT_SUCCESS)
+    {
+        const modbus_iovec_t iov = { data, data_length };
+        record_push(capture, MODBUS_CAPTURE_TX, data_length, &iov, 1);
+    }
+    
+    return callback_result;
+}
+
+/**@brief Bus scatter-gather write callback of the capture.
+ */
+static modbus_callback_result_t capture_writev(void * user_data, 
+                                               const modbus_iovec_t * iov, 
+                                               uint8_t iov_count, 
+                                               uint32_t timeout_ms)
+{
+    modbus_capture_t * const capture = (modbus_capture_t *)user_data;
+    uint32_t length = 0;
+    
+    const modbus_callback_result_t callback_result = capture->writev(capture->user_data, iov, iov_count, timeout_ms);
+    if (callback_result == MODBUS_CALLBACK_RESULT_SUCCESS)
+    {
+        for (uint8_t i = 0; i < iov_count; i++)
+        {
+            length += iov[i].data_length;
+        }
+        record_push(capture, MODBUS_CAPTURE_TX, length, iov, iov_count);
+    }
+    
+    return callback_result;
+}
+
+/**@brief Bus read callback of the capture.
+ */
+static modbus_callback_result_t capture_read(void * user_data, 
+                                             uint8_t * data, 
+                                             uint16_t data_length, 
+                                             uint32_t timeout_ms)
+{
+    modbus_capture_t * const capture = (modbus_capture_t *)user_data;
+    
+    const modbus_callback_result_t callback_result = capture->read(capture->user_data, data, data_length, timeout_ms);
+    if (callback_result == MODBUS_CALLBACK_RESULT_SUCCESS)
+    {
+        const modbus_iovec_t iov = { data, data_length };
+        record_push(capture, MODBUS_CAPTURE_RX, data_length, &iov, 1);
+    }
+    else if (callback_result == MODBUS_CALLBACK_RESULT_TIMEOUT)
+    {
+        record_push(capture, MODBUS_CAPTURE_TIMEOUT, data_length, NULL, 0);
+    }
+    
+    return callback_result;
+}
+
+/**@brief Bus receive callback of the capture.
+ */
+static modbus_callback_result_t capture_receive(void * user_data, 
+                                                uint8_t * data, 
+                                                uint16_t data_length, 
+                                                uint16_t * received)
+{
+    modbus_capture_t * const capture = (modbus_capture_t *)user_data;
+    
+    const modbus_callback_result_t callback_result = capture->receive(capture->user_data, data, data_length, received);
+    if ((callback_result == MODBUS_CALLBACK_RESULT_SUCCESS) && (*received != 0))
+    {
+        const modbus_iovec_t iov = { data, *received };
+        record_push(capture, MODBUS_CAPTURE_RX, *received, &iov, 1);
+    }
+    
+    return callback_result;
+}
+
+/**@brief Bus idle callback of the capture.
+ */
+static void capture_idle(void * user_data, uint16_t data_length)
+{
+    modbus_capture_t * const capture = (modbus_capture_t *)user_data;
+    
+    capture->idle(capture->user_data, data_length);
+}
+
+/**@brief Bus delay callback of the capture.
+ */
+static void capture_delay(void * user_data, uint32_t delay_ms)
+{
+    modbus_capture_t * const capture = (modbus_capture_t *)user_data;
+    
+    capture->delay(capture->user_data, delay_ms);
+}
+
+/**@brief Bus clock callback of the capture.
+ */
+static uint32_t capture_clock(void * user_data)
+{
+    modbus_capture_t * const capture = (modbus_capture_t *)user_data;
+    
+    return capture->clock(capture->user_data);
+}
+
+/**@brief Encode unsigned LEB128 number.
+ *
+ * @return Number of bytes.
+ */
+static uint8_t leb128_encode(uint8_t * encoded, uint32_t value)
+{
+    uint8_t length = 0;
+    
+    while (value >= 0x80)
+    {
+        encoded[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    encoded[length++] = (uint8_t)value;
+    
+    return length;
+}
+
+/**@brief Decode unsigned LEB128 number.
+ *
+ * @return Number of bytes, 0 if the number is truncated or too long.
+ */
+static uint8_t leb128_decode(const uint8_t * encoded, size_t encoded_size, uint32_t * value)
+{
+    *value = 0;
+    
+    for (uint8_t i = 0; (i < 5) && (i < encoded_size); i++)
+    {
+        *value |= (uint32_t)(encoded[i] & 0x7F) << (7 * i);
+        if (!(encoded[i] & 0x80))
+        {
+            return i + 1;
+        }
+    }
+    
+    return 0;
+}
+
+bool modbus_capture_initialize(modbus_capture_t * capture, uint8_t * storage, uint32_t size)
+{
+    if ((size < 2 * MODBUS_CAPTURE_DATA_MAX) || (size & (size - 1)))
+    {
+        return false;
+    }
+    
+    capture->storage = storage;
+    capture->mask = size - 1;
+    atomic_init(&capture->head, 0);
+    atomic_init(&capture->tail, 0);
+    atomic_init(&capture->lost, 0);
+    capture->pending_lost = 0;
+    
+    return true;
+}
+
+void modbus_capture_attach(modbus_ctx_t * ctx, modbus_capture_t * capture)
+{
+    capture->write = ctx->write;
+    capture->read = ctx->read;
+    capture->writev = ctx->writev;
+    capture->receive = ctx->receive;
+    capture->idle = ctx->idle;
+    capture->delay = ctx->delay;
+    capture->clock = ctx->clock;
+    capture->user_data = ctx->user_data;
+    
+    //Optional callbacks stay absent
+    ctx->write = capture_write;
+    ctx->read = capture_read;
+    ctx->writev = (ctx->writev != NULL) ? capture_writev : NULL;
+    ctx->receive = (ctx->receive != NULL) ? capture_receive : NULL;
+    ctx->idle = (ctx->idle != NULL) ? capture_idle : NULL;
+    ctx->delay = (ctx->delay != NULL) ? capture_delay : NULL;
+    ctx->clock = (ctx->clock != NULL) ? capture_clock : NULL;
+    ctx->user_data = capture;
+}
+
+void modbus_capture_detach(modbus_ctx_t * ctx, modbus_capture_t * capture)
+{
+    const uint32_t tail = atomic_load_explicit(&capture->tail, memory_order_acquire);
+    const uint32_t head = atomic_load_explicit(&capture->head, memory_order_relaxed);
+    
+    //Dropped records at the end of the capture are reported if there is room, otherwise only counted
+    if ((capture->pending_lost != 0) && (capture->mask + 1 - (head - tail) >= MODBUS_CAPTURE_RING_HEADER_SIZE))
+    {
+        header_write(capture, head, MODBUS_CAPTURE_LOST, capture->pending_lost, clock_get(capture));
+        atomic_store_explicit(&capture->head, head + MODBUS_CAPTURE_RING_HEADER_SIZE, memory_order_release);
+    }
+    capture->pending_lost = 0;
+    
+    ctx->write = capture->write;
+    ctx->read = capture->read;
+    ctx->writev = capture->writev;
+    ctx->receive = capture->receive;
+    ctx->idle = capture->idle;
+    ctx->delay = capture->delay;
+    ctx->clock = capture->clock;
+    ctx->user_data = capture->user_data;
+}
+
+bool modbus_capture_pop(modbus_capture_t * capture, modbus_capture_record_t * record, uint8_t * data)
+{
+    const uint32_t tail = atomic_load_explicit(&capture->tail, memory_order_relaxed);
+    const uint32_t head = atomic_load_explicit(&capture->head, memory_order_acquire);
+    uint8_t header[MODBUS_CAPTURE_RING_HEADER_SIZE];
+    
+    if (head == tail)
+    {
+        return false;
+    }
+    
+    ring_read(capture, tail, header, sizeof(header));
+    record->type = (modbus_capture_type_t)header[0];
+    record->length = (uint16_t)(header[2] | (header[3] << 8));
+    record->timestamp_us = (uint32_t)header[4] | ((uint32_t)header[5] << 8) |
+                           ((uint32_t)header[6] << 16) | ((uint32_t)header[7] << 24);
+                           
+    uint32_t size = sizeof(header);
+    if ((record->type == MODBUS_CAPTURE_TX) || (record->type == MODBUS_CAPTURE_RX))
+    {
+        ring_read(capture, tail + size, data, record->length);
+        size += record->length;
+    }
+    
+    atomic_store_explicit(&capture->tail, tail + size, memory_order_release);
+    
+    return true;
+}
+
+void modbus_capture_header_encode(uint8_t * header, modbus_mode_t mode, uint32_t baud_rate)
+{
+    memcpy(header, CAPTURE_FILE_MAGIC, 4);
+    header[4] = MODBUS_CAPTURE_FILE_VERSION;
+    header[5] = (uint8_t)mode;
+    header[6] = 0;
+    header[7] = 0;
+    header[8] = (uint8_t)baud_rate;
+    header[9] = (uint8_t)(baud_rate >> 8);
+    header[10] = (uint8_t)(baud_rate >> 16);
+    header[11] = (uint8_t)(baud_rate >> 24);
+}
+
+bool modbus_capture_header_decode(const uint8_t * header, modbus_mode_t * mode, uint32_t * baud_rate)
+{
+    if ((memcmp(header, CAPTURE_FILE_MAGIC, 4) != 0) || (header[4] != MODBUS_CAPTURE_FILE_VERSION) ||
+        (header[5] > MODBUS_PROTOCOL_MODE_RTU_OVER_TCP))
+    {
+        return false;
+    }
+    
+    *mode = (modbus_mode_t)header[5];
+    *baud_rate = (uint32_t)header[8] | ((uint32_t)header[9] << 8) |
+                 ((uint32_t)header[10] << 16) | ((uint32_t)header[11] << 24);
+                 
+    return true;
+}
+
+uint16_t modbus_capture_record_encode(uint8_t * encoded, 
+                                      const modbus_capture_record_t * record, 
+                                      const uint8_t * data, 
+                                      uint32_t previous_us)
+{
+    uint16_t pos = 0;
+    
+    encoded[pos++] = (uint8_t)record->type;
+    pos += leb128_encode(&encoded[pos], record->timestamp_us - previous_us);
+    pos += leb128_encode(&encoded[pos], record->length);
+    if ((record->type == MODBUS_CAPTURE_TX) || (record->type == MODBUS_CAPTURE_RX))
+    {
+        memcpy(&encoded[pos], data, record->length);
+        pos += record->length;
+    }
+    
+    return pos;
+}
+
+size_t modbus_capture_record_decode(const uint8_t * encoded, 
+                                    size_t encoded_size, 
+                                    modbus_capture_record_t * record, 
+                                    const uint8_t ** data, 
+                                    uint32_t previous_us)
+{
+    uint32_t delta_us;
+    uint32_t length;
+    
+    if ((encoded_size < 1) || (encoded[0] > MODBUS_CAPTURE_LOST))
+    {
+        return 0;
+    }
+    
+    size_t pos = 1;
+    uint8_t count = leb128_decode(&encoded[pos], encoded_size - pos, &delta_us);
+    if (count == 0)
+    {
+        return 0;
+    }
+    pos += count;
+    
+    count = leb128_decode(&encoded[pos], encoded_size - pos, &length);
+    if ((count == 0) || (length > UINT16_MAX))
+    {
+        return 0;
+    }
+    pos += count;
+    
+    record->type = (modbus_capture_type_t)encoded[0];
+    record->timestamp_us = previous_us + delta_us;
+    record->length = (uint16_t)length;
+    *data = &encoded[pos];
+    
+    if ((record->type == MODBUS_CAPTURE_TX) || (record->type == MODBUS_CAPTURE_RX))
+    {
+        if ((length > MODBUS_CAPTURE_DATA_MAX) || (encoded_size - pos < length))
+        {
+            return 0;
+        }
+        pos += length;
+    }
+    
+    return pos;
+}
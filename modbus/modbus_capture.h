@@ -0,0 +1,164 @@
+/**
+ * @ingroup modbus_protocol
+ *
+ * @defgroup modbus_capture Modbus wire capture
+ *
+ * @brief Capture of the data written to and read from the bus.
+ *
+ * modbus_capture_attach() wraps the bus callbacks of the context. Every write, read and receive
+ * is stored as a timestamped record in a lock-free single-producer single-consumer ring: the bus
+ * thread produces records without waiting, another thread consumes them with modbus_capture_pop()
+ * (@see serial_capture to store them in a file). Records which do not fit into the ring are dropped
+ * and reported by a MODBUS_CAPTURE_LOST record at their position.
+ *
+ * Timestamps are taken from the bus clock callback (0 if there is no clock).
+ *
+ * Capture file consists of a header (MODBUS_CAPTURE_FILE_HEADER_SIZE bytes) followed by records:
+ * - type (1 byte);
+ * - time since the previous record in microseconds (unsigned LEB128);
+ * - length (unsigned LEB128);
+ * - data (length bytes for MODBUS_CAPTURE_TX and MODBUS_CAPTURE_RX only).
+ *
+ * @{
+ */
+
+#ifndef _MODBUS_CAPTURE_H_
+#define _MODBUS_CAPTURE_H_
+
+#include "modbus_protocol.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define MODBUS_CAPTURE_DATA_MAX             MODBUS_PROTOCOL_BUFFER_SIZE /**< Maximum data length of a record, longer data is dropped. */
+#define MODBUS_CAPTURE_RING_HEADER_SIZE     (8)     /**< Size of the record header in the ring. */
+#define MODBUS_CAPTURE_FILE_HEADER_SIZE     (12)    /**< Size of the capture file header. */
+#define MODBUS_CAPTURE_FILE_VERSION         (1)     /**< Version of the capture file format. */
+#define MODBUS_CAPTURE_RECORD_ENCODED_MAX   (1 + 5 + 3 + MODBUS_CAPTURE_DATA_MAX) /**< Maximum size of an encoded record. */
+
+/**@brief Capture record types. */
+typedef enum
+{
+    MODBUS_CAPTURE_TX,                                  /**< Data written to the bus, timestamp is the end of the write. */
+    MODBUS_CAPTURE_RX,                                  /**< Data read from the bus, timestamp is the end of the read. */
+    MODBUS_CAPTURE_TIMEOUT,                             /**< Read timed out, length is the number of requested bytes (no data). */
+    MODBUS_CAPTURE_LOST                                 /**< Records dropped because the ring was full, length is their number (no data). */
+} modbus_capture_type_t;
+
+/**@brief Capture record. */
+typedef struct
+{
+    modbus_capture_type_t type;                         /**< Record type. */
+    uint32_t timestamp_us;                              /**< Time of the record (bus clock, wraps around). */
+    uint16_t length;                                    /**< Length of the data, @see modbus_capture_type_t. */
+} modbus_capture_record_t;
+
+/**@brief Capture of the bus. */
+typedef struct
+{
+    uint8_t * storage;                                  /**< Ring storage. */
+    uint32_t mask;                                      /**< Ring size minus one (size is a power of two). */
+    atomic_uint head;                                   /**< Write position (free-running), advanced by the bus thread. */
+    atomic_uint tail;                                   /**< Read position (free-running), advanced by the consumer. */
+    atomic_uint lost;                                   /**< Total number of dropped records, including the ones not reported in the ring. */
+    uint16_t pending_lost;                              /**< Dropped records not reported yet (bus thread only). */
+    modbus_write_callback_t write;                      /**< Captured bus write callback. */
+    modbus_read_callback_t read;                        /**< Captured bus read callback. */
+    modbus_writev_callback_t writev;                    /**< Captured bus scatter-gather write callback. */
+    modbus_receive_callback_t receive;                  /**< Captured bus receive callback. */
+    modbus_idle_callback_t idle;                        /**< Captured bus idle callback. */
+    modbus_delay_callback_t delay;                      /**< Captured bus delay callback. */
+    modbus_clock_callback_t clock;                      /**< Captured bus clock callback. */
+    void * user_data;                                   /**< Captured user data of the bus callbacks. */
+} modbus_capture_t;
+
+/**@brief Initialize capture.
+ *
+ * @param[out] capture Pointer to the capture.
+ * @param[in]  storage Pointer to the ring storage.
+ * @param[in]  size    Size of the ring storage, a power of two not less than 2 * MODBUS_CAPTURE_DATA_MAX.
+ *
+ * @retval true if successful, false if the size is invalid.
+ */
+bool modbus_capture_initialize(modbus_capture_t * capture, uint8_t * storage, uint32_t size);
+
+/**@brief Start capture of the bus: the bus callbacks of the context are wrapped by the capture.
+ *        Must be called by the thread which drives the bus while no transaction is in progress.
+ *
+ * @param[in,out] ctx     Pointer to the modbus context.
+ * @param[in]     capture Pointer to the initialized capture.
+ */
+void modbus_capture_attach(modbus_ctx_t * ctx, modbus_capture_t * capture);
+
+/**@brief Stop capture of the bus: the bus callbacks of the context are restored and the records dropped
+ *        since the last stored record are reported if there is room in the ring (they are counted anyway).
+ *        Must be called by the thread which drives the bus while no transaction is in progress.
+ *
+ * @param[in,out] ctx     Pointer to the modbus context.
+ * @param[in]     capture Pointer to the attached capture.
+ */
+void modbus_capture_detach(modbus_ctx_t * ctx, modbus_capture_t * capture);
+
+/**@brief Take the oldest record from the ring. Must be called by a single consumer thread.
+ *
+ * @param[in]  capture Pointer to the capture.
+ * @param[out] record  Pointer to store the record.
+ * @param[out] data    Pointer to store the data, at least MODBUS_CAPTURE_DATA_MAX bytes.
+ *
+ * @retval true if the record is taken, false if the ring is empty.
+ */
+bool modbus_capture_pop(modbus_capture_t * capture, modbus_capture_record_t * record, uint8_t * data);
+
+/**@brief Encode capture file header.
+ *
+ * @param[out] header    Pointer to store MODBUS_CAPTURE_FILE_HEADER_SIZE bytes.
+ * @param[in]  mode      Modbus mode of the bus.
+ * @param[in]  baud_rate Baud rate of the bus (0 if unknown).
+ */
+void modbus_capture_header_encode(uint8_t * header, modbus_mode_t mode, uint32_t baud_rate);
+
+/**@brief Decode capture file header.
+ *
+ * @param[in]  header    Pointer to MODBUS_CAPTURE_FILE_HEADER_SIZE bytes.
+ * @param[out] mode      Pointer to store the Modbus mode of the bus.
+ * @param[out] baud_rate Pointer to store the baud rate of the bus.
+ *
+ * @retval true if successful, false if the header is not a capture file header of a supported version.
+ */
+bool modbus_capture_header_decode(const uint8_t * header, modbus_mode_t * mode, uint32_t * baud_rate);
+
+/**@brief Encode record for the capture file.
+ *
+ * @param[out] encoded     Pointer to store the record, at least MODBUS_CAPTURE_RECORD_ENCODED_MAX bytes.
+ * @param[in]  record      Pointer to the record.
+ * @param[in]  data        Pointer to the data of the record.
+ * @param[in]  previous_us Timestamp of the previous record in the file.
+ *
+ * @return Size of the encoded record in bytes.
+ */
+uint16_t modbus_capture_record_encode(uint8_t * encoded, 
+                                      const modbus_capture_record_t * record, 
+                                      const uint8_t * data, 
+                                      uint32_t previous_us);
+
+/**@brief Decode record of the capture file.
+ *
+ * @param[in]  encoded      Pointer to the encoded record.
+ * @param[in]  encoded_size Number of available bytes.
+ * @param[out] record       Pointer to store the record.
+ * @param[out] data         Pointer to store the pointer to the data inside the encoded record.
+ * @param[in]  previous_us  Timestamp of the previous record in the file.
+ *
+ * @return Size of the encoded record in bytes, 0 if it is truncated or invalid.
+ */
+size_t modbus_capture_record_decode(const uint8_t * encoded, 
+                                    size_t encoded_size, 
+                                    modbus_capture_record_t * record, 
+                                    const uint8_t ** data, 
+                                    uint32_t previous_us);
+
+#endif
+
+/** @} */
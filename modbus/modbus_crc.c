@@ -0,0 +1,321 @@
+#include "modbus_crc.h"
+
+#if (MODBUS_CRC_CLMUL_SUPPORTED)
+#include <immintrin.h>
+#endif
+
+/**@brief Table of CRC values for high-order byte. */
+static const uint8_t crc_high_table[] = {
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
+    0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 
+    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
+    0x00, 0xC1, 0x81, 0x40
+};
+
+/**@brief Table of CRC values for low-order byte. */
+static const uint8_t crc_low_table[] = {
+    0x00, 0xC0, 0xC1, 0x01, 0xC3, 0x03, 0x02, 0xC2, 0xC6, 0x06, 0x07, 0xC7,
+    0x05, 0xC5, 0xC4, 0x04, 0xCC, 0x0C, 0x0D, 0xCD, 0x0F, 0xCF, 0xCE, 0x0E,
+    0x0A, 0xCA, 0xCB, 0x0B, 0xC9, 0x09, 0x08, 0xC8, 0xD8, 0x18, 0x19, 0xD9,
+    0x1B, 0xDB, 0xDA, 0x1A, 0x1E, 0xDE, 0xDF, 0x1F, 0xDD, 0x1D, 0x1C, 0xDC,
+    0x14, 0xD4, 0xD5, 0x15, 0xD7, 0x17, 0x16, 0xD6, 0xD2, 0x12, 0x13, 0xD3,
+    0x11, 0xD1, 0xD0, 0x10, 0xF0, 0x30, 0x31, 0xF1, 0x33, 0xF3, 0xF2, 0x32,
+    0x36, 0xF6, 0xF7, 0x37, 0xF5, 0x35, 0x34, 0xF4, 0x3C, 0xFC, 0xFD, 0x3D,
+    0xFF, 0x3F, 0x3E, 0xFE, 0xFA, 0x3A, 0x3B, 0xFB, 0x39, 0xF9, 0xF8, 0x38, 
+    0x28, 0xE8, 0xE9, 0x29, 0xEB, 0x2B, 0x2A, 0xEA, 0xEE, 0x2E, 0x2F, 0xEF,
+    0x2D, 0xED, 0xEC, 0x2C, 0xE4, 0x24, 0x25, 0xE5, 0x27, 0xE7, 0xE6, 0x26,
+    0x22, 0xE2, 0xE3, 0x23, 0xE1, 0x21, 0x20, 0xE0, 0xA0, 0x60, 0x61, 0xA1,
+    0x63, 0xA3, 0xA2, 0x62, 0x66, 0xA6, 0xA7, 0x67, 0xA5, 0x65, 0x64, 0xA4,
+    0x6C, 0xAC, 0xAD, 0x6D, 0xAF, 0x6F, 0x6E, 0xAE, 0xAA, 0x6A, 0x6B, 0xAB, 
+    0x69, 0xA9, 0xA8, 0x68, 0x78, 0xB8, 0xB9, 0x79, 0xBB, 0x7B, 0x7A, 0xBA,
+    0xBE, 0x7E, 0x7F, 0xBF, 0x7D, 0xBD, 0xBC, 0x7C, 0xB4, 0x74, 0x75, 0xB5,
+    0x77, 0xB7, 0xB6, 0x76, 0x72, 0xB2, 0xB3, 0x73, 0xB1, 0x71, 0x70, 0xB0,
+    0x50, 0x90, 0x91, 0x51, 0x93, 0x53, 0x52, 0x92, 0x96, 0x56, 0x57, 0x97,
+    0x55, 0x95, 0x94, 0x54, 0x9C, 0x5C, 0x5D, 0x9D, 0x5F, 0x9F, 0x9E, 0x5E,
+    0x5A, 0x9A, 0x9B, 0x5B, 0x99, 0x59, 0x58, 0x98, 0x88, 0x48, 0x49, 0x89,
+    0x4B, 0x8B, 0x8A, 0x4A, 0x4E, 0x8E, 0x8F, 0x4F, 0x8D, 0x4D, 0x4C, 0x8C,
+    0x44, 0x84, 0x85, 0x45, 0x87, 0x47, 0x46, 0x86, 0x82, 0x42, 0x43, 0x83,
+    0x41, 0x81, 0x80, 0x40
+};
+
+/**@brief Slicing tables, table k holds the CRC of a byte followed by k zero bytes. */
+static uint16_t crc_slice_table[16][256];
+static bool crc_slice_table_built = false;
+
+/**@brief Selected kernel. */
+static modbus_crc_engine_t crc_engine = MODBUS_CRC_ENGINE_TABLE;
+static uint16_t (*crc_update)(uint16_t crc, const uint8_t * data, size_t data_length) = modbus_crc_update_table;
+
+uint16_t modbus_crc_update_table(uint16_t crc, const uint8_t * data, size_t data_length)
+{
+    uint8_t crc_high = (uint8_t)(crc >> 8);
+    uint8_t crc_low = (uint8_t)(crc & 0xFF);
+    
+    while (data_length--)
+    {
+        uint32_t i = crc_low ^ *(data++);
+        crc_low = (uint8_t)(crc_high ^ crc_high_table[i]);
+        crc_high = crc_low_table[i];
+    }
+    
+    return (uint16_t)(crc_high << 8 | crc_low);
+}
+
+uint16_t modbus_crc_update_slice8(uint16_t crc, const uint8_t * data, size_t data_length)
+{
+    while (data_length >= 8)
+    {
+        const uint16_t x = crc ^ (uint16_t)(data[0] | (data[1] << 8));
+        crc = crc_slice_table[7][x & 0xFF] ^ crc_slice_table[6][x >> 8] ^ 
+              crc_slice_table[5][data[2]] ^ crc_slice_table[4][data[3]] ^ 
+              crc_slice_table[3][data[4]] ^ crc_slice_table[2][data[5]] ^ 
+              crc_slice_table[1][data[6]] ^ crc_slice_table[0][data[7]];
+        data += 8;
+        data_length -= 8;
+    }
+    
+    while (data_length--)
+    {
+        crc = (uint16_t)((crc >> 8) ^ crc_slice_table[0][(crc ^ *(data++)) & 0xFF]);
+    }
+    
+    return crc;
+}
+
+uint16_t modbus_crc_update_slice16(uint16_t crc, const uint8_t * data, size_t data_length)
+{
+    while (data_length >= 16)
+    {
+        const uint16_t x = crc ^ (uint16_t)(data[0] | (data[1] << 8));
+        crc = crc_slice_table[15][x & 0xFF] ^ crc_slice_table[14][x >> 8] ^ 
+              crc_slice_table[13][data[2]] ^ crc_slice_table[12][data[3]] ^ 
+              crc_slice_table[11][data[4]] ^ crc_slice_table[10][data[5]] ^ 
+              crc_slice_table[9][data[6]] ^ crc_slice_table[8][data[7]] ^ 
+              crc_slice_table[7][data[8]] ^ crc_slice_table[6][data[9]] ^ 
+              crc_slice_table[5][data[10]] ^ crc_slice_table[4][data[11]] ^ 
+              crc_slice_table[3][data[12]] ^ crc_slice_table[2][data[13]] ^ 
+              crc_slice_table[1][data[14]] ^ crc_slice_table[0][data[15]];
+        data += 16;
+        data_length -= 16;
+    }
+    
+    return modbus_crc_update_slice8(crc, data, data_length);
+}
+
+#if (MODBUS_CRC_CLMUL_SUPPORTED)
+/* Folding constants: x^(D + 63) mod P and x^(D - 1) mod P, bit-reflected into 64 bits, 
+ * for the folding distance D of 512 bits (4 blocks) and 128 bits (1 block). */
+#define CRC_FOLD_512_HIGH    (0xC450000000000000ULL)
+#define CRC_FOLD_512_LOW     (0x8101000000000000ULL)
+#define CRC_FOLD_128_HIGH    (0xCCD0000000000000ULL)
+#define CRC_FOLD_128_LOW     (0xC100000000000000ULL)
+
+/**@brief Fold 128-bit block forward by the distance given by constants.
+ */
+__attribute__((target("pclmul,sse2")))
+static inline __m128i crc_fold(__m128i block, __m128i constants)
+{
+    return _mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x00), 
+                         _mm_clmulepi64_si128(block, constants, 0x11));
+}
+
+__attribute__((target("pclmul,sse2")))
+uint16_t modbus_crc_update_clmul(uint16_t crc, const uint8_t * data, size_t data_length)
+{
+    if (data_length < 64)
+    {
+        return modbus_crc_update_slice16(crc, data, data_length);
+    }
+    
+    const __m128i fold_512 = _mm_set_epi64x((long long)CRC_FOLD_512_LOW, (long long)CRC_FOLD_512_HIGH);
+    const __m128i fold_128 = _mm_set_epi64x((long long)CRC_FOLD_128_LOW, (long long)CRC_FOLD_128_HIGH);
+    
+    //Current CRC state is equivalent to XOR with the first two message bytes
+    __m128i x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)data), _mm_cvtsi32_si128(crc));
+    __m128i x1 = _mm_loadu_si128((const __m128i *)(data + 16));
+    __m128i x2 = _mm_loadu_si128((const __m128i *)(data + 32));
+    __m128i x3 = _mm_loadu_si128((const __m128i *)(data + 48));
+    data += 64;
+    data_length -= 64;
+    
+    while (data_length >= 64)
+    {
+        x0 = _mm_xor_si128(crc_fold(x0, fold_512), _mm_loadu_si128((const __m128i *)data));
+        x1 = _mm_xor_si128(crc_fold(x1, fold_512), _mm_loadu_si128((const __m128i *)(data + 16)));
+        x2 = _mm_xor_si128(crc_fold(x2, fold_512), _mm_loadu_si128((const __m128i *)(data + 32)));
+        x3 = _mm_xor_si128(crc_fold(x3, fold_512), _mm_loadu_si128((const __m128i *)(data + 48)));
+        data += 64;
+        data_length -= 64;
+    }
+    
+    x1 = _mm_xor_si128(crc_fold(x0, fold_128), x1);
+    x2 = _mm_xor_si128(crc_fold(x1, fold_128), x2);
+    x3 = _mm_xor_si128(crc_fold(x2, fold_128), x3);
+    
+    while (data_length >= 16)
+    {
+        x3 = _mm_xor_si128(crc_fold(x3, fold_128), _mm_loadu_si128((const __m128i *)data));
+        data += 16;
+        data_length -= 16;
+    }
+    
+    //Remaining 128 bits are congruent to the folded message, finish with the table kernel
+    uint8_t remainder[16];
+    _mm_storeu_si128((__m128i *)remainder, x3);
+    crc = modbus_crc_update_slice16(0, remainder, sizeof(remainder));
+    
+    return modbus_crc_update_slice16(crc, data, data_length);
+}
+
+/**@brief Check if the CPU supports carry-less multiplication.
+ */
+static bool crc_clmul_available(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+}
+#endif
+
+/**@brief Cross-check kernel against the reference implementation using whole and split messages 
+ *        of different lengths and alignments.
+ */
+static bool crc_kernel_check(uint16_t (*update)(uint16_t crc, const uint8_t * data, size_t data_length))
+{
+    uint8_t data[1024 + 16];
+    uint32_t seed = 0x12345678;
+    
+    for (uint16_t i = 0; i < sizeof(data); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+    
+    for (uint16_t length = 0; length <= 1024; length += (length < 300) ? 1 : 61)
+    {
+        const uint8_t * message = &data[length & 0x0F];
+        const uint16_t expected = modbus_crc_update_table(MODBUS_CRC_INITIAL, message, length);
+        const uint16_t split = length / 3;
+        
+        if ((update(MODBUS_CRC_INITIAL, message, length) != expected) || 
+            (update(update(MODBUS_CRC_INITIAL, message, split), &message[split], length - split) != expected))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**@brief Build the slicing tables from the reference tables.
+ */
+static void crc_slice_table_build(void)
+{
+    if (crc_slice_table_built)
+    {
+        return;
+    }
+    
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        crc_slice_table[0][i] = (uint16_t)(crc_low_table[i] << 8 | crc_high_table[i]);
+    }
+    for (uint16_t k = 1; k < 16; k++)
+    {
+        for (uint16_t i = 0; i < 256; i++)
+        {
+            const uint16_t previous = crc_slice_table[k - 1][i];
+            crc_slice_table[k][i] = (uint16_t)((previous >> 8) ^ crc_slice_table[0][previous & 0xFF]);
+        }
+    }
+    
+    crc_slice_table_built = true;
+}
+
+void modbus_crc_initialize(void)
+{
+    static bool initialized = false;
+    
+    if (initialized)
+    {
+        return;
+    }
+    
+    if (!modbus_crc_engine_select(MODBUS_CRC_ENGINE_CLMUL))
+    {
+        modbus_crc_engine_select(MODBUS_CRC_ENGINE_SLICE16);
+    }
+    
+    initialized = true;
+}
+
+bool modbus_crc_engine_select(modbus_crc_engine_t engine)
+{
+    uint16_t (*update)(uint16_t crc, const uint8_t * data, size_t data_length);
+    
+    switch (engine)
+    {
+        case MODBUS_CRC_ENGINE_TABLE:
+            update = modbus_crc_update_table;
+            break;
+            
+        case MODBUS_CRC_ENGINE_SLICE8:
+            update = modbus_crc_update_slice8;
+            break;
+            
+        case MODBUS_CRC_ENGINE_SLICE16:
+            update = modbus_crc_update_slice16;
+            break;
+            
+#if (MODBUS_CRC_CLMUL_SUPPORTED)
+        case MODBUS_CRC_ENGINE_CLMUL:
+            if (!crc_clmul_available())
+            {
+                return false;
+            }
+            update = modbus_crc_update_clmul;
+            break;
+#endif
+            
+        default:
+            return false;
+    }
+    
+    crc_slice_table_build();
+    if (!crc_kernel_check(update))
+    {
+        return false;
+    }
+    
+    crc_engine = engine;
+    crc_update = update;
+    
+    return true;
+}
+
+modbus_crc_engine_t modbus_crc_engine_get(void)
+{
+    return crc_engine;
+}
+
+uint16_t modbus_crc_update(uint16_t crc, const uint8_t * data, size_t data_length)
+{
+    return crc_update(crc, data, data_length);
+}
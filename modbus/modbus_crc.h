@@ -0,0 +1,91 @@
+/**
+ * @ingroup modbus_protocol
+ *
+ * @defgroup modbus_crc Modbus CRC engine
+ *
+ * @brief CRC-16-MODBUS (polynomial x16 + x15 + x2 + 1, reflected, initial value 0xFFFF) engine 
+ * with interchangeable kernels:
+ * - table: byte-wise lookup, the reference implementation;
+ * - slice8: slicing-by-8 lookup, processes 8 bytes per iteration;
+ * - slice16: slicing-by-16 lookup, processes 16 bytes per iteration;
+ * - clmul: carry-less multiplication folding (x86-64 with PCLMULQDQ), processes 64 bytes per iteration.
+ *
+ * The best kernel available on the running CPU is selected by modbus_crc_initialize(). Every kernel 
+ * is cross-checked against the reference implementation before it is selected. The slicing tables 
+ * are built by the first modbus_crc_initialize() or modbus_crc_engine_select() call, the slicing 
+ * and clmul kernels must not be called directly before that.
+ *
+ * @{
+ */
+
+#ifndef _MODBUS_CRC_H_
+#define _MODBUS_CRC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define MODBUS_CRC_INITIAL    (0xFFFF)
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MODBUS_CRC_CLMUL_SUPPORTED    (1)
+#endif
+
+/**@brief CRC kernels. */
+typedef enum
+{
+    MODBUS_CRC_ENGINE_TABLE,                            /**< Byte-wise lookup (reference). */
+    MODBUS_CRC_ENGINE_SLICE8,                           /**< Slicing-by-8 lookup. */
+    MODBUS_CRC_ENGINE_SLICE16,                          /**< Slicing-by-16 lookup. */
+    MODBUS_CRC_ENGINE_CLMUL                             /**< Carry-less multiplication folding. */
+} modbus_crc_engine_t;
+
+/**@brief Initialize CRC engine and select the fastest kernel which passes the cross-check.
+ *        Must be called before any other thread uses the engine. Repeated calls have no effect.
+ */
+void modbus_crc_initialize(void);
+
+/**@brief Select CRC kernel. Builds the slicing tables if modbus_crc_initialize() was not called yet.
+ *
+ * @param[in] engine Kernel to select.
+ *
+ * @retval true if selected, false if the kernel is not supported by the CPU or failed the cross-check.
+ */
+bool modbus_crc_engine_select(modbus_crc_engine_t engine);
+
+/**@brief Get selected CRC kernel.
+ */
+modbus_crc_engine_t modbus_crc_engine_get(void);
+
+/**@brief Update CRC using the selected kernel.
+ *
+ * @param[in] crc         Current CRC state (MODBUS_CRC_INITIAL for a new message).
+ * @param[in] data        Pointer to data.
+ * @param[in] data_length Length of the data in bytes.
+ *
+ * @return Updated CRC state. Low byte is transmitted first.
+ */
+uint16_t modbus_crc_update(uint16_t crc, const uint8_t * data, size_t data_length);
+
+/**@brief Update CRC using the byte-wise lookup kernel (reference implementation).
+ */
+uint16_t modbus_crc_update_table(uint16_t crc, const uint8_t * data, size_t data_length);
+
+/**@brief Update CRC using the slicing-by-8 kernel. Valid after modbus_crc_initialize() or modbus_crc_engine_select().
+ */
+uint16_t modbus_crc_update_slice8(uint16_t crc, const uint8_t * data, size_t data_length);
+
+/**@brief Update CRC using the slicing-by-16 kernel. Valid after modbus_crc_initialize() or modbus_crc_engine_select().
+ */
+uint16_t modbus_crc_update_slice16(uint16_t crc, const uint8_t * data, size_t data_length);
+
+#if (MODBUS_CRC_CLMUL_SUPPORTED)
+/**@brief Update CRC using the carry-less multiplication kernel. The CPU must support PCLMULQDQ.
+ *        Valid after modbus_crc_initialize() or modbus_crc_engine_select().
+ */
+uint16_t modbus_crc_update_clmul(uint16_t crc, const uint8_t * data, size_t data_length);
+#endif
+
+#endif
+
+/** @} */
@@ -0,0 +1,452 @@
+#include "modbus_hex.h"
+
+#include <string.h>
+
+#if (MODBUS_HEX_X86_SUPPORTED)
+#include <immintrin.h>
+#endif
+
+#if (MODBUS_HEX_NEON_SUPPORTED)
+#include <arm_neon.h>
+#endif
+
+/**@brief Uppercase hex digits. */
+static const uint8_t hex_digits[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+/**@brief Table of nibble values for characters, invalid characters have the high nibble set. */
+static const uint8_t hex_value_table[256] = {
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0
+};
+
+/**@brief Selected kernel. */
+static modbus_hex_engine_t hex_engine = MODBUS_HEX_ENGINE_LUT;
+static void (*hex_encode)(uint8_t * chars, const uint8_t * bytes, size_t bytes_length) = modbus_hex_encode_lut;
+static bool (*hex_decode)(uint8_t * bytes, const uint8_t * chars, size_t bytes_length) = modbus_hex_decode_lut;
+
+void modbus_hex_encode_lut(uint8_t * chars, const uint8_t * bytes, size_t bytes_length)
+{
+    //Expand from the end, so that every byte is converted before its position is overwritten
+    for (size_t i = bytes_length; i-- > 0;)
+    {
+        const uint8_t byte = bytes[i];
+        chars[2 * i + 1] = hex_digits[byte & 0x0F];
+        chars[2 * i] = hex_digits[byte >> 4];
+    }
+}
+
+bool modbus_hex_decode_lut(uint8_t * bytes, const uint8_t * chars, size_t bytes_length)
+{
+    uint8_t invalid = 0;
+    
+    //Shrink from the start, every pair of characters is read before its position is overwritten
+    for (size_t i = 0; i < bytes_length; i++)
+    {
+        const uint8_t high = hex_value_table[chars[2 * i]];
+        const uint8_t low = hex_value_table[chars[2 * i + 1]];
+        invalid |= (uint8_t)(high | low);
+        bytes[i] = (uint8_t)((high << 4) | low);
+    }
+    
+    return (invalid & 0xF0) == 0;
+}
+
+#if (MODBUS_HEX_X86_SUPPORTED)
+/**@brief Convert nibbles to uppercase hex digits.
+ */
+__attribute__((target("sse2")))
+static inline __m128i hex_chars_sse2(__m128i nibbles)
+{
+    const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '9' - 1));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+/**@brief Convert characters to nibbles, clear lanes of valid for invalid characters.
+ */
+__attribute__((target("sse2")))
+static inline __m128i hex_nibbles_sse2(__m128i chars, __m128i * valid)
+{
+    //Unsigned range checks: x <= limit if min(x, limit) == x
+    const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    
+    *valid = _mm_and_si128(*valid, _mm_or_si128(is_digit, is_letter));
+    
+    return _mm_or_si128(_mm_and_si128(is_digit, digit), 
+                        _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+/**@brief Join pairs of nibbles (high nibble first) into the low bytes of 16-bit lanes.
+ */
+__attribute__((target("sse2")))
+static inline __m128i hex_join_sse2(__m128i nibbles)
+{
+    const __m128i joined = _mm_or_si128(_mm_slli_epi16(nibbles, 4), _mm_srli_epi16(nibbles, 8));
+    return _mm_and_si128(joined, _mm_set1_epi16(0x00FF));
+}
+
+__attribute__((target("sse2")))
+void modbus_hex_encode_sse2(uint8_t * chars, const uint8_t * bytes, size_t bytes_length)
+{
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    size_t i = bytes_length;
+    
+    //Expand from the end, every block is loaded before its characters are stored
+    while (i >= 16)
+    {
+        i -= 16;
+        const __m128i block = _mm_loadu_si128((const __m128i *)&bytes[i]);
+        const __m128i high = hex_chars_sse2(_mm_and_si128(_mm_srli_epi16(block, 4), mask));
+        const __m128i low = hex_chars_sse2(_mm_and_si128(block, mask));
+        _mm_storeu_si128((__m128i *)&chars[2 * i + 16], _mm_unpackhi_epi8(high, low));
+        _mm_storeu_si128((__m128i *)&chars[2 * i], _mm_unpacklo_epi8(high, low));
+    }
+    
+    modbus_hex_encode_lut(chars, bytes, i);
+}
+
+__attribute__((target("sse2")))
+bool modbus_hex_decode_sse2(uint8_t * bytes, const uint8_t * chars, size_t bytes_length)
+{
+    __m128i valid = _mm_set1_epi8(-1);
+    size_t i = 0;
+    
+    //Shrink from the start, every block of characters is loaded before its bytes are stored
+    while (bytes_length - i >= 16)
+    {
+        const __m128i first = hex_nibbles_sse2(_mm_loadu_si128((const __m128i *)&chars[2 * i]), &valid);
+        const __m128i second = hex_nibbles_sse2(_mm_loadu_si128((const __m128i *)&chars[2 * i + 16]), &valid);
+        _mm_storeu_si128((__m128i *)&bytes[i], _mm_packus_epi16(hex_join_sse2(first), hex_join_sse2(second)));
+        i += 16;
+    }
+    
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+    {
+        return false;
+    }
+    
+    return modbus_hex_decode_lut(&bytes[i], &chars[2 * i], bytes_length - i);
+}
+
+/**@brief Convert nibbles to uppercase hex digits.
+ */
+__attribute__((target("avx2")))
+static inline __m256i hex_chars_avx2(__m256i nibbles)
+{
+    const __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), 
+                                             _mm256_set1_epi8('A' - '9' - 1));
+    return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+}
+
+/**@brief Convert characters to nibbles, clear lanes of valid for invalid characters.
+ */
+__attribute__((target("avx2")))
+static inline __m256i hex_nibbles_avx2(__m256i chars, __m256i * valid)
+{
+    const __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+    const __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    const __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+    
+    *valid = _mm256_and_si256(*valid, _mm256_or_si256(is_digit, is_letter));
+    
+    return _mm256_or_si256(_mm256_and_si256(is_digit, digit), 
+                           _mm256_and_si256(is_letter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+/**@brief Join pairs of nibbles (high nibble first) into the low bytes of 16-bit lanes.
+ */
+__attribute__((target("avx2")))
+static inline __m256i hex_join_avx2(__m256i nibbles)
+{
+    const __m256i joined = _mm256_or_si256(_mm256_slli_epi16(nibbles, 4), _mm256_srli_epi16(nibbles, 8));
+    return _mm256_and_si256(joined, _mm256_set1_epi16(0x00FF));
+}
+
+__attribute__((target("avx2")))
+void modbus_hex_encode_avx2(uint8_t * chars, const uint8_t * bytes, size_t bytes_length)
+{
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    size_t i = bytes_length;
+    
+    while (i >= 32)
+    {
+        i -= 32;
+        const __m256i block = _mm256_loadu_si256((const __m256i *)&bytes[i]);
+        const __m256i high = hex_chars_avx2(_mm256_and_si256(_mm256_srli_epi16(block, 4), mask));
+        const __m256i low = hex_chars_avx2(_mm256_and_si256(block, mask));
+        
+        //Unpacking works within 128-bit lanes, restore the byte order across lanes
+        const __m256i first = _mm256_unpacklo_epi8(high, low);
+        const __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i *)&chars[2 * i + 32], _mm256_permute2x128_si256(first, second, 0x31));
+        _mm256_storeu_si256((__m256i *)&chars[2 * i], _mm256_permute2x128_si256(first, second, 0x20));
+    }
+    
+    modbus_hex_encode_sse2(chars, bytes, i);
+}
+
+__attribute__((target("avx2")))
+bool modbus_hex_decode_avx2(uint8_t * bytes, const uint8_t * chars, size_t bytes_length)
+{
+    __m256i valid = _mm256_set1_epi8(-1);
+    size_t i = 0;
+    
+    while (bytes_length - i >= 32)
+    {
+        const __m256i first = hex_nibbles_avx2(_mm256_loadu_si256((const __m256i *)&chars[2 * i]), &valid);
+        const __m256i second = hex_nibbles_avx2(_mm256_loadu_si256((const __m256i *)&chars[2 * i + 32]), &valid);
+        
+        //Packing works within 128-bit lanes, restore the byte order across lanes
+        const __m256i packed = _mm256_packus_epi16(hex_join_avx2(first), hex_join_avx2(second));
+        _mm256_storeu_si256((__m256i *)&bytes[i], _mm256_permute4x64_epi64(packed, 0xD8));
+        i += 32;
+    }
+    
+    if (_mm256_movemask_epi8(valid) != -1)
+    {
+        return false;
+    }
+    
+    return modbus_hex_decode_sse2(&bytes[i], &chars[2 * i], bytes_length - i);
+}
+
+/**@brief Check if the CPU supports the vector extension.
+ */
+static bool hex_sse2_available(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+static bool hex_avx2_available(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#if (MODBUS_HEX_NEON_SUPPORTED)
+void modbus_hex_encode_neon(uint8_t * chars, const uint8_t * bytes, size_t bytes_length)
+{
+    const uint8x16_t digits = vld1q_u8(hex_digits);
+    size_t i = bytes_length;
+    
+    //Expand from the end, every block is loaded before its characters are stored
+    while (i >= 16)
+    {
+        i -= 16;
+        const uint8x16_t block = vld1q_u8(&bytes[i]);
+        uint8x16x2_t pairs;
+        pairs.val[0] = vqtbl1q_u8(digits, vshrq_n_u8(block, 4));
+        pairs.val[1] = vqtbl1q_u8(digits, vandq_u8(block, vdupq_n_u8(0x0F)));
+        vst2q_u8(&chars[2 * i], pairs);
+    }
+    
+    modbus_hex_encode_lut(chars, bytes, i);
+}
+
+/**@brief Convert characters to nibbles, clear lanes of valid for invalid characters.
+ */
+static inline uint8x16_t hex_nibbles_neon(uint8x16_t chars, uint8x16_t * valid)
+{
+    const uint8x16_t digit = vsubq_u8(chars, vdupq_n_u8('0'));
+    const uint8x16_t letter = vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+    const uint8x16_t is_digit = vcltq_u8(digit, vdupq_n_u8(10));
+    const uint8x16_t is_letter = vcltq_u8(letter, vdupq_n_u8(6));
+    
+    *valid = vandq_u8(*valid, vorrq_u8(is_digit, is_letter));
+    
+    return vbslq_u8(is_digit, digit, vaddq_u8(letter, vdupq_n_u8(10)));
+}
+
+bool modbus_hex_decode_neon(uint8_t * bytes, const uint8_t * chars, size_t bytes_length)
+{
+    uint8x16_t valid = vdupq_n_u8(0xFF);
+    size_t i = 0;
+    
+    //Shrink from the start, every block of characters is loaded before its bytes are stored
+    while (bytes_length - i >= 16)
+    {
+        const uint8x16x2_t pairs = vld2q_u8(&chars[2 * i]);
+        const uint8x16_t high = hex_nibbles_neon(pairs.val[0], &valid);
+        const uint8x16_t low = hex_nibbles_neon(pairs.val[1], &valid);
+        vst1q_u8(&bytes[i], vorrq_u8(vshlq_n_u8(high, 4), low));
+        i += 16;
+    }
+    
+    if (vminvq_u8(valid) != 0xFF)
+    {
+        return false;
+    }
+    
+    return modbus_hex_decode_lut(&bytes[i], &chars[2 * i], bytes_length - i);
+}
+#endif
+
+/**@brief Cross-check kernel against the reference implementation: separate and in-place conversion 
+ *        of different lengths and alignments, lowercase characters and every invalid character class.
+ */
+static bool hex_kernel_check(void (*encode)(uint8_t * chars, const uint8_t * bytes, size_t bytes_length), 
+                             bool (*decode)(uint8_t * bytes, const uint8_t * chars, size_t bytes_length))
+{
+    static const uint8_t invalid[] = {0x00, 0x10, 0x19, '/', ':', '@', 'G', '`', 'g', 0x80 | 'A', 0xFF};
+    uint8_t data[256 + 16];
+    uint8_t expected[2 * sizeof(data)];
+    uint8_t chars[2 * sizeof(data)];
+    uint8_t bytes[sizeof(data)];
+    uint32_t seed = 0x12345678;
+    
+    for (uint16_t i = 0; i < sizeof(data); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+    
+    for (uint16_t length = 0; length <= 256; length += (length < 80) ? 1 : 11)
+    {
+        const uint8_t * message = &data[length & 0x0F];
+        modbus_hex_encode_lut(expected, message, length);
+        
+        encode(chars, message, length);
+        if (memcmp(chars, expected, 2 * length) != 0)
+        {
+            return false;
+        }
+        
+        memcpy(chars, message, length);
+        encode(chars, chars, length);
+        if ((memcmp(chars, expected, 2 * length) != 0) || 
+            !decode(bytes, chars, length) || (memcmp(bytes, message, length) != 0))
+        {
+            return false;
+        }
+        
+        for (uint16_t i = 0; i < 2 * length; i++)
+        {
+            chars[i] = (uint8_t)(((chars[i] >= 'A') && (i & 0x01)) ? (chars[i] | 0x20) : chars[i]);
+        }
+        if (!decode(chars, chars, length) || (memcmp(chars, message, length) != 0))
+        {
+            return false;
+        }
+        
+        for (uint16_t i = 0; i < 2 * length; i++)
+        {
+            memcpy(chars, expected, 2 * length);
+            chars[i] = invalid[i % sizeof(invalid)];
+            if (decode(bytes, chars, length))
+            {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+void modbus_hex_initialize(void)
+{
+    static bool initialized = false;
+    
+    if (initialized)
+    {
+        return;
+    }
+    
+    if (!modbus_hex_engine_select(MODBUS_HEX_ENGINE_AVX2) && 
+        !modbus_hex_engine_select(MODBUS_HEX_ENGINE_SSE2))
+    {
+        modbus_hex_engine_select(MODBUS_HEX_ENGINE_NEON);
+    }
+    
+    initialized = true;
+}
+
+bool modbus_hex_engine_select(modbus_hex_engine_t engine)
+{
+    void (*encode)(uint8_t * chars, const uint8_t * bytes, size_t bytes_length);
+    bool (*decode)(uint8_t * bytes, const uint8_t * chars, size_t bytes_length);
+    
+    switch (engine)
+    {
+        case MODBUS_HEX_ENGINE_LUT:
+            encode = modbus_hex_encode_lut;
+            decode = modbus_hex_decode_lut;
+            break;
+            
+#if (MODBUS_HEX_X86_SUPPORTED)
+        case MODBUS_HEX_ENGINE_SSE2:
+            if (!hex_sse2_available())
+            {
+                return false;
+            }
+            encode = modbus_hex_encode_sse2;
+            decode = modbus_hex_decode_sse2;
+            break;
+            
+        case MODBUS_HEX_ENGINE_AVX2:
+            if (!hex_sse2_available() || !hex_avx2_available())
+            {
+                return false;
+            }
+            encode = modbus_hex_encode_avx2;
+            decode = modbus_hex_decode_avx2;
+            break;
+#endif
+            
+#if (MODBUS_HEX_NEON_SUPPORTED)
+        case MODBUS_HEX_ENGINE_NEON:
+            encode = modbus_hex_encode_neon;
+            decode = modbus_hex_decode_neon;
+            break;
+#endif
+            
+        default:
+            return false;
+    }
+    
+    if (!hex_kernel_check(encode, decode))
+    {
+        return false;
+    }
+    
+    hex_engine = engine;
+    hex_encode = encode;
+    hex_decode = decode;
+    
+    return true;
+}
+
+modbus_hex_engine_t modbus_hex_engine_get(void)
+{
+    return hex_engine;
+}
+
+void modbus_hex_encode(uint8_t * chars, const uint8_t * bytes, size_t bytes_length)
+{
+    hex_encode(chars, bytes, bytes_length);
+}
+
+bool modbus_hex_decode(uint8_t * bytes, const uint8_t * chars, size_t bytes_length)
+{
+    return hex_decode(bytes, chars, bytes_length);
+}
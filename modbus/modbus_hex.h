@@ -0,0 +1,121 @@
+/**
+ * @ingroup modbus_protocol_ascii
+ *
+ * @defgroup modbus_hex Modbus ASCII hex codec
+ *
+ * @brief Bulk conversion between bytes and pairs of hexadecimal characters with interchangeable kernels:
+ * - lut: lookup tables, one byte per iteration, the reference implementation;
+ * - sse2: 16 bytes per iteration (x86 with SSE2);
+ * - avx2: 32 bytes per iteration (x86 with AVX2);
+ * - neon: 16 bytes per iteration (AArch64).
+ *
+ * Encoding produces uppercase characters. Decoding accepts both uppercase and lowercase characters
+ * and rejects any other character in the same pass.
+ *
+ * Both directions work in place: encoding expands from the end and decoding shrinks from the start,
+ * so characters and bytes may share the same start address.
+ *
+ * The best kernel available on the running CPU is selected by modbus_hex_initialize(). Every kernel
+ * is cross-checked against the reference implementation before it is selected.
+ *
+ * @{
+ */
+
+#ifndef _MODBUS_HEX_H_
+#define _MODBUS_HEX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MODBUS_HEX_X86_SUPPORTED     (1)
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define MODBUS_HEX_NEON_SUPPORTED    (1)
+#endif
+
+/**@brief Hex codec kernels. */
+typedef enum
+{
+    MODBUS_HEX_ENGINE_LUT,                              /**< Lookup tables (reference). */
+    MODBUS_HEX_ENGINE_SSE2,                             /**< SSE2 vectors. */
+    MODBUS_HEX_ENGINE_AVX2,                             /**< AVX2 vectors. */
+    MODBUS_HEX_ENGINE_NEON                              /**< NEON vectors. */
+} modbus_hex_engine_t;
+
+/**@brief Initialize hex codec and select the fastest kernel which passes the cross-check.
+ *        Must be called before any other thread uses the codec. Repeated calls have no effect.
+ */
+void modbus_hex_initialize(void);
+
+/**@brief Select hex codec kernel.
+ *
+ * @param[in] engine Kernel to select.
+ *
+ * @retval true if selected, false if the kernel is not supported by the CPU or failed the cross-check.
+ */
+bool modbus_hex_engine_select(modbus_hex_engine_t engine);
+
+/**@brief Get selected hex codec kernel.
+ */
+modbus_hex_engine_t modbus_hex_engine_get(void);
+
+/**@brief Encode bytes to uppercase hex characters using the selected kernel.
+ *
+ * @param[out] chars        Pointer to store 2 * bytes_length characters, may be equal to bytes.
+ * @param[in]  bytes        Pointer to bytes.
+ * @param[in]  bytes_length Number of bytes.
+ */
+void modbus_hex_encode(uint8_t * chars, const uint8_t * bytes, size_t bytes_length);
+
+/**@brief Decode hex characters to bytes using the selected kernel.
+ *
+ * @param[out] bytes        Pointer to store bytes_length bytes, may be equal to chars.
+ * @param[in]  chars        Pointer to 2 * bytes_length characters.
+ * @param[in]  bytes_length Number of bytes.
+ *
+ * @retval true if all characters are hex digits, false otherwise (the content of bytes is undefined).
+ */
+bool modbus_hex_decode(uint8_t * bytes, const uint8_t * chars, size_t bytes_length);
+
+/**@brief Encode bytes using the lookup kernel (reference implementation).
+ */
+void modbus_hex_encode_lut(uint8_t * chars, const uint8_t * bytes, size_t bytes_length);
+
+/**@brief Decode characters using the lookup kernel (reference implementation).
+ */
+bool modbus_hex_decode_lut(uint8_t * bytes, const uint8_t * chars, size_t bytes_length);
+
+#if (MODBUS_HEX_X86_SUPPORTED)
+/**@brief Encode bytes using the SSE2 kernel. The CPU must support SSE2.
+ */
+void modbus_hex_encode_sse2(uint8_t * chars, const uint8_t * bytes, size_t bytes_length);
+
+/**@brief Decode characters using the SSE2 kernel. The CPU must support SSE2.
+ */
+bool modbus_hex_decode_sse2(uint8_t * bytes, const uint8_t * chars, size_t bytes_length);
+
+/**@brief Encode bytes using the AVX2 kernel. The CPU must support AVX2.
+ */
+void modbus_hex_encode_avx2(uint8_t * chars, const uint8_t * bytes, size_t bytes_length);
+
+/**@brief Decode characters using the AVX2 kernel. The CPU must support AVX2.
+ */
+bool modbus_hex_decode_avx2(uint8_t * bytes, const uint8_t * chars, size_t bytes_length);
+#endif
+
+#if (MODBUS_HEX_NEON_SUPPORTED)
+/**@brief Encode bytes using the NEON kernel.
+ */
+void modbus_hex_encode_neon(uint8_t * chars, const uint8_t * bytes, size_t bytes_length);
+
+/**@brief Decode characters using the NEON kernel.
+ */
+bool modbus_hex_decode_neon(uint8_t * bytes, const uint8_t * chars, size_t bytes_length);
+#endif
+
+#endif
+
+/** @} */
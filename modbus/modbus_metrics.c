@@ -0,0 +1,240 @@
+#include "modbus_metrics.h"
+
+#include <string.h>
+
+/**@brief Start update of the published metrics.
+ */
+static void update_begin(modbus_metrics_t * metrics)
+{
+    const unsigned int sequence = atomic_load_explicit(&metrics->sequence, memory_order_relaxed);
+    
+    //Odd sequence is visible to readers before any data is changed
+    atomic_store_explicit(&metrics->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**@brief Complete update of the published metrics.
+ */
+static void update_end(modbus_metrics_t * metrics)
+{
+    const unsigned int sequence = atomic_load_explicit(&metrics->sequence, memory_order_relaxed);
+    
+    atomic_store_explicit(&metrics->sequence, sequence + 1, memory_order_release);
+}
+
+/**@brief Get histogram bucket of the latency.
+ */
+static uint8_t bucket_index(uint32_t latency_us)
+{
+    uint8_t index = 0;
+    
+#if defined(__GNUC__)
+    if (latency_us > 1)
+    {
+        index = (uint8_t)(31 - __builtin_clz(latency_us));
+    }
+#else
+    while (latency_us > 1)
+    {
+        latency_us >>= 1;
+        index++;
+    }
+#endif
+    
+    return (index < MODBUS_METRICS_BUCKETS_NUM) ? index : MODBUS_METRICS_BUCKETS_NUM - 1;
+}
+
+/**@brief Add result of the transaction to the counters.
+ */
+static void counters_add(modbus_counters_t * counters, 
+                         modbus_protocol_result_t result, 
+                         bool checksum_failed, 
+                         uint32_t answer_length)
+{
+    counters->rx_bytes += answer_length;
+    
+    switch (result)
+    {
+        case MODBUS_PROTOCOL_RESULT_SUCCESS:
+            counters->answers++;
+            break;
+            
+        case MODBUS_PROTOCOL_RESULT_EXCEPTION:
+            counters->answers++;
+            counters->exceptions++;
+            break;
+            
+        case MODBUS_PROTOCOL_RESULT_TIMEOUT:
+            counters->timeouts++;
+            break;
+            
+        case MODBUS_PROTOCOL_RESULT_CORRUPTED:
+            if (checksum_failed)
+            {
+                counters->checksum_errors++;
+            }
+            else
+            {
+                counters->corrupted++;
+            }
+            break;
+            
+        case MODBUS_PROTOCOL_RESULT_IO_ERROR:
+            counters->io_errors++;
+            break;
+            
+        case MODBUS_PROTOCOL_RESULT_OFFLINE:
+            counters->offline++;
+            break;
+            
+        default:
+            break;
+    }
+}
+
+/**@brief Get time from the bus clock, 0 if there is no clock.
+ */
+static uint32_t clock_get(const modbus_ctx_t * ctx)
+{
+    return (ctx->clock != NULL) ? ctx->clock(ctx->user_data) : 0;
+}
+
+void modbus_metrics_attach(modbus_ctx_t * ctx, modbus_metrics_t * metrics)
+{
+    if (metrics != NULL)
+    {
+        atomic_init(&metrics->sequence, 0);
+        memset(&metrics->data, 0, sizeof(metrics->data));
+        metrics->sent_us = 0;
+        metrics->answer_us = 0;
+        metrics->answer_length = 0;
+        metrics->checksum_failed = false;
+    }
+    
+    ctx->metrics = metrics;
+}
+
+void modbus_metrics_snapshot(const modbus_metrics_t * metrics, modbus_metrics_data_t * data)
+{
+    unsigned int begin;
+    unsigned int end;
+    
+    do
+    {
+        begin = atomic_load_explicit(&metrics->sequence, memory_order_acquire);
+        memcpy(data, &metrics->data, sizeof(*data));
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&metrics->sequence, memory_order_relaxed);
+    } while ((begin & 1) || (begin != end));
+}
+
+uint32_t modbus_histogram_percentile_us(const modbus_histogram_t * histogram, uint8_t percent)
+{
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+    
+    //Rank of the percentile, rounded up
+    const uint64_t rank = ((uint64_t)histogram->count * (percent < 100 ? percent : 100) + 99) / 100;
+    uint64_t counted = 0;
+    
+    for (uint8_t i = 0; i < MODBUS_METRICS_BUCKETS_NUM - 1; i++)
+    {
+        counted += histogram->buckets[i];
+        if ((counted >= rank) && (counted != 0))
+        {
+            const uint32_t bound_us = (2UL << i) - 1;
+            return (bound_us < histogram->max_us) ? bound_us : histogram->max_us;
+        }
+    }
+    
+    return histogram->max_us;
+}
+
+void modbus_histogram_add(modbus_histogram_t * histogram, uint32_t latency_us)
+{
+    histogram->count++;
+    histogram->sum_us += latency_us;
+    if (latency_us > histogram->max_us)
+    {
+        histogram->max_us = latency_us;
+    }
+    histogram->buckets[bucket_index(latency_us)]++;
+}
+
+void modbus_metrics_request_sent(modbus_ctx_t * ctx, uint16_t length, uint32_t sent_us)
+{
+    modbus_metrics_t * const metrics = ctx->metrics;
+    modbus_counters_t * const counters[2] = { &metrics->data.bus, &metrics->data.units[ctx->request_address & 0x7F] };
+    
+    metrics->sent_us = sent_us;
+    metrics->answer_length = 0;
+    metrics->checksum_failed = false;
+    
+    update_begin(metrics);
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        counters[i]->transactions++;
+        counters[i]->tx_bytes += length;
+        if (ctx->attempt != 0)
+        {
+            counters[i]->retries++;
+        }
+    }
+    update_end(metrics);
+}
+
+void modbus_metrics_answer_received(modbus_ctx_t * ctx, uint16_t length)
+{
+    modbus_metrics_t * const metrics = ctx->metrics;
+    
+    if ((metrics->answer_length == 0) && (length != 0))
+    {
+        metrics->answer_us = clock_get(ctx);
+    }
+    metrics->answer_length += length;
+}
+
+void modbus_metrics_checksum_failed(modbus_ctx_t * ctx)
+{
+    ctx->metrics->checksum_failed = true;
+}
+
+void modbus_metrics_transaction_select(modbus_ctx_t * ctx, uint32_t sent_us, uint32_t answer_us, uint16_t answer_length)
+{
+    modbus_metrics_t * const metrics = ctx->metrics;
+    
+    metrics->sent_us = sent_us;
+    metrics->answer_us = answer_us;
+    metrics->answer_length = answer_length;
+    metrics->checksum_failed = false;
+}
+
+void modbus_metrics_transaction_completed(modbus_ctx_t * ctx, modbus_protocol_result_t result)
+{
+    modbus_metrics_t * const metrics = ctx->metrics;
+    const uint8_t address = ctx->request_address;
+    
+    if ((address == MODBUS_ADDRESS_BROADCAST) && (result == MODBUS_PROTOCOL_RESULT_SUCCESS))
+    {
+        return;
+    }
+    
+    const bool answered = (result == MODBUS_PROTOCOL_RESULT_SUCCESS) || (result == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+    const uint32_t now_us = (answered && (ctx->clock != NULL)) ? ctx->clock(ctx->user_data) : 0;
+    
+    update_begin(metrics);
+    counters_add(&metrics->data.bus, result, metrics->checksum_failed, metrics->answer_length);
+    counters_add(&metrics->data.units[address & 0x7F], result, metrics->checksum_failed, metrics->answer_length);
+    if (answered && (ctx->clock != NULL))
+    {
+        modbus_histogram_add(&metrics->data.latency[MODBUS_METRICS_PHASE_TX], metrics->sent_us - ctx->request_us);
+        modbus_histogram_add(&metrics->data.latency[MODBUS_METRICS_PHASE_TURNAROUND], metrics->answer_us - metrics->sent_us);
+        modbus_histogram_add(&metrics->data.latency[MODBUS_METRICS_PHASE_RX], now_us - metrics->answer_us);
+    }
+    update_end(metrics);
+    
+    metrics->answer_length = 0;
+    metrics->checksum_failed = false;
+}
@@ -0,0 +1,175 @@
+/**
+ * @ingroup modbus_protocol
+ *
+ * @defgroup modbus_metrics Modbus transaction metrics
+ *
+ * @brief Counters of the bus and of every server on it, latency histograms of the bus.
+ *
+ * Metrics are recorded by the thread which drives the bus (synchronous and asynchronous transactions)
+ * and may be read by any other thread with modbus_metrics_snapshot(). Updates are published through
+ * a sequence lock: the bus thread never waits, the reader repeats the copy if it overlaps an update.
+ *
+ * Latency of every answered transaction is split into phases:
+ * - tx: from the start of the request transmission until the bus write is completed
+ *   (wire time of the request for asynchronous transactions, which do not wait for the transmission);
+ * - turnaround: from there until the first part of the answer is received;
+ * - rx: from there until the answer is completely received.
+ * Histograms have log2 buckets of microseconds and are recorded only if the bus clock callback is provided.
+ *
+ * Metrics are compiled in by default and cost nothing until a storage is attached with modbus_metrics_attach().
+ * Define MODBUS_METRICS_ENABLED as 0 to remove the recording from the protocol layer entirely.
+ *
+ * @{
+ */
+
+#ifndef _MODBUS_METRICS_H_
+#define _MODBUS_METRICS_H_
+
+#include "modbus_protocol.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef MODBUS_METRICS_ENABLED
+#define MODBUS_METRICS_ENABLED        (1)
+#endif
+
+#define MODBUS_METRICS_BUCKETS_NUM    (24)  /**< Histogram buckets: bucket 0 counts latencies below 2 us, bucket N counts [2^N, 2^(N+1)) us,
+                                                 the last one counts everything above as well. */
+
+/**@brief Record metrics of the bus if the storage is attached.
+ *
+ * @param[in] CTX  Pointer to the modbus context.
+ * @param[in] HOOK Recording function call.
+ */
+#if (MODBUS_METRICS_ENABLED)
+#define MODBUS_METRICS_RECORD(CTX, HOOK)    do { if ((CTX)->metrics != NULL) { HOOK; } } while (0)
+#else
+#define MODBUS_METRICS_RECORD(CTX, HOOK)    do { } while (0)
+#endif
+
+/**@brief Transaction phases. */
+typedef enum
+{
+    MODBUS_METRICS_PHASE_TX,                            /**< Request transmission. */
+    MODBUS_METRICS_PHASE_TURNAROUND,                    /**< Wait for the first part of the answer. */
+    MODBUS_METRICS_PHASE_RX,                            /**< Answer reception. */
+    MODBUS_METRICS_PHASES_NUM
+} modbus_metrics_phase_t;
+
+/**@brief Transaction counters. Counters wrap around, monitoring should use differences of snapshots. */
+typedef struct
+{
+    uint32_t transactions;                              /**< Requests sent, including retries and broadcast requests. */
+    uint32_t retries;                                   /**< Requests sent again after a timeout or a corrupted answer. */
+    uint32_t answers;                                   /**< Valid answers received, including exceptions. */
+    uint32_t exceptions;                                /**< Exception answers. */
+    uint32_t timeouts;                                  /**< Requests left without complete answer. */
+    uint32_t checksum_errors;                           /**< Answers failed the CRC (RTU) or LRC (ASCII) check. */
+    uint32_t corrupted;                                 /**< Other malformed answers: framing errors, answers of other servers. */
+    uint32_t io_errors;                                 /**< Bus I/O errors. */
+    uint32_t offline;                                   /**< Requests not sent because the server is offline. */
+    uint64_t tx_bytes;                                  /**< Bytes of sent requests on the wire (characters in ASCII mode). */
+    uint64_t rx_bytes;                                  /**< Bytes received while waiting for answers (characters in ASCII mode). */
+} modbus_counters_t;
+
+/**@brief Latency histogram. */
+typedef struct
+{
+    uint32_t count;                                     /**< Number of recorded latencies. */
+    uint32_t max_us;                                    /**< Maximum latency. */
+    uint64_t sum_us;                                    /**< Sum of latencies. */
+    uint32_t buckets[MODBUS_METRICS_BUCKETS_NUM];       /**< Number of latencies in log2 buckets, @see MODBUS_METRICS_BUCKETS_NUM. */
+} modbus_histogram_t;
+
+/**@brief Metrics of the bus. */
+typedef struct
+{
+    modbus_counters_t bus;                              /**< Counters of the bus. */
+    modbus_counters_t units[MODBUS_UNITS_NUM];          /**< Counters of the servers, indexed by address (0 counts broadcast requests). */
+    modbus_histogram_t latency[MODBUS_METRICS_PHASES_NUM]; /**< Latency histograms of answered transactions, indexed by phase. */
+} modbus_metrics_data_t;
+
+/**@brief Metrics storage of the bus. */
+struct modbus_metrics_s
+{
+    atomic_uint sequence;                               /**< Sequence lock, odd while the bus thread updates the data. */
+    modbus_metrics_data_t data;                         /**< Published metrics. */
+    uint32_t sent_us;                                   /**< Time the current request was sent (bus thread only). */
+    uint32_t answer_us;                                 /**< Time the first part of the current answer was received (bus thread only). */
+    uint32_t answer_length;                             /**< Bytes of the current answer received so far (bus thread only). */
+    bool checksum_failed;                               /**< Current answer failed the checksum check (bus thread only). */
+};
+
+/**@brief Attach metrics storage to the bus and reset it. Must be called by the thread which drives the bus.
+ *
+ * @param[in]  ctx     Pointer to the modbus context.
+ * @param[out] metrics Pointer to the metrics storage, NULL to stop recording.
+ */
+void modbus_metrics_attach(modbus_ctx_t * ctx, modbus_metrics_t * metrics);
+
+/**@brief Copy consistent metrics. May be called by any thread, never blocks the bus thread.
+ *
+ * @param[in]  metrics Pointer to the metrics storage.
+ * @param[out] data    Pointer to store the metrics.
+ */
+void modbus_metrics_snapshot(const modbus_metrics_t * metrics, modbus_metrics_data_t * data);
+
+/**@brief Get latency percentile from the histogram.
+ *
+ * @param[in] histogram Pointer to the histogram.
+ * @param[in] percent   Percentile (0 - 100).
+ *
+ * @return Upper bound of the bucket the percentile falls into (never above the maximum latency), 0 if the histogram is empty.
+ */
+uint32_t modbus_histogram_percentile_us(const modbus_histogram_t * histogram, uint8_t percent);
+
+/**@brief Add latency to the histogram (e.g. latencies measured outside the protocol layer).
+ *
+ * @param[in,out] histogram  Pointer to the histogram.
+ * @param[in]     latency_us Latency in microseconds.
+ */
+void modbus_histogram_add(modbus_histogram_t * histogram, uint32_t latency_us);
+
+/**@brief Record sent request (bus thread only, @see MODBUS_METRICS_RECORD).
+ *
+ * @param[in] ctx     Pointer to the modbus context, ctx->request_address and ctx->request_us are set.
+ * @param[in] length  Length of the request on the wire.
+ * @param[in] sent_us Time the request transmission was completed.
+ */
+void modbus_metrics_request_sent(modbus_ctx_t * ctx, uint16_t length, uint32_t sent_us);
+
+/**@brief Record received part of the answer (bus thread only, @see MODBUS_METRICS_RECORD).
+ *
+ * @param[in] ctx    Pointer to the modbus context.
+ * @param[in] length Number of received bytes.
+ */
+void modbus_metrics_answer_received(modbus_ctx_t * ctx, uint16_t length);
+
+/**@brief Record checksum failure of the answer (bus thread only, @see MODBUS_METRICS_RECORD).
+ *
+ * @param[in] ctx Pointer to the modbus context.
+ */
+void modbus_metrics_checksum_failed(modbus_ctx_t * ctx);
+
+/**@brief Select the transaction whose completion is recorded next (bus thread only, @see MODBUS_METRICS_RECORD). 
+ *        With several requests in flight (MODBUS_PROTOCOL_MODE_TCP) the state of each one is kept by the caller.
+ *
+ * @param[in] ctx           Pointer to the modbus context, ctx->request_address and ctx->request_us are set.
+ * @param[in] sent_us       Time the request transmission was completed.
+ * @param[in] answer_us     Time the first part of the answer was received.
+ * @param[in] answer_length Length of the received answer (0 if not answered).
+ */
+void modbus_metrics_transaction_select(modbus_ctx_t * ctx, uint32_t sent_us, uint32_t answer_us, uint16_t answer_length);
+
+/**@brief Record completed transaction (bus thread only, @see MODBUS_METRICS_RECORD).
+ *
+ * @param[in] ctx    Pointer to the modbus context, ctx->request_address is set.
+ * @param[in] result Result of the transaction, not recorded for successful broadcast requests.
+ */
+void modbus_metrics_transaction_completed(modbus_ctx_t * ctx, modbus_protocol_result_t result);
+
+#endif
+
+/** @} */
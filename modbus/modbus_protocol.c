@@ -1,24 +1,464 @@
 #include "modbus_protocol.h"
 #include "modbus_protocol_ascii.h"
 #include "modbus_protocol_rtu.h"
+#include "modbus_protocol_tcp.h"
+#include "modbus_crc.h"
+#include "modbus_hex.h"
+#include "modbus_metrics.h"
 
-static const modbus_params_t * modbus_params;
+#include <string.h>
 
-void modbus_protocol_initialize(const modbus_params_t * params)
+uint16_t modbus_pdu_length(const uint8_t * pdu, uint16_t length, bool request)
 {
-    modbus_params = params;
+    if (length < 2)
+    {
+        return 2;
+    }
+    
+    const uint8_t function = pdu[1];
+    if (!request && (function & 0x80))
+    {
+        //Exception answer: address, function code, exception code
+        return 3;
+    }
+    
+    switch (function)
+    {
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04:
+            if (request)
+            {
+                return 6;
+            }
+            return (length < 3) ? 3 : (uint16_t)(3 + pdu[2]);
+            
+        case 0x05:
+        case 0x06:
+            return 6;
+            
+        case 0x0F:
+        case 0x10:
+            if (!request)
+            {
+                return 6;
+            }
+            return (length < 7) ? 7 : (uint16_t)(7 + pdu[6]);
+            
+        case 0x17:
+            if (request)
+            {
+                return (length < 11) ? 11 : (uint16_t)(11 + pdu[10]);
+            }
+            return (length < 3) ? 3 : (uint16_t)(3 + pdu[2]);
+            
+        default:
+            return 0;
+    }
 }
 
-modbus_protocol_result_t modbus_request_write(uint8_t * data, uint16_t data_length)
+/**@brief Get length of the frame with the PDU of given length on the wire.
+ */
+static uint16_t wire_length(const modbus_ctx_t * ctx, uint16_t pdu_length)
 {
-    return (modbus_params->mode == MODBUS_PROTOCOL_MODE_RTU) ? 
-            modbus_protocol_rtu_request_write(modbus_params->write, modbus_params->idle, data, data_length) :
-            modbus_protocol_ascii_request_write(modbus_params->write, data, data_length);
+    switch (ctx->mode)
+    {
+        case MODBUS_PROTOCOL_MODE_ASCII:
+            //Two characters per byte and 5 framing characters
+            return pdu_length * 2 + 5;
+            
+        case MODBUS_PROTOCOL_MODE_TCP:
+            //MBAP header, unit identifier is the first byte of the PDU
+            return pdu_length + MODBUS_TCP_HEADER_SIZE;
+            
+        default:
+            //PDU and CRC
+            return pdu_length + 2;
+    }
 }
 
-modbus_protocol_result_t modbus_answer_read(uint8_t * data, uint16_t data_length)
+uint32_t modbus_wire_time_us(const modbus_ctx_t * ctx, uint16_t pdu_length)
 {
-    return (modbus_params->mode == MODBUS_PROTOCOL_MODE_RTU) ? 
-            modbus_protocol_rtu_answer_read(modbus_params->read, data, data_length) :
-            modbus_protocol_ascii_answer_read(modbus_params->read, data, data_length);
+    if ((ctx->baud_rate == 0) || MODBUS_MODE_NETWORK(ctx->mode))
+    {
+        return 0;
+    }
+    
+    //RTU: 11 bits per byte, ASCII: 10 bits per character
+    const uint32_t bits = ((ctx->mode == MODBUS_PROTOCOL_MODE_RTU) ? 11UL : 10UL) * wire_length(ctx, pdu_length);
+    
+    return (uint32_t)((bits * 1000000ULL + ctx->baud_rate - 1) / ctx->baud_rate);
+}
+
+/**@brief Get answer delay allowance of the server.
+ */
+static uint32_t unit_allowance_us(const modbus_ctx_t * ctx, uint8_t address, uint8_t attempt)
+{
+    const modbus_unit_t * const unit = &ctx->units[address & 0x7F];
+    const uint32_t allowance_max_us = ctx->timeout_ms * 1000;
+    //Lost segment is retransmitted by TCP, the answer must not be abandoned before that
+    const uint32_t allowance_min_us = MODBUS_MODE_NETWORK(ctx->mode) ? MODBUS_UNIT_RTO_MIN_NETWORK_US : MODBUS_UNIT_RTO_MIN_US;
+    uint32_t allowance_us = allowance_max_us;
+    
+    if (unit->srtt_us != 0)
+    {
+        allowance_us = unit->srtt_us + 4 * unit->rttvar_us;
+        if (allowance_us < allowance_min_us)
+        {
+            allowance_us = allowance_min_us;
+        }
+        
+        for (uint8_t i = 0; (i < unit->backoff + attempt) && (allowance_us < allowance_max_us); i++)
+        {
+            allowance_us *= 2;
+        }
+        if (allowance_us > allowance_max_us)
+        {
+            allowance_us = allowance_max_us;
+        }
+    }
+    
+    return allowance_us;
+}
+
+uint32_t modbus_unit_timeout_us(const modbus_ctx_t * ctx, 
+                                uint8_t address, 
+                                uint16_t request_pdu_length, 
+                                uint16_t answer_pdu_length, 
+                                uint8_t attempt)
+{
+    return modbus_wire_time_us(ctx, request_pdu_length) + modbus_wire_time_us(ctx, answer_pdu_length) + 
+           unit_allowance_us(ctx, address, attempt);
+}
+
+bool modbus_unit_available(const modbus_ctx_t * ctx, uint8_t address, uint32_t now_us)
+{
+    const modbus_unit_t * const unit = &ctx->units[address & 0x7F];
+    
+    return !(unit->flags & MODBUS_UNIT_FLAG_OFFLINE) || ((int32_t)(now_us - unit->probe_us) >= 0);
+}
+
+bool modbus_unit_online(const modbus_ctx_t * ctx, uint8_t address)
+{
+    return !(ctx->units[address & 0x7F].flags & MODBUS_UNIT_FLAG_OFFLINE);
+}
+
+void modbus_unit_answered(modbus_ctx_t * ctx, uint8_t address, uint32_t delay_us, bool sample)
+{
+    modbus_unit_t * const unit = &ctx->units[address & 0x7F];
+    
+    unit->flags &= (uint8_t)~MODBUS_UNIT_FLAG_OFFLINE;
+    unit->failures = 0;
+    
+    if (!sample)
+    {
+        return;
+    }
+    
+    //RFC 6298: rttvar = 3/4 rttvar + 1/4 |srtt - r|, srtt = 7/8 srtt + 1/8 r
+    if (unit->srtt_us == 0)
+    {
+        unit->srtt_us = (delay_us != 0) ? delay_us : 1;
+        unit->rttvar_us = delay_us / 2;
+    }
+    else
+    {
+        const uint32_t deviation_us = (unit->srtt_us > delay_us) ? unit->srtt_us - delay_us : delay_us - unit->srtt_us;
+        unit->rttvar_us = unit->rttvar_us - unit->rttvar_us / 4 + deviation_us / 4;
+        unit->srtt_us = unit->srtt_us - unit->srtt_us / 8 + delay_us / 8;
+        if (unit->srtt_us == 0)
+        {
+            unit->srtt_us = 1;
+        }
+    }
+    unit->backoff = 0;
+}
+
+void modbus_unit_failed(modbus_ctx_t * ctx, uint8_t address, uint32_t now_us)
+{
+    modbus_unit_t * const unit = &ctx->units[address & 0x7F];
+    
+    if (unit->failures < UINT8_MAX)
+    {
+        unit->failures++;
+    }
+    if (unit->backoff < MODBUS_UNIT_BACKOFF_MAX)
+    {
+        unit->backoff++;
+    }
+    
+    if (unit->flags & MODBUS_UNIT_FLAG_OFFLINE)
+    {
+        //Probe failed, probe less often
+        unit->probe_interval_ms *= 2;
+        if (unit->probe_interval_ms > MODBUS_UNIT_PROBE_MAX_MS)
+        {
+            unit->probe_interval_ms = MODBUS_UNIT_PROBE_MAX_MS;
+        }
+    }
+    else if (unit->failures >= MODBUS_UNIT_OFFLINE_FAILURES)
+    {
+        unit->flags |= MODBUS_UNIT_FLAG_OFFLINE;
+        unit->probe_interval_ms = MODBUS_UNIT_PROBE_MIN_MS;
+    }
+    else
+    {
+        return;
+    }
+    
+    unit->probe_us = now_us + unit->probe_interval_ms * 1000;
+}
+
+void modbus_protocol_initialize(modbus_ctx_t * ctx, const modbus_params_t * params)
+{
+    ctx->mode = params->mode;
+    ctx->write = params->write;
+    ctx->read = params->read;
+    ctx->idle = params->idle;
+    ctx->writev = params->writev;
+    ctx->receive = params->receive;
+    ctx->delay = params->delay;
+    ctx->clock = params->clock;
+    ctx->user_data = params->user_data;
+    ctx->timeout_ms = (params->timeout_ms != 0) ? params->timeout_ms : MODBUS_PROTOCOL_BUS_TIMEOUT_MS;
+    ctx->baud_rate = MODBUS_MODE_NETWORK(params->mode) ? 0 : params->baud_rate;
+    ctx->turnaround_ms = (params->turnaround_ms != 0) ? params->turnaround_ms : MODBUS_PROTOCOL_TURNAROUND_MS;
+    ctx->retries = params->retries;
+    ctx->attempt = 0;
+    ctx->request_address = MODBUS_ADDRESS_BROADCAST;
+    ctx->answer_timeout_ms = ctx->timeout_ms;
+    ctx->transaction_id = 0;
+    ctx->exception = MODBUS_EXCEPTION_NONE;
+    ctx->result = MODBUS_PROTOCOL_RESULT_SUCCESS;
+    ctx->metrics = NULL;
+    
+    for (uint16_t i = 0; i < MODBUS_UNITS_NUM; i++)
+    {
+        modbus_unit_t * const unit = &ctx->units[i];
+        unit->flags = 0;
+        unit->failures = 0;
+        unit->backoff = 0;
+        unit->srtt_us = 0;
+        unit->rttvar_us = 0;
+        unit->probe_us = 0;
+        unit->probe_interval_ms = 0;
+    }
+    
+    modbus_crc_initialize();
+    modbus_hex_initialize();
+}
+
+modbus_protocol_result_t modbus_request_write(modbus_ctx_t * ctx, uint8_t * data, uint16_t data_length)
+{
+    switch (ctx->mode)
+    {
+        case MODBUS_PROTOCOL_MODE_ASCII:
+            return modbus_protocol_ascii_request_write(ctx, data, data_length);
+            
+        case MODBUS_PROTOCOL_MODE_TCP:
+            return modbus_protocol_tcp_request_write(ctx, data, data_length);
+            
+        default:
+            return modbus_protocol_rtu_request_write(ctx, data, data_length);
+    }
+}
+
+modbus_protocol_result_t modbus_answer_read(modbus_ctx_t * ctx, uint8_t * data, uint16_t data_length)
+{
+    switch (ctx->mode)
+    {
+        case MODBUS_PROTOCOL_MODE_ASCII:
+            return modbus_protocol_ascii_answer_read(ctx, data, data_length);
+            
+        case MODBUS_PROTOCOL_MODE_TCP:
+            return modbus_protocol_tcp_answer_read(ctx, data, data_length);
+            
+        default:
+            return modbus_protocol_rtu_answer_read(ctx, data, data_length);
+    }
+}
+
+/**@brief Send request frame in the framing of the mode.
+ */
+static modbus_protocol_result_t frame_write(modbus_ctx_t * ctx, modbus_frame_t * frame)
+{
+    switch (ctx->mode)
+    {
+        case MODBUS_PROTOCOL_MODE_ASCII:
+            return modbus_protocol_ascii_frame_write(ctx, frame);
+            
+        case MODBUS_PROTOCOL_MODE_TCP:
+            return modbus_protocol_tcp_frame_write(ctx, frame);
+            
+        default:
+            return modbus_protocol_rtu_frame_write(ctx, frame);
+    }
+}
+
+/**@brief Read answer frame in the framing of the mode.
+ */
+static modbus_protocol_result_t frame_read(modbus_ctx_t * ctx, modbus_frame_t * frame, uint16_t pdu_length)
+{
+    switch (ctx->mode)
+    {
+        case MODBUS_PROTOCOL_MODE_ASCII:
+            return modbus_protocol_ascii_frame_read(ctx, frame, pdu_length);
+            
+        case MODBUS_PROTOCOL_MODE_TCP:
+            return modbus_protocol_tcp_frame_read(ctx, frame, pdu_length);
+            
+        default:
+            return modbus_protocol_rtu_frame_read(ctx, frame, pdu_length);
+    }
+}
+
+modbus_protocol_result_t modbus_frame_request_write(modbus_ctx_t * ctx, modbus_frame_t * frame)
+{
+    const bool broadcast = (MODBUS_FRAME_PDU(frame)[0] == MODBUS_ADDRESS_BROADCAST);
+    
+    ctx->request_address = MODBUS_FRAME_PDU(frame)[0];
+    ctx->request_wire_us = modbus_wire_time_us(ctx, frame->pdu_length);
+    ctx->request_us = (ctx->clock != NULL) ? ctx->clock(ctx->user_data) : 0;
+    
+    modbus_protocol_result_t protocol_result = frame_write(ctx, frame);
+    
+    if (protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS)
+    {
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_request_sent(ctx, wire_length(ctx, frame->pdu_length), 
+                                                               (ctx->clock != NULL) ? ctx->clock(ctx->user_data) : 0));
+    }
+    else
+    {
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_transaction_completed(ctx, protocol_result));
+    }
+    
+    if (broadcast && (protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS) && (ctx->delay != NULL))
+    {
+        //Servers process the broadcast request without answering
+        ctx->delay(ctx->user_data, ctx->turnaround_ms);
+    }
+    
+    return protocol_result;
+}
+
+modbus_protocol_result_t modbus_frame_answer_read(modbus_ctx_t * ctx, modbus_frame_t * frame, uint16_t pdu_length)
+{
+    const uint8_t address = ctx->request_address;
+    const bool adaptive = (ctx->clock != NULL) && (address != MODBUS_ADDRESS_BROADCAST);
+    
+    ctx->answer_timeout_ms = ctx->timeout_ms;
+    if (adaptive)
+    {
+        //Part of the timeout is already spent on the request transmission
+        const uint32_t timeout_us = ctx->request_wire_us + modbus_wire_time_us(ctx, pdu_length) + 
+                                    unit_allowance_us(ctx, address, ctx->attempt);
+        const uint32_t elapsed_us = ctx->clock(ctx->user_data) - ctx->request_us;
+        ctx->answer_timeout_ms = (timeout_us > elapsed_us) ? (timeout_us - elapsed_us + 999) / 1000 : 1;
+    }
+    
+    modbus_protocol_result_t protocol_result = frame_read(ctx, frame, pdu_length);
+    
+    if (((protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS) || (protocol_result == MODBUS_PROTOCOL_RESULT_EXCEPTION)) && 
+        (MODBUS_FRAME_PDU(frame)[0] != address))
+    {
+        //Late answer to a previous request or noise
+        protocol_result = MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    MODBUS_METRICS_RECORD(ctx, modbus_metrics_transaction_completed(ctx, protocol_result));
+    
+    if (adaptive)
+    {
+        const uint32_t now_us = ctx->clock(ctx->user_data);
+        if (protocol_result == MODBUS_PROTOCOL_RESULT_TIMEOUT)
+        {
+            modbus_unit_failed(ctx, address, now_us);
+        }
+        else if (protocol_result != MODBUS_PROTOCOL_RESULT_IO_ERROR)
+        {
+            const uint32_t wire_us = ctx->request_wire_us + modbus_wire_time_us(ctx, frame->pdu_length);
+            const uint32_t round_trip_us = now_us - ctx->request_us;
+            const bool valid = (protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS) || 
+                               (protocol_result == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+            modbus_unit_answered(ctx, address, (round_trip_us > wire_us) ? round_trip_us - wire_us : 0, 
+                                 valid && (ctx->attempt == 0));
+        }
+    }
+    
+    ctx->exception = (protocol_result == MODBUS_PROTOCOL_RESULT_EXCEPTION) ? 
+            (modbus_exception_t)MODBUS_FRAME_PDU(frame)[2] : MODBUS_EXCEPTION_NONE;
+    
+    return protocol_result;
+}
+
+modbus_protocol_result_t modbus_frame_transaction(modbus_ctx_t * ctx, modbus_frame_t * frame, uint16_t pdu_length)
+{
+    modbus_protocol_result_t protocol_result;
+    uint8_t * const pdu = MODBUS_FRAME_PDU(frame);
+    const uint8_t address = pdu[0];
+    const uint16_t request_length = frame->pdu_length;
+    uint8_t request[MODBUS_PDU_LENGTH_MAX];
+    uint8_t attempts = 1 + ctx->retries;
+    
+    if (address == MODBUS_ADDRESS_BROADCAST)
+    {
+        ctx->exception = MODBUS_EXCEPTION_NONE;
+        ctx->result = modbus_frame_request_write(ctx, frame);
+        return ctx->result;
+    }
+    
+    if (ctx->clock != NULL)
+    {
+        if (!modbus_unit_available(ctx, address, ctx->clock(ctx->user_data)))
+        {
+            ctx->request_address = address;
+            MODBUS_METRICS_RECORD(ctx, modbus_metrics_transaction_completed(ctx, MODBUS_PROTOCOL_RESULT_OFFLINE));
+            ctx->exception = MODBUS_EXCEPTION_NONE;
+            ctx->result = MODBUS_PROTOCOL_RESULT_OFFLINE;
+            return ctx->result;
+        }
+        
+        if (!modbus_unit_online(ctx, address))
+        {
+            //Single probe of the offline server
+            attempts = 1;
+        }
+    }
+    
+    //Encoding and the answer overwrite the request, keep it for retries
+    if ((attempts > 1) && (request_length <= sizeof(request)))
+    {
+        memcpy(request, pdu, request_length);
+    }
+    else
+    {
+        attempts = 1;
+    }
+    
+    for (ctx->attempt = 0; ; ctx->attempt++)
+    {
+        protocol_result = modbus_frame_request_write(ctx, frame);
+        if (protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS)
+        {
+            protocol_result = modbus_frame_answer_read(ctx, frame, pdu_length);
+        }
+        
+        if (((protocol_result != MODBUS_PROTOCOL_RESULT_TIMEOUT) && (protocol_result != MODBUS_PROTOCOL_RESULT_CORRUPTED)) || 
+            (ctx->attempt + 1 >= attempts))
+        {
+            break;
+        }
+        
+        memcpy(pdu, request, request_length);
+        frame->pdu_length = request_length;
+    }
+    ctx->attempt = 0;
+    
+    if (protocol_result != MODBUS_PROTOCOL_RESULT_EXCEPTION)
+    {
+        ctx->exception = MODBUS_EXCEPTION_NONE;
+    }
+    ctx->result = protocol_result;
+    
+    return protocol_result;
 }
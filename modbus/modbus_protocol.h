@@ -2,7 +2,8 @@
  * @defgroup modbus_protocol Modbus communication protocol
  *
  * @brief A client/server data communications protocol between two devices.
- * Supports modbus RTU/ASCII protocols for RS-232/485 interfaces.
+ * Supports modbus RTU/ASCII protocols for RS-232/485 interfaces and modbus TCP 
+ * (also RTU frames over TCP) for network connections.
  *
  * @{
  */
@@ -12,15 +13,44 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #define MODBUS_PROTOCOL_BUS_TIMEOUT_MS    (100)
-#define MODBUS_PROTOCOL_BUFFER_SIZE       (256)
+#define MODBUS_PDU_LENGTH_MAX             (254) /**< Maximum PDU length (address, function code and data), RTU frame is 256 bytes. */
+#define MODBUS_PROTOCOL_BUFFER_SIZE       (2 * MODBUS_PDU_LENGTH_MAX + 5)   /**< Fits the largest frame in any Modbus mode. */
+#define MODBUS_PROTOCOL_TURNAROUND_MS     (100) /**< Delay after a broadcast request to let the servers process it. */
+
+#define MODBUS_ADDRESS_BROADCAST          (0)   /**< Request address of all servers, broadcast requests are not answered. */
+
+#define MODBUS_FRAME_HEADROOM             (6)   /**< Frame storage reserved ahead of the PDU (ASCII start character, TCP MBAP header). */
+#define MODBUS_FRAME_TAILROOM             (4)   /**< Frame storage reserved after the encoded PDU (checksum and ASCII end characters). */
+
+/**@brief Size of the frame storage required for a PDU of the given length in any Modbus mode. */
+#define MODBUS_FRAME_SIZE(PDU_LENGTH)     (MODBUS_FRAME_HEADROOM + 2 * (PDU_LENGTH) + MODBUS_FRAME_TAILROOM)
+
+/**@brief Size of the frame storage required for a PDU of the given length in the binary modes only (all but MODBUS_PROTOCOL_MODE_ASCII). */
+#define MODBUS_FRAME_RTU_SIZE(PDU_LENGTH) (MODBUS_FRAME_HEADROOM + (PDU_LENGTH) + MODBUS_FRAME_TAILROOM)
+
+/**@brief Size of the frame storage required for a PDU of the given length in the given Modbus mode. */
+#define MODBUS_FRAME_MODE_SIZE(MODE, PDU_LENGTH) \
+    (((MODE) == MODBUS_PROTOCOL_MODE_ASCII) ? MODBUS_FRAME_SIZE(PDU_LENGTH) : MODBUS_FRAME_RTU_SIZE(PDU_LENGTH))
+
+/**@brief Check if the Modbus mode uses RTU frames (MODBUS_PROTOCOL_MODE_RTU, MODBUS_PROTOCOL_MODE_RTU_OVER_TCP). */
+#define MODBUS_MODE_RTU_FRAMING(MODE)     (((MODE) == MODBUS_PROTOCOL_MODE_RTU) || ((MODE) == MODBUS_PROTOCOL_MODE_RTU_OVER_TCP))
+
+/**@brief Check if the Modbus mode runs over a network connection (no bus timing, no serial line parameters). */
+#define MODBUS_MODE_NETWORK(MODE)         (((MODE) == MODBUS_PROTOCOL_MODE_TCP) || ((MODE) == MODBUS_PROTOCOL_MODE_RTU_OVER_TCP))
+
+/**@brief Pointer to the PDU (address, function code and data) inside the frame storage. */
+#define MODBUS_FRAME_PDU(FRAME)           (&(FRAME)->buffer[MODBUS_FRAME_HEADROOM])
 
 /**@brief Modbus modes. */
 typedef enum
 {
-    MODBUS_PROTOCOL_MODE_ASCII,
-    MODBUS_PROTOCOL_MODE_RTU
+    MODBUS_PROTOCOL_MODE_ASCII,                         /**< ASCII frames on a serial line. */
+    MODBUS_PROTOCOL_MODE_RTU,                           /**< RTU frames on a serial line. */
+    MODBUS_PROTOCOL_MODE_TCP,                           /**< MBAP frames on a TCP connection, answers are matched by transaction identifier. */
+    MODBUS_PROTOCOL_MODE_RTU_OVER_TCP                   /**< RTU frames on a TCP connection (serial gateways), without inter-frame timing. */
 } modbus_mode_t;
 
 /**@brief Modbus callback results. */
@@ -38,16 +68,53 @@ typedef enum
     MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE,             /**< Insufficient protocol buffer space, MODBUS_PROTOCOL_BUFFER_SIZE increase required. */
     MODBUS_PROTOCOL_RESULT_TIMEOUT,                     /**< Protocol operation not completed during set timeout. */
     MODBUS_PROTOCOL_RESULT_CORRUPTED,                   /**< Received message is corrupted. */
-    MODBUS_PROTOCOL_RESULT_IO_ERROR                     /**< I/O error occured during protocol operation. */
+    MODBUS_PROTOCOL_RESULT_IO_ERROR,                    /**< I/O error occured during protocol operation. */
+    MODBUS_PROTOCOL_RESULT_EXCEPTION,                   /**< Exception answer received, exception code is the third byte of the answer PDU. */
+    MODBUS_PROTOCOL_RESULT_OFFLINE                      /**< Server is marked offline and is not probed yet, request is not sent. */
 } modbus_protocol_result_t;
 
+/**@brief Modbus exception codes. */
+typedef enum
+{
+    MODBUS_EXCEPTION_NONE                       = 0x00, /**< No exception. */
+    MODBUS_EXCEPTION_ILLEGAL_FUNCTION           = 0x01, /**< Function code is not supported by server. */
+    MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS       = 0x02, /**< Data address is not allowed by server. */
+    MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE         = 0x03, /**< Data value is not allowed by server. */
+    MODBUS_EXCEPTION_SERVER_DEVICE_FAILURE      = 0x04, /**< Unrecoverable error occured in server. */
+    MODBUS_EXCEPTION_ACKNOWLEDGE                = 0x05, /**< Request accepted, but it takes a long time to process it. */
+    MODBUS_EXCEPTION_SERVER_DEVICE_BUSY         = 0x06, /**< Server is busy processing a long-duration command. */
+    MODBUS_EXCEPTION_GATEWAY_PATH_UNAVAILABLE   = 0x0A, /**< Gateway has no path to the target server. */
+    MODBUS_EXCEPTION_GATEWAY_TARGET_FAILED      = 0x0B  /**< Target server behind the gateway did not respond. */
+} modbus_exception_t;
+
 #define MODBUS_CALLBACK_TO_PROTOCOL_RESULT(СALLBACK_RESULT) \
     (СALLBACK_RESULT == MODBUS_CALLBACK_RESULT_TIMEOUT) ? MODBUS_PROTOCOL_RESULT_TIMEOUT : \
       (СALLBACK_RESULT == MODBUS_CALLBACK_RESULT_IO_ERROR) ? MODBUS_PROTOCOL_RESULT_IO_ERROR :  \
         MODBUS_PROTOCOL_RESULT_SUCCESS
 
+/**@brief Modbus frame.
+ *
+ * The PDU is built by the caller directly at MODBUS_FRAME_PDU(). The protocol layer encodes
+ * and decodes the frame in place using the reserved headroom and tailroom, so no intermediate
+ * buffers are filled or copied during a transaction.
+ */
+typedef struct
+{
+    uint8_t * buffer;                                   /**< Pointer to the caller-owned frame storage. */
+    uint16_t size;                                      /**< Size of the frame storage in bytes, @see MODBUS_FRAME_SIZE. */
+    uint16_t pdu_length;                                /**< Length of the PDU in bytes. */
+} modbus_frame_t;
+
+/**@brief Bus scatter-gather element. */
+typedef struct
+{
+    const uint8_t * data;                               /**< Pointer to data to write. */
+    uint16_t data_length;                               /**< Length of the data in bytes. */
+} modbus_iovec_t;
+
 /**@brief Bus write callback.
  *
+ * @param[in] user_data   User data of the bus, @see modbus_params_t.
  * @param[in] data        Pointer to data to write.
  * @param[in] data_length Length of the data in bytes.
  * @param[in] timeout_ms  Minimum waiting time for sending data.
@@ -56,12 +123,14 @@ typedef enum
  * @retval MODBUS_CALLBACK_RESULT_TIMEOUT  No data was sent during set timeout.
  * @retval MODBUS_CALLBACK_RESULT_IO_ERROR If I/O error occured.
  */
-typedef modbus_callback_result_t (*modbus_write_callback_t)(uint8_t * data, 
+typedef modbus_callback_result_t (*modbus_write_callback_t)(void * user_data, 
+                                                            uint8_t * data, 
                                                             uint16_t data_length, 
                                                             uint32_t timeout_ms);
 
 /**@brief Bus read callback.
  *
+ * @param[in]  user_data   User data of the bus, @see modbus_params_t.
  * @param[out] data        Pointer to store read data.
  * @param[in]  data_length Length of the data in bytes.
  * @param[in]  timeout_ms  Minimum waiting time for receiving data.
@@ -70,51 +139,303 @@ typedef modbus_callback_result_t (*modbus_write_callback_t)(uint8_t * data,
  * @retval MODBUS_CALLBACK_RESULT_TIMEOUT  No data received during set timeout.
  * @retval MODBUS_CALLBACK_RESULT_IO_ERROR I/O error occured.
  */
-typedef modbus_callback_result_t (*modbus_read_callback_t)(uint8_t * data, 
+typedef modbus_callback_result_t (*modbus_read_callback_t)(void * user_data, 
+                                                           uint8_t * data, 
                                                            uint16_t data_length, 
                                                            uint32_t timeout_ms);
 
+/**@brief Bus receive callback. Reads bytes already received by the bus without waiting.
+ *
+ * @param[in]  user_data   User data of the bus, @see modbus_params_t.
+ * @param[out] data        Pointer to store received data.
+ * @param[in]  data_length Maximum length of the data in bytes.
+ * @param[out] received    Number of bytes stored.
+ *
+ * @retval MODBUS_CALLBACK_RESULT_SUCCESS  Received data (possibly none) successfully read.
+ * @retval MODBUS_CALLBACK_RESULT_IO_ERROR I/O error occured.
+ */
+typedef modbus_callback_result_t (*modbus_receive_callback_t)(void * user_data, 
+                                                              uint8_t * data, 
+                                                              uint16_t data_length, 
+                                                              uint16_t * received);
+
+/**@brief Bus scatter-gather write callback. All elements must go out as one continuous frame.
+ *
+ * @param[in] user_data  User data of the bus, @see modbus_params_t.
+ * @param[in] iov        Pointer to the array of elements to write.
+ * @param[in] iov_count  Number of elements.
+ * @param[in] timeout_ms Minimum waiting time for sending data.
+ *
+ * @retval MODBUS_CALLBACK_RESULT_SUCCESS  Data succesfully written to bus.
+ * @retval MODBUS_CALLBACK_RESULT_TIMEOUT  No data was sent during set timeout.
+ * @retval MODBUS_CALLBACK_RESULT_IO_ERROR If I/O error occured.
+ */
+typedef modbus_callback_result_t (*modbus_writev_callback_t)(void * user_data, 
+                                                             const modbus_iovec_t * iov, 
+                                                             uint8_t iov_count, 
+                                                             uint32_t timeout_ms);
+
 /**@brief Bus idle callback (for MODBUS_PROTOCOL_MODE_RTU). Callback must provide a time interval  
  *        on the bus with a duration of at least 3.5 bytes for a given baud rate.
  *
+ * @param[in] user_data   User data of the bus, @see modbus_params_t.
  * @param[in] data_length Length of the data in bytes.
  */
-typedef void (*modbus_idle_callback_t)(uint16_t data_length);
+typedef void (*modbus_idle_callback_t)(void * user_data, uint16_t data_length);
+
+/**@brief Bus delay callback. Callback must keep the bus silent for the given time after 
+ *        the transmission of the previously written data is completed.
+ *
+ * @param[in] user_data User data of the bus, @see modbus_params_t.
+ * @param[in] delay_ms  Delay in milliseconds.
+ */
+typedef void (*modbus_delay_callback_t)(void * user_data, uint32_t delay_ms);
+
+/**@brief Bus clock callback. 
+ *
+ * @param[in] user_data User data of the bus, @see modbus_params_t.
+ *
+ * @return Monotonic time in microseconds (wraps around).
+ */
+typedef uint32_t (*modbus_clock_callback_t)(void * user_data);
+
+/**@brief Metrics storage of the bus, @see modbus_metrics. */
+typedef struct modbus_metrics_s modbus_metrics_t;
 
 /**@brief Modbus parameters. */
 typedef struct
 {
     const modbus_mode_t mode;                           /**< Modbus mode. */
-    const modbus_read_callback_t write;                 /**< Pointer to a bus write callback. */
+    const modbus_write_callback_t write;                /**< Pointer to a bus write callback. */
     const modbus_read_callback_t read;                  /**< Pointer to a bus read callback. */
-    const modbus_idle_callback_t idle;                  /**< Pointer to a bus idle callback (required only for MODBUS_PROTOCOL_MODE_RTU). */
+    const modbus_idle_callback_t idle;                  /**< Pointer to a bus idle callback (required only for MODBUS_PROTOCOL_MODE_RTU, NULL otherwise). */
+    const modbus_writev_callback_t writev;              /**< Pointer to a bus scatter-gather write callback (optional, NULL if not supported). */
+    const modbus_receive_callback_t receive;            /**< Pointer to a bus receive callback (required only for asynchronous transactions). */
+    const modbus_delay_callback_t delay;                /**< Pointer to a bus delay callback (optional, NULL if the turnaround delay is provided by the caller). */
+    const modbus_clock_callback_t clock;                /**< Pointer to a bus clock callback (optional, required by the polling scheduler, NULL disables adaptive timeouts and offline servers). */
+    void * const user_data;                             /**< User data passed to the bus callbacks (e.g. port handle). */
+    const uint32_t timeout_ms;                          /**< Bus timeout, the upper bound of adaptive answer timeouts (0 for MODBUS_PROTOCOL_BUS_TIMEOUT_MS). */
+    const uint32_t baud_rate;                           /**< Bus baud rate (0 if unknown, required for asynchronous transactions in MODBUS_PROTOCOL_MODE_RTU, ignored in network modes). */
+    const uint32_t turnaround_ms;                       /**< Turnaround delay after broadcast requests (0 for MODBUS_PROTOCOL_TURNAROUND_MS). */
+    const uint8_t retries;                              /**< Number of retries of a request left without valid answer by modbus_frame_transaction(). */
 } modbus_params_t;
 
-/**@brief Initialize modbus protocol.
+#define MODBUS_UNITS_NUM                  (128) /**< Number of server addresses on the bus (0 is broadcast). */
+
+#define MODBUS_UNIT_FLAG_NO_READ_WRITE    (0x01) /**< Server does not support Read/Write Multiple Registers (0x17). */
+#define MODBUS_UNIT_FLAG_OFFLINE          (0x02) /**< Server does not answer, it is only probed from time to time. */
+
+#define MODBUS_UNIT_RTO_MIN_US            (2000) /**< Lower bound of the answer delay allowance on top of the wire time. */
+#define MODBUS_UNIT_RTO_MIN_NETWORK_US    (200000) /**< Lower bound of the allowance in network modes (TCP retransmission timeout). */
+#define MODBUS_UNIT_BACKOFF_MAX           (6)    /**< Maximum number of allowance doublings after failures. */
+#define MODBUS_UNIT_OFFLINE_FAILURES      (3)    /**< Consecutive unanswered transactions to mark the server offline. */
+#define MODBUS_UNIT_PROBE_MIN_MS          (100)  /**< First interval between probes of an offline server. */
+#define MODBUS_UNIT_PROBE_MAX_MS          (5000) /**< Maximum interval between probes of an offline server. */
+
+/**@brief State of a server on the bus. 
+ *
+ * Answer delay (round-trip time minus wire time of request and answer) is smoothed as in TCP (RFC 6298): 
+ * the allowance is srtt + 4 * rttvar, doubled for every retry and after unanswered transactions until 
+ * the next sample. Answers to retried requests are not sampled (Karn's algorithm).
+ */
+typedef struct
+{
+    uint8_t flags;                                      /**< Server flags (MODBUS_UNIT_FLAG_*). */
+    uint8_t failures;                                   /**< Consecutive unanswered transactions. */
+    uint8_t backoff;                                    /**< Allowance doublings until the next sample. */
+    uint32_t srtt_us;                                   /**< Smoothed answer delay (0 until the first sample). */
+    uint32_t rttvar_us;                                 /**< Answer delay variation. */
+    uint32_t probe_us;                                  /**< Time of the next probe (MODBUS_UNIT_FLAG_OFFLINE). */
+    uint32_t probe_interval_ms;                         /**< Current interval between probes (MODBUS_UNIT_FLAG_OFFLINE). */
+} modbus_unit_t;
+
+/**@brief Modbus context. Each context drives one bus and shares no state with other contexts, 
+ *        so independent buses can be used concurrently from separate threads.
+ */
+typedef struct
+{
+    modbus_mode_t mode;                                 /**< Modbus mode. */
+    modbus_write_callback_t write;                      /**< Pointer to a bus write callback. */
+    modbus_read_callback_t read;                        /**< Pointer to a bus read callback. */
+    modbus_idle_callback_t idle;                        /**< Pointer to a bus idle callback. */
+    modbus_writev_callback_t writev;                    /**< Pointer to a bus scatter-gather write callback. */
+    modbus_receive_callback_t receive;                  /**< Pointer to a bus receive callback. */
+    modbus_delay_callback_t delay;                      /**< Pointer to a bus delay callback. */
+    modbus_clock_callback_t clock;                      /**< Pointer to a bus clock callback. */
+    void * user_data;                                   /**< User data passed to the bus callbacks. */
+    uint32_t timeout_ms;                                /**< Bus timeout. */
+    uint32_t baud_rate;                                 /**< Bus baud rate. */
+    uint32_t turnaround_ms;                             /**< Turnaround delay after broadcast requests. */
+    uint8_t retries;                                    /**< Number of retries of a request. */
+    uint8_t attempt;                                    /**< Attempt of the current request (0 for the first one). */
+    uint8_t request_address;                            /**< Server address of the current request. */
+    uint32_t request_us;                                /**< Time the current request was sent. */
+    uint32_t request_wire_us;                           /**< Wire time of the current request. */
+    uint32_t answer_timeout_ms;                         /**< Timeout of the current answer. */
+    uint16_t transaction_id;                            /**< Transaction identifier of the last request (MODBUS_PROTOCOL_MODE_TCP). */
+    modbus_exception_t exception;                       /**< Exception code of the last answer. */
+    modbus_protocol_result_t result;                    /**< Result of the last modbus_frame_transaction(). */
+    modbus_metrics_t * metrics;                         /**< Metrics storage (NULL if not attached), @see modbus_metrics_attach(). */
+    modbus_unit_t units[MODBUS_UNITS_NUM];              /**< State of the servers, indexed by address. */
+    uint8_t buffer[MODBUS_PROTOCOL_BUFFER_SIZE];        /**< Scratch buffer. */
+} modbus_ctx_t;
+
+/**@brief Get PDU length from its leading bytes.
+ *
+ * The length is inferred from the function code and, where present, from the byte count field. 
+ * The result is refined as more bytes become available: while it is greater than the number 
+ * of available bytes, at least that many bytes are required to complete the PDU or infer its length.
+ *
+ * @param[in] pdu     Pointer to the leading bytes of PDU (address, function code and data).
+ * @param[in] length  Number of available bytes.
+ * @param[in] request true if PDU is a request (received by a server), false if it is an answer.
+ *
+ * @return PDU length (or lower bound of it, see above), 0 if function code is unknown.
+ */
+uint16_t modbus_pdu_length(const uint8_t * pdu, uint16_t length, bool request);
+
+/**@brief Get time required to transmit the frame with the PDU of given length on the bus.
+ *
+ * @param[in] ctx        Pointer to the modbus context.
+ * @param[in] pdu_length Length of the PDU in bytes.
+ *
+ * @return Time in microseconds, 0 if the baud rate is unknown (always in network modes).
+ */
+uint32_t modbus_wire_time_us(const modbus_ctx_t * ctx, uint16_t pdu_length);
+
+/**@brief Get answer timeout of the request to the server.
+ *
+ * @param[in] ctx                Pointer to the modbus context.
+ * @param[in] address            Server address.
+ * @param[in] request_pdu_length Length of the request PDU in bytes.
+ * @param[in] answer_pdu_length  Length of the answer PDU in bytes.
+ * @param[in] attempt            Attempt of the request (0 for the first one).
+ *
+ * @return Time from the start of the request transmission to the end of the answer in microseconds: 
+ *         wire time of both frames and the answer delay allowance (ctx->timeout_ms until the first sample, 
+ *         never more than that).
+ */
+uint32_t modbus_unit_timeout_us(const modbus_ctx_t * ctx, 
+                                uint8_t address, 
+                                uint16_t request_pdu_length, 
+                                uint16_t answer_pdu_length, 
+                                uint8_t attempt);
+
+/**@brief Check if the request to the server may be sent: server is online or its probe is due.
+ *
+ * @param[in] ctx     Pointer to the modbus context.
+ * @param[in] address Server address.
+ * @param[in] now_us  Current time in microseconds (same time base as the clock callback).
+ */
+bool modbus_unit_available(const modbus_ctx_t * ctx, uint8_t address, uint32_t now_us);
+
+/**@brief Check if the server is online.
+ *
+ * @param[in] ctx     Pointer to the modbus context.
+ * @param[in] address Server address.
+ */
+bool modbus_unit_online(const modbus_ctx_t * ctx, uint8_t address);
+
+/**@brief Register the answer of the server (including exceptions and corrupted answers), bring it online.
  *
- * @param[in] params Pointer to the modbus parameters.
+ * @param[in] ctx      Pointer to the modbus context.
+ * @param[in] address  Server address.
+ * @param[in] delay_us Measured answer delay: round-trip time minus wire time of request and answer.
+ * @param[in] sample   true to update the answer delay estimate (first attempt with valid answer only).
  */
-void modbus_protocol_initialize(const modbus_params_t * params);
+void modbus_unit_answered(modbus_ctx_t * ctx, uint8_t address, uint32_t delay_us, bool sample);
+
+/**@brief Register unanswered request to the server. Server is marked offline after 
+ *        MODBUS_UNIT_OFFLINE_FAILURES consecutive failures, the probe interval of an offline server is doubled.
+ *
+ * @param[in] ctx     Pointer to the modbus context.
+ * @param[in] address Server address.
+ * @param[in] now_us  Current time in microseconds (same time base as the clock callback).
+ */
+void modbus_unit_failed(modbus_ctx_t * ctx, uint8_t address, uint32_t now_us);
+
+/**@brief Initialize modbus context.
+ *
+ * The CRC engine shared by all contexts is selected on the first call, so the first context 
+ * must be initialized before other threads start using the protocol.
+ *
+ * @param[out] ctx    Pointer to the modbus context.
+ * @param[in]  params Pointer to the modbus parameters.
+ */
+void modbus_protocol_initialize(modbus_ctx_t * ctx, const modbus_params_t * params);
 
 /**@brief Send request.
  *
+ * @param[in] ctx         Pointer to the modbus context.
  * @param[in] data        Pointer to request to send
  * @param[in] data_length Length of the request in bytes.
  *
  * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
  * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
  */
-modbus_protocol_result_t modbus_request_write(uint8_t * data, uint16_t data_length);
+modbus_protocol_result_t modbus_request_write(modbus_ctx_t * ctx, uint8_t * data, uint16_t data_length);
 
 /**@brief Read answer.
  *
+ * @param[in]  ctx         Pointer to the modbus context.
  * @param[out] data        Pointer to store read answer.
  * @param[in]  data_length Length of the answer in bytes.
  *
- * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received, its 3-byte PDU is stored to data.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_answer_read(modbus_ctx_t * ctx, uint8_t * data, uint16_t data_length);
+
+/**@brief Send request frame. The frame is encoded in place.
+ *
+ * Broadcast request (MODBUS_ADDRESS_BROADCAST) is not answered, it is followed by the turnaround delay 
+ * provided by the bus delay callback.
+ *
+ * @param[in] ctx   Pointer to the modbus context.
+ * @param[in] frame Pointer to the frame with the request PDU.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
  * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
  */
-modbus_protocol_result_t modbus_answer_read(uint8_t * data, uint16_t data_length);
+modbus_protocol_result_t modbus_frame_request_write(modbus_ctx_t * ctx, modbus_frame_t * frame);
+
+/**@brief Read answer frame. The frame is decoded in place, the answer PDU is available at MODBUS_FRAME_PDU().
+ *
+ * Exception answers are recognized by the function code and returned as soon as they are received, 
+ * exception code is stored in ctx->exception. Answer of another server is treated as corrupted. 
+ * In MODBUS_PROTOCOL_MODE_TCP late answers to previous requests are recognized by the transaction 
+ * identifier and skipped.
+ *
+ * If the clock callback is provided, the answer timeout is derived from the wire time and the answer 
+ * delay estimate of the server (@see modbus_unit_timeout_us()) and the estimate is updated.
+ *
+ * @param[in]     ctx        Pointer to the modbus context.
+ * @param[in,out] frame      Pointer to the frame to store read answer.
+ * @param[in]     pdu_length Length of the answer PDU in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_frame_answer_read(modbus_ctx_t * ctx, modbus_frame_t * frame, uint16_t pdu_length);
+
+/**@brief Send request frame and read answer frame.
+ *
+ * Request left without valid answer (timeout, corrupted answer or answer from another server) is retried 
+ * up to ctx->retries times with doubled answer timeout. Request to an offline server is sent only when 
+ * its probe is due and is not retried.
+ *
+ * @param[in]     ctx        Pointer to the modbus context.
+ * @param[in,out] frame      Pointer to the frame with the request PDU, the answer PDU is stored in it.
+ * @param[in]     pdu_length Length of the answer PDU in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received (or not expected for broadcast request).
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received.
+ * @retval MODBUS_PROTOCOL_RESULT_OFFLINE   Server is offline, request is not sent.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t. The result is stored in ctx->result.
+ */
+modbus_protocol_result_t modbus_frame_transaction(modbus_ctx_t * ctx, modbus_frame_t * frame, uint16_t pdu_length);
 
 #endif
 
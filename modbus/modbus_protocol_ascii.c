@@ -1,64 +1,274 @@
 #include "modbus_protocol_ascii.h"
+#include "modbus_hex.h"
+#include "modbus_metrics.h"
 
-/**@brief Converting ASCII character to byte.
+uint8_t modbus_protocol_ascii_lrc_calculate(const uint8_t * data, uint16_t data_length)
+{
+    uint8_t checksum = 0;
+    
+    while (data_length--)
+    {
+        checksum += *data++;
+    }
+    
+    //Return twos complement
+    checksum = (uint8_t)(-((int8_t)checksum));
+    
+    return checksum;
+}
+
+/**@brief Get number of characters required to complete the frame of given PDU length (or its lower bound).
  */
-static uint8_t char_to_hex(uint8_t character)
+static uint16_t receiver_chars_needed(const modbus_ascii_receiver_t * receiver, uint16_t pdu_length)
 {
-    if ('0' <= character && character <= '9')
+    if (receiver->state == MODBUS_ASCII_RECEIVER_STATE_END)
     {
-        return (uint8_t)(character - '0');
+        return 1;
     }
     
-    if ('A' <= character && character <= 'F')
+    //Start character, characters of PDU and LRC, CR/LF
+    uint16_t needed = (receiver->state == MODBUS_ASCII_RECEIVER_STATE_IDLE) ? 1 : 0;
+    if (receiver->length < pdu_length + 1)
+    {
+        needed += (uint16_t)((pdu_length + 1 - receiver->length) * 2 - (receiver->odd ? 1 : 0));
+    }
+    else if (receiver->odd)
     {
-        return (uint8_t)(character - 'A' + 0x0A);
+        needed += 1;
     }
     
-    return 0xFF;
+    return (uint16_t)(needed + 2);
 }
 
-/**@brief Converting byte to ASCII character.
+/**@brief Complete received frame.
  */
-static uint8_t hex_to_char(uint8_t byte)
+static modbus_ascii_receiver_status_t receiver_complete(modbus_ascii_receiver_t * receiver)
 {
-    if (byte <= 0x09)
+    const bool framed = (receiver->length >= 3) && !receiver->odd && !receiver->invalid;
+    const bool valid = framed && (receiver->lrc == 0);
+    
+    //Sum of the frame bytes including its own LRC is zero
+    receiver->frame->pdu_length = (receiver->length >= 1) ? receiver->length - 1 : 0;
+    modbus_protocol_ascii_receiver_reset(receiver);
+    receiver->checksum_failed = framed && !valid;
+    
+    return valid ? MODBUS_ASCII_RECEIVER_STATUS_COMPLETE : MODBUS_ASCII_RECEIVER_STATUS_CORRUPTED;
+}
+
+/**@brief Decode pairs of hex characters into the frame and update the LRC.
+ *
+ * @retval false if the frame storage is too small.
+ */
+static bool receiver_store(modbus_ascii_receiver_t * receiver, const uint8_t * chars, uint16_t pairs)
+{
+    uint8_t * const bytes = &MODBUS_FRAME_PDU(receiver->frame)[receiver->length];
+    
+    if (MODBUS_FRAME_HEADROOM + receiver->length + pairs > receiver->frame->size)
     {
-        return (uint8_t)('0' + byte);
+        return false;
     }
     
-    if ((byte >= 0x0A) && (byte <= 0x0F))
+    if (!modbus_hex_decode(bytes, chars, pairs))
     {
-        return (uint8_t)(byte - 0x0A + 'A');
+        receiver->invalid = true;
     }
     
-    return '0';
+    receiver->lrc = (uint8_t)(receiver->lrc - modbus_protocol_ascii_lrc_calculate(bytes, pairs));
+    receiver->length += pairs;
+    
+    return true;
+}
+
+void modbus_protocol_ascii_receiver_initialize(modbus_ascii_receiver_t * receiver, 
+                                               modbus_frame_t * frame, 
+                                               bool request)
+{
+    receiver->frame = frame;
+    receiver->request = request;
+    
+    modbus_protocol_ascii_receiver_reset(receiver);
+}
+
+void modbus_protocol_ascii_receiver_reset(modbus_ascii_receiver_t * receiver)
+{
+    receiver->state = MODBUS_ASCII_RECEIVER_STATE_IDLE;
+    receiver->length = 0;
+    receiver->lrc = 0;
+    receiver->odd = false;
+    receiver->invalid = false;
+    receiver->checksum_failed = false;
 }
 
-/**@brief Calculating LRC (Longitudinal Redundancy Check).
+modbus_ascii_receiver_status_t modbus_protocol_ascii_receiver_feed(modbus_ascii_receiver_t * receiver, 
+                                                                   const uint8_t * data, 
+                                                                   uint16_t data_length, 
+                                                                   uint16_t * consumed)
+{
+    modbus_ascii_receiver_status_t status = MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE;
+    uint16_t pos = 0;
+    
+    while ((pos < data_length) && (status == MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE))
+    {
+        if (data[pos] == ':')
+        {
+            //Start character always begins a new frame, incomplete frame is discarded
+            modbus_protocol_ascii_receiver_reset(receiver);
+            receiver->state = MODBUS_ASCII_RECEIVER_STATE_DATA;
+            pos++;
+            continue;
+        }
+        
+        switch (receiver->state)
+        {
+            case MODBUS_ASCII_RECEIVER_STATE_IDLE:
+                //Skip characters outside of a frame
+                pos++;
+                break;
+                
+            case MODBUS_ASCII_RECEIVER_STATE_END:
+                if (data[pos++] != '\n')
+                {
+                    receiver->invalid = true;
+                }
+                status = receiver_complete(receiver);
+                break;
+                
+            case MODBUS_ASCII_RECEIVER_STATE_DATA:
+            {
+                if ((data[pos] == '\r') || (data[pos] == '\n'))
+                {
+                    //LF without CR completes the frame as corrupted
+                    receiver->invalid |= (data[pos] == '\n');
+                    receiver->state = MODBUS_ASCII_RECEIVER_STATE_END;
+                    status = (data[pos++] == '\n') ? receiver_complete(receiver) : status;
+                    break;
+                }
+                
+                //Run of characters up to the next control character is decoded at once
+                uint16_t end = pos;
+                while ((end < data_length) && (data[end] != ':') && (data[end] != '\r') && (data[end] != '\n'))
+                {
+                    end++;
+                }
+                
+                bool stored = true;
+                if (receiver->odd)
+                {
+                    const uint8_t pair[2] = { receiver->high, data[pos++] };
+                    receiver->odd = false;
+                    stored = receiver_store(receiver, pair, 1);
+                }
+                
+                const uint16_t pairs = (uint16_t)((end - pos) / 2);
+                stored = stored && receiver_store(receiver, &data[pos], pairs);
+                pos += pairs * 2;
+                
+                if (pos < end)
+                {
+                    receiver->high = data[pos++];
+                    receiver->odd = true;
+                }
+                
+                if (!stored)
+                {
+                    modbus_protocol_ascii_receiver_reset(receiver);
+                    status = MODBUS_ASCII_RECEIVER_STATUS_OVERFLOW;
+                }
+                break;
+            }
+        }
+    }
+    
+    if (consumed != NULL)
+    {
+        *consumed = pos;
+    }
+    
+    return status;
+}
+
+uint16_t modbus_protocol_ascii_receiver_needed(const modbus_ascii_receiver_t * receiver)
+{
+    const uint16_t pdu_length = modbus_pdu_length(MODBUS_FRAME_PDU(receiver->frame), 
+                                                  receiver->length, 
+                                                  receiver->request);
+    if (pdu_length == 0)
+    {
+        return 0;
+    }
+    
+    return receiver_chars_needed(receiver, pdu_length);
+}
+
+/**@brief Receive answer frame in parts through the receiver.
+ *
+ * @param[in]     ctx        Pointer to the modbus context.
+ * @param[in,out] frame      Pointer to the frame to store the answer PDU.
+ * @param[in]     pdu_length Expected length of the answer PDU, used for unknown function codes.
+ * @param[out]    chars      Pointer to store received characters.
+ * @param[in]     chars_size Size of the characters storage.
  */
-static uint8_t checksum_calculate(uint8_t * data, uint16_t data_length)
+static modbus_protocol_result_t frame_receive(modbus_ctx_t * ctx, 
+                                              modbus_frame_t * frame, 
+                                              uint16_t pdu_length, 
+                                              uint8_t * chars, 
+                                              uint16_t chars_size)
 {
-    uint8_t checksum = 0;
+    modbus_callback_result_t callback_result;
+    modbus_ascii_receiver_t receiver;
+    modbus_ascii_receiver_status_t status;
     
-    while (data_length--)
+    if (MODBUS_FRAME_HEADROOM + pdu_length + 1 > frame->size)
     {
-        checksum += *data++;
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
     }
     
-    //Return twos complement
-    checksum = (uint8_t)(-((int8_t)checksum));
+    modbus_protocol_ascii_receiver_initialize(&receiver, frame, false);
     
-    return checksum;
+    do
+    {
+        uint16_t needed = modbus_protocol_ascii_receiver_needed(&receiver);
+        if (needed == 0)
+        {
+            //Unknown function code, rely on the expected length
+            needed = receiver_chars_needed(&receiver, pdu_length);
+        }
+        if (needed > chars_size)
+        {
+            needed = chars_size;
+        }
+        
+        callback_result = ctx->read(ctx->user_data, chars, needed, ctx->answer_timeout_ms);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        }
+        
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_answer_received(ctx, needed));
+        
+        status = modbus_protocol_ascii_receiver_feed(&receiver, chars, needed, NULL);
+    } while (status == MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE);
+    
+    if (status != MODBUS_ASCII_RECEIVER_STATUS_COMPLETE)
+    {
+        if (receiver.checksum_failed)
+        {
+            MODBUS_METRICS_RECORD(ctx, modbus_metrics_checksum_failed(ctx));
+        }
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    return (MODBUS_FRAME_PDU(frame)[1] & 0x80) ? MODBUS_PROTOCOL_RESULT_EXCEPTION : MODBUS_PROTOCOL_RESULT_SUCCESS;
 }
 
-modbus_protocol_result_t modbus_protocol_ascii_request_write(modbus_write_callback_t write, 
+modbus_protocol_result_t modbus_protocol_ascii_request_write(modbus_ctx_t * ctx, 
                                                              uint8_t * data, 
                                                              uint16_t data_length)
 {
     modbus_callback_result_t callback_result;
-    uint8_t modbus_buffer[MODBUS_PROTOCOL_BUFFER_SIZE] = { 0 };
+    uint8_t * const modbus_buffer = ctx->buffer;
     
-    const uint8_t checksum = checksum_calculate(data, data_length);
+    const uint8_t checksum = modbus_protocol_ascii_lrc_calculate(data, data_length);
     const uint16_t length = data_length * 2 + 5;
     if (length > MODBUS_PROTOCOL_BUFFER_SIZE)
     {
@@ -67,58 +277,131 @@ modbus_protocol_result_t modbus_protocol_ascii_request_write(modbus_write_callba
     
     uint16_t pos = 0;
     modbus_buffer[pos++] = ':';
-    for (uint16_t i = 0; i < data_length; i++)
-    {
-        modbus_buffer[pos++] = hex_to_char((uint8_t)(data[i] >> 4));
-        modbus_buffer[pos++] = hex_to_char((uint8_t)(data[i] & 0x0F));
-    }
-    modbus_buffer[pos++] = hex_to_char((uint8_t)(checksum >> 4));
-    modbus_buffer[pos++] = hex_to_char((uint8_t)(checksum & 0x0F));
+    modbus_hex_encode(&modbus_buffer[pos], data, data_length);
+    pos += data_length * 2;
+    modbus_hex_encode(&modbus_buffer[pos], &checksum, 1);
+    pos += 2;
     modbus_buffer[pos++] = '\r';
     modbus_buffer[pos++] = '\n';
     
-    callback_result = write(modbus_buffer, pos, MODBUS_PROTOCOL_BUS_TIMEOUT_MS);
+    callback_result = ctx->write(ctx->user_data, modbus_buffer, pos, ctx->timeout_ms);
     
     return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
 }
 
-modbus_protocol_result_t modbus_protocol_ascii_answer_read(modbus_read_callback_t read, 
+modbus_protocol_result_t modbus_protocol_ascii_answer_read(modbus_ctx_t * ctx, 
                                                            uint8_t * data, 
                                                            uint16_t data_length)
 {
-    modbus_callback_result_t callback_result;
-    uint8_t modbus_buffer[MODBUS_PROTOCOL_BUFFER_SIZE] = { 0 };
+    modbus_protocol_result_t protocol_result;
     
-    const uint16_t length = data_length * 2 + 5;
-    if (length > MODBUS_PROTOCOL_BUFFER_SIZE)
+    //First part of the buffer stores the decoded answer, the rest is used for the received characters
+    const uint16_t frame_size = MODBUS_FRAME_RTU_SIZE(MODBUS_PDU_LENGTH_MAX);
+    modbus_frame_t frame = { .buffer = ctx->buffer, .size = frame_size };
+    
+    if (data_length > MODBUS_PDU_LENGTH_MAX)
     {
         return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
     }
     
-    callback_result = read(modbus_buffer, length, MODBUS_PROTOCOL_BUS_TIMEOUT_MS);
-    if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+    ctx->answer_timeout_ms = ctx->timeout_ms;
+    protocol_result = frame_receive(ctx, &frame, data_length, &ctx->buffer[frame_size], 
+                                    MODBUS_PROTOCOL_BUFFER_SIZE - frame_size);
+    if ((protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS) && (protocol_result != MODBUS_PROTOCOL_RESULT_EXCEPTION))
     {
-        return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        return protocol_result;
     }
     
-    uint16_t pos = 1, rcvpos = 0;
-    if ((modbus_buffer[0] == ':') && (modbus_buffer[length - 2] == '\r') && (modbus_buffer[length - 1] == '\n'))
+    if ((frame.pdu_length > data_length) || 
+        ((protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS) && (frame.pdu_length != data_length)))
     {
-        while (pos < length - 4)
-        {
-            data[rcvpos] = (uint8_t)(char_to_hex(modbus_buffer[pos++]) << 4);
-            data[rcvpos++] |= char_to_hex(modbus_buffer[pos++]);
-        }
-        
-        uint8_t checksum = (uint8_t)(char_to_hex(modbus_buffer[pos++]) << 4);
-        checksum |= char_to_hex(modbus_buffer[pos++]);        
-        const uint8_t checksum_calculated = checksum_calculate(data, data_length);
-        
-        if (checksum == checksum_calculated)
-        {
-            return MODBUS_PROTOCOL_RESULT_SUCCESS;
-        }
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    const uint8_t * const pdu = MODBUS_FRAME_PDU(&frame);
+    for (uint16_t i = 0; i < frame.pdu_length; i++)
+    {
+        data[i] = pdu[i];
+    }
+    
+    return protocol_result;
+}
+
+uint8_t * modbus_protocol_ascii_frame_encode(modbus_frame_t * frame, uint16_t * length)
+{
+    uint8_t * const pdu = MODBUS_FRAME_PDU(frame);
+    uint8_t * const adu = &frame->buffer[MODBUS_FRAME_ASCII_OFFSET];
+    
+    if (MODBUS_FRAME_ASCII_OFFSET + frame->pdu_length * 2 + 5 > frame->size)
+    {
+        return NULL;
+    }
+    
+    const uint8_t checksum = modbus_protocol_ascii_lrc_calculate(pdu, frame->pdu_length);
+    uint16_t pos = frame->pdu_length * 2 + 1;
+    modbus_hex_encode(&adu[pos], &checksum, 1);
+    pos += 2;
+    adu[pos++] = '\r';
+    adu[pos++] = '\n';
+    *length = pos;
+    
+    //Characters of the PDU start right after the start character, which is the PDU position itself
+    modbus_hex_encode(&adu[1], pdu, frame->pdu_length);
+    adu[0] = ':';
+    
+    return adu;
+}
+
+modbus_protocol_result_t modbus_protocol_ascii_frame_decode(modbus_frame_t * frame, uint16_t length)
+{
+    uint8_t * const pdu = MODBUS_FRAME_PDU(frame);
+    const uint8_t * const adu = &frame->buffer[MODBUS_FRAME_ASCII_OFFSET];
+    
+    if ((length < 5) || ((length & 0x01) == 0) || 
+        (adu[0] != ':') || (adu[length - 2] != '\r') || (adu[length - 1] != '\n'))
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    //PDU and LRC are decoded in place in one pass, any non-hex character corrupts the frame
+    const uint16_t pdu_length = (length - 5) / 2;
+    if (!modbus_hex_decode(pdu, &adu[1], pdu_length + 1))
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    const uint8_t checksum = pdu[pdu_length];
+    const uint8_t checksum_calculated = modbus_protocol_ascii_lrc_calculate(pdu, pdu_length);
+    
+    if (checksum == checksum_calculated)
+    {
+        frame->pdu_length = pdu_length;
+        return MODBUS_PROTOCOL_RESULT_SUCCESS;
     }
     
     return MODBUS_PROTOCOL_RESULT_CORRUPTED;
 }
+
+modbus_protocol_result_t modbus_protocol_ascii_frame_write(modbus_ctx_t * ctx, 
+                                                           modbus_frame_t * frame)
+{
+    modbus_callback_result_t callback_result;
+    uint16_t length;
+    
+    uint8_t * adu = modbus_protocol_ascii_frame_encode(frame, &length);
+    if (adu == NULL)
+    {
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+    }
+    
+    callback_result = ctx->write(ctx->user_data, adu, length, ctx->timeout_ms);
+    
+    return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+}
+
+modbus_protocol_result_t modbus_protocol_ascii_frame_read(modbus_ctx_t * ctx, 
+                                                          modbus_frame_t * frame, 
+                                                          uint16_t pdu_length)
+{
+    return frame_receive(ctx, frame, pdu_length, ctx->buffer, MODBUS_PROTOCOL_BUFFER_SIZE);
+}
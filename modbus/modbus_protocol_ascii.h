@@ -12,40 +12,179 @@
  *
  * @{
  */
-
+ 
 #ifndef _MODBUS_PROTOCOL_ASCII_H_
 #define _MODBUS_PROTOCOL_ASCII_H_
-
+ 
 #include <stdbool.h>
 #include <stdint.h>
 #include "modbus_protocol.h"
-
+ 
+#define MODBUS_FRAME_ASCII_OFFSET  (MODBUS_FRAME_HEADROOM - 1)  /**< Offset of the ASCII frame inside the frame storage. */
+ 
+/**@brief Modbus ASCII receiver status. */
+typedef enum
+{
+    MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE,            /**< More characters are required to complete the frame. */
+    MODBUS_ASCII_RECEIVER_STATUS_COMPLETE,              /**< Frame is complete and its LRC is valid. */
+    MODBUS_ASCII_RECEIVER_STATUS_CORRUPTED,             /**< Frame is complete, but it has non-hex characters, wrong terminator or invalid LRC. */
+    MODBUS_ASCII_RECEIVER_STATUS_OVERFLOW               /**< Frame does not fit into the frame storage. */
+} modbus_ascii_receiver_status_t;
+    
+/**@brief Modbus ASCII receiver state. */
+typedef enum
+{
+    MODBUS_ASCII_RECEIVER_STATE_IDLE,                   /**< Waiting for the start character. */
+    MODBUS_ASCII_RECEIVER_STATE_DATA,                   /**< Receiving hex characters. */
+    MODBUS_ASCII_RECEIVER_STATE_END                     /**< CR received, waiting for LF. */
+} modbus_ascii_receiver_state_t;
+    
+/**@brief Modbus ASCII receiver. 
+ *
+ * Characters are fed as they arrive and decoded straight into the frame PDU, the LRC is updated on the fly. 
+ * Characters outside of a frame are skipped, the start character always begins a new frame, 
+ * so the receiver resynchronizes after noise or a truncated frame. Frame is completed by CR/LF 
+ * whatever its length is.
+ */
+typedef struct
+{
+    modbus_frame_t * frame;                             /**< Frame to store received PDU. */
+    bool request;                                       /**< Receive requests (server) instead of answers (client). */
+    modbus_ascii_receiver_state_t state;                /**< Current state. */
+    uint16_t length;                                    /**< Number of decoded bytes (PDU and LRC). */
+    uint8_t lrc;                                        /**< Sum of the decoded bytes, zero for a valid frame. */
+    uint8_t high;                                       /**< First character of an incomplete pair. */
+    bool odd;                                           /**< Incomplete pair is pending. */
+    bool invalid;                                       /**< Non-hex character was received inside the frame. */
+    bool checksum_failed;                               /**< Last completed frame failed the LRC check only. */
+} modbus_ascii_receiver_t;
+    
 /**@brief Send request via Modbus ASCII protocol.
  *
- * @param[in] write       Write callback.
+ * @param[in] ctx         Pointer to the modbus context.
  * @param[in] data        Pointer to request to write.
  * @param[in] data_length Length of the request in bytes.
  *
  * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
  * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
  */
-modbus_protocol_result_t modbus_protocol_ascii_request_write(modbus_write_callback_t write, 
+modbus_protocol_result_t modbus_protocol_ascii_request_write(modbus_ctx_t * ctx, 
                                                              uint8_t * data, 
                                                              uint16_t data_length);
 
 /**@brief Read answer via Modbus ASCII protocol.
  *
- * @param[in]  read        Read callback.
+ * The answer is received into the context buffer by the ASCII receiver and its PDU is copied out.
+ *
+ * @param[in]  ctx         Pointer to the modbus context.
  * @param[out] data        Pointer to store read answer.
  * @param[in]  data_length Length of the answer in bytes.
  *
- * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Answer successfully received.
- * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received, its 3-byte PDU is stored to data.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
  */
-modbus_protocol_result_t modbus_protocol_ascii_answer_read(modbus_read_callback_t read, 
+modbus_protocol_result_t modbus_protocol_ascii_answer_read(modbus_ctx_t * ctx, 
                                                            uint8_t * data, 
                                                            uint16_t data_length);
 
+/**@brief Calculate LRC (Longitudinal Redundancy Check) of the data.
+ *
+ * @param[in] data        Pointer to the data.
+ * @param[in] data_length Length of the data.
+ *
+ * @return Twos complement of the sum of the bytes.
+ */
+uint8_t modbus_protocol_ascii_lrc_calculate(const uint8_t * data, uint16_t data_length);
+
+/**@brief Encode frame via Modbus ASCII protocol. The PDU is expanded to characters in place,
+ *        start character, LRC and end characters are added using the frame headroom and tailroom.
+ *
+ * @param[in,out] frame  Pointer to the frame with the PDU.
+ * @param[out]    length Length of the encoded frame in bytes.
+ *
+ * @return Pointer to the encoded frame inside the frame storage, NULL if the storage is too small.
+ */
+uint8_t * modbus_protocol_ascii_frame_encode(modbus_frame_t * frame, uint16_t * length);
+
+/**@brief Decode frame via Modbus ASCII protocol. The PDU is decoded in place.
+ *
+ * @param[in,out] frame  Pointer to the frame with the encoded frame stored at MODBUS_FRAME_ASCII_OFFSET.
+ * @param[in]     length Length of the encoded frame in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Frame successfully decoded, frame->pdu_length is set.
+ * @retval MODBUS_PROTOCOL_RESULT_CORRUPTED Frame is corrupted: wrong framing, non-hex character or LRC mismatch.
+ */
+modbus_protocol_result_t modbus_protocol_ascii_frame_decode(modbus_frame_t * frame, uint16_t length);
+
+/**@brief Initialize Modbus ASCII receiver.
+ *
+ * @param[out] receiver Pointer to the receiver.
+ * @param[in]  frame    Pointer to the frame to store received PDU.
+ * @param[in]  request  true to receive requests, false to receive answers.
+ */
+void modbus_protocol_ascii_receiver_initialize(modbus_ascii_receiver_t * receiver, 
+                                               modbus_frame_t * frame, 
+                                               bool request);
+
+/**@brief Discard received characters and wait for the start character.
+ *
+ * @param[in] receiver Pointer to the receiver.
+ */
+void modbus_protocol_ascii_receiver_reset(modbus_ascii_receiver_t * receiver);
+
+/**@brief Feed received characters to Modbus ASCII receiver.
+ *
+ * @param[in]  receiver    Pointer to the receiver.
+ * @param[in]  data        Pointer to received characters.
+ * @param[in]  data_length Number of received characters.
+ * @param[out] consumed    Number of characters consumed, the rest belongs to the next frame (may be NULL).
+ *
+ * @return Receiver status. When the frame is complete, frame->pdu_length is set.
+ */
+modbus_ascii_receiver_status_t modbus_protocol_ascii_receiver_feed(modbus_ascii_receiver_t * receiver, 
+                                                                   const uint8_t * data, 
+                                                                   uint16_t data_length, 
+                                                                   uint16_t * consumed);
+
+/**@brief Get number of characters required to complete the frame or to refine its expected length.
+ *        Reading that many characters never consumes characters of the next frame.
+ *
+ * @param[in] receiver Pointer to the receiver.
+ *
+ * @return Number of characters, 0 if the frame length can't be inferred (frame ends by CR/LF only).
+ */
+uint16_t modbus_protocol_ascii_receiver_needed(const modbus_ascii_receiver_t * receiver);
+
+/**@brief Send request frame via Modbus ASCII protocol.
+ *
+ * @param[in]     ctx   Pointer to the modbus context.
+ * @param[in,out] frame Pointer to the frame with the request PDU.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
+ * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_ascii_frame_write(modbus_ctx_t * ctx, 
+                                                           modbus_frame_t * frame);
+
+/**@brief Read answer frame via Modbus ASCII protocol.
+ *
+ * The answer is read in parts through the receiver, characters before the start character are skipped 
+ * and answers shorter than expected (e.g. exceptions) are completed without waiting for the timeout. 
+ * The PDU is decoded straight into the frame, so the frame storage only has to fit the PDU and LRC.
+ *
+ * @param[in]     ctx        Pointer to the modbus context.
+ * @param[in,out] frame      Pointer to the frame to store read answer.
+ * @param[in]     pdu_length Length of the answer PDU in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_ascii_frame_read(modbus_ctx_t * ctx, 
+                                                          modbus_frame_t * frame, 
+                                                          uint16_t pdu_length);
+
 #endif
 
 /** @} */
\ No newline at end of file
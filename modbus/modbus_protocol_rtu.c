@@ -1,81 +1,29 @@
 #include "modbus_protocol_rtu.h"
-
-/**@brief Table of CRC values for high-order byte. */
-static const uint8_t crc_high_table[] = {
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 
-    0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81, 0x40,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41,
-    0x00, 0xC1, 0x81, 0x40
-};
-
-/**@brief Table of CRC values for low-order byte. */
-static const uint8_t crc_low_table[] = {
-    0x00, 0xC0, 0xC1, 0x01, 0xC3, 0x03, 0x02, 0xC2, 0xC6, 0x06, 0x07, 0xC7,
-    0x05, 0xC5, 0xC4, 0x04, 0xCC, 0x0C, 0x0D, 0xCD, 0x0F, 0xCF, 0xCE, 0x0E,
-    0x0A, 0xCA, 0xCB, 0x0B, 0xC9, 0x09, 0x08, 0xC8, 0xD8, 0x18, 0x19, 0xD9,
-    0x1B, 0xDB, 0xDA, 0x1A, 0x1E, 0xDE, 0xDF, 0x1F, 0xDD, 0x1D, 0x1C, 0xDC,
-    0x14, 0xD4, 0xD5, 0x15, 0xD7, 0x17, 0x16, 0xD6, 0xD2, 0x12, 0x13, 0xD3,
-    0x11, 0xD1, 0xD0, 0x10, 0xF0, 0x30, 0x31, 0xF1, 0x33, 0xF3, 0xF2, 0x32,
-    0x36, 0xF6, 0xF7, 0x37, 0xF5, 0x35, 0x34, 0xF4, 0x3C, 0xFC, 0xFD, 0x3D,
-    0xFF, 0x3F, 0x3E, 0xFE, 0xFA, 0x3A, 0x3B, 0xFB, 0x39, 0xF9, 0xF8, 0x38, 
-    0x28, 0xE8, 0xE9, 0x29, 0xEB, 0x2B, 0x2A, 0xEA, 0xEE, 0x2E, 0x2F, 0xEF,
-    0x2D, 0xED, 0xEC, 0x2C, 0xE4, 0x24, 0x25, 0xE5, 0x27, 0xE7, 0xE6, 0x26,
-    0x22, 0xE2, 0xE3, 0x23, 0xE1, 0x21, 0x20, 0xE0, 0xA0, 0x60, 0x61, 0xA1,
-    0x63, 0xA3, 0xA2, 0x62, 0x66, 0xA6, 0xA7, 0x67, 0xA5, 0x65, 0x64, 0xA4,
-    0x6C, 0xAC, 0xAD, 0x6D, 0xAF, 0x6F, 0x6E, 0xAE, 0xAA, 0x6A, 0x6B, 0xAB, 
-    0x69, 0xA9, 0xA8, 0x68, 0x78, 0xB8, 0xB9, 0x79, 0xBB, 0x7B, 0x7A, 0xBA,
-    0xBE, 0x7E, 0x7F, 0xBF, 0x7D, 0xBD, 0xBC, 0x7C, 0xB4, 0x74, 0x75, 0xB5,
-    0x77, 0xB7, 0xB6, 0x76, 0x72, 0xB2, 0xB3, 0x73, 0xB1, 0x71, 0x70, 0xB0,
-    0x50, 0x90, 0x91, 0x51, 0x93, 0x53, 0x52, 0x92, 0x96, 0x56, 0x57, 0x97,
-    0x55, 0x95, 0x94, 0x54, 0x9C, 0x5C, 0x5D, 0x9D, 0x5F, 0x9F, 0x9E, 0x5E,
-    0x5A, 0x9A, 0x9B, 0x5B, 0x99, 0x59, 0x58, 0x98, 0x88, 0x48, 0x49, 0x89,
-    0x4B, 0x8B, 0x8A, 0x4A, 0x4E, 0x8E, 0x8F, 0x4F, 0x8D, 0x4D, 0x4C, 0x8C,
-    0x44, 0x84, 0x85, 0x45, 0x87, 0x47, 0x46, 0x86, 0x82, 0x42, 0x43, 0x83,
-    0x41, 0x81, 0x80, 0x40
-};
+#include "modbus_crc.h"
+#include "modbus_metrics.h"
 
 /**@brief Calculating CRC.
  */
 static uint16_t checksum_calculate(uint8_t * data, uint16_t data_length)
 {
-    uint8_t crc_high = 0xFF;
-    uint8_t crc_low = 0xFF;
-    
-    while (data_length--)
+    return modbus_crc_update(MODBUS_CRC_INITIAL, data, data_length);
+}
+
+/**@brief Keep the inter-frame silence on the bus (there is none for RTU frames over TCP).
+ */
+static void bus_idle(modbus_ctx_t * ctx, uint16_t length)
+{
+    if (ctx->idle != NULL)
     {
-        uint32_t i = crc_low ^ *(data++);
-        crc_low = (uint8_t)(crc_high ^ crc_high_table[i]);
-        crc_high = crc_low_table[i];
+        ctx->idle(ctx->user_data, length);
     }
-    
-    return (uint16_t)(crc_high << 8 | crc_low);
 }
 
-modbus_protocol_result_t modbus_protocol_rtu_request_write(modbus_write_callback_t write, 
-                                                           modbus_idle_callback_t idle, 
+modbus_protocol_result_t modbus_protocol_rtu_request_write(modbus_ctx_t * ctx, 
                                                            uint8_t * data, 
                                                            uint16_t data_length)
 {
     modbus_callback_result_t callback_result;
-    uint8_t modbus_buffer[MODBUS_PROTOCOL_BUFFER_SIZE] = { 0 };
     
     const uint16_t checksum = checksum_calculate(data, data_length);
     const uint16_t length = data_length + 2;
@@ -84,6 +32,19 @@ modbus_protocol_result_t modbus_protocol_rtu_request_write(modbus_write_callback
         return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
     }
     
+    if (ctx->writev != NULL)
+    {
+        const uint8_t crc[2] = { (uint8_t)(checksum & 0xFF), (uint8_t)(checksum >> 8) };
+        const modbus_iovec_t iov[2] = { { data, data_length }, { crc, sizeof(crc) } };
+        
+        bus_idle(ctx, length);
+        callback_result = ctx->writev(ctx->user_data, iov, 2, ctx->timeout_ms);
+        bus_idle(ctx, length);
+        
+        return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+    }
+    
+    uint8_t * const modbus_buffer = ctx->buffer;
     for (uint16_t i = 0; i < data_length; i++)
     {
         modbus_buffer[i] = data[i];
@@ -91,43 +52,316 @@ modbus_protocol_result_t modbus_protocol_rtu_request_write(modbus_write_callback
     modbus_buffer[length - 2] = (uint8_t)(checksum & 0xFF);
     modbus_buffer[length - 1] = (uint8_t)(checksum >> 8);
     
-    idle(length);
-    callback_result = write(modbus_buffer, length, MODBUS_PROTOCOL_BUS_TIMEOUT_MS);
-    idle(length);
+    bus_idle(ctx, length);
+    callback_result = ctx->write(ctx->user_data, modbus_buffer, length, ctx->timeout_ms);
+    bus_idle(ctx, length);
     
     return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
 }
 
-modbus_protocol_result_t modbus_protocol_rtu_answer_read(modbus_read_callback_t read, 
+modbus_protocol_result_t modbus_protocol_rtu_answer_read(modbus_ctx_t * ctx, 
                                                          uint8_t * data, 
                                                          uint16_t data_length)
 {
-    modbus_callback_result_t callback_result;
-    uint8_t modbus_buffer[MODBUS_PROTOCOL_BUFFER_SIZE] = { 0 };
+    modbus_protocol_result_t protocol_result;
+    uint8_t modbus_buffer[MODBUS_FRAME_HEADROOM + MODBUS_PROTOCOL_BUFFER_SIZE];
+    modbus_frame_t frame = { .buffer = modbus_buffer, .size = sizeof(modbus_buffer) };
     
-    const uint16_t length = data_length + 2;
-    if (length > MODBUS_PROTOCOL_BUFFER_SIZE)
+    ctx->answer_timeout_ms = ctx->timeout_ms;
+    protocol_result = modbus_protocol_rtu_frame_read(ctx, &frame, data_length);
+    if ((protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS) && (protocol_result != MODBUS_PROTOCOL_RESULT_EXCEPTION))
     {
-        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+        return protocol_result;
     }
     
-    callback_result = read(modbus_buffer, length, MODBUS_PROTOCOL_BUS_TIMEOUT_MS);
-    if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+    if ((frame.pdu_length > data_length) || 
+        ((protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS) && (frame.pdu_length != data_length)))
     {
-        return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
     }
     
-    for (uint16_t i = 0; i < data_length; i++)
+    const uint8_t * pdu = MODBUS_FRAME_PDU(&frame);
+    for (uint16_t i = 0; i < frame.pdu_length; i++)
+    {
+        data[i] = pdu[i];
+    }
+    
+    return protocol_result;
+}
+
+uint8_t * modbus_protocol_rtu_frame_encode(modbus_frame_t * frame, uint16_t * length)
+{
+    uint8_t * pdu = MODBUS_FRAME_PDU(frame);
+    
+    if (MODBUS_FRAME_RTU_OFFSET + frame->pdu_length + 2 > frame->size)
     {
-        data[i] = modbus_buffer[i];
-    }    
-    const uint16_t checksum = (modbus_buffer[length - 1] << 8) | modbus_buffer[length - 2];
-    const uint16_t checksum_calculated = checksum_calculate(data, data_length);
+        return NULL;
+    }
+    
+    const uint16_t checksum = checksum_calculate(pdu, frame->pdu_length);
+    pdu[frame->pdu_length] = (uint8_t)(checksum & 0xFF);
+    pdu[frame->pdu_length + 1] = (uint8_t)(checksum >> 8);
+    
+    *length = frame->pdu_length + 2;
+    
+    return &frame->buffer[MODBUS_FRAME_RTU_OFFSET];
+}
+
+modbus_protocol_result_t modbus_protocol_rtu_frame_decode(modbus_frame_t * frame, uint16_t length)
+{
+    uint8_t * pdu = MODBUS_FRAME_PDU(frame);
+    
+    if (length < 2)
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    const uint16_t pdu_length = length - 2;
+    const uint16_t checksum = (pdu[pdu_length + 1] << 8) | pdu[pdu_length];
+    const uint16_t checksum_calculated = checksum_calculate(pdu, pdu_length);
     
     if (checksum == checksum_calculated)
     {
+        frame->pdu_length = pdu_length;
         return MODBUS_PROTOCOL_RESULT_SUCCESS;
     }
     
     return MODBUS_PROTOCOL_RESULT_CORRUPTED;
 }
+
+void modbus_protocol_rtu_receiver_initialize(modbus_rtu_receiver_t * receiver, 
+                                             modbus_frame_t * frame, 
+                                             uint32_t baud_rate, 
+                                             bool request)
+{
+    receiver->frame = frame;
+    receiver->request = request;
+    
+    if (baud_rate == 0)
+    {
+        receiver->char_us = 0;
+        receiver->t15_us = 0;
+        receiver->t35_us = 0;
+    }
+    else
+    {
+        //11 bits per character, fixed intervals are recommended for baud rates above 19200
+        receiver->char_us = (11 * 1000000UL + baud_rate - 1) / baud_rate;
+        receiver->t15_us = (baud_rate > 19200) ? 750 : (receiver->char_us * 3 + 1) / 2;
+        receiver->t35_us = (baud_rate > 19200) ? 1750 : (receiver->char_us * 7 + 1) / 2;
+    }
+    
+    modbus_protocol_rtu_receiver_reset(receiver);
+}
+
+void modbus_protocol_rtu_receiver_reset(modbus_rtu_receiver_t * receiver)
+{
+    receiver->length = 0;
+    receiver->crc = MODBUS_CRC_INITIAL;
+    receiver->gap_exceeded = false;
+    receiver->checksum_failed = false;
+}
+
+uint16_t modbus_protocol_rtu_receiver_needed(const modbus_rtu_receiver_t * receiver)
+{
+    const uint16_t pdu_length = modbus_pdu_length(MODBUS_FRAME_PDU(receiver->frame), 
+                                                  receiver->length, 
+                                                  receiver->request);
+    if (pdu_length == 0)
+    {
+        return 0;
+    }
+    
+    return (uint16_t)(pdu_length + 2 - receiver->length);
+}
+
+/**@brief Complete received frame.
+ */
+static modbus_rtu_receiver_status_t receiver_complete(modbus_rtu_receiver_t * receiver)
+{
+    const bool framed = (receiver->length >= 4) && !receiver->gap_exceeded;
+    const bool valid = framed && (receiver->crc == 0);
+    
+    //CRC of a frame including its own CRC is zero
+    receiver->frame->pdu_length = (receiver->length >= 2) ? receiver->length - 2 : 0;
+    modbus_protocol_rtu_receiver_reset(receiver);
+    receiver->checksum_failed = framed && !valid;
+    
+    return valid ? MODBUS_RTU_RECEIVER_STATUS_COMPLETE : MODBUS_RTU_RECEIVER_STATUS_CORRUPTED;
+}
+
+modbus_rtu_receiver_status_t modbus_protocol_rtu_receiver_feed(modbus_rtu_receiver_t * receiver, 
+                                                               const uint8_t * data, 
+                                                               uint16_t data_length, 
+                                                               uint32_t timestamp_us, 
+                                                               uint16_t * consumed)
+{
+    uint8_t * const adu = &receiver->frame->buffer[MODBUS_FRAME_RTU_OFFSET];
+    const uint16_t capacity = receiver->frame->size - MODBUS_FRAME_RTU_OFFSET;
+    uint16_t pos = 0;
+    
+    if ((receiver->char_us != 0) && (receiver->length != 0) && (data_length != 0))
+    {
+        const uint32_t gap = timestamp_us - receiver->timestamp_us - receiver->char_us;
+        if ((int32_t)gap >= (int32_t)receiver->t35_us)
+        {
+            //Incomplete frame was followed by the inter-frame silence
+            modbus_protocol_rtu_receiver_reset(receiver);
+        }
+        else if ((int32_t)gap > (int32_t)receiver->t15_us)
+        {
+            receiver->gap_exceeded = true;
+        }
+    }
+    
+    modbus_rtu_receiver_status_t status = MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE;
+    while (pos < data_length)
+    {
+        uint16_t needed = modbus_protocol_rtu_receiver_needed(receiver);
+        if ((needed == 0) || (needed > data_length - pos))
+        {
+            needed = data_length - pos;
+        }
+        
+        if (receiver->length + needed > capacity)
+        {
+            pos = data_length;
+            modbus_protocol_rtu_receiver_reset(receiver);
+            status = MODBUS_RTU_RECEIVER_STATUS_OVERFLOW;
+            break;
+        }
+        
+        for (uint16_t i = 0; i < needed; i++)
+        {
+            adu[receiver->length + i] = data[pos + i];
+        }
+        receiver->crc = modbus_crc_update(receiver->crc, &data[pos], needed);
+        receiver->length += needed;
+        pos += needed;
+        
+        const uint16_t pdu_length = modbus_pdu_length(MODBUS_FRAME_PDU(receiver->frame), 
+                                                      receiver->length, 
+                                                      receiver->request);
+        if ((pdu_length != 0) && (pdu_length + 2 <= receiver->length))
+        {
+            status = receiver_complete(receiver);
+            break;
+        }
+    }
+    
+    if ((receiver->char_us != 0) && (pos != 0))
+    {
+        receiver->timestamp_us = timestamp_us + (uint32_t)(pos - 1) * receiver->char_us;
+    }
+    
+    if (consumed != NULL)
+    {
+        *consumed = pos;
+    }
+    
+    return status;
+}
+
+modbus_rtu_receiver_status_t modbus_protocol_rtu_receiver_poll(modbus_rtu_receiver_t * receiver, 
+                                                               uint32_t timestamp_us)
+{
+    if ((receiver->char_us == 0) || (receiver->length == 0))
+    {
+        return MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE;
+    }
+    
+    const uint32_t gap = timestamp_us - receiver->timestamp_us - receiver->char_us;
+    if ((int32_t)gap < (int32_t)receiver->t35_us)
+    {
+        return MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE;
+    }
+    
+    return receiver_complete(receiver);
+}
+
+modbus_protocol_result_t modbus_protocol_rtu_frame_write(modbus_ctx_t * ctx, 
+                                                         modbus_frame_t * frame)
+{
+    modbus_callback_result_t callback_result;
+    uint16_t length;
+    
+    if ((MODBUS_FRAME_RTU_OFFSET + frame->pdu_length + 2 > frame->size) && (ctx->writev != NULL))
+    {
+        //No tailroom for the CRC, it is written after the PDU by the scatter-gather callback
+        return modbus_protocol_rtu_request_write(ctx, MODBUS_FRAME_PDU(frame), frame->pdu_length);
+    }
+    
+    uint8_t * adu = modbus_protocol_rtu_frame_encode(frame, &length);
+    if (adu == NULL)
+    {
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+    }
+    
+    bus_idle(ctx, length);
+    callback_result = ctx->write(ctx->user_data, adu, length, ctx->timeout_ms);
+    bus_idle(ctx, length);
+    
+    return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+}
+
+modbus_protocol_result_t modbus_protocol_rtu_frame_read(modbus_ctx_t * ctx, 
+                                                        modbus_frame_t * frame, 
+                                                        uint16_t pdu_length)
+{
+    modbus_callback_result_t callback_result;
+    modbus_rtu_receiver_t receiver;
+    modbus_rtu_receiver_status_t status;
+    
+    if (MODBUS_FRAME_RTU_OFFSET + pdu_length + 2 > frame->size)
+    {
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+    }
+    
+    modbus_protocol_rtu_receiver_initialize(&receiver, frame, 0, false);
+    
+    do
+    {
+        uint8_t * const adu = &frame->buffer[MODBUS_FRAME_RTU_OFFSET];
+        const uint16_t received = receiver.length;
+        uint16_t needed = modbus_protocol_rtu_receiver_needed(&receiver);
+        if (needed == 0)
+        {
+            //Unknown function code, rely on the expected length
+            needed = (received < pdu_length + 2) ? pdu_length + 2 - received : 1;
+        }
+        
+        if (MODBUS_FRAME_RTU_OFFSET + received + needed > frame->size)
+        {
+            return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+        }
+        
+        callback_result = ctx->read(ctx->user_data, &adu[received], needed, ctx->answer_timeout_ms);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        }
+        
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_answer_received(ctx, needed));
+        
+        status = modbus_protocol_rtu_receiver_feed(&receiver, &adu[received], needed, 0, NULL);
+        if ((status == MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE) && 
+            (modbus_protocol_rtu_receiver_needed(&receiver) == 0) && (receiver.length >= pdu_length + 2))
+        {
+            //Unknown function code, the expected length is received
+            status = (receiver.crc == 0) ? MODBUS_RTU_RECEIVER_STATUS_COMPLETE : MODBUS_RTU_RECEIVER_STATUS_CORRUPTED;
+            receiver.checksum_failed = (receiver.crc != 0);
+            frame->pdu_length = receiver.length - 2;
+        }
+    } while (status == MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE);
+    
+    if (status != MODBUS_RTU_RECEIVER_STATUS_COMPLETE)
+    {
+        if (receiver.checksum_failed)
+        {
+            MODBUS_METRICS_RECORD(ctx, modbus_metrics_checksum_failed(ctx));
+        }
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    return (MODBUS_FRAME_PDU(frame)[1] & 0x80) ? MODBUS_PROTOCOL_RESULT_EXCEPTION : MODBUS_PROTOCOL_RESULT_SUCCESS;
+}
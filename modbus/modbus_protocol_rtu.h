@@ -22,34 +22,173 @@
 #include <stdint.h>
 #include "modbus_protocol.h"
 
+#define MODBUS_FRAME_RTU_OFFSET    (MODBUS_FRAME_HEADROOM)  /**< Offset of the RTU frame inside the frame storage. */
+
+/**@brief Modbus RTU receiver status. */
+typedef enum
+{
+    MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE,              /**< More bytes are required to complete the frame. */
+    MODBUS_RTU_RECEIVER_STATUS_COMPLETE,                /**< Frame is complete and its CRC is valid. */
+    MODBUS_RTU_RECEIVER_STATUS_CORRUPTED,               /**< Frame is complete, but its CRC is invalid or t1.5 was exceeded inside it. */
+    MODBUS_RTU_RECEIVER_STATUS_OVERFLOW                 /**< Frame does not fit into the frame storage. */
+} modbus_rtu_receiver_status_t;
+
+/**@brief Modbus RTU receiver. 
+ *
+ * Bytes are fed as they arrive, the CRC is updated on the fly. Frame is completed as soon as 
+ * its length can be inferred from the function code and the byte count field, frames with unknown 
+ * function codes are completed by the t3.5 silence interval.
+ */
+typedef struct
+{
+    modbus_frame_t * frame;                             /**< Frame to store received frame. */
+    bool request;                                       /**< Receive requests (server) instead of answers (client). */
+    uint32_t char_us;                                   /**< Character time in microseconds (0 if inter-character timing is not checked). */
+    uint32_t t15_us;                                    /**< Maximum inter-character interval inside the frame in microseconds. */
+    uint32_t t35_us;                                    /**< Minimum inter-frame interval in microseconds. */
+    uint32_t timestamp_us;                              /**< Time of the last received character in microseconds. */
+    uint16_t length;                                    /**< Number of received bytes. */
+    uint16_t crc;                                       /**< CRC of the received bytes. */
+    bool gap_exceeded;                                  /**< t1.5 was exceeded inside the frame. */
+    bool checksum_failed;                               /**< Last completed frame failed the CRC check only. */
+} modbus_rtu_receiver_t;
+
 /**@brief Send request via Modbus RTU protocol.
  *
- * @param[in] write       Write callback.
- * @param[in] idle        Idle callback.
+ * If the scatter-gather write callback is provided, request and CRC are written without copying.
+ *
+ * @param[in] ctx         Pointer to the modbus context.
  * @param[in] data        Pointer to request to write.
  * @param[in] data_length Length of the request in bytes.
  *
  * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
  * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
  */
-modbus_protocol_result_t modbus_protocol_rtu_request_write(modbus_write_callback_t write, 
-                                                           modbus_idle_callback_t idle, 
+modbus_protocol_result_t modbus_protocol_rtu_request_write(modbus_ctx_t * ctx, 
                                                            uint8_t * data, 
                                                            uint16_t data_length);
 
 /**@brief Read answer via Modbus RTU protocol.
  *
- * @param[in]  read        Read callback.
+ * The answer is read by modbus_protocol_rtu_frame_read() into a stack frame and its PDU is copied out.
+ *
+ * @param[in]  ctx         Pointer to the modbus context.
  * @param[out] data        Pointer to store read answer.
  * @param[in]  data_length Length of the answer in bytes.
  *
- * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Answer successfully received.
- * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received, its 3-byte PDU is stored to data.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
  */
-modbus_protocol_result_t modbus_protocol_rtu_answer_read(modbus_read_callback_t read, 
+modbus_protocol_result_t modbus_protocol_rtu_answer_read(modbus_ctx_t * ctx, 
                                                          uint8_t * data, 
                                                          uint16_t data_length);
 
+/**@brief Encode frame via Modbus RTU protocol. CRC is appended to the PDU in place.
+ *
+ * @param[in,out] frame  Pointer to the frame with the PDU.
+ * @param[out]    length Length of the encoded frame in bytes.
+ *
+ * @return Pointer to the encoded frame inside the frame storage, NULL if the storage is too small.
+ */
+uint8_t * modbus_protocol_rtu_frame_encode(modbus_frame_t * frame, uint16_t * length);
+
+/**@brief Decode frame via Modbus RTU protocol. 
+ *
+ * @param[in,out] frame  Pointer to the frame with the encoded frame stored at MODBUS_FRAME_RTU_OFFSET.
+ * @param[in]     length Length of the encoded frame in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Frame successfully decoded, frame->pdu_length is set.
+ * @retval MODBUS_PROTOCOL_RESULT_CORRUPTED Frame is corrupted.
+ */
+modbus_protocol_result_t modbus_protocol_rtu_frame_decode(modbus_frame_t * frame, uint16_t length);
+
+/**@brief Initialize Modbus RTU receiver.
+ *
+ * @param[out] receiver  Pointer to the receiver.
+ * @param[in]  frame     Pointer to the frame to store received frame.
+ * @param[in]  baud_rate Baud rate used to derive t1.5 and t3.5 intervals (0 if timing is not checked).
+ * @param[in]  request   true to receive requests, false to receive answers.
+ */
+void modbus_protocol_rtu_receiver_initialize(modbus_rtu_receiver_t * receiver, 
+                                             modbus_frame_t * frame, 
+                                             uint32_t baud_rate, 
+                                             bool request);
+
+/**@brief Discard received bytes and wait for a new frame.
+ *
+ * @param[in] receiver Pointer to the receiver.
+ */
+void modbus_protocol_rtu_receiver_reset(modbus_rtu_receiver_t * receiver);
+
+/**@brief Feed received bytes to Modbus RTU receiver.
+ *
+ * Bytes of one call are considered to be received continuously. If the silence before them exceeds t3.5, 
+ * previously received incomplete frame is discarded.
+ *
+ * @param[in]  receiver     Pointer to the receiver.
+ * @param[in]  data         Pointer to received bytes.
+ * @param[in]  data_length  Number of received bytes.
+ * @param[in]  timestamp_us Time of the first byte reception in microseconds.
+ * @param[out] consumed     Number of bytes consumed, the rest belongs to the next frame (may be NULL).
+ *
+ * @return Receiver status. When the frame is complete, frame->pdu_length is set.
+ */
+modbus_rtu_receiver_status_t modbus_protocol_rtu_receiver_feed(modbus_rtu_receiver_t * receiver, 
+                                                               const uint8_t * data, 
+                                                               uint16_t data_length, 
+                                                               uint32_t timestamp_us, 
+                                                               uint16_t * consumed);
+
+/**@brief Complete the frame with unknown length if the t3.5 silence has elapsed.
+ *
+ * @param[in] receiver     Pointer to the receiver.
+ * @param[in] timestamp_us Current time in microseconds.
+ *
+ * @return Receiver status.
+ */
+modbus_rtu_receiver_status_t modbus_protocol_rtu_receiver_poll(modbus_rtu_receiver_t * receiver, 
+                                                               uint32_t timestamp_us);
+
+/**@brief Get number of bytes required to complete the frame or to refine its expected length.
+ *
+ * @param[in] receiver Pointer to the receiver.
+ *
+ * @return Number of bytes, 0 if the frame length can't be inferred (frame ends by silence).
+ */
+uint16_t modbus_protocol_rtu_receiver_needed(const modbus_rtu_receiver_t * receiver);
+
+/**@brief Send request frame via Modbus RTU protocol.
+ *
+ * CRC is appended in place if the frame storage has room for it. Otherwise PDU and CRC are written 
+ * by the scatter-gather write callback, so a frame sized for the PDU only is still sent without copying.
+ *
+ * @param[in]     ctx   Pointer to the modbus context.
+ * @param[in,out] frame Pointer to the frame with the request PDU.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
+ * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_rtu_frame_write(modbus_ctx_t * ctx, 
+                                                         modbus_frame_t * frame);
+
+/**@brief Read answer frame via Modbus RTU protocol.
+ *
+ * The answer is read in parts, its length is inferred from the received bytes, so answers shorter 
+ * than expected (e.g. exceptions) are completed without waiting for the timeout.
+ *
+ * @param[in]     ctx        Pointer to the modbus context.
+ * @param[in,out] frame      Pointer to the frame to store read answer.
+ * @param[in]     pdu_length Length of the answer PDU in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_rtu_frame_read(modbus_ctx_t * ctx, 
+                                                        modbus_frame_t * frame, 
+                                                        uint16_t pdu_length);
+
 #endif
 
 /** @} */
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "modbus_protocol_tcp.h"
+#include "modbus_metrics.h"
+
+#include <string.h>
+
+/**@brief Store the header of the frame with the PDU of given length.
+ */
+static void header_encode(uint8_t * header, uint16_t transaction_id, uint16_t pdu_length)
+{
+    header[0] = (uint8_t)(transaction_id >> 8);
+    header[1] = (uint8_t)(transaction_id & 0xFF);
+    header[2] = 0;
+    header[3] = 0;
+    header[4] = (uint8_t)(pdu_length >> 8);
+    header[5] = (uint8_t)(pdu_length & 0xFF);
+}
+
+/**@brief Get transaction identifier from the header.
+ */
+static uint16_t header_id(const uint8_t * header)
+{
+    return (uint16_t)((header[0] << 8) | header[1]);
+}
+
+/**@brief Get PDU length (unit identifier and the rest of the frame) from the header.
+ */
+static uint16_t header_pdu_length(const uint8_t * header)
+{
+    return (uint16_t)((header[4] << 8) | header[5]);
+}
+
+/**@brief Check the protocol identifier and the length of the header.
+ */
+static bool header_valid(const uint8_t * header)
+{
+    const uint16_t pdu_length = header_pdu_length(header);
+    
+    //Unit identifier and function code at least
+    return (header[2] == 0) && (header[3] == 0) && (pdu_length >= 2) && (pdu_length <= MODBUS_PDU_LENGTH_MAX);
+}
+
+/**@brief Read the answer with the current transaction identifier, skip the other ones.
+ */
+static modbus_protocol_result_t frame_receive(modbus_ctx_t * ctx, modbus_frame_t * frame, uint32_t timeout_ms)
+{
+    modbus_callback_result_t callback_result;
+    uint8_t * const header = &frame->buffer[MODBUS_FRAME_TCP_OFFSET];
+    
+    for (;;)
+    {
+        callback_result = ctx->read(ctx->user_data, header, MODBUS_TCP_HEADER_SIZE, timeout_ms);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        }
+        
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_answer_received(ctx, MODBUS_TCP_HEADER_SIZE));
+        
+        if (!header_valid(header))
+        {
+            return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+        }
+        
+        //Late answer or the one which does not fit is read into the scratch buffer
+        const uint16_t pdu_length = header_pdu_length(header);
+        const bool current = (header_id(header) == ctx->transaction_id);
+        const bool fits = (MODBUS_FRAME_HEADROOM + pdu_length <= frame->size);
+        uint8_t * const pdu = (current && fits) ? MODBUS_FRAME_PDU(frame) : ctx->buffer;
+        
+        callback_result = ctx->read(ctx->user_data, pdu, pdu_length, timeout_ms);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+        }
+        
+        MODBUS_METRICS_RECORD(ctx, modbus_metrics_answer_received(ctx, pdu_length));
+        
+        if (current)
+        {
+            if (!fits)
+            {
+                return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+            }
+            frame->pdu_length = pdu_length;
+            
+            return (pdu[1] & 0x80) ? MODBUS_PROTOCOL_RESULT_EXCEPTION : MODBUS_PROTOCOL_RESULT_SUCCESS;
+        }
+    }
+}
+
+modbus_protocol_result_t modbus_protocol_tcp_request_write(modbus_ctx_t * ctx, 
+                                                           uint8_t * data, 
+                                                           uint16_t data_length)
+{
+    modbus_callback_result_t callback_result;
+    uint8_t header[MODBUS_TCP_HEADER_SIZE];
+    
+    const uint16_t length = data_length + MODBUS_TCP_HEADER_SIZE;
+    if (length > MODBUS_PROTOCOL_BUFFER_SIZE)
+    {
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+    }
+    
+    ctx->transaction_id++;
+    header_encode(header, ctx->transaction_id, data_length);
+    
+    if (ctx->writev != NULL)
+    {
+        const modbus_iovec_t iov[2] = { { header, sizeof(header) }, { data, data_length } };
+        
+        callback_result = ctx->writev(ctx->user_data, iov, 2, ctx->timeout_ms);
+        
+        return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+    }
+    
+    uint8_t * const modbus_buffer = ctx->buffer;
+    memcpy(modbus_buffer, header, sizeof(header));
+    memcpy(&modbus_buffer[sizeof(header)], data, data_length);
+    
+    callback_result = ctx->write(ctx->user_data, modbus_buffer, length, ctx->timeout_ms);
+    
+    return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+}
+
+modbus_protocol_result_t modbus_protocol_tcp_answer_read(modbus_ctx_t * ctx, 
+                                                         uint8_t * data, 
+                                                         uint16_t data_length)
+{
+    modbus_frame_t frame = { .buffer = ctx->buffer, .size = sizeof(ctx->buffer), .pdu_length = 0 };
+    
+    if (MODBUS_FRAME_HEADROOM + data_length > frame.size)
+    {
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+    }
+    
+    modbus_protocol_result_t protocol_result = frame_receive(ctx, &frame, ctx->timeout_ms);
+    if ((protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS) && (protocol_result != MODBUS_PROTOCOL_RESULT_EXCEPTION))
+    {
+        return protocol_result;
+    }
+    
+    if ((frame.pdu_length > data_length) || 
+        ((protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS) && (frame.pdu_length != data_length)))
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    memcpy(data, MODBUS_FRAME_PDU(&frame), frame.pdu_length);
+    
+    return protocol_result;
+}
+
+uint8_t * modbus_protocol_tcp_frame_encode(modbus_frame_t * frame, uint16_t transaction_id, uint16_t * length)
+{
+    if (MODBUS_FRAME_HEADROOM + frame->pdu_length > frame->size)
+    {
+        return NULL;
+    }
+    
+    uint8_t * const adu = &frame->buffer[MODBUS_FRAME_TCP_OFFSET];
+    header_encode(adu, transaction_id, frame->pdu_length);
+    
+    *length = MODBUS_TCP_HEADER_SIZE + frame->pdu_length;
+    
+    return adu;
+}
+
+modbus_protocol_result_t modbus_protocol_tcp_frame_decode(modbus_frame_t * frame, 
+                                                          uint16_t length, 
+                                                          uint16_t * transaction_id)
+{
+    const uint8_t * const header = &frame->buffer[MODBUS_FRAME_TCP_OFFSET];
+    
+    if ((length < MODBUS_TCP_HEADER_SIZE) || (MODBUS_FRAME_TCP_OFFSET + length > frame->size) || 
+        !header_valid(header) || (MODBUS_TCP_HEADER_SIZE + header_pdu_length(header) != length))
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    frame->pdu_length = header_pdu_length(header);
+    *transaction_id = header_id(header);
+    
+    return MODBUS_PROTOCOL_RESULT_SUCCESS;
+}
+
+void modbus_protocol_tcp_receiver_initialize(modbus_tcp_receiver_t * receiver)
+{
+    receiver->frame = NULL;
+    receiver->length = 0;
+    receiver->pdu_length = 0;
+    memset(receiver->header, 0, sizeof(receiver->header));
+}
+
+modbus_tcp_receiver_status_t modbus_protocol_tcp_receiver_feed(modbus_tcp_receiver_t * receiver, 
+                                                               const uint8_t * data, 
+                                                               uint16_t data_length, 
+                                                               uint16_t * consumed)
+{
+    if (receiver->length < MODBUS_TCP_HEADER_SIZE)
+    {
+        const uint16_t needed = MODBUS_TCP_HEADER_SIZE - receiver->length;
+        const uint16_t count = (data_length < needed) ? data_length : needed;
+        memcpy(&receiver->header[receiver->length], data, count);
+        receiver->length += count;
+        *consumed = count;
+        
+        if (receiver->length < MODBUS_TCP_HEADER_SIZE)
+        {
+            return MODBUS_TCP_RECEIVER_STATUS_INCOMPLETE;
+        }
+        
+        if (!header_valid(receiver->header))
+        {
+            receiver->length = 0;
+            return MODBUS_TCP_RECEIVER_STATUS_CORRUPTED;
+        }
+        
+        receiver->pdu_length = header_pdu_length(receiver->header);
+        receiver->frame = NULL;
+        
+        return MODBUS_TCP_RECEIVER_STATUS_HEADER;
+    }
+    
+    const uint16_t received = receiver->length - MODBUS_TCP_HEADER_SIZE;
+    const uint16_t needed = receiver->pdu_length - received;
+    const uint16_t count = (data_length < needed) ? data_length : needed;
+    if (receiver->frame != NULL)
+    {
+        memcpy(&MODBUS_FRAME_PDU(receiver->frame)[received], data, count);
+    }
+    receiver->length += count;
+    *consumed = count;
+    
+    if (count < needed)
+    {
+        return MODBUS_TCP_RECEIVER_STATUS_INCOMPLETE;
+    }
+    
+    if (receiver->frame != NULL)
+    {
+        receiver->frame->pdu_length = receiver->pdu_length;
+    }
+    //Header is kept until the next frame is fed
+    receiver->length = 0;
+    
+    return MODBUS_TCP_RECEIVER_STATUS_COMPLETE;
+}
+
+uint16_t modbus_protocol_tcp_receiver_id(const modbus_tcp_receiver_t * receiver)
+{
+    return header_id(receiver->header);
+}
+
+bool modbus_protocol_tcp_receiver_accept(modbus_tcp_receiver_t * receiver, modbus_frame_t * frame)
+{
+    if ((frame != NULL) && (MODBUS_FRAME_HEADROOM + receiver->pdu_length > frame->size))
+    {
+        frame = NULL;
+    }
+    receiver->frame = frame;
+    
+    return (frame != NULL);
+}
+
+modbus_protocol_result_t modbus_protocol_tcp_frame_write(modbus_ctx_t * ctx, 
+                                                         modbus_frame_t * frame)
+{
+    modbus_callback_result_t callback_result;
+    uint16_t length;
+    
+    ctx->transaction_id++;
+    uint8_t * adu = modbus_protocol_tcp_frame_encode(frame, ctx->transaction_id, &length);
+    if (adu == NULL)
+    {
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+    }
+    
+    callback_result = ctx->write(ctx->user_data, adu, length, ctx->timeout_ms);
+    
+    return MODBUS_CALLBACK_TO_PROTOCOL_RESULT(callback_result);
+}
+
+modbus_protocol_result_t modbus_protocol_tcp_frame_read(modbus_ctx_t * ctx, 
+                                                        modbus_frame_t * frame, 
+                                                        uint16_t pdu_length)
+{
+    if (MODBUS_FRAME_HEADROOM + pdu_length > frame->size)
+    {
+        return MODBUS_PROTOCOL_RESULT_NO_BUFFER_SPACE;
+    }
+    
+    return frame_receive(ctx, frame, ctx->answer_timeout_ms);
+}
@@ -0,0 +1,174 @@
+/**
+ * @ingroup modbus_protocol
+ *
+ * @defgroup modbus_protocol_tcp Modbus TCP protocol
+ *
+ * @brief Modbus TCP carries the PDU over a TCP connection prefixed by the MBAP header
+ * (Modbus Application Protocol): transaction identifier, protocol identifier (0) and length
+ * of the rest of the frame. The unit identifier which completes the header is the server address,
+ * the first byte of the PDU, so the header is encoded in place into the frame headroom.
+ *
+ * TCP provides the integrity of the data, there is no checksum. Every request gets a new transaction
+ * identifier and the answer repeats it, so several requests may be in flight on one connection
+ * (@see modbus_async) and late answers to abandoned requests are recognized and skipped.
+ *
+ * Gateways passing RTU frames over TCP unchanged are served by MODBUS_PROTOCOL_MODE_RTU_OVER_TCP
+ * with the RTU framing (@see modbus_protocol_rtu), one request at a time.
+ *
+ * @{
+ */
+
+#ifndef _MODBUS_PROTOCOL_TCP_H_
+#define _MODBUS_PROTOCOL_TCP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus_protocol.h"
+
+#define MODBUS_TCP_PORT            (502)    /**< Registered Modbus TCP port. */
+#define MODBUS_TCP_HEADER_SIZE     (6)      /**< MBAP header up to the unit identifier (the first byte of the PDU). */
+#define MODBUS_FRAME_TCP_OFFSET    (MODBUS_FRAME_HEADROOM - MODBUS_TCP_HEADER_SIZE) /**< Offset of the TCP frame inside the frame storage. */
+
+/**@brief Modbus TCP receiver status. */
+typedef enum
+{
+    MODBUS_TCP_RECEIVER_STATUS_INCOMPLETE,              /**< More bytes are required to complete the frame. */
+    MODBUS_TCP_RECEIVER_STATUS_HEADER,                  /**< Header is received, the frame to store the PDU is to be accepted. */
+    MODBUS_TCP_RECEIVER_STATUS_COMPLETE,                /**< Frame is complete. */
+    MODBUS_TCP_RECEIVER_STATUS_CORRUPTED                /**< Header is invalid, the stream is out of sync and should be closed. */
+} modbus_tcp_receiver_status_t;
+
+/**@brief Modbus TCP receiver.
+ *
+ * Bytes are fed as they arrive. Once the header is received, the caller selects the frame to store
+ * the PDU by its transaction identifier (@see modbus_protocol_tcp_receiver_accept()), PDUs which
+ * are not accepted are skipped.
+ */
+typedef struct
+{
+    modbus_frame_t * frame;                             /**< Frame to store the PDU of the current frame (NULL to skip it). */
+    uint8_t header[MODBUS_TCP_HEADER_SIZE];             /**< Header of the current frame. */
+    uint16_t length;                                    /**< Number of received bytes of the current frame. */
+    uint16_t pdu_length;                                /**< PDU length of the current frame (valid once the header is received). */
+} modbus_tcp_receiver_t;
+
+/**@brief Send request via Modbus TCP protocol with a new transaction identifier.
+ *
+ * @param[in] ctx         Pointer to the modbus context.
+ * @param[in] data        Pointer to request to write.
+ * @param[in] data_length Length of the request in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
+ * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_tcp_request_write(modbus_ctx_t * ctx, 
+                                                           uint8_t * data, 
+                                                           uint16_t data_length);
+
+/**@brief Read answer via Modbus TCP protocol.
+ *
+ * @param[in]  ctx         Pointer to the modbus context.
+ * @param[out] data        Pointer to store read answer.
+ * @param[in]  data_length Length of the answer in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received, its 3-byte PDU is stored to data.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_tcp_answer_read(modbus_ctx_t * ctx, 
+                                                         uint8_t * data, 
+                                                         uint16_t data_length);
+
+/**@brief Encode frame via Modbus TCP protocol. The header is stored ahead of the PDU in place.
+ *
+ * @param[in,out] frame          Pointer to the frame with the PDU.
+ * @param[in]     transaction_id Transaction identifier.
+ * @param[out]    length         Length of the encoded frame in bytes.
+ *
+ * @return Pointer to the encoded frame inside the frame storage, NULL if the storage is too small.
+ */
+uint8_t * modbus_protocol_tcp_frame_encode(modbus_frame_t * frame, uint16_t transaction_id, uint16_t * length);
+
+/**@brief Decode frame via Modbus TCP protocol.
+ *
+ * @param[in,out] frame          Pointer to the frame with the encoded frame stored at MODBUS_FRAME_TCP_OFFSET.
+ * @param[in]     length         Length of the encoded frame in bytes.
+ * @param[out]    transaction_id Transaction identifier of the frame.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Frame successfully decoded, frame->pdu_length is set.
+ * @retval MODBUS_PROTOCOL_RESULT_CORRUPTED Frame is corrupted.
+ */
+modbus_protocol_result_t modbus_protocol_tcp_frame_decode(modbus_frame_t * frame, 
+                                                          uint16_t length, 
+                                                          uint16_t * transaction_id);
+
+/**@brief Initialize Modbus TCP receiver.
+ *
+ * @param[out] receiver Pointer to the receiver.
+ */
+void modbus_protocol_tcp_receiver_initialize(modbus_tcp_receiver_t * receiver);
+
+/**@brief Feed received bytes to Modbus TCP receiver.
+ *
+ * The receiver stops after the header (MODBUS_TCP_RECEIVER_STATUS_HEADER) and after the complete frame,
+ * the rest of the bytes is fed by the next call.
+ *
+ * @param[in]  receiver    Pointer to the receiver.
+ * @param[in]  data        Pointer to received bytes.
+ * @param[in]  data_length Number of received bytes.
+ * @param[out] consumed    Number of bytes consumed.
+ *
+ * @return Receiver status. When the frame is complete and accepted, frame->pdu_length is set.
+ */
+modbus_tcp_receiver_status_t modbus_protocol_tcp_receiver_feed(modbus_tcp_receiver_t * receiver, 
+                                                               const uint8_t * data, 
+                                                               uint16_t data_length, 
+                                                               uint16_t * consumed);
+
+/**@brief Get transaction identifier of the current frame, valid from MODBUS_TCP_RECEIVER_STATUS_HEADER
+ *        until the next frame is fed.
+ *
+ * @param[in] receiver Pointer to the receiver.
+ */
+uint16_t modbus_protocol_tcp_receiver_id(const modbus_tcp_receiver_t * receiver);
+
+/**@brief Select the frame to store the PDU of the current frame.
+ *
+ * @param[in] receiver Pointer to the receiver.
+ * @param[in] frame    Pointer to the frame (NULL to skip the PDU).
+ *
+ * @retval true if the PDU is stored into the frame, false if it is skipped (no frame or the frame is too small).
+ */
+bool modbus_protocol_tcp_receiver_accept(modbus_tcp_receiver_t * receiver, modbus_frame_t * frame);
+
+/**@brief Send request frame via Modbus TCP protocol with a new transaction identifier (ctx->transaction_id).
+ *
+ * @param[in]     ctx   Pointer to the modbus context.
+ * @param[in,out] frame Pointer to the frame with the request PDU.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS Request successfully sent.
+ * @retval protocol_result                Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_tcp_frame_write(modbus_ctx_t * ctx, 
+                                                         modbus_frame_t * frame);
+
+/**@brief Read answer frame via Modbus TCP protocol.
+ *
+ * The answer length is taken from the header. Answers with other transaction identifiers
+ * (late answers to previous requests) are skipped.
+ *
+ * @param[in]     ctx        Pointer to the modbus context.
+ * @param[in,out] frame      Pointer to the frame to store read answer.
+ * @param[in]     pdu_length Length of the answer PDU in bytes.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Answer successfully received.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Exception answer received.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t modbus_protocol_tcp_frame_read(modbus_ctx_t * ctx, 
+                                                        modbus_frame_t * frame, 
+                                                        uint16_t pdu_length);
+
+#endif
+
+/** @} */
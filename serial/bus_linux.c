@@ -0,0 +1,119 @@
+#include "bus_linux.h"
+
+#include <errno.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/**@brief Wake callback: signal the event the owner thread sleeps on.
+ */
+static void owner_wake(void * wake_data)
+{
+    bus_owner_t * const owner = (bus_owner_t *)wake_data;
+    const uint64_t count = 1;
+    
+    while ((write(owner->event_fd, &count, sizeof(count)) < 0) && (errno == EINTR))
+    {
+    }
+}
+
+/**@brief Owner thread.
+ */
+static void * owner_thread(void * arg)
+{
+    bus_owner_t * const owner = (bus_owner_t *)arg;
+    uint64_t count;
+    
+    for (;;)
+    {
+        while (servo_bus_poll(owner->bus))
+        {
+        }
+        
+        //Jobs submitted before the stop are executed by the loop above
+        if (!atomic_load(&owner->running))
+        {
+            break;
+        }
+        
+        if (servo_bus_idle_enter(owner->bus))
+        {
+            while ((read(owner->event_fd, &count, sizeof(count)) < 0) && (errno == EINTR))
+            {
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+/**@brief Completion callback of bus_owner_execute(): release the waiting thread.
+ */
+static void execute_complete(servo_bus_job_t * job, bool success)
+{
+    (void)success;
+    sem_post((sem_t *)job->user_data);
+}
+
+bool bus_owner_start(bus_owner_t * owner, servo_bus_t * bus, modbus_ctx_t * ctx)
+{
+    owner->event_fd = eventfd(0, EFD_CLOEXEC);
+    if (owner->event_fd < 0)
+    {
+        return false;
+    }
+    
+    owner->bus = bus;
+    atomic_init(&owner->running, true);
+    servo_bus_initialize(bus, ctx, bus_owner_clock, NULL, owner_wake, owner);
+    
+    const int error = pthread_create(&owner->thread, NULL, owner_thread, owner);
+    if (error != 0)
+    {
+        close(owner->event_fd);
+        errno = error;
+        return false;
+    }
+    
+    return true;
+}
+
+void bus_owner_stop(bus_owner_t * owner)
+{
+    atomic_store(&owner->running, false);
+    owner_wake(owner);
+    pthread_join(owner->thread, NULL);
+    
+    close(owner->event_fd);
+    owner->event_fd = -1;
+}
+
+bool bus_owner_execute(bus_owner_t * owner, servo_bus_lane_t lane, servo_bus_job_t * job)
+{
+    sem_t done;
+    
+    if (sem_init(&done, 0, 0) != 0)
+    {
+        job->result = MODBUS_PROTOCOL_RESULT_IO_ERROR;
+        return false;
+    }
+    
+    servo_bus_submit(owner->bus, lane, job, execute_complete, &done);
+    while ((sem_wait(&done) != 0) && (errno == EINTR))
+    {
+    }
+    sem_destroy(&done);
+    
+    return (job->result == MODBUS_PROTOCOL_RESULT_SUCCESS);
+}
+
+uint32_t bus_owner_clock(void * user_data)
+{
+    struct timespec now;
+    
+    (void)user_data;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000);
+}
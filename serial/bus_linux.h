@@ -0,0 +1,85 @@
+/**
+ * @ingroup serial_linux
+ *
+ * @defgroup bus_linux Bus owner thread
+ *
+ * @brief Thread which owns a bus and executes the jobs submitted by the other threads (@see servo_bus).
+ *
+ * The thread sleeps on an eventfd while there are no jobs, the submitting thread wakes it only if it
+ * sleeps. bus_owner_execute() is the blocking counterpart of the servo_* functions for any thread:
+ * @code
+ * servo_bus_t bus;
+ * bus_owner_t owner;
+ * bus_owner_start(&owner, &bus, &ctx);
+ * ...
+ * //Motion thread
+ * servo_bus_job_t stop;
+ * servo_bus_oneword_write_prepare(&stop, 1, 0x0100, 0);
+ * bus_owner_execute(&owner, SERVO_BUS_LANE_CRITICAL, &stop);
+ * ...
+ * //Diagnostics thread
+ * servo_bus_job_t dump;
+ * servo_bus_read_prepare(&dump, 1, 0x0000, parameters, 2000);
+ * bus_owner_execute(&owner, SERVO_BUS_LANE_BACKGROUND, &dump);
+ * ...
+ * bus_owner_stop(&owner);
+ * @endcode
+ *
+ * @{
+ */
+
+#ifndef _BUS_LINUX_H_
+#define _BUS_LINUX_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "servo/servo_bus.h"
+
+/**@brief Bus owner thread. */
+typedef struct
+{
+    servo_bus_t * bus;                                  /**< Bus owner queue. */
+    int event_fd;                                       /**< Wake event of the sleeping thread. */
+    pthread_t thread;                                   /**< Owner thread. */
+    atomic_bool running;                                /**< Owner thread keeps waiting for jobs while set. */
+} bus_owner_t;
+
+/**@brief Initialize bus owner queue with the monotonic clock and start the owner thread. From now on the modbus
+ *        context is used by the owner thread only.
+ *
+ * @param[out] owner Pointer to the bus owner thread.
+ * @param[out] bus   Pointer to the bus owner queue to initialize.
+ * @param[in]  ctx   Pointer to the initialized modbus context of the bus.
+ *
+ * @retval true if started, otherwise false (errno is set).
+ */
+bool bus_owner_start(bus_owner_t * owner, servo_bus_t * bus, modbus_ctx_t * ctx);
+
+/**@brief Execute jobs submitted before the call and stop the owner thread. No jobs may be submitted afterwards.
+ *
+ * @param[in] owner Pointer to the bus owner thread.
+ */
+void bus_owner_stop(bus_owner_t * owner);
+
+/**@brief Submit prepared job and wait for its completion. Must not be called by the owner thread
+ *        (completion callbacks of the jobs).
+ *
+ * @param[in] owner Pointer to the bus owner thread.
+ * @param[in] lane  Priority lane.
+ * @param[in] job   Pointer to the prepared job.
+ *
+ * @retval true if successful, otherwise false (result and exception code are available in the job).
+ */
+bool bus_owner_execute(bus_owner_t * owner, servo_bus_lane_t lane, servo_bus_job_t * job);
+
+/**@brief Get monotonic time in microseconds, the clock of the bus owner queue (@see modbus_clock_callback_t).
+ *
+ * @param[in] user_data Not used.
+ */
+uint32_t bus_owner_clock(void * user_data);
+
+#endif
+
+/** @} */
@@ -0,0 +1,154 @@
+#include "serial_capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERIAL_CAPTURE_BATCH_SIZE    (16384)
+
+/**@brief Write the whole buffer to the file.
+ */
+static bool file_write(int fd, const uint8_t * data, size_t data_length)
+{
+    while (data_length != 0)
+    {
+        const ssize_t written = write(fd, data, data_length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        data_length -= (size_t)written;
+    }
+    
+    return true;
+}
+
+/**@brief Move all records from the ring to the file.
+ *
+ * @return Number of moved records.
+ */
+static uint32_t drain(serial_capture_t * writer)
+{
+    uint8_t data[MODBUS_CAPTURE_DATA_MAX];
+    uint8_t batch[SERIAL_CAPTURE_BATCH_SIZE];
+    modbus_capture_record_t record;
+    uint32_t count = 0;
+    size_t batch_length = 0;
+    
+    while (modbus_capture_pop(writer->capture, &record, data))
+    {
+        if (batch_length + MODBUS_CAPTURE_RECORD_ENCODED_MAX > sizeof(batch))
+        {
+            writer->failed = writer->failed || !file_write(writer->fd, batch, batch_length);
+            batch_length = 0;
+        }
+        batch_length += modbus_capture_record_encode(&batch[batch_length], &record, data, writer->previous_us);
+        writer->previous_us = record.timestamp_us;
+        if (record.type == MODBUS_CAPTURE_LOST)
+        {
+            writer->lost += record.length;
+        }
+        count++;
+    }
+    
+    if (batch_length != 0)
+    {
+        writer->failed = writer->failed || !file_write(writer->fd, batch, batch_length);
+    }
+    
+    return count;
+}
+
+/**@brief Writer thread.
+ */
+static void * writer_thread(void * arg)
+{
+    serial_capture_t * const writer = (serial_capture_t *)arg;
+    const struct timespec interval = { .tv_sec = 0, .tv_nsec = SERIAL_CAPTURE_DRAIN_INTERVAL_MS * 1000000L };
+    
+    while (atomic_load_explicit(&writer->running, memory_order_relaxed))
+    {
+        if (drain(writer) == 0)
+        {
+            nanosleep(&interval, NULL);
+        }
+    }
+    
+    return NULL;
+}
+
+bool serial_capture_start(serial_capture_t * writer, 
+                          modbus_capture_t * capture, 
+                          const char * path, 
+                          modbus_mode_t mode, 
+                          uint32_t baud_rate)
+{
+    uint8_t header[MODBUS_CAPTURE_FILE_HEADER_SIZE];
+    
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (writer->fd < 0)
+    {
+        return false;
+    }
+    
+    modbus_capture_header_encode(header, mode, baud_rate);
+    if (!file_write(writer->fd, header, sizeof(header)))
+    {
+        close(writer->fd);
+        return false;
+    }
+    
+    writer->capture = capture;
+    writer->previous_us = 0;
+    writer->lost = 0;
+    writer->failed = false;
+    atomic_init(&writer->running, true);
+    
+    const int error = pthread_create(&writer->thread, NULL, writer_thread, writer);
+    if (error != 0)
+    {
+        close(writer->fd);
+        errno = error;
+        return false;
+    }
+    
+    return true;
+}
+
+bool serial_capture_stop(serial_capture_t * writer)
+{
+    atomic_store_explicit(&writer->running, false, memory_order_relaxed);
+    pthread_join(writer->thread, NULL);
+    
+    drain(writer);
+    
+    //Dropped records which did not fit into the ring
+    const uint32_t lost = atomic_load_explicit(&writer->capture->lost, memory_order_relaxed);
+    while (writer->lost != lost)
+    {
+        uint8_t encoded[MODBUS_CAPTURE_RECORD_ENCODED_MAX];
+        const uint32_t remainder = lost - writer->lost;
+        const modbus_capture_record_t record =
+        {
+            .type = MODBUS_CAPTURE_LOST,
+            .timestamp_us = writer->previous_us,
+            .length = (remainder < UINT16_MAX) ? (uint16_t)remainder : UINT16_MAX
+        };
+        const uint16_t length = modbus_capture_record_encode(encoded, &record, NULL, writer->previous_us);
+        writer->failed = writer->failed || !file_write(writer->fd, encoded, length);
+        writer->lost += record.length;
+    }
+    
+    if (close(writer->fd) != 0)
+    {
+        writer->failed = true;
+    }
+    
+    return !writer->failed;
+}
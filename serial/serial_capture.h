@@ -0,0 +1,76 @@
+/**
+ * @ingroup serial_linux
+ *
+ * @defgroup serial_capture Capture file writer
+ *
+ * @brief Background thread which drains a capture ring (@see modbus_capture) into a capture file.
+ *
+ * The bus thread never waits for the file: the writer polls the ring and writes the records in batches.
+ * If the file cannot keep up, the ring overflows and the dropped records are reported in the file.
+ * @code
+ * static uint8_t storage[65536];
+ * modbus_capture_t capture;
+ * serial_capture_t writer;
+ * modbus_capture_initialize(&capture, storage, sizeof(storage));
+ * serial_capture_start(&writer, &capture, "session.mbcap", MODBUS_PROTOCOL_MODE_RTU, 19200);
+ * modbus_capture_attach(&ctx, &capture);
+ * ...
+ * modbus_capture_detach(&ctx, &capture);
+ * serial_capture_stop(&writer);
+ * @endcode
+ *
+ * @{
+ */
+
+#ifndef _SERIAL_CAPTURE_H_
+#define _SERIAL_CAPTURE_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_capture.h"
+
+#define SERIAL_CAPTURE_DRAIN_INTERVAL_MS    (10)    /**< Sleep of the writer when the ring is empty. */
+
+/**@brief Capture file writer. */
+typedef struct
+{
+    modbus_capture_t * capture;                         /**< Drained capture. */
+    int fd;                                             /**< Capture file descriptor. */
+    pthread_t thread;                                   /**< Writer thread. */
+    atomic_bool running;                                /**< Writer thread keeps draining while set. */
+    uint32_t previous_us;                               /**< Timestamp of the last written record. */
+    uint32_t lost;                                      /**< Dropped records reported in the file. */
+    bool failed;                                        /**< Writing to the file failed, the rest of the records is discarded. */
+} serial_capture_t;
+
+/**@brief Create capture file and start the writer thread.
+ *
+ * @param[out] writer    Pointer to the capture file writer.
+ * @param[in]  capture   Pointer to the initialized capture.
+ * @param[in]  path      Path to the capture file (truncated if exists).
+ * @param[in]  mode      Modbus mode of the captured bus.
+ * @param[in]  baud_rate Baud rate of the captured bus (0 if unknown).
+ *
+ * @retval true if successful, otherwise false (errno is set).
+ */
+bool serial_capture_start(serial_capture_t * writer, 
+                          modbus_capture_t * capture, 
+                          const char * path, 
+                          modbus_mode_t mode, 
+                          uint32_t baud_rate);
+
+/**@brief Stop the writer thread, write the remaining records and close the capture file.
+ *        The capture should be detached from the bus before. Dropped records which the ring could not report
+ *        are reported at the end of the file.
+ *
+ * @param[in] writer Pointer to the capture file writer.
+ *
+ * @retval true if all records were written, false if writing to the file failed.
+ */
+bool serial_capture_stop(serial_capture_t * writer);
+
+#endif
+
+/** @} */
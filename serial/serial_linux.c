@@ -0,0 +1,391 @@
+#include "serial_linux.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/serial.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+#define SERIAL_IOV_MAX    (8)
+
+/**@brief Get monotonic time in nanoseconds.
+ */
+static uint64_t time_ns(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**@brief Sleep until the given monotonic time.
+ */
+static void sleep_until_ns(uint64_t deadline_ns)
+{
+    const struct timespec deadline = 
+    {
+        .tv_sec = (time_t)(deadline_ns / 1000000000ULL),
+        .tv_nsec = (long)(deadline_ns % 1000000000ULL)
+    };
+    
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+}
+
+/**@brief Convert baud rate to termios speed.
+ */
+static speed_t baud_rate_to_speed(uint32_t baud_rate)
+{
+    switch (baud_rate)
+    {
+        case 1200:   return B1200;
+        case 2400:   return B2400;
+        case 4800:   return B4800;
+        case 9600:   return B9600;
+        case 19200:  return B19200;
+        case 38400:  return B38400;
+        case 57600:  return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default:     return B0;
+    }
+}
+
+/**@brief Account transmission of the data, which is queued after the data already being sent.
+ */
+static void transmit_account(serial_port_t * port, size_t data_length)
+{
+    const uint64_t now_ns = time_ns();
+    const uint64_t start_ns = (port->activity_ns > now_ns) ? port->activity_ns : now_ns;
+    
+    port->activity_ns = start_ns + (uint64_t)data_length * port->char_ns;
+}
+
+/**@brief Wait until the terminal is ready for writing.
+ */
+static modbus_callback_result_t write_wait(serial_port_t * port, uint64_t deadline_ns)
+{
+    struct pollfd pfd = { .fd = port->fd, .events = POLLOUT };
+    const uint64_t now_ns = time_ns();
+    
+    if (now_ns >= deadline_ns)
+    {
+        return MODBUS_CALLBACK_RESULT_TIMEOUT;
+    }
+    
+    const int ready = poll(&pfd, 1, (int)((deadline_ns - now_ns + 999999) / 1000000));
+    if (ready < 0)
+    {
+        return (errno == EINTR) ? MODBUS_CALLBACK_RESULT_SUCCESS : MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    return (ready == 0) ? MODBUS_CALLBACK_RESULT_TIMEOUT : MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+bool serial_port_open(serial_port_t * port, 
+                      const char * path, 
+                      uint32_t baud_rate, 
+                      serial_parity_t parity, 
+                      modbus_mode_t mode, 
+                      bool rs485)
+{
+    struct termios tty;
+    const speed_t speed = baud_rate_to_speed(baud_rate);
+    
+    if (speed == B0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+    
+    port->fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (port->fd < 0)
+    {
+        return false;
+    }
+    
+    if (tcgetattr(port->fd, &tty) != 0)
+    {
+        close(port->fd);
+        return false;
+    }
+    
+    cfmakeraw(&tty);
+    tty.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB | CRTSCTS);
+    tty.c_cflag |= CLOCAL | CREAD | ((mode == MODBUS_PROTOCOL_MODE_RTU) ? CS8 : CS7);
+    switch (parity)
+    {
+        case SERIAL_PARITY_EVEN:
+            tty.c_cflag |= PARENB;
+            break;
+            
+        case SERIAL_PARITY_ODD:
+            tty.c_cflag |= PARENB | PARODD;
+            break;
+            
+        default:
+            //Without parity the character is completed by the second stop bit
+            tty.c_cflag |= CSTOPB;
+            break;
+    }
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    
+    if (tcsetattr(port->fd, TCSANOW, &tty) != 0)
+    {
+        close(port->fd);
+        return false;
+    }
+    
+    if (rs485)
+    {
+        struct serial_rs485 rs485_config;
+        
+        memset(&rs485_config, 0, sizeof(rs485_config));
+        rs485_config.flags = SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND;
+        if (ioctl(port->fd, TIOCSRS485, &rs485_config) != 0)
+        {
+            close(port->fd);
+            return false;
+        }
+    }
+    
+    port->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = port->fd };
+    if ((port->epoll_fd < 0) || (epoll_ctl(port->epoll_fd, EPOLL_CTL_ADD, port->fd, &event) != 0))
+    {
+        if (port->epoll_fd >= 0)
+        {
+            close(port->epoll_fd);
+        }
+        close(port->fd);
+        return false;
+    }
+    
+    //Start bit, data bits, parity bit (or second stop bit) and stop bit
+    const uint32_t char_bits = (mode == MODBUS_PROTOCOL_MODE_RTU) ? 11 : 10;
+    port->baud_rate = baud_rate;
+    port->char_ns = (uint32_t)((char_bits * 1000000000ULL + baud_rate - 1) / baud_rate);
+    port->silence_ns = (baud_rate > 19200) ? 1750000 : (port->char_ns * 7 + 1) / 2;
+    port->activity_ns = time_ns();
+    
+    tcflush(port->fd, TCIOFLUSH);
+    
+    return true;
+}
+
+void serial_port_close(serial_port_t * port)
+{
+    close(port->epoll_fd);
+    close(port->fd);
+    port->epoll_fd = -1;
+    port->fd = -1;
+}
+
+modbus_callback_result_t serial_port_write(void * user_data, 
+                                           uint8_t * data, 
+                                           uint16_t data_length, 
+                                           uint32_t timeout_ms)
+{
+    const modbus_iovec_t iov = { data, data_length };
+    
+    return serial_port_writev(user_data, &iov, 1, timeout_ms);
+}
+
+modbus_callback_result_t serial_port_writev(void * user_data, 
+                                            const modbus_iovec_t * iov, 
+                                            uint8_t iov_count, 
+                                            uint32_t timeout_ms)
+{
+    serial_port_t * const port = (serial_port_t *)user_data;
+    const uint64_t deadline_ns = time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    struct iovec vector[SERIAL_IOV_MAX];
+    size_t total = 0;
+    int count = 0;
+    
+    if (iov_count > SERIAL_IOV_MAX)
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    for (uint8_t i = 0; i < iov_count; i++)
+    {
+        vector[i].iov_base = (void *)iov[i].data;
+        vector[i].iov_len = iov[i].data_length;
+        total += iov[i].data_length;
+    }
+    count = iov_count;
+    
+    struct iovec * pending = vector;
+    size_t written = 0;
+    while (written < total)
+    {
+        const ssize_t result = writev(port->fd, pending, count);
+        if (result < 0)
+        {
+            if ((errno != EAGAIN) && (errno != EINTR))
+            {
+                return MODBUS_CALLBACK_RESULT_IO_ERROR;
+            }
+            
+            const modbus_callback_result_t callback_result = write_wait(port, deadline_ns);
+            if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+            {
+                return callback_result;
+            }
+            continue;
+        }
+        
+        transmit_account(port, (size_t)result);
+        written += (size_t)result;
+        
+        //Skip the written part of the vector
+        size_t skip = (size_t)result;
+        while ((count > 0) && (skip >= pending->iov_len))
+        {
+            skip -= pending->iov_len;
+            pending++;
+            count--;
+        }
+        if (count > 0)
+        {
+            pending->iov_base = (uint8_t *)pending->iov_base + skip;
+            pending->iov_len -= skip;
+        }
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+modbus_callback_result_t serial_port_read(void * user_data, 
+                                          uint8_t * data, 
+                                          uint16_t data_length, 
+                                          uint32_t timeout_ms)
+{
+    serial_port_t * const port = (serial_port_t *)user_data;
+    const uint64_t deadline_ns = time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    uint16_t received = 0;
+    
+    while (received < data_length)
+    {
+        const ssize_t result = read(port->fd, &data[received], data_length - received);
+        if (result > 0)
+        {
+            received += (uint16_t)result;
+            port->activity_ns = time_ns();
+            continue;
+        }
+        
+        if ((result < 0) && (errno != EAGAIN) && (errno != EINTR))
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+        
+        const uint64_t now_ns = time_ns();
+        if (now_ns >= deadline_ns)
+        {
+            return MODBUS_CALLBACK_RESULT_TIMEOUT;
+        }
+        
+        struct epoll_event event;
+        const int ready = epoll_wait(port->epoll_fd, &event, 1, (int)((deadline_ns - now_ns + 999999) / 1000000));
+        if ((ready < 0) && (errno != EINTR))
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+modbus_callback_result_t serial_port_receive(void * user_data, 
+                                             uint8_t * data, 
+                                             uint16_t data_length, 
+                                             uint16_t * received)
+{
+    serial_port_t * const port = (serial_port_t *)user_data;
+    
+    const ssize_t result = read(port->fd, data, data_length);
+    if (result < 0)
+    {
+        *received = 0;
+        return ((errno == EAGAIN) || (errno == EINTR)) ? MODBUS_CALLBACK_RESULT_SUCCESS : MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    *received = (uint16_t)result;
+    if (result > 0)
+    {
+        port->activity_ns = time_ns();
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Wait until the transmission of the written data is completed.
+ */
+static void transmit_wait(serial_port_t * port, uint16_t data_length)
+{
+    int pending;
+    
+    //Wait until the driver queue is empty, the rest of the transmission is estimated by the baud rate
+    const uint64_t deadline_ns = port->activity_ns + (uint64_t)(data_length + 1) * port->char_ns;
+    while (true)
+    {
+        if (ioctl(port->fd, TIOCOUTQ, &pending) != 0)
+        {
+            tcdrain(port->fd);
+            break;
+        }
+        
+        if (pending == 0)
+        {
+            break;
+        }
+        
+        const uint64_t now_ns = time_ns();
+        if (now_ns >= deadline_ns)
+        {
+            tcdrain(port->fd);
+            break;
+        }
+        sleep_until_ns(now_ns + (uint64_t)pending * port->char_ns);
+    }
+}
+
+void serial_port_idle(void * user_data, uint16_t data_length)
+{
+    serial_port_t * const port = (serial_port_t *)user_data;
+    
+    transmit_wait(port, data_length);
+    sleep_until_ns(port->activity_ns + port->silence_ns);
+}
+
+void serial_port_delay(void * user_data, uint32_t delay_ms)
+{
+    serial_port_t * const port = (serial_port_t *)user_data;
+    
+    transmit_wait(port, 0);
+    
+    const uint64_t now_ns = time_ns();
+    const uint64_t start_ns = (port->activity_ns > now_ns) ? port->activity_ns : now_ns;
+    sleep_until_ns(start_ns + (uint64_t)delay_ms * 1000000ULL);
+}
+
+uint32_t serial_port_clock(void * user_data)
+{
+    (void)user_data;
+    
+    return (uint32_t)(time_ns() / 1000);
+}
@@ -0,0 +1,131 @@
+/**
+ * @defgroup serial_linux Linux serial port backend
+ *
+ * @brief Modbus bus callbacks for Linux serial ports (termios).
+ *
+ * The port is configured in raw mode with the character format of the Modbus mode 
+ * (8 data bits for RTU, 7 data bits for ASCII; one stop bit with parity, two without). 
+ * Reads are driven by epoll, RS-485 transceiver direction is controlled by the kernel 
+ * driver (TIOCSRS485). Inter-frame silence is derived from the baud rate and measured 
+ * from the last bus activity with clock_nanosleep().
+ *
+ * The callbacks take the serial port as user data:
+ * @code
+ * serial_port_t port;
+ * serial_port_open(&port, "/dev/ttyUSB0", 19200, SERIAL_PARITY_EVEN, MODBUS_PROTOCOL_MODE_RTU, true);
+ * const modbus_params_t params = 
+ * {
+ *     .mode = MODBUS_PROTOCOL_MODE_RTU,
+ *     .write = serial_port_write,
+ *     .read = serial_port_read,
+ *     .idle = serial_port_idle,
+ *     .writev = serial_port_writev,
+ *     .receive = serial_port_receive,
+ *     .delay = serial_port_delay,
+ *     .clock = serial_port_clock,
+ *     .user_data = &port,
+ *     .baud_rate = 19200
+ * };
+ * @endcode
+ *
+ * Any terminal device can be used, including a pseudo-terminal (RS-485 mode is not available for it).
+ *
+ * @{
+ */
+
+#ifndef _SERIAL_LINUX_H_
+#define _SERIAL_LINUX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+
+/**@brief Serial port parity. */
+typedef enum
+{
+    SERIAL_PARITY_NONE,
+    SERIAL_PARITY_EVEN,
+    SERIAL_PARITY_ODD
+} serial_parity_t;
+
+/**@brief Serial port. */
+typedef struct
+{
+    int fd;                                             /**< Terminal file descriptor. */
+    int epoll_fd;                                       /**< Epoll instance watching the terminal. */
+    uint32_t baud_rate;                                 /**< Baud rate. */
+    uint32_t char_ns;                                   /**< Character time in nanoseconds. */
+    uint32_t silence_ns;                                /**< Inter-frame silence in nanoseconds. */
+    uint64_t activity_ns;                               /**< Time the last character leaves or arrives to the bus. */
+} serial_port_t;
+
+/**@brief Open serial port.
+ *
+ * @param[out] port      Pointer to the serial port.
+ * @param[in]  path      Path to the terminal device.
+ * @param[in]  baud_rate Baud rate (one of the standard rates).
+ * @param[in]  parity    Parity.
+ * @param[in]  mode      Modbus mode, defines the character format and the inter-frame silence.
+ * @param[in]  rs485     true to enable RS-485 mode with RTS direction control.
+ *
+ * @retval true if successful, otherwise false (errno is set).
+ */
+bool serial_port_open(serial_port_t * port, 
+                      const char * path, 
+                      uint32_t baud_rate, 
+                      serial_parity_t parity, 
+                      modbus_mode_t mode, 
+                      bool rs485);
+
+/**@brief Close serial port.
+ *
+ * @param[in] port Pointer to the serial port.
+ */
+void serial_port_close(serial_port_t * port);
+
+/**@brief Bus write callback, @see modbus_write_callback_t. Returns when the data is handed to the driver, 
+ *        serial_port_idle() waits for the transmission to complete.
+ */
+modbus_callback_result_t serial_port_write(void * user_data, 
+                                           uint8_t * data, 
+                                           uint16_t data_length, 
+                                           uint32_t timeout_ms);
+
+/**@brief Bus scatter-gather write callback, @see modbus_writev_callback_t.
+ */
+modbus_callback_result_t serial_port_writev(void * user_data, 
+                                            const modbus_iovec_t * iov, 
+                                            uint8_t iov_count, 
+                                            uint32_t timeout_ms);
+
+/**@brief Bus read callback, @see modbus_read_callback_t.
+ */
+modbus_callback_result_t serial_port_read(void * user_data, 
+                                          uint8_t * data, 
+                                          uint16_t data_length, 
+                                          uint32_t timeout_ms);
+
+/**@brief Bus receive callback, @see modbus_receive_callback_t.
+ */
+modbus_callback_result_t serial_port_receive(void * user_data, 
+                                             uint8_t * data, 
+                                             uint16_t data_length, 
+                                             uint16_t * received);
+
+/**@brief Bus idle callback, @see modbus_idle_callback_t. Waits until the transmission is completed 
+ *        and the inter-frame silence since the last bus activity has elapsed.
+ */
+void serial_port_idle(void * user_data, uint16_t data_length);
+
+/**@brief Bus delay callback, @see modbus_delay_callback_t. Waits until the transmission is completed 
+ *        and the delay has elapsed.
+ */
+void serial_port_delay(void * user_data, uint32_t delay_ms);
+
+/**@brief Bus clock callback, @see modbus_clock_callback_t. Monotonic clock (CLOCK_MONOTONIC) in microseconds.
+ */
+uint32_t serial_port_clock(void * user_data);
+
+#endif
+
+/** @} */
@@ -0,0 +1,52 @@
+/**
+ * @ingroup serial_linux
+ *
+ * @brief Serial port transport policy of the C++ codecs (@see modbus_cxx): the serial port functions
+ * are called directly instead of through the callbacks of a modbus context.
+ * @code
+ * modbus::client<MODBUS_PROTOCOL_MODE_RTU, serial::port_transport> client{ serial::port_transport{ &port } };
+ * @endcode
+ *
+ * @{
+ */
+
+#ifndef _SERIAL_LINUX_HPP_
+#define _SERIAL_LINUX_HPP_
+
+#include "modbus/modbus.hpp"
+
+extern "C"
+{
+#include "serial_linux.h"
+}
+
+namespace serial
+{
+
+/**@brief Transport over the opened serial port. */
+struct port_transport
+{
+    serial_port_t * port;                               /**< Opened serial port. */
+    uint32_t timeout_ms = MODBUS_PROTOCOL_BUS_TIMEOUT_MS; /**< Bus timeout. */
+
+    modbus_callback_result_t write(const uint8_t * data, std::size_t length)
+    {
+        return serial_port_write(port, const_cast<uint8_t *>(data), (uint16_t)length, timeout_ms);
+    }
+
+    modbus_callback_result_t read(uint8_t * data, std::size_t length)
+    {
+        return serial_port_read(port, data, (uint16_t)length, timeout_ms);
+    }
+
+    void idle(std::size_t length)
+    {
+        serial_port_idle(port, (uint16_t)length);
+    }
+};
+
+} //namespace serial
+
+#endif
+
+/** @} */
@@ -0,0 +1,430 @@
+#include "serial_replay.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**@brief Get monotonic time in nanoseconds.
+ */
+static uint64_t time_ns(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**@brief Sleep until the given monotonic time.
+ */
+static void sleep_until_ns(uint64_t deadline_ns)
+{
+    const struct timespec deadline =
+    {
+        .tv_sec = (time_t)(deadline_ns / 1000000000ULL),
+        .tv_nsec = (long)(deadline_ns % 1000000000ULL)
+    };
+    
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+}
+
+/**@brief Advance the time of the client, wait for it in SERIAL_REPLAY_TIMED timing.
+ */
+static void clock_advance(serial_replay_t * replay, uint32_t time_us)
+{
+    if ((int32_t)(time_us - replay->clock_us) <= 0)
+    {
+        return;
+    }
+    
+    replay->clock_us = time_us;
+    if ((replay->timing == SERIAL_REPLAY_TIMED) && ((int32_t)(time_us - replay->request_us) > 0))
+    {
+        sleep_until_ns(replay->request_ns + (uint64_t)(time_us - replay->request_us) * 1000);
+    }
+}
+
+/**@brief Decode the next record without taking it.
+ *
+ * @return Size of the encoded record, 0 at the end of the file.
+ */
+static size_t record_peek(const serial_replay_t * replay, modbus_capture_record_t * record, const uint8_t ** data)
+{
+    return modbus_capture_record_decode(&replay->file[replay->position], 
+                                        replay->file_size - replay->position, 
+                                        record, 
+                                        data, 
+                                        replay->previous_us);
+}
+
+/**@brief Make the current answer record the one with unread bytes.
+ *
+ * @retval true if there are unread bytes, false if the answer ends here.
+ */
+static bool answer_load(serial_replay_t * replay)
+{
+    modbus_capture_record_t record;
+    const uint8_t * data;
+    
+    while (replay->rx_offset == replay->rx_length)
+    {
+        const size_t size = record_peek(replay, &record, &data);
+        if ((size == 0) || ((record.type != MODBUS_CAPTURE_RX) && (record.type != MODBUS_CAPTURE_LOST)))
+        {
+            return false;
+        }
+        
+        replay->position += size;
+        replay->previous_us = record.timestamp_us;
+        if (record.type == MODBUS_CAPTURE_RX)
+        {
+            replay->rx_data = data;
+            replay->rx_length = record.length;
+            replay->rx_offset = 0;
+            replay->rx_us = record.timestamp_us;
+        }
+    }
+    
+    return true;
+}
+
+/**@brief Get time of the client the byte of the current answer record arrives.
+ *        The recorded time is the arrival of the last byte of the record.
+ */
+static uint32_t answer_byte_us(const serial_replay_t * replay, uint16_t index)
+{
+    const uint64_t before_ns = (uint64_t)(replay->rx_length - 1 - index) * replay->char_ns;
+    
+    return replay->rx_us + replay->shift_us - (uint32_t)(before_ns / 1000);
+}
+
+/**@brief Take the recorded timeout which ends the answer, if any.
+ */
+static void answer_timeout_skip(serial_replay_t * replay)
+{
+    modbus_capture_record_t record;
+    const uint8_t * data;
+    
+    const size_t size = record_peek(replay, &record, &data);
+    if ((size != 0) && (record.type == MODBUS_CAPTURE_TIMEOUT))
+    {
+        replay->position += size;
+        replay->previous_us = record.timestamp_us;
+    }
+}
+
+/**@brief Find the written request among the following recorded requests and make it the current one.
+ *
+ * @param[in] replay      Pointer to the replay.
+ * @param[in] data        Written request, NULL to take the next recorded request.
+ * @param[in] data_length Length of the written request.
+ * @param[in] count       Number of recorded requests to search.
+ *
+ * @retval true if found, false otherwise (the position is not changed).
+ */
+static bool request_match(serial_replay_t * replay, const uint8_t * data, uint16_t data_length, uint8_t count)
+{
+    size_t position = replay->position;
+    uint32_t previous_us = replay->previous_us;
+    modbus_capture_record_t record;
+    const uint8_t * request;
+    
+    while (count != 0)
+    {
+        const size_t size = modbus_capture_record_decode(&replay->file[position], 
+                                                         replay->file_size - position, 
+                                                         &record, 
+                                                         &request, 
+                                                         previous_us);
+        if (size == 0)
+        {
+            return false;
+        }
+        position += size;
+        previous_us = record.timestamp_us;
+        
+        if (record.type != MODBUS_CAPTURE_TX)
+        {
+            continue;
+        }
+        
+        if ((data == NULL) || ((record.length == data_length) && (memcmp(request, data, data_length) == 0)))
+        {
+            replay->position = position;
+            replay->previous_us = previous_us;
+            replay->request_data = request;
+            replay->request_length = record.length;
+            replay->request_end = position;
+            replay->request_record_us = record.timestamp_us;
+            return true;
+        }
+        count--;
+    }
+    
+    return false;
+}
+
+bool serial_replay_open(serial_replay_t * replay, const char * path, serial_replay_timing_t timing)
+{
+    struct stat status;
+    
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    
+    if ((size_t)status.st_size < MODBUS_CAPTURE_FILE_HEADER_SIZE)
+    {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+    
+    void * const file = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+    {
+        return false;
+    }
+    
+    replay->file = (const uint8_t *)file;
+    replay->file_size = (size_t)status.st_size;
+    if (!modbus_capture_header_decode(replay->file, &replay->mode, &replay->baud_rate))
+    {
+        munmap(file, replay->file_size);
+        errno = EINVAL;
+        return false;
+    }
+    
+    //Start bit, data bits, parity bit (or second stop bit) and stop bit
+    const uint32_t char_bits = (replay->mode == MODBUS_PROTOCOL_MODE_RTU) ? 11 : 10;
+    replay->char_ns = (replay->baud_rate != 0) ? (uint32_t)((char_bits * 1000000000ULL + replay->baud_rate - 1) / replay->baud_rate) : 0;
+    replay->timing = timing;
+    serial_replay_rewind(replay);
+    
+    return true;
+}
+
+void serial_replay_close(serial_replay_t * replay)
+{
+    munmap((void *)replay->file, replay->file_size);
+    replay->file = NULL;
+    replay->file_size = 0;
+}
+
+void serial_replay_rewind(serial_replay_t * replay)
+{
+    modbus_capture_record_t record;
+    const uint8_t * data;
+    
+    replay->position = MODBUS_CAPTURE_FILE_HEADER_SIZE;
+    replay->previous_us = 0;
+    replay->rx_data = NULL;
+    replay->rx_length = 0;
+    replay->rx_offset = 0;
+    replay->rx_us = 0;
+    replay->request_data = NULL;
+    replay->request_length = 0;
+    replay->request_end = 0;
+    replay->request_record_us = 0;
+    replay->requests = 0;
+    replay->mismatches = 0;
+    
+    //Time of the client starts at the first record
+    replay->clock_us = (record_peek(replay, &record, &data) != 0) ? record.timestamp_us : 0;
+    replay->request_us = replay->clock_us;
+    replay->shift_us = 0;
+    replay->request_ns = time_ns();
+}
+
+bool serial_replay_record_next(serial_replay_t * replay, modbus_capture_record_t * record, const uint8_t ** data)
+{
+    const size_t size = record_peek(replay, record, data);
+    if (size == 0)
+    {
+        return false;
+    }
+    
+    replay->position += size;
+    replay->previous_us = record->timestamp_us;
+    
+    return true;
+}
+
+modbus_callback_result_t serial_replay_write(void * user_data, 
+                                             uint8_t * data, 
+                                             uint16_t data_length, 
+                                             uint32_t timeout_ms)
+{
+    serial_replay_t * const replay = (serial_replay_t *)user_data;
+    
+    (void)timeout_ms;
+    
+    //Answer bytes which are not read are discarded, as by the serial port
+    replay->requests++;
+    if (!request_match(replay, data, data_length, 1))
+    {
+        replay->mismatches++;
+        if ((replay->request_data != NULL) && (replay->request_length == data_length) && 
+            (memcmp(replay->request_data, data, data_length) == 0))
+        {
+            //Client repeats the request, the recorded answer is served again
+            replay->position = replay->request_end;
+            replay->previous_us = replay->request_record_us;
+        }
+        else if (!request_match(replay, data, data_length, SERIAL_REPLAY_LOOKAHEAD) && 
+                 !request_match(replay, NULL, 0, 1))
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+    }
+    
+    //Time of the client catches up with the recorded request, the answer follows the request
+    if ((int32_t)(replay->request_record_us - replay->clock_us) > 0)
+    {
+        replay->clock_us = replay->request_record_us;
+    }
+    replay->request_us = replay->clock_us;
+    replay->shift_us = replay->clock_us - replay->request_record_us;
+    replay->request_ns = time_ns();
+    replay->rx_length = 0;
+    replay->rx_offset = 0;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+modbus_callback_result_t serial_replay_writev(void * user_data, 
+                                              const modbus_iovec_t * iov, 
+                                              uint8_t iov_count, 
+                                              uint32_t timeout_ms)
+{
+    uint8_t data[MODBUS_CAPTURE_DATA_MAX];
+    uint16_t data_length = 0;
+    
+    for (uint8_t i = 0; i < iov_count; i++)
+    {
+        if (iov[i].data_length > sizeof(data) - data_length)
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+        memcpy(&data[data_length], iov[i].data, iov[i].data_length);
+        data_length += iov[i].data_length;
+    }
+    
+    return serial_replay_write(user_data, data, data_length, timeout_ms);
+}
+
+modbus_callback_result_t serial_replay_read(void * user_data, 
+                                            uint8_t * data, 
+                                            uint16_t data_length, 
+                                            uint32_t timeout_ms)
+{
+    serial_replay_t * const replay = (serial_replay_t *)user_data;
+    const uint32_t deadline_us = replay->clock_us + timeout_ms * 1000;
+    uint16_t received = 0;
+    
+    while (received < data_length)
+    {
+        if (!answer_load(replay))
+        {
+            answer_timeout_skip(replay);
+            clock_advance(replay, deadline_us);
+            return MODBUS_CALLBACK_RESULT_TIMEOUT;
+        }
+        
+        const uint16_t available = replay->rx_length - replay->rx_offset;
+        const uint16_t count = (available < data_length - received) ? available : data_length - received;
+        const uint32_t arrival_us = answer_byte_us(replay, replay->rx_offset + count - 1);
+        if ((int32_t)(arrival_us - deadline_us) > 0)
+        {
+            clock_advance(replay, deadline_us);
+            return MODBUS_CALLBACK_RESULT_TIMEOUT;
+        }
+        
+        clock_advance(replay, arrival_us);
+        memcpy(&data[received], &replay->rx_data[replay->rx_offset], count);
+        replay->rx_offset += count;
+        received += count;
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+modbus_callback_result_t serial_replay_receive(void * user_data, 
+                                               uint8_t * data, 
+                                               uint16_t data_length, 
+                                               uint16_t * received)
+{
+    serial_replay_t * const replay = (serial_replay_t *)user_data;
+    //Client which polls waits at least a character time
+    const uint32_t step_us = (replay->char_ns != 0) ? (replay->char_ns + 999) / 1000 : 1000;
+    
+    if (replay->timing == SERIAL_REPLAY_TIMED)
+    {
+        clock_advance(replay, replay->request_us + (uint32_t)((time_ns() - replay->request_ns) / 1000));
+    }
+    
+    *received = 0;
+    while ((*received < data_length) && answer_load(replay))
+    {
+        uint16_t available = replay->rx_length - replay->rx_offset;
+        while ((available != 0) && ((int32_t)(answer_byte_us(replay, replay->rx_offset + available - 1) - replay->clock_us) > 0))
+        {
+            available--;
+        }
+        if (available == 0)
+        {
+            break;
+        }
+        
+        const uint16_t count = (available < data_length - *received) ? available : data_length - *received;
+        memcpy(&data[*received], &replay->rx_data[replay->rx_offset], count);
+        replay->rx_offset += count;
+        *received += count;
+    }
+    
+    if ((*received == 0) && (replay->timing == SERIAL_REPLAY_FAST))
+    {
+        uint32_t time_us = replay->clock_us + step_us;
+        if (answer_load(replay) && ((int32_t)(answer_byte_us(replay, replay->rx_offset) - time_us) < 0))
+        {
+            time_us = answer_byte_us(replay, replay->rx_offset);
+        }
+        clock_advance(replay, time_us);
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+void serial_replay_idle(void * user_data, uint16_t data_length)
+{
+    (void)user_data;
+    (void)data_length;
+}
+
+void serial_replay_delay(void * user_data, uint32_t delay_ms)
+{
+    serial_replay_t * const replay = (serial_replay_t *)user_data;
+    
+    clock_advance(replay, replay->clock_us + delay_ms * 1000);
+}
+
+uint32_t serial_replay_clock(void * user_data)
+{
+    const serial_replay_t * const replay = (const serial_replay_t *)user_data;
+    
+    return replay->clock_us;
+}
@@ -0,0 +1,168 @@
+/**
+ * @ingroup serial_linux
+ *
+ * @defgroup serial_replay Capture file replay
+ *
+ * @brief Modbus bus callbacks which play a capture file (@see serial_capture) back to the client.
+ *
+ * Every written request is matched with a recorded request of the same content: normally the next one,
+ * the current one again if the client repeats it (the answer is served once more), or one of the following
+ * SERIAL_REPLAY_LOOKAHEAD requests if the client skipped some. Otherwise the next request is taken anyway.
+ * Requests which are not the next recorded ones are counted as mismatches. The answer recorded after the request
+ * is served by the read and receive callbacks, answer bytes which are not read before the next request are discarded.
+ *
+ * Replay runs on the recorded time line: the clock callback returns the time of the client, which advances
+ * with the recorded events (answer bytes arrive with the recorded delay after the request, with the character time
+ * of the recorded baud rate between them) and with the waiting of the client. A read fails with a timeout
+ * when the client's timeout expires before the answer is complete, so the timeouts, adaptive timeouts and offline
+ * decisions of the client are those of the recorded session and do not depend on the scheduling of the replay.
+ *
+ * Timing:
+ * - SERIAL_REPLAY_TIMED: the callbacks also wait in real time, so the session runs at the recorded speed;
+ * - SERIAL_REPLAY_FAST: no waiting, a session runs as fast as the client can parse it.
+ *
+ * The callbacks take the replay as user data, the Modbus mode of the client must be the one of the file:
+ * @code
+ * serial_replay_t replay;
+ * serial_replay_open(&replay, "session.mbcap", SERIAL_REPLAY_FAST);
+ * const modbus_params_t params =
+ * {
+ *     .mode = replay.mode,
+ *     .write = serial_replay_write,
+ *     .read = serial_replay_read,
+ *     .idle = serial_replay_idle,
+ *     .writev = serial_replay_writev,
+ *     .receive = serial_replay_receive,
+ *     .delay = serial_replay_delay,
+ *     .clock = serial_replay_clock,
+ *     .user_data = &replay,
+ *     .baud_rate = replay.baud_rate
+ * };
+ * @endcode
+ *
+ * The records may also be iterated directly with serial_replay_record_next(), e.g. to feed the answers
+ * to a receiver without a client.
+ *
+ * @{
+ */
+
+#ifndef _SERIAL_REPLAY_H_
+#define _SERIAL_REPLAY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "modbus/modbus_capture.h"
+
+#define SERIAL_REPLAY_LOOKAHEAD    (8)      /**< Number of recorded requests searched for the written one. */
+
+/**@brief Replay timing. */
+typedef enum
+{
+    SERIAL_REPLAY_TIMED,                                /**< Recorded timing. */
+    SERIAL_REPLAY_FAST                                  /**< No waiting. */
+} serial_replay_timing_t;
+
+/**@brief Capture file replay. */
+typedef struct
+{
+    const uint8_t * file;                               /**< Mapped capture file. */
+    size_t file_size;                                   /**< Size of the capture file. */
+    size_t position;                                    /**< Offset of the next record. */
+    uint32_t previous_us;                               /**< Timestamp of the last decoded record. */
+    modbus_mode_t mode;                                 /**< Modbus mode of the captured bus. */
+    uint32_t baud_rate;                                 /**< Baud rate of the captured bus (0 if unknown). */
+    uint32_t char_ns;                                   /**< Character time in nanoseconds (0 if the baud rate is unknown). */
+    serial_replay_timing_t timing;                      /**< Replay timing. */
+    const uint8_t * request_data;                       /**< Data of the current request record (NULL before the first request). */
+    uint16_t request_length;                            /**< Length of the current request record. */
+    size_t request_end;                                 /**< Offset of the record after the current request record. */
+    uint32_t request_record_us;                         /**< Recorded time of the current request. */
+    uint32_t clock_us;                                  /**< Time of the client. */
+    uint32_t request_us;                                /**< Time of the client the current request was written. */
+    uint32_t shift_us;                                  /**< Time of the client minus the recorded time of the current request. */
+    uint64_t request_ns;                                /**< Real time the current request was written (SERIAL_REPLAY_TIMED timing). */
+    const uint8_t * rx_data;                            /**< Data of the current answer record. */
+    uint16_t rx_length;                                 /**< Length of the current answer record. */
+    uint16_t rx_offset;                                 /**< Bytes of the current answer record already read. */
+    uint32_t rx_us;                                     /**< Recorded time of the current answer record. */
+    uint32_t requests;                                  /**< Written requests. */
+    uint32_t mismatches;                                /**< Written requests which are not the next recorded ones. */
+} serial_replay_t;
+
+/**@brief Open capture file for replay.
+ *
+ * @param[out] replay Pointer to the replay.
+ * @param[in]  path   Path to the capture file.
+ * @param[in]  timing Replay timing.
+ *
+ * @retval true if successful, otherwise false (errno is set, EINVAL if the file is not a supported capture file).
+ */
+bool serial_replay_open(serial_replay_t * replay, const char * path, serial_replay_timing_t timing);
+
+/**@brief Close capture file.
+ *
+ * @param[in] replay Pointer to the replay.
+ */
+void serial_replay_close(serial_replay_t * replay);
+
+/**@brief Start replay from the first record again and reset the request counters.
+ *
+ * @param[in] replay Pointer to the replay.
+ */
+void serial_replay_rewind(serial_replay_t * replay);
+
+/**@brief Take the next record of the file. Must not be mixed with the bus callbacks.
+ *
+ * @param[in]  replay Pointer to the replay.
+ * @param[out] record Pointer to store the record.
+ * @param[out] data   Pointer to store the pointer to the data of the record (inside the mapped file).
+ *
+ * @retval true if the record is taken, false at the end of the file (or at a truncated record).
+ */
+bool serial_replay_record_next(serial_replay_t * replay, modbus_capture_record_t * record, const uint8_t ** data);
+
+/**@brief Bus write callback, @see modbus_write_callback_t. Fails with MODBUS_CALLBACK_RESULT_IO_ERROR
+ *        when there are no more requests in the file.
+ */
+modbus_callback_result_t serial_replay_write(void * user_data, 
+                                             uint8_t * data, 
+                                             uint16_t data_length, 
+                                             uint32_t timeout_ms);
+
+/**@brief Bus scatter-gather write callback, @see modbus_writev_callback_t.
+ */
+modbus_callback_result_t serial_replay_writev(void * user_data, 
+                                              const modbus_iovec_t * iov, 
+                                              uint8_t iov_count, 
+                                              uint32_t timeout_ms);
+
+/**@brief Bus read callback, @see modbus_read_callback_t.
+ */
+modbus_callback_result_t serial_replay_read(void * user_data, 
+                                            uint8_t * data, 
+                                            uint16_t data_length, 
+                                            uint32_t timeout_ms);
+
+/**@brief Bus receive callback, @see modbus_receive_callback_t.
+ */
+modbus_callback_result_t serial_replay_receive(void * user_data, 
+                                               uint8_t * data, 
+                                               uint16_t data_length, 
+                                               uint16_t * received);
+
+/**@brief Bus idle callback, @see modbus_idle_callback_t. Does nothing, the answers are aligned to the requests.
+ */
+void serial_replay_idle(void * user_data, uint16_t data_length);
+
+/**@brief Bus delay callback, @see modbus_delay_callback_t. Advances the time of the client.
+ */
+void serial_replay_delay(void * user_data, uint32_t delay_ms);
+
+/**@brief Bus clock callback, @see modbus_clock_callback_t. Time of the client on the recorded time line in microseconds.
+ */
+uint32_t serial_replay_clock(void * user_data);
+
+#endif
+
+/** @} */
@@ -0,0 +1,288 @@
+#include "tcp_linux.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define TCP_IOV_MAX    (8)
+
+/**@brief Get monotonic time in nanoseconds.
+ */
+static uint64_t time_ns(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**@brief Wait for the socket events until the deadline.
+ */
+static modbus_callback_result_t socket_wait(int fd, short events, uint64_t deadline_ns)
+{
+    struct pollfd pfd = { .fd = fd, .events = events };
+    const uint64_t now_ns = time_ns();
+    
+    if (now_ns >= deadline_ns)
+    {
+        return MODBUS_CALLBACK_RESULT_TIMEOUT;
+    }
+    
+    const int ready = poll(&pfd, 1, (int)((deadline_ns - now_ns + 999999) / 1000000));
+    if (ready < 0)
+    {
+        return (errno == EINTR) ? MODBUS_CALLBACK_RESULT_SUCCESS : MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    return (ready == 0) ? MODBUS_CALLBACK_RESULT_TIMEOUT : MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Connect the non-blocking socket to the address within the deadline.
+ *
+ * @return Socket file descriptor, -1 on error (errno is set).
+ */
+static int address_connect(const struct addrinfo * address, uint64_t deadline_ns)
+{
+    int error = 0;
+    socklen_t error_length = sizeof(error);
+    const int enable = 1;
+    
+    const int fd = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    
+    if ((connect(fd, address->ai_addr, address->ai_addrlen) != 0) && (errno != EINPROGRESS))
+    {
+        error = errno;
+    }
+    else
+    {
+        const modbus_callback_result_t callback_result = socket_wait(fd, POLLOUT, deadline_ns);
+        
+        if (callback_result == MODBUS_CALLBACK_RESULT_TIMEOUT)
+        {
+            error = ETIMEDOUT;
+        }
+        else if ((callback_result != MODBUS_CALLBACK_RESULT_SUCCESS) || 
+                 (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length) != 0))
+        {
+            error = errno;
+        }
+    }
+    
+    //Requests are small, they must not wait for more data to fill a segment
+    if ((error == 0) && (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) != 0))
+    {
+        error = errno;
+    }
+    
+    if (error != 0)
+    {
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    
+    return fd;
+}
+
+bool tcp_client_connect(tcp_client_t * client, const char * host, uint16_t port, uint32_t timeout_ms)
+{
+    const struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    const uint64_t deadline_ns = time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    struct addrinfo * addresses;
+    char service[8];
+    
+    client->fd = -1;
+    
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &addresses) != 0)
+    {
+        errno = EHOSTUNREACH;
+        return false;
+    }
+    
+    for (const struct addrinfo * address = addresses; (address != NULL) && (client->fd < 0); address = address->ai_next)
+    {
+        client->fd = address_connect(address, deadline_ns);
+    }
+    freeaddrinfo(addresses);
+    
+    return (client->fd >= 0);
+}
+
+void tcp_client_close(tcp_client_t * client)
+{
+    close(client->fd);
+    client->fd = -1;
+}
+
+modbus_callback_result_t tcp_client_write(void * user_data, 
+                                          uint8_t * data, 
+                                          uint16_t data_length, 
+                                          uint32_t timeout_ms)
+{
+    const modbus_iovec_t iov = { data, data_length };
+    
+    return tcp_client_writev(user_data, &iov, 1, timeout_ms);
+}
+
+modbus_callback_result_t tcp_client_writev(void * user_data, 
+                                           const modbus_iovec_t * iov, 
+                                           uint8_t iov_count, 
+                                           uint32_t timeout_ms)
+{
+    tcp_client_t * const client = (tcp_client_t *)user_data;
+    const uint64_t deadline_ns = time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    struct iovec vector[TCP_IOV_MAX];
+    struct msghdr message = { .msg_iov = vector };
+    size_t total = 0;
+    
+    if (iov_count > TCP_IOV_MAX)
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    for (uint8_t i = 0; i < iov_count; i++)
+    {
+        vector[i].iov_base = (void *)iov[i].data;
+        vector[i].iov_len = iov[i].data_length;
+        total += iov[i].data_length;
+    }
+    message.msg_iovlen = iov_count;
+    
+    size_t written = 0;
+    while (written < total)
+    {
+        //Closed connection is reported as an error instead of SIGPIPE
+        const ssize_t result = sendmsg(client->fd, &message, MSG_NOSIGNAL);
+        if (result < 0)
+        {
+            if ((errno != EAGAIN) && (errno != EINTR))
+            {
+                return MODBUS_CALLBACK_RESULT_IO_ERROR;
+            }
+            
+            const modbus_callback_result_t callback_result = socket_wait(client->fd, POLLOUT, deadline_ns);
+            if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+            {
+                return callback_result;
+            }
+            continue;
+        }
+        
+        written += (size_t)result;
+        
+        //Skip the written part of the vector
+        size_t skip = (size_t)result;
+        while ((message.msg_iovlen > 0) && (skip >= message.msg_iov->iov_len))
+        {
+            skip -= message.msg_iov->iov_len;
+            message.msg_iov++;
+            message.msg_iovlen--;
+        }
+        if (message.msg_iovlen > 0)
+        {
+            message.msg_iov->iov_base = (uint8_t *)message.msg_iov->iov_base + skip;
+            message.msg_iov->iov_len -= skip;
+        }
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+modbus_callback_result_t tcp_client_read(void * user_data, 
+                                         uint8_t * data, 
+                                         uint16_t data_length, 
+                                         uint32_t timeout_ms)
+{
+    tcp_client_t * const client = (tcp_client_t *)user_data;
+    const uint64_t deadline_ns = time_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    uint16_t received = 0;
+    
+    while (received < data_length)
+    {
+        const ssize_t result = recv(client->fd, &data[received], data_length - received, 0);
+        if (result > 0)
+        {
+            received += (uint16_t)result;
+            continue;
+        }
+        
+        //Connection closed by the server
+        if ((result == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+        {
+            return MODBUS_CALLBACK_RESULT_IO_ERROR;
+        }
+        
+        const modbus_callback_result_t callback_result = socket_wait(client->fd, POLLIN, deadline_ns);
+        if (callback_result != MODBUS_CALLBACK_RESULT_SUCCESS)
+        {
+            return callback_result;
+        }
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+modbus_callback_result_t tcp_client_receive(void * user_data, 
+                                            uint8_t * data, 
+                                            uint16_t data_length, 
+                                            uint16_t * received)
+{
+    tcp_client_t * const client = (tcp_client_t *)user_data;
+    
+    *received = 0;
+    const ssize_t result = recv(client->fd, data, data_length, 0);
+    if (result < 0)
+    {
+        return ((errno == EAGAIN) || (errno == EINTR)) ? MODBUS_CALLBACK_RESULT_SUCCESS : MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    //Connection closed by the server
+    if ((result == 0) && (data_length != 0))
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    *received = (uint16_t)result;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+void tcp_client_delay(void * user_data, uint32_t delay_ms)
+{
+    const struct timespec delay = 
+    {
+        .tv_sec = (time_t)(delay_ms / 1000),
+        .tv_nsec = (long)(delay_ms % 1000) * 1000000L
+    };
+    struct timespec remaining;
+    
+    (void)user_data;
+    
+    if (nanosleep(&delay, &remaining) != 0)
+    {
+        while ((errno == EINTR) && (nanosleep(&remaining, &remaining) != 0))
+        {
+        }
+    }
+}
+
+uint32_t tcp_client_clock(void * user_data)
+{
+    (void)user_data;
+    
+    return (uint32_t)(time_ns() / 1000);
+}
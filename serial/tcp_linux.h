@@ -0,0 +1,99 @@
+/**
+ * @defgroup tcp_linux Linux TCP client backend
+ *
+ * @brief Modbus bus callbacks for a TCP connection to a Modbus TCP server or a serial gateway
+ * (MODBUS_PROTOCOL_MODE_TCP, MODBUS_PROTOCOL_MODE_RTU_OVER_TCP).
+ *
+ * The socket is non-blocking with Nagle's algorithm disabled (TCP_NODELAY), so every request
+ * leaves as soon as it is written. There is no inter-frame silence, the idle callback is not used.
+ * A connection closed by the server is reported as an I/O error, the caller reconnects.
+ *
+ * The callbacks take the client as user data:
+ * @code
+ * tcp_client_t client;
+ * tcp_client_connect(&client, "192.168.1.10", MODBUS_TCP_PORT, 1000);
+ * const modbus_params_t params = 
+ * {
+ *     .mode = MODBUS_PROTOCOL_MODE_TCP,
+ *     .write = tcp_client_write,
+ *     .read = tcp_client_read,
+ *     .writev = tcp_client_writev,
+ *     .receive = tcp_client_receive,
+ *     .delay = tcp_client_delay,
+ *     .clock = tcp_client_clock,
+ *     .user_data = &client
+ * };
+ * @endcode
+ *
+ * @{
+ */
+
+#ifndef _TCP_LINUX_H_
+#define _TCP_LINUX_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+
+/**@brief TCP client. */
+typedef struct
+{
+    int fd;                                             /**< Socket file descriptor. */
+} tcp_client_t;
+
+/**@brief Connect to the server.
+ *
+ * @param[out] client     Pointer to the TCP client.
+ * @param[in]  host       Host name or address of the server.
+ * @param[in]  port       TCP port of the server (MODBUS_TCP_PORT for Modbus TCP).
+ * @param[in]  timeout_ms Connection timeout.
+ *
+ * @retval true if successful, otherwise false (errno is set).
+ */
+bool tcp_client_connect(tcp_client_t * client, const char * host, uint16_t port, uint32_t timeout_ms);
+
+/**@brief Close the connection.
+ *
+ * @param[in] client Pointer to the TCP client.
+ */
+void tcp_client_close(tcp_client_t * client);
+
+/**@brief Bus write callback, @see modbus_write_callback_t. Returns when the data is handed to the socket.
+ */
+modbus_callback_result_t tcp_client_write(void * user_data, 
+                                          uint8_t * data, 
+                                          uint16_t data_length, 
+                                          uint32_t timeout_ms);
+
+/**@brief Bus scatter-gather write callback, @see modbus_writev_callback_t.
+ */
+modbus_callback_result_t tcp_client_writev(void * user_data, 
+                                           const modbus_iovec_t * iov, 
+                                           uint8_t iov_count, 
+                                           uint32_t timeout_ms);
+
+/**@brief Bus read callback, @see modbus_read_callback_t.
+ */
+modbus_callback_result_t tcp_client_read(void * user_data, 
+                                         uint8_t * data, 
+                                         uint16_t data_length, 
+                                         uint32_t timeout_ms);
+
+/**@brief Bus receive callback, @see modbus_receive_callback_t.
+ */
+modbus_callback_result_t tcp_client_receive(void * user_data, 
+                                            uint8_t * data, 
+                                            uint16_t data_length, 
+                                            uint16_t * received);
+
+/**@brief Bus delay callback, @see modbus_delay_callback_t.
+ */
+void tcp_client_delay(void * user_data, uint32_t delay_ms);
+
+/**@brief Bus clock callback, @see modbus_clock_callback_t. Monotonic clock (CLOCK_MONOTONIC) in microseconds.
+ */
+uint32_t tcp_client_clock(void * user_data);
+
+#endif
+
+/** @} */
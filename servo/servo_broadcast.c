@@ -0,0 +1,126 @@
+#include "servo_broadcast.h"
+
+/**@brief Make all servos on the bus pending verification of the last write.
+ */
+static void axes_pending(servo_broadcast_t * broadcast)
+{
+    for (uint8_t axis = 1; axis < 128; axis++)
+    {
+        if (broadcast->states[axis] != SERVO_BROADCAST_STATE_NONE)
+        {
+            broadcast->states[axis] = SERVO_BROADCAST_STATE_PENDING;
+        }
+    }
+    
+    broadcast->next = 1;
+}
+
+void servo_broadcast_initialize(servo_broadcast_t * broadcast, modbus_ctx_t * ctx)
+{
+    broadcast->ctx = ctx;
+    broadcast->next = 1;
+    broadcast->words_num = 0;
+    
+    for (uint8_t axis = 0; axis < 128; axis++)
+    {
+        broadcast->states[axis] = SERVO_BROADCAST_STATE_NONE;
+    }
+}
+
+void servo_broadcast_axis_add(servo_broadcast_t * broadcast, uint8_t axis)
+{
+    if ((axis >= 1) && (axis <= 127))
+    {
+        //Servo has not received the previous writes
+        broadcast->states[axis] = (broadcast->words_num != 0) ? SERVO_BROADCAST_STATE_MISMATCH : 
+                                                               SERVO_BROADCAST_STATE_VERIFIED;
+    }
+}
+
+bool servo_broadcast_nwords_write(servo_broadcast_t * broadcast, uint16_t address, uint16_t * words, uint16_t words_num)
+{
+    if ((words_num == 0) || (words_num > SERVO_WRITE_WORDS_MAX))
+    {
+        return false;
+    }
+    
+    if (!servo_nwords_write(broadcast->ctx, MODBUS_ADDRESS_BROADCAST, address, words, words_num))
+    {
+        return false;
+    }
+    
+    broadcast->address = address;
+    broadcast->words_num = words_num;
+    for (uint16_t i = 0; i < words_num; i++)
+    {
+        broadcast->words[i] = words[i];
+    }
+    axes_pending(broadcast);
+    
+    return true;
+}
+
+bool servo_broadcast_oneword_write(servo_broadcast_t * broadcast, uint16_t address, uint16_t word)
+{
+    if (!servo_oneword_write(broadcast->ctx, MODBUS_ADDRESS_BROADCAST, address, word))
+    {
+        return false;
+    }
+    
+    broadcast->address = address;
+    broadcast->words_num = 1;
+    broadcast->words[0] = word;
+    axes_pending(broadcast);
+    
+    return true;
+}
+
+uint8_t servo_broadcast_verify(servo_broadcast_t * broadcast, uint8_t axes_max)
+{
+    uint16_t words[SERVO_WRITE_WORDS_MAX];
+    uint8_t pending = 0;
+    
+    //Rotation starts where the previous call stopped, the next start is updated once all axes are visited
+    const uint8_t start = broadcast->next;
+    uint8_t next = start;
+    for (uint8_t i = 0; i < 127; i++)
+    {
+        const uint8_t axis = (uint8_t)((start - 1 + i) % 127 + 1);
+        if (broadcast->states[axis] != SERVO_BROADCAST_STATE_PENDING)
+        {
+            continue;
+        }
+        
+        if (axes_max == 0)
+        {
+            pending++;
+            continue;
+        }
+        axes_max--;
+        next = (uint8_t)(axis % 127 + 1);
+        
+        if (!servo_nwords_read(broadcast->ctx, axis, broadcast->address, words, broadcast->words_num))
+        {
+            broadcast->states[axis] = SERVO_BROADCAST_STATE_FAILED;
+            continue;
+        }
+        
+        broadcast->states[axis] = SERVO_BROADCAST_STATE_VERIFIED;
+        for (uint16_t j = 0; j < broadcast->words_num; j++)
+        {
+            if (words[j] != broadcast->words[j])
+            {
+                broadcast->states[axis] = SERVO_BROADCAST_STATE_MISMATCH;
+                break;
+            }
+        }
+    }
+    broadcast->next = next;
+    
+    return pending;
+}
+
+servo_broadcast_state_t servo_broadcast_state_get(const servo_broadcast_t * broadcast, uint8_t axis)
+{
+    return (axis <= 127) ? (servo_broadcast_state_t)broadcast->states[axis] : SERVO_BROADCAST_STATE_NONE;
+}
@@ -0,0 +1,100 @@
+/**
+ * @ingroup servo_driver
+ *
+ * @defgroup servo_broadcast Servo broadcast writes
+ *
+ * @brief Synchronized update of all servos on the bus with verification.
+ *
+ * The write is sent once to MODBUS_ADDRESS_BROADCAST, so every servo picks up the new value 
+ * at the same time. Broadcast requests are not answered, therefore the tracker remembers the 
+ * written registers and the servos that should have received them. The servos are verified 
+ * later by reading the registers back, a few servos per call to spread the load over poll cycles.
+ *
+ * @{
+ */
+
+#ifndef _SERVO_BROADCAST_H_
+#define _SERVO_BROADCAST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+#include "servo_driver.h"
+
+/**@brief Verification state of the servo. */
+typedef enum
+{
+    SERVO_BROADCAST_STATE_NONE,                         /**< Servo is not on the bus. */
+    SERVO_BROADCAST_STATE_PENDING,                      /**< Servo is not verified yet. */
+    SERVO_BROADCAST_STATE_VERIFIED,                     /**< Servo registers match the written words. */
+    SERVO_BROADCAST_STATE_MISMATCH,                     /**< Servo registers differ from the written words. */
+    SERVO_BROADCAST_STATE_FAILED                        /**< Servo registers could not be read. */
+} servo_broadcast_state_t;
+
+/**@brief Broadcast writes tracker of the bus. */
+typedef struct
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus. */
+    uint8_t states[128];                                /**< Verification state of every servo, @see servo_broadcast_state_t. */
+    uint8_t next;                                       /**< Next servo to verify. */
+    uint16_t address;                                   /**< Starting address of the last write. */
+    uint16_t words[SERVO_WRITE_WORDS_MAX];              /**< Words of the last write. */
+    uint16_t words_num;                                 /**< Words number of the last write. */
+} servo_broadcast_t;
+
+/**@brief Initialize broadcast writes tracker with no servos.
+ *
+ * @param[out] broadcast Pointer to the tracker.
+ * @param[in]  ctx       Pointer to the modbus context of the bus.
+ */
+void servo_broadcast_initialize(servo_broadcast_t * broadcast, modbus_ctx_t * ctx);
+
+/**@brief Add servo expected to receive broadcast writes.
+ *
+ * @param[in] broadcast Pointer to the tracker.
+ * @param[in] axis      Communication address (1-127).
+ */
+void servo_broadcast_axis_add(servo_broadcast_t * broadcast, uint8_t axis);
+
+/**@brief Write N words to all servos. @see servo_nwords_write.
+ *
+ * @param[in] broadcast Pointer to the tracker.
+ * @param[in] address   Starting address.
+ * @param[in] words     Pointer to write words.
+ * @param[in] words_num Words number (1-123).
+ *
+ * @retval true if the request is sent, all servos become pending verification.
+ */
+bool servo_broadcast_nwords_write(servo_broadcast_t * broadcast, uint16_t address, uint16_t * words, uint16_t words_num);
+
+/**@brief Write 1 word to all servos. @see servo_oneword_write.
+ *
+ * @param[in] broadcast Pointer to the tracker.
+ * @param[in] address   Starting address.
+ * @param[in] word      Write word.
+ *
+ * @retval true if the request is sent, all servos become pending verification.
+ */
+bool servo_broadcast_oneword_write(servo_broadcast_t * broadcast, uint16_t address, uint16_t word);
+
+/**@brief Verify pending servos by reading back the registers of the last write.
+ *
+ * @param[in] broadcast Pointer to the tracker.
+ * @param[in] axes_max  Maximum number of servos to verify by this call.
+ *
+ * @return Number of servos still pending verification.
+ */
+uint8_t servo_broadcast_verify(servo_broadcast_t * broadcast, uint8_t axes_max);
+
+/**@brief Get verification state of the servo.
+ *
+ * @param[in] broadcast Pointer to the tracker.
+ * @param[in] axis      Communication address (1-127).
+ *
+ * @return Verification state.
+ */
+servo_broadcast_state_t servo_broadcast_state_get(const servo_broadcast_t * broadcast, uint8_t axis);
+
+#endif
+
+/** @} */
@@ -0,0 +1,326 @@
+#include "servo_bus.h"
+#include "servo_driver.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/**@brief Get time from the clock, 0 if there is no clock.
+ */
+static uint32_t clock_get(const servo_bus_t * bus)
+{
+    return (bus->clock != NULL) ? bus->clock(bus->clock_data) : 0;
+}
+
+/**@brief Start update of the published statistics.
+ */
+static void update_begin(servo_bus_t * bus)
+{
+    const unsigned int sequence = atomic_load_explicit(&bus->sequence, memory_order_relaxed);
+    
+    //Odd sequence is visible to readers before any statistics are changed
+    atomic_store_explicit(&bus->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**@brief Complete update of the published statistics.
+ */
+static void update_end(servo_bus_t * bus)
+{
+    const unsigned int sequence = atomic_load_explicit(&bus->sequence, memory_order_relaxed);
+    
+    atomic_store_explicit(&bus->sequence, sequence + 1, memory_order_release);
+}
+
+/**@brief Take the submitted jobs of every lane over and append them to the lanes in the order of submission.
+ */
+static void jobs_collect(servo_bus_t * bus)
+{
+    for (uint8_t lane = 0; lane < SERVO_BUS_LANES_NUM; lane++)
+    {
+        if (atomic_load_explicit(&bus->submitted[lane], memory_order_relaxed) == NULL)
+        {
+            continue;
+        }
+        
+        //Submitted jobs are stacked newest first, the whole stack is taken at once and reversed
+        servo_bus_job_t * job = atomic_exchange_explicit(&bus->submitted[lane], NULL, memory_order_acquire);
+        servo_bus_job_t * reversed = NULL;
+        servo_bus_job_t * const last = job;
+        while (job != NULL)
+        {
+            servo_bus_job_t * const next = job->next;
+            job->next = reversed;
+            reversed = job;
+            job = next;
+        }
+        
+        if (bus->head[lane] == NULL)
+        {
+            bus->head[lane] = reversed;
+        }
+        else
+        {
+            bus->tail[lane]->next = reversed;
+        }
+        bus->tail[lane] = last;
+    }
+}
+
+/**@brief Execute one step of the job.
+ *
+ * @retval true if successful, otherwise false.
+ */
+static bool job_step(modbus_ctx_t * ctx, servo_bus_job_t * job)
+{
+    const uint32_t remaining = job->words_num - job->done;
+    const uint16_t address = (uint16_t)(job->address + job->done);
+    uint16_t num;
+    bool success;
+    
+    switch (job->operation)
+    {
+        case SERVO_BUS_OPERATION_READ:
+            num = (remaining > SERVO_READ_WORDS_MAX) ? SERVO_READ_WORDS_MAX : (uint16_t)remaining;
+            success = (num == 0) || servo_nwords_read(ctx, job->axis, address, &job->words[job->done], num);
+            break;
+            
+        case SERVO_BUS_OPERATION_WRITE:
+            num = (remaining > SERVO_WRITE_WORDS_MAX) ? SERVO_WRITE_WORDS_MAX : (uint16_t)remaining;
+            success = (num == 0) || servo_nwords_write(ctx, job->axis, address, &job->words[job->done], num);
+            break;
+            
+        case SERVO_BUS_OPERATION_WRITE_ONE:
+            num = 1;
+            success = servo_oneword_write(ctx, job->axis, job->address, job->word);
+            break;
+            
+        default:
+            num = (uint16_t)remaining;
+            success = job->function(ctx, job);
+            break;
+    }
+    
+    job->done += success ? num : 0;
+    
+    return success;
+}
+
+/**@brief Record the step of the job and its completion in the statistics of the lane.
+ */
+static void stats_record(servo_bus_t * bus, 
+                         servo_bus_job_t * job, 
+                         servo_bus_job_t * preempted, 
+                         bool completed, 
+                         bool success, 
+                         uint32_t now_us)
+{
+    servo_bus_lane_stats_t * const stats = &bus->stats.lanes[job->lane];
+    
+    update_begin(bus);
+    stats->transactions++;
+    if (preempted != NULL)
+    {
+        bus->stats.lanes[preempted->lane].preemptions++;
+    }
+    if (completed)
+    {
+        stats->jobs++;
+        stats->failures += success ? 0 : 1;
+        if (bus->clock != NULL)
+        {
+            modbus_histogram_add(&stats->wait, job->started_us - job->queued_us);
+            modbus_histogram_add(&stats->run, now_us - job->started_us);
+        }
+    }
+    update_end(bus);
+}
+
+void servo_bus_initialize(servo_bus_t * bus, 
+                          modbus_ctx_t * ctx, 
+                          modbus_clock_callback_t clock, 
+                          void * clock_data, 
+                          servo_bus_wake_t wake, 
+                          void * wake_data)
+{
+    bus->ctx = ctx;
+    bus->clock = clock;
+    bus->clock_data = clock_data;
+    bus->wake = wake;
+    bus->wake_data = wake_data;
+    for (uint8_t lane = 0; lane < SERVO_BUS_LANES_NUM; lane++)
+    {
+        atomic_init(&bus->submitted[lane], NULL);
+        bus->head[lane] = NULL;
+        bus->tail[lane] = NULL;
+    }
+    atomic_init(&bus->waiting, false);
+    bus->current = NULL;
+    atomic_init(&bus->sequence, 0);
+    memset(&bus->stats, 0, sizeof(bus->stats));
+}
+
+bool servo_bus_read_prepare(servo_bus_job_t * job, uint8_t axis, uint16_t address, uint16_t * words, uint32_t words_num)
+{
+    if ((axis < 1 || 127 < axis) || ((uint32_t)address + words_num > 0x10000))
+    {
+        return false;
+    }
+    
+    job->operation = SERVO_BUS_OPERATION_READ;
+    job->axis = axis;
+    job->address = address;
+    job->words = words;
+    job->words_num = words_num;
+    
+    return true;
+}
+
+bool servo_bus_write_prepare(servo_bus_job_t * job, uint8_t axis, uint16_t address, uint16_t * words, uint32_t words_num)
+{
+    if ((127 < axis) || ((uint32_t)address + words_num > 0x10000))
+    {
+        return false;
+    }
+    
+    job->operation = SERVO_BUS_OPERATION_WRITE;
+    job->axis = axis;
+    job->address = address;
+    job->words = words;
+    job->words_num = words_num;
+    
+    return true;
+}
+
+bool servo_bus_oneword_write_prepare(servo_bus_job_t * job, uint8_t axis, uint16_t address, uint16_t word)
+{
+    if (127 < axis)
+    {
+        return false;
+    }
+    
+    job->operation = SERVO_BUS_OPERATION_WRITE_ONE;
+    job->axis = axis;
+    job->address = address;
+    job->word = word;
+    job->words_num = 1;
+    
+    return true;
+}
+
+void servo_bus_call_prepare(servo_bus_job_t * job, servo_bus_function_t function)
+{
+    job->operation = SERVO_BUS_OPERATION_CALL;
+    job->function = function;
+    job->words_num = 1;
+}
+
+void servo_bus_submit(servo_bus_t * bus, 
+                      servo_bus_lane_t lane, 
+                      servo_bus_job_t * job, 
+                      servo_bus_callback_t complete, 
+                      void * user_data)
+{
+    job->done = 0;
+    job->result = MODBUS_PROTOCOL_RESULT_SUCCESS;
+    job->exception = MODBUS_EXCEPTION_NONE;
+    job->complete = complete;
+    job->user_data = user_data;
+    job->lane = lane;
+    job->started = false;
+    job->queued_us = clock_get(bus);
+    
+    //Jobs are only pushed here and taken by the owner all at once, so a completed job may be submitted again safely
+    servo_bus_job_t * top = atomic_load_explicit(&bus->submitted[lane], memory_order_relaxed);
+    do
+    {
+        job->next = top;
+    } while (!atomic_compare_exchange_weak_explicit(&bus->submitted[lane], &top, job, 
+                                                    memory_order_seq_cst, memory_order_relaxed));
+    
+    //The owner checks the lanes after announcing the wait, so either it sees the job or the job sees the wait
+    if (atomic_load(&bus->waiting) && atomic_exchange(&bus->waiting, false) && (bus->wake != NULL))
+    {
+        bus->wake(bus->wake_data);
+    }
+}
+
+bool servo_bus_poll(servo_bus_t * bus)
+{
+    servo_bus_job_t * job = NULL;
+    
+    jobs_collect(bus);
+    for (uint8_t lane = 0; (lane < SERVO_BUS_LANES_NUM) && (job == NULL); lane++)
+    {
+        job = bus->head[lane];
+    }
+    
+    if (job == NULL)
+    {
+        return false;
+    }
+    
+    if (!job->started)
+    {
+        job->started = true;
+        job->started_us = clock_get(bus);
+    }
+    
+    //Started job is interrupted by a job of a higher lane
+    servo_bus_job_t * const preempted = ((bus->current != NULL) && (bus->current != job)) ? bus->current : NULL;
+    
+    const bool success = job_step(bus->ctx, job);
+    const bool completed = !success || (job->done >= job->words_num);
+    const uint32_t now_us = completed ? clock_get(bus) : 0;
+    
+    bus->current = completed ? NULL : job;
+    stats_record(bus, job, preempted, completed, success, now_us);
+    if (!completed)
+    {
+        return true;
+    }
+    
+    bus->head[job->lane] = job->next;
+    if (!success)
+    {
+        job->result = servo_result_get(bus->ctx);
+        job->exception = servo_exception_get(bus->ctx);
+    }
+    
+    //The job belongs to the caller again
+    if (job->complete != NULL)
+    {
+        job->complete(job, success);
+    }
+    
+    return true;
+}
+
+bool servo_bus_idle_enter(servo_bus_t * bus)
+{
+    atomic_store(&bus->waiting, true);
+    
+    for (uint8_t lane = 0; lane < SERVO_BUS_LANES_NUM; lane++)
+    {
+        if ((bus->head[lane] != NULL) || (atomic_load(&bus->submitted[lane]) != NULL))
+        {
+            atomic_store(&bus->waiting, false);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void servo_bus_stats_get(const servo_bus_t * bus, servo_bus_stats_t * stats)
+{
+    unsigned int begin;
+    unsigned int end;
+    
+    do
+    {
+        begin = atomic_load_explicit(&bus->sequence, memory_order_acquire);
+        memcpy(stats, &bus->stats, sizeof(*stats));
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&bus->sequence, memory_order_relaxed);
+    } while ((begin & 1) || (begin != end));
+}
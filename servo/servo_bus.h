@@ -0,0 +1,244 @@
+/**
+ * @ingroup servo_driver
+ *
+ * @defgroup servo_bus Servo bus owner queue
+ *
+ * @brief Jobs of several threads (motion, diagnostics, user interface) executed on one bus by its owner thread.
+ *
+ * The protocol layer is not synchronized, so one thread owns the modbus context and every other thread
+ * submits jobs instead of calling servo_* functions. Submission is lock-free: each priority lane is
+ * a multi-producer stack the owner takes over at once and turns into the execution order, so a producer
+ * never waits for the bus or for another producer.
+ *
+ * The owner executes one Modbus transaction per servo_bus_poll(), always from the highest lane with jobs.
+ * Reads and writes longer than one request are split, so a critical write waits at most for the
+ * transaction on the bus, not for the rest of a long parameter dump. Jobs of one lane are executed
+ * in the order of submission. Lanes have strict priority: a lower lane waits while a higher one has jobs.
+ *
+ * Every lane records the latency from the submission to the start of the first transaction of a job (wait)
+ * and from there to the completion (run), published to any thread like the bus metrics (@see modbus_metrics).
+ *
+ * Owner loop (@see bus_linux for a ready-made thread):
+ * @code
+ * for (;;)
+ * {
+ *     while (servo_bus_poll(&bus))
+ *     {
+ *     }
+ *     if (servo_bus_idle_enter(&bus))
+ *     {
+ *         //Sleep until the wake callback is called
+ *     }
+ * }
+ * @endcode
+ *
+ * @{
+ */
+
+#ifndef _SERVO_BUS_H_
+#define _SERVO_BUS_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+#include "modbus/modbus_metrics.h"
+
+/**@brief Wake the owner thread waiting after servo_bus_idle_enter(). Called by the submitting threads.
+ *
+ * @param[in] wake_data User data of the wake callback.
+ */
+typedef void (*servo_bus_wake_t)(void * wake_data);
+
+typedef struct servo_bus_job_s servo_bus_job_t;
+
+/**@brief Job function executed by the owner thread (SERVO_BUS_OPERATION_CALL).
+ *
+ * @param[in] ctx Pointer to the modbus context of the bus.
+ * @param[in] job Pointer to the job.
+ *
+ * @retval true if successful, otherwise false (the cause is taken from servo_result_get()).
+ */
+typedef bool (*servo_bus_function_t)(modbus_ctx_t * ctx, servo_bus_job_t * job);
+
+/**@brief Job completion callback, called by the owner thread. The job may be reused or released by the callback.
+ *
+ * @param[in] job     Pointer to the completed job.
+ * @param[in] success true if successful, otherwise false (result and exception code are available in the job).
+ */
+typedef void (*servo_bus_callback_t)(servo_bus_job_t * job, bool success);
+
+/**@brief Priority lanes, the lower the more urgent. */
+typedef enum
+{
+    SERVO_BUS_LANE_CRITICAL,                            /**< Latency-critical commands (emergency stop, setpoints). */
+    SERVO_BUS_LANE_NORMAL,                              /**< Cyclic monitoring. */
+    SERVO_BUS_LANE_BACKGROUND,                          /**< Parameter dumps, diagnostics, user interface. */
+    SERVO_BUS_LANES_NUM
+} servo_bus_lane_t;
+
+/**@brief Job operations. */
+typedef enum
+{
+    SERVO_BUS_OPERATION_READ,                           /**< Read any number of words, @see servo_block_read(). */
+    SERVO_BUS_OPERATION_WRITE,                          /**< Write any number of words, @see servo_block_write(). */
+    SERVO_BUS_OPERATION_WRITE_ONE,                      /**< Write 1 word, @see servo_oneword_write(). */
+    SERVO_BUS_OPERATION_CALL                            /**< Call the job function, executed as one step. */
+} servo_bus_operation_t;
+
+/**@brief Bus job. Owned by the caller, must stay valid from the submission until completion. */
+struct servo_bus_job_s
+{
+    servo_bus_operation_t operation;                    /**< Operation. */
+    uint8_t axis;                                       /**< Communication address. */
+    uint16_t address;                                   /**< Starting address. */
+    uint16_t * words;                                   /**< Pointer to read or write words. */
+    uint32_t words_num;                                 /**< Words number. */
+    uint16_t word;                                      /**< Write word (SERVO_BUS_OPERATION_WRITE_ONE). */
+    servo_bus_function_t function;                      /**< Job function (SERVO_BUS_OPERATION_CALL). */
+    uint32_t done;                                      /**< Number of words transferred so far. */
+    modbus_protocol_result_t result;                    /**< Result of the job, @see servo_result_get(). */
+    modbus_exception_t exception;                       /**< Exception code if the request was rejected by servo. */
+    servo_bus_callback_t complete;                      /**< Completion callback (may be NULL). */
+    void * user_data;                                   /**< User data of the job. */
+    servo_bus_lane_t lane;                              /**< Lane the job is submitted to (internal). */
+    bool started;                                       /**< First transaction is performed (internal). */
+    uint32_t queued_us;                                 /**< Time of the submission (internal). */
+    uint32_t started_us;                                /**< Time of the first transaction (internal). */
+    servo_bus_job_t * next;                             /**< Next job of the lane (internal). */
+};
+
+/**@brief Lane statistics. Counters wrap around, monitoring should use differences of snapshots. */
+typedef struct
+{
+    uint32_t jobs;                                      /**< Completed jobs. */
+    uint32_t failures;                                  /**< Jobs failed with communication errors or exceptions. */
+    uint32_t transactions;                              /**< Executed steps (one Modbus transaction each, except calls). */
+    uint32_t preemptions;                               /**< Started jobs interrupted by a job of a higher lane. */
+    modbus_histogram_t wait;                            /**< Latency from the submission to the start of the job. */
+    modbus_histogram_t run;                             /**< Latency from the start of the job to its completion. */
+} servo_bus_lane_stats_t;
+
+/**@brief Bus statistics. */
+typedef struct
+{
+    servo_bus_lane_stats_t lanes[SERVO_BUS_LANES_NUM];  /**< Statistics of the lanes. */
+} servo_bus_stats_t;
+
+/**@brief Bus owner queue. */
+typedef struct
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus, used by the owner thread only. */
+    modbus_clock_callback_t clock;                      /**< Monotonic clock (NULL - latencies are not recorded). */
+    void * clock_data;                                  /**< User data of the clock. */
+    servo_bus_wake_t wake;                              /**< Wake callback (NULL if the owner does not sleep). */
+    void * wake_data;                                   /**< User data of the wake callback. */
+    _Atomic(servo_bus_job_t *) submitted[SERVO_BUS_LANES_NUM]; /**< Submitted jobs not taken by the owner, newest first. */
+    atomic_bool waiting;                                /**< Owner waits for the wake callback. */
+    servo_bus_job_t * head[SERVO_BUS_LANES_NUM];        /**< Jobs taken by the owner, oldest first (owner only). */
+    servo_bus_job_t * tail[SERVO_BUS_LANES_NUM];        /**< Last job taken by the owner (owner only). */
+    servo_bus_job_t * current;                          /**< Started job not completed yet (owner only). */
+    atomic_uint sequence;                               /**< Sequence lock of the statistics, odd while the owner updates them. */
+    servo_bus_stats_t stats;                            /**< Published statistics. */
+} servo_bus_t;
+
+/**@brief Initialize bus owner queue.
+ *
+ * @param[out] bus        Pointer to the bus owner queue.
+ * @param[in]  ctx        Pointer to the initialized modbus context of the bus.
+ * @param[in]  clock      Monotonic clock in microseconds (may be NULL), called by the submitting threads as well.
+ * @param[in]  clock_data User data of the clock.
+ * @param[in]  wake       Wake callback (may be NULL).
+ * @param[in]  wake_data  User data of the wake callback.
+ */
+void servo_bus_initialize(servo_bus_t * bus, 
+                          modbus_ctx_t * ctx, 
+                          modbus_clock_callback_t clock, 
+                          void * clock_data, 
+                          servo_bus_wake_t wake, 
+                          void * wake_data);
+
+/**@brief Prepare job reading any number of words from servo.
+ *
+ * @param[out] job       Pointer to the job.
+ * @param[in]  axis      Communication address (1-127).
+ * @param[in]  address   Starting address.
+ * @param[out] words     Pointer to read words, valid after completion.
+ * @param[in]  words_num Words number.
+ *
+ * @retval true if prepared, false if the parameters are invalid.
+ */
+bool servo_bus_read_prepare(servo_bus_job_t * job, uint8_t axis, uint16_t address, uint16_t * words, uint32_t words_num);
+
+/**@brief Prepare job writing any number of words to servo.
+ *
+ * @param[out] job       Pointer to the job.
+ * @param[in]  axis      Communication address (1-127, MODBUS_ADDRESS_BROADCAST for all servos).
+ * @param[in]  address   Starting address.
+ * @param[in]  words     Pointer to write words, must be valid until completion.
+ * @param[in]  words_num Words number.
+ *
+ * @retval true if prepared, false if the parameters are invalid.
+ */
+bool servo_bus_write_prepare(servo_bus_job_t * job, uint8_t axis, uint16_t address, uint16_t * words, uint32_t words_num);
+
+/**@brief Prepare job writing 1 word to servo.
+ *
+ * @param[out] job     Pointer to the job.
+ * @param[in]  axis    Communication address (1-127, MODBUS_ADDRESS_BROADCAST for all servos).
+ * @param[in]  address Starting address.
+ * @param[in]  word    Write word.
+ *
+ * @retval true if prepared, false if the parameters are invalid.
+ */
+bool servo_bus_oneword_write_prepare(servo_bus_job_t * job, uint8_t axis, uint16_t address, uint16_t word);
+
+/**@brief Prepare job calling the function on the bus (any servo_* sequence which must not be interleaved).
+ *
+ * @param[out] job      Pointer to the job.
+ * @param[in]  function Job function.
+ */
+void servo_bus_call_prepare(servo_bus_job_t * job, servo_bus_function_t function);
+
+/**@brief Submit prepared job. May be called by any thread, never blocks.
+ *
+ * @param[in] bus       Pointer to the bus owner queue.
+ * @param[in] lane      Priority lane.
+ * @param[in] job       Pointer to the prepared job.
+ * @param[in] complete  Completion callback (may be NULL).
+ * @param[in] user_data User data of the job.
+ */
+void servo_bus_submit(servo_bus_t * bus, 
+                      servo_bus_lane_t lane, 
+                      servo_bus_job_t * job, 
+                      servo_bus_callback_t complete, 
+                      void * user_data);
+
+/**@brief Execute one step of the most urgent job: one Modbus transaction or the job function (owner thread only).
+ *        Completion callback of the job is called if the job is completed.
+ *
+ * @param[in] bus Pointer to the bus owner queue.
+ *
+ * @retval true if a step was executed, false if there are no jobs.
+ */
+bool servo_bus_poll(servo_bus_t * bus);
+
+/**@brief Prepare the owner thread to wait for jobs (owner thread only).
+ *
+ * @param[in] bus Pointer to the bus owner queue.
+ *
+ * @retval true if there are no jobs, the wake callback will be called on the next submission.
+ * @retval false if there are jobs to execute, the owner must not wait.
+ */
+bool servo_bus_idle_enter(servo_bus_t * bus);
+
+/**@brief Copy consistent statistics. May be called by any thread, never blocks the owner thread.
+ *
+ * @param[in]  bus   Pointer to the bus owner queue.
+ * @param[out] stats Pointer to store the statistics.
+ */
+void servo_bus_stats_get(const servo_bus_t * bus, servo_bus_stats_t * stats);
+
+#endif
+
+/** @} */
@@ -0,0 +1,375 @@
+#include "servo_cache.h"
+#include "servo_driver.h"
+
+/**@brief Find cached register.
+ *
+ * @return Pointer to the register, NULL if the register is not cached.
+ */
+static servo_cache_register_t * register_find(servo_cache_t * cache, uint16_t address)
+{
+    uint16_t low = 0;
+    uint16_t high = cache->registers_num;
+    
+    while (low < high)
+    {
+        const uint16_t middle = (low + high) / 2;
+        if (cache->registers[middle].address < address)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    
+    if ((low < cache->registers_num) && (cache->registers[low].address == address))
+    {
+        return &cache->registers[low];
+    }
+    
+    return NULL;
+}
+
+/**@brief Check if the cached value can be used instead of the servo register.
+ */
+static bool register_fresh(const servo_cache_register_t * reg, uint32_t now_ms)
+{
+    if ((reg == NULL) || (reg->policy == SERVO_CACHE_POLICY_LIVE))
+    {
+        return false;
+    }
+    
+    if (reg->dirty)
+    {
+        return true;
+    }
+    
+    return reg->valid && ((reg->policy == SERVO_CACHE_POLICY_STATIC) || (now_ms - reg->timestamp_ms < reg->ttl_ms));
+}
+
+/**@brief Check if the servo register already has the value.
+ */
+static bool register_unchanged(const servo_cache_register_t * reg, uint16_t value, uint32_t now_ms)
+{
+    return register_fresh(reg, now_ms) && !reg->dirty && (reg->value == value);
+}
+
+/**@brief Store the value written to or read from the servo.
+ */
+static void register_store(servo_cache_register_t * reg, uint16_t value, uint32_t now_ms)
+{
+    if ((reg == NULL) || (reg->policy == SERVO_CACHE_POLICY_LIVE))
+    {
+        return;
+    }
+    
+    reg->value = value;
+    reg->timestamp_ms = now_ms;
+    reg->valid = true;
+    reg->dirty = false;
+}
+
+/**@brief Invalidate the cache if the last request was rejected by the servo.
+ */
+static void exception_check(servo_cache_t * cache)
+{
+    if (servo_exception_get(cache->ctx) != MODBUS_EXCEPTION_NONE)
+    {
+        servo_cache_invalidate(cache, SERVO_CACHE_INVALIDATE_EXCEPTION);
+    }
+}
+
+void servo_cache_initialize(servo_cache_t * cache, 
+                            modbus_ctx_t * ctx, 
+                            uint8_t axis, 
+                            servo_cache_invalidated_callback_t invalidated, 
+                            void * user_data)
+{
+    cache->ctx = ctx;
+    cache->axis = axis;
+    cache->registers_num = 0;
+    cache->stats = (servo_cache_stats_t){ 0 };
+    cache->invalidated = invalidated;
+    cache->user_data = user_data;
+}
+
+bool servo_cache_registers_define(servo_cache_t * cache, 
+                                  uint16_t address, 
+                                  uint16_t count, 
+                                  servo_cache_policy_t policy, 
+                                  uint32_t ttl_ms)
+{
+    uint16_t added = 0;
+    
+    if ((uint32_t)address + count > 0x10000)
+    {
+        return false;
+    }
+    
+    //Check the capacity first, so a failure leaves the definitions unchanged
+    for (uint32_t i = address; i < (uint32_t)address + count; i++)
+    {
+        if (register_find(cache, (uint16_t)i) == NULL)
+        {
+            added++;
+        }
+    }
+    if (cache->registers_num + added > SERVO_CACHE_REGISTERS_NUM)
+    {
+        return false;
+    }
+    
+    for (uint32_t i = address; i < (uint32_t)address + count; i++)
+    {
+        servo_cache_register_t * reg = register_find(cache, (uint16_t)i);
+        if (reg == NULL)
+        {
+            //Keep the registers sorted by address
+            uint16_t pos = cache->registers_num;
+            while ((pos > 0) && (cache->registers[pos - 1].address > i))
+            {
+                cache->registers[pos] = cache->registers[pos - 1];
+                pos--;
+            }
+            reg = &cache->registers[pos];
+            cache->registers_num++;
+            
+            *reg = (servo_cache_register_t){ .address = (uint16_t)i };
+        }
+        
+        reg->policy = (uint8_t)policy;
+        reg->ttl_ms = ttl_ms;
+        reg->valid = false;
+    }
+    
+    return true;
+}
+
+bool servo_cache_nwords_read(servo_cache_t * cache, 
+                             uint16_t address, 
+                             uint16_t * words, 
+                             uint16_t words_num, 
+                             uint32_t now_ms)
+{
+    bool cached = (words_num != 0);
+    
+    for (uint16_t i = 0; cached && (i < words_num); i++)
+    {
+        cached = register_fresh(register_find(cache, address + i), now_ms);
+    }
+    
+    if (cached)
+    {
+        for (uint16_t i = 0; i < words_num; i++)
+        {
+            words[i] = register_find(cache, address + i)->value;
+        }
+        cache->stats.hits++;
+        return true;
+    }
+    
+    cache->stats.misses++;
+    if (!servo_nwords_read(cache->ctx, cache->axis, address, words, words_num))
+    {
+        exception_check(cache);
+        return false;
+    }
+    
+    for (uint16_t i = 0; i < words_num; i++)
+    {
+        servo_cache_register_t * reg = register_find(cache, address + i);
+        if ((reg != NULL) && reg->dirty)
+        {
+            //Value to be written supersedes the servo register
+            words[i] = reg->value;
+        }
+        else
+        {
+            register_store(reg, words[i], now_ms);
+        }
+    }
+    
+    return true;
+}
+
+bool servo_cache_nwords_write(servo_cache_t * cache, 
+                              uint16_t address, 
+                              uint16_t * words, 
+                              uint16_t words_num, 
+                              uint32_t now_ms)
+{
+    uint16_t first = 0;
+    uint16_t last = words_num;
+    
+    while ((first < last) && register_unchanged(register_find(cache, address + first), words[first], now_ms))
+    {
+        first++;
+    }
+    while ((last > first) && register_unchanged(register_find(cache, address + last - 1), words[last - 1], now_ms))
+    {
+        last--;
+    }
+    
+    if ((first == last) && (words_num != 0))
+    {
+        cache->stats.writes_skipped++;
+        return true;
+    }
+    
+    if (!servo_nwords_write(cache->ctx, cache->axis, address + first, &words[first], last - first))
+    {
+        exception_check(cache);
+        return false;
+    }
+    
+    for (uint16_t i = first; i < last; i++)
+    {
+        register_store(register_find(cache, address + i), words[i], now_ms);
+    }
+    
+    return true;
+}
+
+bool servo_cache_oneword_write(servo_cache_t * cache, uint16_t address, uint16_t word, uint32_t now_ms)
+{
+    servo_cache_register_t * reg = register_find(cache, address);
+    
+    if (register_unchanged(reg, word, now_ms))
+    {
+        cache->stats.writes_skipped++;
+        return true;
+    }
+    
+    if (!servo_oneword_write(cache->ctx, cache->axis, address, word))
+    {
+        exception_check(cache);
+        return false;
+    }
+    
+    register_store(reg, word, now_ms);
+    
+    return true;
+}
+
+bool servo_cache_word_set(servo_cache_t * cache, uint16_t address, uint16_t word)
+{
+    servo_cache_register_t * reg = register_find(cache, address);
+    
+    if ((reg == NULL) || (reg->policy == SERVO_CACHE_POLICY_LIVE))
+    {
+        return false;
+    }
+    
+    if (!reg->dirty && reg->valid && (reg->value == word))
+    {
+        return true;
+    }
+    
+    reg->value = word;
+    reg->dirty = true;
+    
+    return true;
+}
+
+bool servo_cache_word_get(servo_cache_t * cache, uint16_t address, uint16_t * word, uint32_t now_ms)
+{
+    const servo_cache_register_t * reg = register_find(cache, address);
+    
+    if (!register_fresh(reg, now_ms) || reg->dirty)
+    {
+        return false;
+    }
+    
+    *word = reg->value;
+    
+    return true;
+}
+
+void servo_cache_words_store(servo_cache_t * cache, 
+                             uint16_t address, 
+                             const uint16_t * words, 
+                             uint16_t words_num, 
+                             uint32_t now_ms)
+{
+    for (uint16_t i = 0; i < words_num; i++)
+    {
+        register_store(register_find(cache, address + i), words[i], now_ms);
+    }
+}
+
+bool servo_cache_flush(servo_cache_t * cache, uint32_t now_ms)
+{
+    uint16_t words[SERVO_WRITE_WORDS_MAX];
+    uint16_t i = 0;
+    
+    while (i < cache->registers_num)
+    {
+        if (!cache->registers[i].dirty)
+        {
+            i++;
+            continue;
+        }
+        
+        //Collect adjacent dirty registers
+        const uint16_t first = i;
+        uint16_t words_num = 0;
+        do
+        {
+            words[words_num++] = cache->registers[i++].value;
+        } while ((i < cache->registers_num) && (words_num < SERVO_WRITE_WORDS_MAX) && cache->registers[i].dirty && 
+                 (cache->registers[i].address == cache->registers[i - 1].address + 1));
+        
+        const uint16_t address = cache->registers[first].address;
+        const bool success = (words_num == 1) ? 
+                servo_oneword_write(cache->ctx, cache->axis, address, words[0]) : 
+                servo_nwords_write(cache->ctx, cache->axis, address, words, words_num);
+        if (!success)
+        {
+            if (servo_exception_get(cache->ctx) != MODBUS_EXCEPTION_NONE)
+            {
+                //Rejected values are not retried
+                for (uint16_t j = 0; j < words_num; j++)
+                {
+                    cache->registers[first + j].dirty = false;
+                }
+            }
+            exception_check(cache);
+            return false;
+        }
+        
+        for (uint16_t j = 0; j < words_num; j++)
+        {
+            register_store(&cache->registers[first + j], words[j], now_ms);
+        }
+    }
+    
+    return true;
+}
+
+bool servo_cache_dirty(const servo_cache_t * cache)
+{
+    for (uint16_t i = 0; i < cache->registers_num; i++)
+    {
+        if (cache->registers[i].dirty)
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void servo_cache_invalidate(servo_cache_t * cache, servo_cache_invalidate_t reason)
+{
+    for (uint16_t i = 0; i < cache->registers_num; i++)
+    {
+        cache->registers[i].valid = false;
+    }
+    
+    cache->stats.invalidations++;
+    if (cache->invalidated != NULL)
+    {
+        cache->invalidated(cache, reason);
+    }
+}
@@ -0,0 +1,236 @@
+/**
+ * @ingroup servo_driver
+ *
+ * @defgroup servo_cache Servo register cache
+ *
+ * @brief Optional per-axis shadow copy of the servo registers.
+ *
+ * Registers are cached only if they are defined with servo_cache_registers_define(), 
+ * each with its own policy:
+ * - SERVO_CACHE_POLICY_LIVE - never cached, always read from the servo (default for undefined registers);
+ * - SERVO_CACHE_POLICY_STATIC - read once, the cached value is valid until invalidation;
+ * - SERVO_CACHE_POLICY_TTL - the cached value is valid for the given time.
+ *
+ * Writes of the values equal to the cached ones are skipped. Values can also be set in the cache 
+ * only (marked dirty) and written later by servo_cache_flush(), which coalesces adjacent dirty 
+ * registers into multiple registers writes.
+ *
+ * Cached values are dropped if the servo answers with an exception, and should be dropped by 
+ * the application after the drive reset (servo_cache_invalidate()). The invalidation callback 
+ * is called in both cases.
+ *
+ * Time is passed by the caller in milliseconds from any monotonic source.
+ *
+ * @{
+ */
+
+#ifndef _SERVO_CACHE_H_
+#define _SERVO_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+
+#define SERVO_CACHE_REGISTERS_NUM    (64)               /**< Maximum number of cached registers per axis. */
+
+/**@brief Register cache policy. */
+typedef enum
+{
+    SERVO_CACHE_POLICY_LIVE,                            /**< Always read from the servo. */
+    SERVO_CACHE_POLICY_STATIC,                          /**< Cached until invalidation. */
+    SERVO_CACHE_POLICY_TTL                              /**< Cached for the given time. */
+} servo_cache_policy_t;
+
+/**@brief Cache invalidation reason. */
+typedef enum
+{
+    SERVO_CACHE_INVALIDATE_EXCEPTION,                   /**< Servo answered with an exception. */
+    SERVO_CACHE_INVALIDATE_RESET,                       /**< Drive was reset. */
+    SERVO_CACHE_INVALIDATE_USER                         /**< Invalidated by the application. */
+} servo_cache_invalidate_t;
+
+typedef struct servo_cache_s servo_cache_t;
+
+/**@brief Cache invalidation callback.
+ *
+ * @param[in] cache  Pointer to the invalidated cache.
+ * @param[in] reason Invalidation reason.
+ */
+typedef void (*servo_cache_invalidated_callback_t)(servo_cache_t * cache, servo_cache_invalidate_t reason);
+
+/**@brief Cached register. */
+typedef struct
+{
+    uint16_t address;                                   /**< Register address. */
+    uint16_t value;                                     /**< Cached value. */
+    uint32_t timestamp_ms;                              /**< Time the value was read or written. */
+    uint32_t ttl_ms;                                    /**< Time to live (SERVO_CACHE_POLICY_TTL). */
+    uint8_t policy;                                     /**< Cache policy, @see servo_cache_policy_t. */
+    bool valid;                                         /**< Cached value matches the servo register. */
+    bool dirty;                                         /**< Cached value is not written to the servo yet. */
+} servo_cache_register_t;
+
+/**@brief Cache statistics. */
+typedef struct
+{
+    uint32_t hits;                                      /**< Reads served from the cache. */
+    uint32_t misses;                                    /**< Reads forwarded to the servo. */
+    uint32_t writes_skipped;                            /**< Writes skipped because the values are unchanged. */
+    uint32_t invalidations;                             /**< Number of invalidations. */
+} servo_cache_stats_t;
+
+/**@brief Register cache of the servo. */
+struct servo_cache_s
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus. */
+    uint8_t axis;                                       /**< Communication address. */
+    servo_cache_register_t registers[SERVO_CACHE_REGISTERS_NUM];    /**< Cached registers sorted by address. */
+    uint16_t registers_num;                             /**< Number of cached registers. */
+    servo_cache_stats_t stats;                          /**< Statistics. */
+    servo_cache_invalidated_callback_t invalidated;     /**< Invalidation callback (may be NULL). */
+    void * user_data;                                   /**< User data of the invalidation callback. */
+};
+
+/**@brief Initialize cache of the servo with no cached registers.
+ *
+ * @param[out] cache       Pointer to the cache.
+ * @param[in]  ctx         Pointer to the modbus context of the bus.
+ * @param[in]  axis        Communication address (1-127).
+ * @param[in]  invalidated Invalidation callback (may be NULL).
+ * @param[in]  user_data   User data of the invalidation callback.
+ */
+void servo_cache_initialize(servo_cache_t * cache, 
+                            modbus_ctx_t * ctx, 
+                            uint8_t axis, 
+                            servo_cache_invalidated_callback_t invalidated, 
+                            void * user_data);
+
+/**@brief Define cache policy of the registers.
+ *
+ * @param[in] cache   Pointer to the cache.
+ * @param[in] address Starting address.
+ * @param[in] count   Number of registers.
+ * @param[in] policy  Cache policy.
+ * @param[in] ttl_ms  Time to live (SERVO_CACHE_POLICY_TTL).
+ *
+ * @retval true if defined, false if the range exceeds the address space or there are too many cached 
+ *         registers (no register is defined then).
+ */
+bool servo_cache_registers_define(servo_cache_t * cache, 
+                                  uint16_t address, 
+                                  uint16_t count, 
+                                  servo_cache_policy_t policy, 
+                                  uint32_t ttl_ms);
+
+/**@brief Read N words through the cache. @see servo_nwords_read.
+ *
+ * If all the words are cached and valid, the servo is not accessed. Otherwise all the words are read 
+ * from the servo and cached, dirty values take precedence over the read ones.
+ *
+ * @param[in]  cache     Pointer to the cache.
+ * @param[in]  address   Starting address.
+ * @param[out] words     Pointer to read words.
+ * @param[in]  words_num Words number (0-125).
+ * @param[in]  now_ms    Current time in milliseconds.
+ *
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
+ */
+bool servo_cache_nwords_read(servo_cache_t * cache, 
+                             uint16_t address, 
+                             uint16_t * words, 
+                             uint16_t words_num, 
+                             uint32_t now_ms);
+
+/**@brief Write N words through the cache. @see servo_nwords_write.
+ *
+ * Unchanged words at the beginning and the end are not written, the write is skipped if all 
+ * the words are unchanged.
+ *
+ * @param[in] cache     Pointer to the cache.
+ * @param[in] address   Starting address.
+ * @param[in] words     Pointer to write words.
+ * @param[in] words_num Words number (0-123).
+ * @param[in] now_ms    Current time in milliseconds.
+ *
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
+ */
+bool servo_cache_nwords_write(servo_cache_t * cache, 
+                              uint16_t address, 
+                              uint16_t * words, 
+                              uint16_t words_num, 
+                              uint32_t now_ms);
+
+/**@brief Write 1 word through the cache, skipped if the word is unchanged. @see servo_oneword_write.
+ *
+ * @param[in] cache   Pointer to the cache.
+ * @param[in] address Starting address.
+ * @param[in] word    Write word.
+ * @param[in] now_ms  Current time in milliseconds.
+ *
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
+ */
+bool servo_cache_oneword_write(servo_cache_t * cache, uint16_t address, uint16_t word, uint32_t now_ms);
+
+/**@brief Set 1 word in the cache only, it is written to the servo by servo_cache_flush().
+ *
+ * @param[in] cache   Pointer to the cache.
+ * @param[in] address Register address, must be cached (not SERVO_CACHE_POLICY_LIVE).
+ * @param[in] word    Write word.
+ *
+ * @retval true if set, false if the register is not cached.
+ */
+bool servo_cache_word_set(servo_cache_t * cache, uint16_t address, uint16_t word);
+
+/**@brief Get 1 word known to be in the servo register (cached, valid and not dirty).
+ *
+ * @param[in]  cache   Pointer to the cache.
+ * @param[in]  address Register address.
+ * @param[out] word    Pointer to store the word.
+ * @param[in]  now_ms  Current time in milliseconds.
+ *
+ * @retval true if the word is known, otherwise false.
+ */
+bool servo_cache_word_get(servo_cache_t * cache, uint16_t address, uint16_t * word, uint32_t now_ms);
+
+/**@brief Store N words written to the servo bypassing the cache. Registers which are not cached are ignored.
+ *
+ * @param[in] cache     Pointer to the cache.
+ * @param[in] address   Starting address.
+ * @param[in] words     Pointer to written words.
+ * @param[in] words_num Words number.
+ * @param[in] now_ms    Current time in milliseconds.
+ */
+void servo_cache_words_store(servo_cache_t * cache, 
+                             uint16_t address, 
+                             const uint16_t * words, 
+                             uint16_t words_num, 
+                             uint32_t now_ms);
+
+/**@brief Write dirty registers to the servo. Adjacent registers are written by one request.
+ *
+ * @param[in] cache  Pointer to the cache.
+ * @param[in] now_ms Current time in milliseconds.
+ *
+ * @retval true if all dirty registers are written, otherwise false (values rejected by the servo are 
+ *         dropped, the rest stay dirty).
+ */
+bool servo_cache_flush(servo_cache_t * cache, uint32_t now_ms);
+
+/**@brief Check if there are dirty registers.
+ *
+ * @param[in] cache Pointer to the cache.
+ *
+ * @retval true if there are registers to flush.
+ */
+bool servo_cache_dirty(const servo_cache_t * cache);
+
+/**@brief Drop cached values, dirty values are kept to be flushed.
+ *
+ * @param[in] cache  Pointer to the cache.
+ * @param[in] reason Invalidation reason passed to the invalidation callback.
+ */
+void servo_cache_invalidate(servo_cache_t * cache, servo_cache_invalidate_t reason);
+
+#endif
+
+/** @} */
@@ -1,14 +1,23 @@
 #include "servo_driver.h"
 #include "modbus/modbus_protocol.h"
 
-static modbus_callback_result_t bus_write(uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+#define SERVO_COMMAND_READ          (0x03)
+#define SERVO_COMMAND_WRITE_ONE     (0x06)
+#define SERVO_COMMAND_WRITE         (0x10)
+#define SERVO_COMMAND_READ_WRITE    (0x17)
+
+#if defined(__linux__)
+#include "serial/serial_linux.h"
+#include "serial/tcp_linux.h"
+#else
+static modbus_callback_result_t bus_write(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
 {
 #error Add your implementation
     
     return MODBUS_CALLBACK_RESULT_SUCCESS;
 }
 
-static modbus_callback_result_t bus_read(uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+static modbus_callback_result_t bus_read(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
 {
 #error Add your implementation
     
@@ -16,7 +25,7 @@ static modbus_callback_result_t bus_read(uint8_t * data, uint16_t data_length, u
 }
 
 #if (MODBUS_MODE_RTU)
-static void bus_idle(uint16_t data_length)
+static void bus_idle(void * user_data, uint16_t data_length)
 {
 #error Add your implementation
     
@@ -25,154 +34,515 @@ static void bus_idle(uint16_t data_length)
      * a duration of at least 3.5 bytes for a given baud rate. */
 }
 #endif
+#endif
 
-static modbus_params_t modbus_params = 
+/**@brief Build request PDU.
+ *
+ * @return PDU length in bytes.
+ */
+static uint16_t request_build(uint8_t * pdu, 
+                              uint8_t axis, 
+                              uint8_t command, 
+                              uint16_t address, 
+                              const uint16_t * words, 
+                              uint16_t words_num)
 {
-    .mode = MODBUS_MODE_RTU ? MODBUS_PROTOCOL_MODE_RTU : MODBUS_PROTOCOL_MODE_ASCII,
-    .write = bus_write,
-    .read = bus_read,
-#if (MODBUS_MODE_RTU)
-    .idle = bus_idle
-#else
-    .idle = NULL
-#endif
-};
+    pdu[0] = axis;
+    pdu[1] = command;
+    pdu[2] = (uint8_t)(address >> 8);
+    pdu[3] = (uint8_t)(address & 0xFF);
+    
+    if (command == SERVO_COMMAND_WRITE_ONE)
+    {
+        pdu[4] = (uint8_t)(words[0] >> 8);
+        pdu[5] = (uint8_t)(words[0] & 0xFF);
+        return 6;
+    }
+    
+    pdu[4] = (uint8_t)(words_num >> 8);
+    pdu[5] = (uint8_t)(words_num & 0xFF);
+    if (command == SERVO_COMMAND_READ)
+    {
+        return 6;
+    }
+    
+    pdu[6] = (uint8_t)(words_num * 2);
+    for (uint16_t i = 0; i < words_num; i++)
+    {
+        pdu[2 * i + 7] = (uint8_t)(words[i] >> 8);
+        pdu[2 * i + 8] = (uint8_t)(words[i] & 0xFF);
+    }
+    
+    return 2 * words_num + 7;
+}
 
-void servo_initialize(void)
+/**@brief Build read/write request PDU.
+ *
+ * @return PDU length in bytes.
+ */
+static uint16_t request_read_write_build(uint8_t * pdu, 
+                                         uint8_t axis, 
+                                         uint16_t read_address, 
+                                         uint16_t read_words_num, 
+                                         uint16_t write_address, 
+                                         const uint16_t * write_words, 
+                                         uint16_t write_words_num)
 {
-    modbus_protocol_initialize(&modbus_params);
+    pdu[0] = axis;
+    pdu[1] = SERVO_COMMAND_READ_WRITE;
+    pdu[2] = (uint8_t)(read_address >> 8);
+    pdu[3] = (uint8_t)(read_address & 0xFF);
+    pdu[4] = (uint8_t)(read_words_num >> 8);
+    pdu[5] = (uint8_t)(read_words_num & 0xFF);
+    pdu[6] = (uint8_t)(write_address >> 8);
+    pdu[7] = (uint8_t)(write_address & 0xFF);
+    pdu[8] = (uint8_t)(write_words_num >> 8);
+    pdu[9] = (uint8_t)(write_words_num & 0xFF);
+    pdu[10] = (uint8_t)(write_words_num * 2);
+    for (uint16_t i = 0; i < write_words_num; i++)
+    {
+        pdu[2 * i + 11] = (uint8_t)(write_words[i] >> 8);
+        pdu[2 * i + 12] = (uint8_t)(write_words[i] & 0xFF);
+    }
+    
+    return 2 * write_words_num + 11;
 }
 
-bool servo_nwords_read(uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num)
+/**@brief Get expected answer PDU length.
+ */
+static uint16_t answer_length(uint8_t command, uint16_t words_num)
 {
-    modbus_protocol_result_t protocol_result;
-    uint8_t servo_buffer[256] = { 0 };
+    return ((command == SERVO_COMMAND_READ) || (command == SERVO_COMMAND_READ_WRITE)) ? 2 * words_num + 3 : 6;
+}
+
+/**@brief Check if the exception answer belongs to the request.
+ */
+static modbus_protocol_result_t exception_check(modbus_protocol_result_t protocol_result, 
+                                                const uint8_t * pdu, 
+                                                uint8_t axis, 
+                                                uint8_t command)
+{
+    if ((protocol_result == MODBUS_PROTOCOL_RESULT_EXCEPTION) && 
+        ((pdu[0] != axis) || (pdu[1] != (command | 0x80))))
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
     
-    if ((axis < 1 || 127 < axis) || (words_num >= 30))
+    return protocol_result;
+}
+
+/**@brief Check answer PDU, store read words.
+ */
+static bool answer_parse(const uint8_t * pdu, 
+                         uint16_t pdu_length, 
+                         uint8_t axis, 
+                         uint8_t command, 
+                         uint16_t address, 
+                         uint16_t * words, 
+                         uint16_t words_num)
+{
+    uint8_t answer_axis = pdu[0];
+    uint8_t answer_command = pdu[1];
+    if ((answer_axis != axis) || (answer_command != command) || (pdu_length != answer_length(command, words_num)))
     {
         return false;
     }
     
-    servo_buffer[0] = axis;
-    servo_buffer[1] = 0x03;
-    servo_buffer[2] = (uint8_t)(address >> 8);
-    servo_buffer[3] = (uint8_t)(address & 0xFF);
-    servo_buffer[4] = (uint8_t)(words_num >> 8);
-    servo_buffer[5] = (uint8_t)(words_num & 0xFF);
+    if ((command == SERVO_COMMAND_READ) || (command == SERVO_COMMAND_READ_WRITE))
+    {
+        uint8_t answer_bytes_num = pdu[2];
+        if (answer_bytes_num != words_num * 2)
+        {
+            return false;
+        }
+        
+        for (uint16_t i = 0; i < words_num; i++)
+        {
+            words[i] = (pdu[2 * i + 3] << 8) | pdu[2 * i + 4];
+        }
+        
+        return true;
+    }
     
-    protocol_result = modbus_request_write(servo_buffer, 6);
-    if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+    uint16_t answer_address = (pdu[2] << 8) | pdu[3];
+    uint16_t answer_value = (pdu[4] << 8) | pdu[5];
+    uint16_t value = (command == SERVO_COMMAND_WRITE_ONE) ? words[0] : words_num;
+    if ((answer_address != address) || (answer_value != value))
     {
         return false;
     }
     
-    protocol_result = modbus_answer_read(servo_buffer, 2 * words_num + 3);
+    return true;
+}
+
+/**@brief Send request frame and read answer frame.
+ *
+ * @retval true if the answer is received (or not expected for broadcast request).
+ */
+static bool frame_transaction(modbus_ctx_t * ctx, modbus_frame_t * frame, uint8_t axis, uint8_t command, uint16_t words_num)
+{
+    modbus_protocol_result_t protocol_result;
+    const uint8_t * pdu = MODBUS_FRAME_PDU(frame);
+    
+    protocol_result = modbus_frame_transaction(ctx, frame, answer_length(command, words_num));
+    if (axis == MODBUS_ADDRESS_BROADCAST)
+    {
+        return (protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS);
+    }
+    
+    protocol_result = exception_check(protocol_result, pdu, axis, command);
+    ctx->result = protocol_result;
     if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
     {
+        if (protocol_result != MODBUS_PROTOCOL_RESULT_EXCEPTION)
+        {
+            ctx->exception = MODBUS_EXCEPTION_NONE;
+        }
         return false;
     }
     
-    uint8_t answer_axis = servo_buffer[0];
-    uint8_t answer_command = servo_buffer[1];
-    uint8_t answer_bytes_num = servo_buffer[2];
-    if ((answer_axis != axis) || (answer_command != 0x03) || (answer_bytes_num != words_num * 2))
+    return true;
+}
+
+/**@brief Perform transaction with servo.
+ */
+static bool transaction(modbus_ctx_t * ctx, 
+                        uint8_t axis, 
+                        uint8_t command, 
+                        uint16_t address, 
+                        uint16_t * words, 
+                        uint16_t words_num)
+{
+    uint8_t servo_buffer[SERVO_FRAME_SIZE];
+    modbus_frame_t frame = { .buffer = servo_buffer, .size = sizeof(servo_buffer) };
+    uint8_t * pdu = MODBUS_FRAME_PDU(&frame);
+    
+    frame.pdu_length = request_build(pdu, axis, command, address, words, words_num);
+    if (!frame_transaction(ctx, &frame, axis, command, words_num))
     {
         return false;
     }
     
-    for (uint16_t i = 0; i < words_num; i++)
+    if ((axis != MODBUS_ADDRESS_BROADCAST) && 
+        !answer_parse(pdu, frame.pdu_length, axis, command, address, words, words_num))
     {
-        words[i] = (servo_buffer[2 * i + 3] << 8) | servo_buffer[2 * i + 4];
+        ctx->result = MODBUS_PROTOCOL_RESULT_CORRUPTED;
+        return false;
     }
     
     return true;
 }
 
-bool servo_nwords_write(uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num)
+/**@brief Asynchronous transaction completion.
+ */
+static void transaction_complete(modbus_transaction_t * modbus_transaction, modbus_protocol_result_t protocol_result)
 {
-    modbus_protocol_result_t protocol_result;
-    uint8_t servo_buffer[256] = { 0 };
+    servo_transaction_t * transaction = (servo_transaction_t *)modbus_transaction->user_data;
+    const uint8_t * pdu = MODBUS_FRAME_PDU(&modbus_transaction->frame);
+    bool success = false;
     
-    if ((axis < 1 || 127 < axis) || (words_num >= 30))
+    protocol_result = exception_check(protocol_result, pdu, transaction->axis, transaction->command);
+    transaction->exception = (protocol_result == MODBUS_PROTOCOL_RESULT_EXCEPTION) ? 
+            (modbus_exception_t)pdu[2] : MODBUS_EXCEPTION_NONE;
+    
+    if ((protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS) && (transaction->axis == MODBUS_ADDRESS_BROADCAST))
     {
-        return false;
+        //Broadcast request is not answered
+        success = true;
     }
+    else if (protocol_result == MODBUS_PROTOCOL_RESULT_SUCCESS)
+    {
+        success = answer_parse(pdu, modbus_transaction->frame.pdu_length, transaction->axis, transaction->command, 
+                               transaction->address, transaction->words, transaction->words_num);
+        protocol_result = success ? protocol_result : MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    transaction->result = protocol_result;
+    
+    transaction->complete(transaction, success);
+}
+
+/**@brief Submit asynchronous transaction with servo.
+ */
+static bool transaction_submit(modbus_async_t * async, 
+                               servo_transaction_t * transaction, 
+                               uint8_t axis, 
+                               uint8_t command, 
+                               uint16_t address, 
+                               uint16_t * words, 
+                               uint16_t words_num, 
+                               servo_completion_callback_t complete, 
+                               void * user_data)
+{
+    modbus_transaction_t * modbus_transaction = &transaction->transaction;
     
-    servo_buffer[0] = axis;
-    servo_buffer[1] = 0x10;
-    servo_buffer[2] = (uint8_t)(address >> 8);
-    servo_buffer[3] = (uint8_t)(address & 0xFF);
-    servo_buffer[4] = (uint8_t)(words_num >> 8);
-    servo_buffer[5] = (uint8_t)(words_num & 0xFF);
-    servo_buffer[6] = (uint8_t)(words_num * 2);
+    transaction->axis = axis;
+    transaction->command = command;
+    transaction->address = address;
+    transaction->words = words;
+    transaction->words_num = words_num;
+    transaction->exception = MODBUS_EXCEPTION_NONE;
+    transaction->result = MODBUS_PROTOCOL_RESULT_SUCCESS;
+    transaction->complete = complete;
+    transaction->user_data = user_data;
     
-    for (uint16_t i = 0; i < words_num; i++)
+    modbus_transaction->frame.buffer = transaction->buffer;
+    modbus_transaction->frame.size = sizeof(transaction->buffer);
+    modbus_transaction->frame.pdu_length = request_build(MODBUS_FRAME_PDU(&modbus_transaction->frame), 
+                                                         axis, command, address, words, words_num);
+    modbus_transaction->answer_length = answer_length(command, words_num);
+    modbus_transaction->complete = transaction_complete;
+    modbus_transaction->user_data = transaction;
+    
+    return modbus_async_submit(async, modbus_transaction);
+}
+
+void servo_initialize(modbus_ctx_t * ctx, void * bus)
+{
+    const modbus_params_t modbus_params = 
+    {
+        .mode = SERVO_MODBUS_MODE,
+#if defined(__linux__)
+        .write = serial_port_write,
+        .read = serial_port_read,
+        .idle = serial_port_idle,
+        .writev = serial_port_writev,
+        .receive = serial_port_receive,
+        .delay = serial_port_delay,
+        .clock = serial_port_clock,
+        .baud_rate = ((serial_port_t *)bus)->baud_rate,
+#else
+        .write = bus_write,
+        .read = bus_read,
+#if (MODBUS_MODE_RTU)
+        .idle = bus_idle,
+#else
+        .idle = NULL,
+#endif
+        .writev = NULL,
+        .receive = NULL,
+        .delay = NULL,
+        .clock = NULL,
+        .baud_rate = 0,
+#endif
+        .user_data = bus,
+        .timeout_ms = MODBUS_PROTOCOL_BUS_TIMEOUT_MS,
+        .retries = SERVO_RETRIES
+    };
+    
+    modbus_protocol_initialize(ctx, &modbus_params);
+}
+
+#if defined(__linux__)
+void servo_tcp_initialize(modbus_ctx_t * ctx, void * client, modbus_mode_t mode)
+{
+    const modbus_params_t modbus_params = 
+    {
+        .mode = mode,
+        .write = tcp_client_write,
+        .read = tcp_client_read,
+        .idle = NULL,
+        .writev = tcp_client_writev,
+        .receive = tcp_client_receive,
+        .delay = tcp_client_delay,
+        .clock = tcp_client_clock,
+        .baud_rate = 0,
+        .user_data = client,
+        .timeout_ms = MODBUS_PROTOCOL_BUS_TIMEOUT_MS,
+        .retries = SERVO_RETRIES
+    };
+    
+    modbus_protocol_initialize(ctx, &modbus_params);
+}
+#endif
+
+modbus_exception_t servo_exception_get(const modbus_ctx_t * ctx)
+{
+    return ctx->exception;
+}
+
+modbus_protocol_result_t servo_result_get(const modbus_ctx_t * ctx)
+{
+    return ctx->result;
+}
+
+bool servo_nwords_read(modbus_ctx_t * ctx, uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num)
+{
+    if ((axis < 1 || 127 < axis) || (words_num > SERVO_READ_WORDS_MAX))
     {
-        servo_buffer[2 * i + 7] = (uint8_t)(words[i] >> 8);
-        servo_buffer[2 * i + 8] = (uint8_t)(words[i] & 0xFF);
+        return false;
     }
     
-    protocol_result = modbus_request_write(servo_buffer, 2 * words_num + 7);
-    if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+    return transaction(ctx, axis, SERVO_COMMAND_READ, address, words, words_num);
+}
+
+bool servo_nwords_write(modbus_ctx_t * ctx, uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num)
+{
+    if ((127 < axis) || (words_num > SERVO_WRITE_WORDS_MAX))
     {
         return false;
     }
     
-    protocol_result = modbus_answer_read(servo_buffer, 6);
-    if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+    return transaction(ctx, axis, SERVO_COMMAND_WRITE, address, words, words_num);
+}
+
+bool servo_oneword_write(modbus_ctx_t * ctx, uint8_t axis, uint16_t address, uint16_t word)
+{
+    if (127 < axis)
     {
         return false;
     }
     
-    uint8_t answer_axis = servo_buffer[0];
-    uint8_t answer_command = servo_buffer[1];
-    uint16_t answer_address = (servo_buffer[2] << 8) | servo_buffer[3];
-    uint16_t answer_words_num = (servo_buffer[4] << 8) | servo_buffer[5];
-    if ((answer_axis != axis) || (answer_command != 0x10) || (answer_address != address) || (answer_words_num != words_num))
+    return transaction(ctx, axis, SERVO_COMMAND_WRITE_ONE, address, &word, 1);
+}
+
+bool servo_nwords_read_write(modbus_ctx_t * ctx, 
+                             uint8_t axis, 
+                             uint16_t read_address, 
+                             uint16_t * read_words, 
+                             uint16_t read_words_num, 
+                             uint16_t write_address, 
+                             uint16_t * write_words, 
+                             uint16_t write_words_num)
+{
+    if ((axis < 1 || 127 < axis) || 
+        (read_words_num < 1) || (read_words_num > SERVO_READ_WORDS_MAX) || 
+        (write_words_num < 1) || (write_words_num > SERVO_READ_WRITE_WORDS_MAX))
     {
         return false;
     }
     
-    return true;
+    modbus_unit_t * const unit = &ctx->units[axis];
+    if (!(unit->flags & MODBUS_UNIT_FLAG_NO_READ_WRITE))
+    {
+        uint8_t servo_buffer[SERVO_FRAME_SIZE];
+        modbus_frame_t frame = { .buffer = servo_buffer, .size = sizeof(servo_buffer) };
+        uint8_t * pdu = MODBUS_FRAME_PDU(&frame);
+        
+        frame.pdu_length = request_read_write_build(pdu, axis, read_address, read_words_num, 
+                                                    write_address, write_words, write_words_num);
+        if (frame_transaction(ctx, &frame, axis, SERVO_COMMAND_READ_WRITE, read_words_num))
+        {
+            if (!answer_parse(pdu, frame.pdu_length, axis, SERVO_COMMAND_READ_WRITE, 
+                              read_address, read_words, read_words_num))
+            {
+                ctx->result = MODBUS_PROTOCOL_RESULT_CORRUPTED;
+                return false;
+            }
+            return true;
+        }
+        
+        if (ctx->exception != MODBUS_EXCEPTION_ILLEGAL_FUNCTION)
+        {
+            return false;
+        }
+        
+        //Servo doesn't support the function, don't try it again
+        unit->flags |= MODBUS_UNIT_FLAG_NO_READ_WRITE;
+    }
+    
+    //Write is performed before read, as by the combined request
+    return servo_nwords_write(ctx, axis, write_address, write_words, write_words_num) && 
+           servo_nwords_read(ctx, axis, read_address, read_words, read_words_num);
 }
 
-bool servo_oneword_write(uint8_t axis, uint16_t address, uint16_t word)
+bool servo_block_read(modbus_ctx_t * ctx, 
+                      uint8_t axis, 
+                      uint16_t address, 
+                      uint16_t * words, 
+                      uint32_t words_num, 
+                      uint32_t * done)
 {
-    modbus_protocol_result_t protocol_result;
-    uint8_t servo_buffer[256] = { 0 };
+    uint32_t pos = 0;
+    bool success = ((uint32_t)address + words_num <= 0x10000);
     
-    if (axis < 1 || 127 < axis)
+    while (success && (pos < words_num))
     {
-        return false;
+        const uint16_t num = (words_num - pos > SERVO_READ_WORDS_MAX) ? SERVO_READ_WORDS_MAX : (uint16_t)(words_num - pos);
+        success = servo_nwords_read(ctx, axis, (uint16_t)(address + pos), &words[pos], num);
+        pos += success ? num : 0;
+    }
+    
+    if (done != NULL)
+    {
+        *done = pos;
     }
     
-    servo_buffer[0] = axis;
-    servo_buffer[1] = 0x06;
-    servo_buffer[2] = (uint8_t)(address >> 8);
-    servo_buffer[3] = (uint8_t)(address & 0xFF);
-    servo_buffer[4] = (uint8_t)(word >> 8);
-    servo_buffer[5] = (uint8_t)(word & 0xFF);
+    return success;
+}
+
+bool servo_block_write(modbus_ctx_t * ctx, 
+                       uint8_t axis, 
+                       uint16_t address, 
+                       uint16_t * words, 
+                       uint32_t words_num, 
+                       uint32_t * done)
+{
+    uint32_t pos = 0;
+    bool success = ((uint32_t)address + words_num <= 0x10000);
     
-    protocol_result = modbus_request_write(servo_buffer, 6);
-    if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+    while (success && (pos < words_num))
+    {
+        const uint16_t num = (words_num - pos > SERVO_WRITE_WORDS_MAX) ? SERVO_WRITE_WORDS_MAX : (uint16_t)(words_num - pos);
+        success = servo_nwords_write(ctx, axis, (uint16_t)(address + pos), &words[pos], num);
+        pos += success ? num : 0;
+    }
+    
+    if (done != NULL)
+    {
+        *done = pos;
+    }
+    
+    return success;
+}
+
+bool servo_nwords_read_submit(modbus_async_t * async, 
+                              servo_transaction_t * transaction, 
+                              uint8_t axis, 
+                              uint16_t address, 
+                              uint16_t * words, 
+                              uint16_t words_num, 
+                              servo_completion_callback_t complete, 
+                              void * user_data)
+{
+    if ((axis < 1 || 127 < axis) || (words_num > SERVO_READ_WORDS_MAX))
     {
         return false;
     }
     
-    protocol_result = modbus_answer_read(servo_buffer, 6);
-    if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+    return transaction_submit(async, transaction, axis, SERVO_COMMAND_READ, address, words, words_num, complete, user_data);
+}
+
+bool servo_nwords_write_submit(modbus_async_t * async, 
+                               servo_transaction_t * transaction, 
+                               uint8_t axis, 
+                               uint16_t address, 
+                               uint16_t * words, 
+                               uint16_t words_num, 
+                               servo_completion_callback_t complete, 
+                               void * user_data)
+{
+    if ((127 < axis) || (words_num > SERVO_WRITE_WORDS_MAX))
     {
         return false;
     }
     
-    uint8_t answer_axis = servo_buffer[0];
-    uint8_t answer_command = servo_buffer[1];
-    uint16_t answer_address = (servo_buffer[2] << 8) | servo_buffer[3];
-    uint16_t answer_word = (servo_buffer[4] << 8) | servo_buffer[5];
-    if ((answer_axis != axis) || (answer_command != 0x06) || (answer_address != address) || (answer_word != word))
+    return transaction_submit(async, transaction, axis, SERVO_COMMAND_WRITE, address, words, words_num, complete, user_data);
+}
+
+bool servo_oneword_write_submit(modbus_async_t * async, 
+                                servo_transaction_t * transaction, 
+                                uint8_t axis, 
+                                uint16_t address, 
+                                uint16_t word, 
+                                servo_completion_callback_t complete, 
+                                void * user_data)
+{
+    if (127 < axis)
     {
         return false;
     }
     
-    return true;
+    transaction->word = word;
+    
+    return transaction_submit(async, transaction, axis, SERVO_COMMAND_WRITE_ONE, address, &transaction->word, 1, complete, user_data);
 }
@@ -3,11 +3,27 @@
  *
  * @brief Basic driver for communicating with EPS-B1 series servo using Modbus protocol
  *
- * It is intended only to demonstrate interaction with the servo. To make this example work:
+ * It is intended only to demonstrate interaction with the servo. On Linux the bus callbacks are provided 
+ * by the serial port backend (@see serial_linux), pass the opened serial port to servo_initialize(). 
+ * On other platforms, to make this example work:
  * - add implementation of the read/write bus callbacks (see functions bus_read() and bus_write());
  * - if Modbus RTU mode is used, then add implementation of the idle bus callback (bus_idle).
  *
- * You can change the Modbus mode using the MODBUS_MODE_RTU flag (true - RTU mode is used, otherwise - ASCII).
+ * You can change the Modbus mode using the MODBUS_MODE_RTU flag (true - RTU mode is used, otherwise - ASCII). 
+ * Frame storage is sized for the largest frame of the mode, so serial contexts used with the driver must be 
+ * in the same mode. Servos behind a Modbus TCP server or a serial gateway are reached over TCP in any build 
+ * (@see servo_tcp_initialize()), asynchronous transactions are pipelined on the connection in MODBUS_PROTOCOL_MODE_TCP.
+ *
+ * Every function takes the modbus context of the bus the servo is connected to, so servos on several 
+ * buses can be driven independently (contexts may be initialized by modbus_protocol_initialize() 
+ * with bus-specific parameters).
+ *
+ * Writes to MODBUS_ADDRESS_BROADCAST update all servos on the bus by one request. Broadcast requests 
+ * are not answered, so their success means only that the request was sent (@see servo_broadcast 
+ * to verify the servos afterwards).
+ *
+ * Failed functions return false, the cause is given by servo_result_get(). Transaction counters and 
+ * latency histograms of the bus and of every servo are recorded after modbus_metrics_attach().
  *
  * @{
  */
@@ -18,44 +34,239 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include "modbus/modbus_protocol.h"
+#include "modbus/modbus_async.h"
+
+#define MODBUS_MODE_RTU             (false)
+#define SERVO_MODBUS_MODE           (MODBUS_MODE_RTU ? MODBUS_PROTOCOL_MODE_RTU : MODBUS_PROTOCOL_MODE_ASCII)
 
-#define MODBUS_MODE_RTU   (false)
+#define SERVO_READ_WORDS_MAX        (125)   /**< Maximum words number of one read request. */
+#define SERVO_WRITE_WORDS_MAX       (123)   /**< Maximum words number of one write request. */
+#define SERVO_READ_WRITE_WORDS_MAX  (121)   /**< Maximum write words number of one read/write request. */
+#define SERVO_FRAME_SIZE            MODBUS_FRAME_MODE_SIZE(SERVO_MODBUS_MODE, MODBUS_PDU_LENGTH_MAX)
+#define SERVO_RETRIES               (2)     /**< Number of retries of a request left without valid answer. */
+
+typedef struct servo_transaction_s servo_transaction_t;
+
+/**@brief Servo transaction completion callback.
+ *
+ * @param[in] transaction Pointer to the completed transaction.
+ * @param[in] success     true if successful, otherwise false (result and exception code are available in the transaction).
+ */
+typedef void (*servo_completion_callback_t)(servo_transaction_t * transaction, bool success);
+
+/**@brief Asynchronous servo transaction. Owned by the caller until completion. */
+struct servo_transaction_s
+{
+    modbus_transaction_t transaction;                   /**< Modbus transaction (internal). */
+    uint8_t buffer[SERVO_FRAME_SIZE];                   /**< Frame storage (internal). */
+    uint8_t axis;                                       /**< Communication address. */
+    uint8_t command;                                    /**< Function code. */
+    uint16_t address;                                   /**< Starting address. */
+    uint16_t * words;                                   /**< Pointer to read or write words. */
+    uint16_t words_num;                                 /**< Words number. */
+    uint16_t word;                                      /**< Write word (servo_oneword_write_submit()). */
+    modbus_exception_t exception;                       /**< Exception code if the request was rejected by servo. */
+    modbus_protocol_result_t result;                    /**< Result of the transaction, @see servo_result_get(). */
+    servo_completion_callback_t complete;               /**< Completion callback. */
+    void * user_data;                                   /**< User data of the transaction. */
+};
 
 /**@brief Initialize servo driver.
-*/
-void servo_initialize(void);
+ *
+ * @param[out] ctx Pointer to the modbus context to initialize with the driver bus callbacks.
+ * @param[in]  bus User data of the bus callbacks (pointer to the opened serial_port_t on Linux).
+ */
+void servo_initialize(modbus_ctx_t * ctx, void * bus);
+
+#if defined(__linux__)
+/**@brief Initialize servo driver for a TCP connection (@see tcp_linux).
+ *
+ * @param[out] ctx    Pointer to the modbus context to initialize with the TCP bus callbacks.
+ * @param[in]  client Pointer to the connected tcp_client_t.
+ * @param[in]  mode   MODBUS_PROTOCOL_MODE_TCP or MODBUS_PROTOCOL_MODE_RTU_OVER_TCP.
+ */
+void servo_tcp_initialize(modbus_ctx_t * ctx, void * client, modbus_mode_t mode);
+#endif
+
+/**@brief Get exception code of the last request.
+ *
+ * @param[in] ctx Pointer to the modbus context.
+ *
+ * @retval MODBUS_EXCEPTION_NONE if the last request was not rejected by servo, otherwise exception code.
+ */
+modbus_exception_t servo_exception_get(const modbus_ctx_t * ctx);
+
+/**@brief Get result of the last request, tells the cause of a failure.
+ *
+ * @param[in] ctx Pointer to the modbus context.
+ *
+ * @retval MODBUS_PROTOCOL_RESULT_SUCCESS   Request was successfully completed.
+ * @retval MODBUS_PROTOCOL_RESULT_EXCEPTION Request was rejected by servo, @see servo_exception_get().
+ * @retval MODBUS_PROTOCOL_RESULT_CORRUPTED Answer was corrupted or does not match the request.
+ * @retval protocol_result                  Otherwise, @see modbus_protocol_result_t.
+ */
+modbus_protocol_result_t servo_result_get(const modbus_ctx_t * ctx);
 
 /**@brief Read N words from servo.
  *
+ * @param[in]  ctx       Pointer to the modbus context.
  * @param[in]  axis      Communication address (1-127).
  * @param[in]  address   Starting address.
  * @param[out] words     Pointer to read words.
- * @param[in]  words_num Words number (0-29).
+ * @param[in]  words_num Words number (0-125).
  *
- * @retval true if successful, otherwise false.
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
  */
-bool servo_nwords_read(uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num);
+bool servo_nwords_read(modbus_ctx_t * ctx, uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num);
 
 /**@brief Write N words to servo.
  *
- * @param[in] axis      Communication address (1-127).
+ * @param[in] ctx       Pointer to the modbus context.
+ * @param[in] axis      Communication address (1-127, MODBUS_ADDRESS_BROADCAST for all servos).
  * @param[in] address   Starting address.
  * @param[in] words     Pointer to write words.
- * @param[in] words_num Words number (0-29).
+ * @param[in] words_num Words number (0-123).
  *
- * @retval true if successful, otherwise false.
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
  */
-bool servo_nwords_write(uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num);
+bool servo_nwords_write(modbus_ctx_t * ctx, uint8_t axis, uint16_t address, uint16_t * words, uint16_t words_num);
 
 /**@brief Write 1 word to servo.
  *
- * @param[in] axis    Communication address (1-127).
+ * @param[in] ctx     Pointer to the modbus context.
+ * @param[in] axis    Communication address (1-127, MODBUS_ADDRESS_BROADCAST for all servos).
  * @param[in] address Starting address.
  * @param[in] word    Write word.
  * 
- * @retval true if successful, otherwise false.
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
+ */
+bool servo_oneword_write(modbus_ctx_t * ctx, uint8_t axis, uint16_t address, uint16_t word);
+
+/**@brief Write N words to servo and read N words from servo by one request (Read/Write Multiple Registers).
+ *
+ * Write is performed before read. If the servo doesn't support the request, it is remembered for the axis 
+ * in the modbus context and the words are transferred by separate write and read requests.
+ *
+ * @param[in]  ctx             Pointer to the modbus context.
+ * @param[in]  axis            Communication address (1-127).
+ * @param[in]  read_address    Starting address to read.
+ * @param[out] read_words      Pointer to read words.
+ * @param[in]  read_words_num  Read words number (1-125).
+ * @param[in]  write_address   Starting address to write.
+ * @param[in]  write_words     Pointer to write words.
+ * @param[in]  write_words_num Write words number (1-121).
+ *
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
+ */
+bool servo_nwords_read_write(modbus_ctx_t * ctx, 
+                             uint8_t axis, 
+                             uint16_t read_address, 
+                             uint16_t * read_words, 
+                             uint16_t read_words_num, 
+                             uint16_t write_address, 
+                             uint16_t * write_words, 
+                             uint16_t write_words_num);
+
+/**@brief Read any number of words from servo, split into requests of up to SERVO_READ_WORDS_MAX words.
+ *
+ * @param[in]  ctx       Pointer to the modbus context.
+ * @param[in]  axis      Communication address (1-127).
+ * @param[in]  address   Starting address.
+ * @param[out] words     Pointer to read words.
+ * @param[in]  words_num Words number.
+ * @param[out] done      Pointer to store the number of read words (may be NULL).
+ *
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
+ */
+bool servo_block_read(modbus_ctx_t * ctx, 
+                      uint8_t axis, 
+                      uint16_t address, 
+                      uint16_t * words, 
+                      uint32_t words_num, 
+                      uint32_t * done);
+
+/**@brief Write any number of words to servo, split into requests of up to SERVO_WRITE_WORDS_MAX words.
+ *
+ * @param[in]  ctx       Pointer to the modbus context.
+ * @param[in]  axis      Communication address (1-127, MODBUS_ADDRESS_BROADCAST for all servos).
+ * @param[in]  address   Starting address.
+ * @param[in]  words     Pointer to write words.
+ * @param[in]  words_num Words number.
+ * @param[out] done      Pointer to store the number of written words (may be NULL).
+ *
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get()).
+ */
+bool servo_block_write(modbus_ctx_t * ctx, 
+                       uint8_t axis, 
+                       uint16_t address, 
+                       uint16_t * words, 
+                       uint32_t words_num, 
+                       uint32_t * done);
+
+/**@brief Submit asynchronous read of N words from servo. @see servo_nwords_read.
+ *
+ * @param[in]  async       Pointer to the asynchronous transactions queue of the bus.
+ * @param[in]  transaction Pointer to the transaction.
+ * @param[in]  axis        Communication address (1-127).
+ * @param[in]  address     Starting address.
+ * @param[out] words       Pointer to read words, valid after completion.
+ * @param[in]  words_num   Words number (0-125).
+ * @param[in]  complete    Completion callback.
+ * @param[in]  user_data   User data of the transaction.
+ *
+ * @retval true if submitted, otherwise false.
+ */
+bool servo_nwords_read_submit(modbus_async_t * async, 
+                              servo_transaction_t * transaction, 
+                              uint8_t axis, 
+                              uint16_t address, 
+                              uint16_t * words, 
+                              uint16_t words_num, 
+                              servo_completion_callback_t complete, 
+                              void * user_data);
+
+/**@brief Submit asynchronous write of N words to servo. @see servo_nwords_write.
+ *
+ * @param[in] async       Pointer to the asynchronous transactions queue of the bus.
+ * @param[in] transaction Pointer to the transaction.
+ * @param[in] axis        Communication address (1-127, MODBUS_ADDRESS_BROADCAST for all servos).
+ * @param[in] address     Starting address.
+ * @param[in] words       Pointer to write words, must be valid until completion.
+ * @param[in] words_num   Words number (0-123).
+ * @param[in] complete    Completion callback.
+ * @param[in] user_data   User data of the transaction.
+ *
+ * @retval true if submitted, otherwise false.
+ */
+bool servo_nwords_write_submit(modbus_async_t * async, 
+                               servo_transaction_t * transaction, 
+                               uint8_t axis, 
+                               uint16_t address, 
+                               uint16_t * words, 
+                               uint16_t words_num, 
+                               servo_completion_callback_t complete, 
+                               void * user_data);
+
+/**@brief Submit asynchronous write of 1 word to servo. @see servo_oneword_write.
+ *
+ * @param[in] async       Pointer to the asynchronous transactions queue of the bus.
+ * @param[in] transaction Pointer to the transaction.
+ * @param[in] axis        Communication address (1-127, MODBUS_ADDRESS_BROADCAST for all servos).
+ * @param[in] address     Starting address.
+ * @param[in] word        Write word.
+ * @param[in] complete    Completion callback.
+ * @param[in] user_data   User data of the transaction.
+ *
+ * @retval true if submitted, otherwise false.
  */
-bool servo_oneword_write(uint8_t axis, uint16_t address, uint16_t word);
+bool servo_oneword_write_submit(modbus_async_t * async, 
+                                servo_transaction_t * transaction, 
+                                uint8_t axis, 
+                                uint16_t address, 
+                                uint16_t word, 
+                                servo_completion_callback_t complete, 
+                                void * user_data);
 
 #endif
 
@@ -0,0 +1,161 @@
+#include "servo_plan.h"
+#include "servo_driver.h"
+
+#define PLAN_SILENCE_BITS        (39)         /**< RTU inter-frame silence: 3.5 characters of 11 bits. */
+#define PLAN_SILENCE_FIXED_NS    (1750000)    /**< RTU inter-frame silence above 19200 baud. */
+#define PLAN_SEGMENT_OVERHEAD    (40)         /**< IPv4 and TCP headers of a segment in bytes (network modes). */
+#define PLAN_BAUD_RATE_DEFAULT   (19200)      /**< Bit rate assumed for a serial line without baud rate. */
+#define PLAN_NETWORK_BIT_RATE    (100000000)  /**< Bit rate assumed for network modes (Fast Ethernet). */
+
+/**@brief Get number of bits required to transmit the frame with the PDU of given length. 
+ *        @see modbus_wire_time_us.
+ */
+static uint32_t frame_bits(modbus_mode_t mode, uint16_t pdu_length)
+{
+    switch (mode)
+    {
+        case MODBUS_PROTOCOL_MODE_ASCII:
+            return 10UL * (pdu_length * 2 + 5);
+            
+        case MODBUS_PROTOCOL_MODE_RTU:
+            return 11UL * (pdu_length + 2);
+            
+        case MODBUS_PROTOCOL_MODE_TCP:
+            //Every frame is a segment of its own (TCP_NODELAY)
+            return 8UL * (PLAN_SEGMENT_OVERHEAD + pdu_length + 6);
+            
+        default:
+            return 8UL * (PLAN_SEGMENT_OVERHEAD + pdu_length + 2);
+    }
+}
+
+/**@brief Get time in nanoseconds required to transmit the bits at the bit rate.
+ */
+static uint64_t bits_time_ns(uint32_t bits, uint32_t bit_rate)
+{
+    return (uint64_t)bits * 1000000000ULL / bit_rate;
+}
+
+/**@brief Get cost of the read request in nanoseconds on the bus.
+ */
+static uint64_t read_cost(modbus_mode_t mode, uint16_t words_num, uint32_t bit_rate, uint64_t overhead_ns)
+{
+    return overhead_ns + bits_time_ns(frame_bits(mode, 6) + frame_bits(mode, 3 + 2 * words_num), bit_rate);
+}
+
+bool servo_plan_compile(servo_plan_t * plan, 
+                        modbus_ctx_t * ctx, 
+                        uint8_t axis, 
+                        const servo_plan_item_t * items, 
+                        uint16_t items_num, 
+                        uint32_t turnaround_us)
+{
+    uint64_t cost[SERVO_PLAN_ITEMS_NUM + 1];
+    uint16_t start[SERVO_PLAN_ITEMS_NUM + 1];
+    
+    if (items_num > SERVO_PLAN_ITEMS_NUM)
+    {
+        return false;
+    }
+    
+    plan->ctx = ctx;
+    plan->axis = axis;
+    plan->items_num = items_num;
+    plan->reads_num = 0;
+    plan->words_num = 0;
+    
+    //Sort registers by address
+    for (uint16_t i = 0; i < items_num; i++)
+    {
+        uint16_t pos = i;
+        while ((pos > 0) && (plan->items[pos - 1].address > items[i].address))
+        {
+            plan->items[pos] = plan->items[pos - 1];
+            pos--;
+        }
+        plan->items[pos] = items[i];
+    }
+    
+    //Costs are times, so the turnaround counts even where the baud rate is unknown (network modes, unset baud rate)
+    const uint32_t bit_rate = MODBUS_MODE_NETWORK(ctx->mode) ? PLAN_NETWORK_BIT_RATE : 
+                              (ctx->baud_rate != 0) ? ctx->baud_rate : PLAN_BAUD_RATE_DEFAULT;
+    
+    //Request overhead besides the frames: turnaround and, in RTU mode, silence before the request and the answer
+    uint64_t overhead_ns = (uint64_t)turnaround_us * 1000;
+    if (ctx->mode == MODBUS_PROTOCOL_MODE_RTU)
+    {
+        overhead_ns += 2 * ((bit_rate > 19200) ? PLAN_SILENCE_FIXED_NS : bits_time_ns(PLAN_SILENCE_BITS, bit_rate));
+    }
+    
+    //cost[i] - minimal cost of reading the first i registers, start[i] - first register of the last request
+    cost[0] = 0;
+    for (uint16_t i = 1; i <= items_num; i++)
+    {
+        const uint16_t last = plan->items[i - 1].address;
+        cost[i] = UINT64_MAX;
+        
+        for (uint16_t j = i; j > 0; j--)
+        {
+            const uint32_t words_num = (uint32_t)last - plan->items[j - 1].address + 1;
+            if (words_num > SERVO_READ_WORDS_MAX)
+            {
+                break;
+            }
+            
+            const uint64_t candidate = cost[j - 1] + read_cost(ctx->mode, (uint16_t)words_num, bit_rate, overhead_ns);
+            if (candidate <= cost[i])
+            {
+                cost[i] = candidate;
+                start[i] = j - 1;
+            }
+        }
+    }
+    
+    //Restore requests from the last one
+    for (uint16_t i = items_num; i > 0; i = start[i])
+    {
+        plan->reads_num++;
+    }
+    
+    uint16_t read = plan->reads_num;
+    for (uint16_t i = items_num; i > 0; i = start[i])
+    {
+        servo_plan_read_t * r = &plan->reads[--read];
+        r->item_first = start[i];
+        r->items_num = i - start[i];
+        r->address = plan->items[start[i]].address;
+        r->words_num = plan->items[i - 1].address - r->address + 1;
+        plan->words_num += r->words_num;
+    }
+    
+    return true;
+}
+
+void servo_plan_scatter(const servo_plan_t * plan, uint16_t read, const uint16_t * words, void * data)
+{
+    const servo_plan_read_t * r = &plan->reads[read];
+    
+    for (uint16_t i = r->item_first; i < r->item_first + r->items_num; i++)
+    {
+        const servo_plan_item_t * item = &plan->items[i];
+        *(uint16_t *)((uint8_t *)data + item->offset) = words[item->address - r->address];
+    }
+}
+
+bool servo_plan_read(const servo_plan_t * plan, void * data)
+{
+    uint16_t words[SERVO_READ_WORDS_MAX];
+    
+    for (uint16_t i = 0; i < plan->reads_num; i++)
+    {
+        const servo_plan_read_t * r = &plan->reads[i];
+        if (!servo_nwords_read(plan->ctx, plan->axis, r->address, words, r->words_num))
+        {
+            return false;
+        }
+        
+        servo_plan_scatter(plan, i, words, data);
+    }
+    
+    return true;
+}
@@ -0,0 +1,112 @@
+/**
+ * @ingroup servo_driver
+ *
+ * @defgroup servo_plan Servo read plan
+ *
+ * @brief Reads a set of scattered servo registers with the minimal number of requests.
+ *
+ * The plan is compiled once from the list of registers and reused every poll cycle. Registers are 
+ * grouped into Read Holding Registers requests of up to SERVO_READ_WORDS_MAX words, the gap between 
+ * registers is read along if transmitting the extra words takes less time than the overhead of 
+ * another request (request frame, answer header, inter-frame silence or TCP/IP headers and servo turnaround). 
+ * The grouping minimizes the total time on the bus.
+ *
+ * Read words are scattered to the caller structure, every register is stored at its offset:
+ * @code
+ * typedef struct { uint16_t status; uint16_t speed; uint16_t torque; } monitor_t;
+ * static const servo_plan_item_t items[] = 
+ * {
+ *     { 0x0806, offsetof(monitor_t, status) },
+ *     { 0x0800, offsetof(monitor_t, speed) },
+ *     { 0x0812, offsetof(monitor_t, torque) }
+ * };
+ * servo_plan_compile(&plan, &ctx, 1, items, 3, 1000);
+ * ...
+ * servo_plan_read(&plan, &monitor);
+ * @endcode
+ *
+ * @{
+ */
+
+#ifndef _SERVO_PLAN_H_
+#define _SERVO_PLAN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "modbus/modbus_protocol.h"
+
+#define SERVO_PLAN_ITEMS_NUM    (64)                    /**< Maximum number of registers in the plan. */
+
+/**@brief Register to read. */
+typedef struct
+{
+    uint16_t address;                                   /**< Register address. */
+    uint16_t offset;                                    /**< Offset of the word in the caller structure. */
+} servo_plan_item_t;
+
+/**@brief Planned read request. */
+typedef struct
+{
+    uint16_t address;                                   /**< Starting address. */
+    uint16_t words_num;                                 /**< Words number. */
+    uint16_t item_first;                                /**< Index of the first register of the request. */
+    uint16_t items_num;                                 /**< Number of registers of the request. */
+} servo_plan_read_t;
+
+/**@brief Read plan of the servo. */
+typedef struct
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus. */
+    uint8_t axis;                                       /**< Communication address. */
+    servo_plan_item_t items[SERVO_PLAN_ITEMS_NUM];      /**< Registers sorted by address. */
+    uint16_t items_num;                                 /**< Number of registers. */
+    servo_plan_read_t reads[SERVO_PLAN_ITEMS_NUM];      /**< Read requests. */
+    uint16_t reads_num;                                 /**< Number of read requests. */
+    uint16_t words_num;                                 /**< Total number of words read, including the gaps. */
+} servo_plan_t;
+
+/**@brief Compile read plan.
+ *
+ * @param[out] plan          Pointer to the plan.
+ * @param[in]  ctx           Pointer to the modbus context of the bus (its mode and baud rate are used 
+ *                           to estimate the frame times, a context without baud rate is assumed 
+ *                           to run at 19200 baud).
+ * @param[in]  axis          Communication address (1-127).
+ * @param[in]  items         Pointer to the registers to read.
+ * @param[in]  items_num     Number of registers.
+ * @param[in]  turnaround_us Expected time between the request and the answer in microseconds.
+ *
+ * @retval true if compiled, false if there are too many registers.
+ */
+bool servo_plan_compile(servo_plan_t * plan, 
+                        modbus_ctx_t * ctx, 
+                        uint8_t axis, 
+                        const servo_plan_item_t * items, 
+                        uint16_t items_num, 
+                        uint32_t turnaround_us);
+
+/**@brief Read registers of the plan.
+ *
+ * @param[in]  plan Pointer to the plan.
+ * @param[out] data Pointer to the caller structure to store read words.
+ *
+ * @retval true if successful, otherwise false (exception code is available via servo_exception_get(), 
+ *         words of the failed and subsequent requests are not stored).
+ */
+bool servo_plan_read(const servo_plan_t * plan, void * data);
+
+/**@brief Store words read by the planned request to the caller structure.
+ *
+ * Used if the planned requests are issued by other means (e.g. servo_nwords_read_submit()).
+ *
+ * @param[in]  plan  Pointer to the plan.
+ * @param[in]  read  Index of the planned request.
+ * @param[in]  words Pointer to the read words.
+ * @param[out] data  Pointer to the caller structure.
+ */
+void servo_plan_scatter(const servo_plan_t * plan, uint16_t read, const uint16_t * words, void * data);
+
+#endif
+
+/** @} */
@@ -0,0 +1,230 @@
+#include "servo_scheduler.h"
+#include "servo_driver.h"
+
+/**@brief Rate-monotonic utilization bounds n(2^(1/n) - 1) in per mille, ln(2) for larger n.
+ */
+static const uint16_t utilization_bound[] = { 1000, 828, 779, 756, 743, 734, 728, 724, 720, 717 };
+#define SCHEDULER_BOUND_LIMIT    (693)
+
+/**@brief Get bus time of the read plan.
+ */
+static uint32_t plan_cost(const servo_scheduler_t * scheduler, const servo_plan_t * plan)
+{
+    const modbus_ctx_t * ctx = scheduler->ctx;
+    uint32_t silence_us = 0;
+    uint32_t cost_us = 0;
+    
+    if ((ctx->mode == MODBUS_PROTOCOL_MODE_RTU) && (ctx->baud_rate != 0))
+    {
+        //t3.5 before the request and before the answer, fixed for baud rates above 19200
+        silence_us = (ctx->baud_rate > 19200) ? 1750 : (uint32_t)((11 * 3500000ULL + ctx->baud_rate - 1) / ctx->baud_rate);
+    }
+    
+    for (uint16_t i = 0; i < plan->reads_num; i++)
+    {
+        cost_us += modbus_wire_time_us(ctx, 6) + 
+                   modbus_wire_time_us(ctx, 3 + 2 * plan->reads[i].words_num) + 
+                   2 * silence_us + scheduler->turnaround_us;
+    }
+    
+    return cost_us;
+}
+
+/**@brief Get current time from the clock of the bus.
+ */
+static uint32_t clock_get(const servo_scheduler_t * scheduler)
+{
+    return scheduler->ctx->clock(scheduler->ctx->user_data);
+}
+
+/**@brief Get utilization of the task in parts per million.
+ */
+static uint32_t task_utilization(const servo_scheduler_task_t * task, uint32_t cost_us)
+{
+    return (uint32_t)((uint64_t)cost_us * 1000000 / task->period_us);
+}
+
+bool servo_scheduler_initialize(servo_scheduler_t * scheduler, 
+                                modbus_ctx_t * ctx, 
+                                uint32_t turnaround_us)
+{
+    scheduler->ctx = ctx;
+    scheduler->turnaround_us = turnaround_us;
+    scheduler->tasks_num = 0;
+    
+    return (ctx->clock != NULL);
+}
+
+bool servo_scheduler_task_add(servo_scheduler_t * scheduler, 
+                              servo_scheduler_task_t * task, 
+                              const servo_plan_t * plan, 
+                              void * data, 
+                              uint32_t period_us, 
+                              servo_scheduler_callback_t complete, 
+                              void * user_data)
+{
+    if ((scheduler->tasks_num >= SERVO_SCHEDULER_TASKS_NUM) || (period_us == 0))
+    {
+        return false;
+    }
+    
+    task->plan = plan;
+    task->data = data;
+    task->period_us = period_us;
+    task->cost_us = plan_cost(scheduler, plan);
+    task->release_us = clock_get(scheduler);
+    task->stats = (servo_scheduler_stats_t){ 0 };
+    task->complete = complete;
+    task->user_data = user_data;
+    
+    //Keep the tasks in rate-monotonic order
+    uint8_t pos = scheduler->tasks_num++;
+    while ((pos > 0) && (scheduler->tasks[pos - 1]->period_us > period_us))
+    {
+        scheduler->tasks[pos] = scheduler->tasks[pos - 1];
+        pos--;
+    }
+    scheduler->tasks[pos] = task;
+    
+    return true;
+}
+
+servo_scheduler_feasibility_t servo_scheduler_check(const servo_scheduler_t * scheduler, uint32_t * utilization)
+{
+    servo_scheduler_feasibility_t feasibility = SERVO_SCHEDULER_FEASIBLE;
+    uint32_t total = 0;
+    
+    for (uint8_t i = 0; i < scheduler->tasks_num; i++)
+    {
+        const servo_scheduler_task_t * task = scheduler->tasks[i];
+        total += task_utilization(task, task->cost_us);
+        
+        //Request of a task with lower priority may be already on the bus when the task is released
+        uint32_t blocking_us = 0;
+        for (uint8_t j = i + 1; j < scheduler->tasks_num; j++)
+        {
+            if (scheduler->tasks[j]->cost_us > blocking_us)
+            {
+                blocking_us = scheduler->tasks[j]->cost_us;
+            }
+        }
+        
+        const uint32_t bound = (i < sizeof(utilization_bound) / sizeof(utilization_bound[0])) ? 
+                utilization_bound[i] : SCHEDULER_BOUND_LIMIT;
+        if (total + task_utilization(task, blocking_us) > bound * 1000UL)
+        {
+            feasibility = SERVO_SCHEDULER_UNGUARANTEED;
+        }
+    }
+    
+    if (total > 1000000)
+    {
+        feasibility = SERVO_SCHEDULER_OVERLOADED;
+    }
+    
+    if (utilization != NULL)
+    {
+        *utilization = (total + 999) / 1000;
+    }
+    
+    return feasibility;
+}
+
+void servo_scheduler_start(servo_scheduler_t * scheduler)
+{
+    const uint32_t now_us = clock_get(scheduler);
+    
+    for (uint8_t i = 0; i < scheduler->tasks_num; i++)
+    {
+        scheduler->tasks[i]->release_us = now_us;
+        scheduler->tasks[i]->stats = (servo_scheduler_stats_t){ 0 };
+    }
+}
+
+/**@brief Run the task and account its timing.
+ */
+static void task_run(servo_scheduler_t * scheduler, servo_scheduler_task_t * task, uint32_t start_us)
+{
+    const uint32_t jitter_us = start_us - task->release_us;
+    const bool success = servo_plan_read(task->plan, task->data);
+    const uint32_t end_us = clock_get(scheduler);
+    const uint32_t duration_us = end_us - start_us;
+    servo_scheduler_stats_t * stats = &task->stats;
+    
+    stats->runs++;
+    stats->failures += success ? 0 : 1;
+    stats->jitter_sum_us += jitter_us;
+    if (jitter_us > stats->jitter_max_us)
+    {
+        stats->jitter_max_us = jitter_us;
+    }
+    if (duration_us > stats->duration_max_us)
+    {
+        stats->duration_max_us = duration_us;
+    }
+    
+    //Deadline is the next release
+    const uint32_t elapsed_us = end_us - task->release_us;
+    if (elapsed_us > task->period_us)
+    {
+        stats->misses++;
+        
+        //Releases passed during the overrun are skipped
+        const uint32_t periods = elapsed_us / task->period_us;
+        stats->skipped += periods - 1;
+        task->release_us += periods * task->period_us;
+    }
+    else
+    {
+        task->release_us += task->period_us;
+    }
+    
+    if (task->complete != NULL)
+    {
+        task->complete(task, success);
+    }
+}
+
+uint32_t servo_scheduler_poll(servo_scheduler_t * scheduler)
+{
+    servo_scheduler_task_t * due = NULL;
+    uint32_t now_us = clock_get(scheduler);
+    
+    //Tasks are sorted by period, the earliest released wins among equal periods
+    for (uint8_t i = 0; i < scheduler->tasks_num; i++)
+    {
+        servo_scheduler_task_t * task = scheduler->tasks[i];
+        if ((int32_t)(now_us - task->release_us) < 0)
+        {
+            continue;
+        }
+        
+        if ((due == NULL) || 
+            ((task->period_us == due->period_us) && ((int32_t)(task->release_us - due->release_us) < 0)))
+        {
+            due = task;
+        }
+    }
+    
+    if (due != NULL)
+    {
+        task_run(scheduler, due, now_us);
+        now_us = clock_get(scheduler);
+    }
+    
+    uint32_t delay_us = UINT32_MAX;
+    for (uint8_t i = 0; i < scheduler->tasks_num; i++)
+    {
+        const int32_t remaining_us = (int32_t)(scheduler->tasks[i]->release_us - now_us);
+        if (remaining_us <= 0)
+        {
+            return 0;
+        }
+        if ((uint32_t)remaining_us < delay_us)
+        {
+            delay_us = (uint32_t)remaining_us;
+        }
+    }
+    
+    return delay_us;
+}
@@ -0,0 +1,139 @@
+/**
+ * @ingroup servo_driver
+ *
+ * @defgroup servo_scheduler Servo polling scheduler
+ *
+ * @brief Cyclic multi-rate polling of servo register groups on one bus.
+ *
+ * Every task reads a register group of one servo (@see servo_plan) with its own period. The bus time 
+ * of every task is computed from the planned requests: request and answer frames at the bus baud rate 
+ * (ASCII characters take twice as many as RTU bytes), inter-frame silence in RTU mode and the servo 
+ * turnaround. Tasks are served rate-monotonically: the due task with the shortest period first, due 
+ * tasks with equal periods in release order, which makes them round-robin across axes.
+ *
+ * Schedulability is checked up front by the bus utilization, including blocking by a longer task 
+ * (requests are not preemptible). At runtime the start jitter and deadline misses (task not completed 
+ * within its period) are measured for every task.
+ *
+ * @{
+ */
+
+#ifndef _SERVO_SCHEDULER_H_
+#define _SERVO_SCHEDULER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+#include "servo_plan.h"
+
+#define SERVO_SCHEDULER_TASKS_NUM    (32)               /**< Maximum number of tasks. */
+
+typedef struct servo_scheduler_task_s servo_scheduler_task_t;
+
+/**@brief Task completion callback.
+ *
+ * @param[in] task    Pointer to the completed task.
+ * @param[in] success true if all the registers are read, otherwise false.
+ */
+typedef void (*servo_scheduler_callback_t)(servo_scheduler_task_t * task, bool success);
+
+/**@brief Schedulability of the tasks. */
+typedef enum
+{
+    SERVO_SCHEDULER_FEASIBLE,                           /**< All deadlines are guaranteed (rate-monotonic bound). */
+    SERVO_SCHEDULER_UNGUARANTEED,                       /**< Bus capacity is sufficient, but deadlines may be missed. */
+    SERVO_SCHEDULER_OVERLOADED                          /**< Requested rates exceed bus capacity. */
+} servo_scheduler_feasibility_t;
+
+/**@brief Task statistics. */
+typedef struct
+{
+    uint32_t runs;                                      /**< Number of runs. */
+    uint32_t failures;                                  /**< Number of runs with communication errors or exceptions. */
+    uint32_t misses;                                    /**< Number of deadline misses. */
+    uint32_t skipped;                                   /**< Number of releases skipped because of overrun. */
+    uint32_t jitter_max_us;                             /**< Maximum delay of the start after the release. */
+    uint64_t jitter_sum_us;                             /**< Sum of the start delays (average = sum / runs). */
+    uint32_t duration_max_us;                           /**< Maximum run duration. */
+} servo_scheduler_stats_t;
+
+/**@brief Polling task. Owned by the caller. */
+struct servo_scheduler_task_s
+{
+    const servo_plan_t * plan;                          /**< Read plan of the register group. */
+    void * data;                                        /**< Caller structure to store read words. */
+    uint32_t period_us;                                 /**< Target period. */
+    uint32_t cost_us;                                   /**< Bus time of one run (computed). */
+    uint32_t release_us;                                /**< Time of the next release (internal). */
+    servo_scheduler_stats_t stats;                      /**< Statistics. */
+    servo_scheduler_callback_t complete;                /**< Completion callback (may be NULL). */
+    void * user_data;                                   /**< User data of the task. */
+};
+
+/**@brief Polling scheduler of the bus. */
+typedef struct
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus, its clock times the tasks. */
+    uint32_t turnaround_us;                             /**< Expected servo turnaround. */
+    servo_scheduler_task_t * tasks[SERVO_SCHEDULER_TASKS_NUM];  /**< Tasks. */
+    uint8_t tasks_num;                                  /**< Number of tasks. */
+} servo_scheduler_t;
+
+/**@brief Initialize scheduler with no tasks.
+ *
+ * @param[out] scheduler     Pointer to the scheduler.
+ * @param[in]  ctx           Pointer to the modbus context of the bus (the clock callback is required).
+ * @param[in]  turnaround_us Expected time between the request and the answer in microseconds.
+ *
+ * @retval true if initialized, false if the modbus context has no clock callback.
+ */
+bool servo_scheduler_initialize(servo_scheduler_t * scheduler, 
+                                modbus_ctx_t * ctx, 
+                                uint32_t turnaround_us);
+
+/**@brief Add polling task.
+ *
+ * @param[in] scheduler Pointer to the scheduler.
+ * @param[in] task      Pointer to the task.
+ * @param[in] plan      Read plan of the register group (compiled for the same bus).
+ * @param[in] data      Caller structure to store read words.
+ * @param[in] period_us Target period in microseconds.
+ * @param[in] complete  Completion callback (may be NULL).
+ * @param[in] user_data User data of the task.
+ *
+ * @retval true if added, false if there are too many tasks or the period is 0.
+ */
+bool servo_scheduler_task_add(servo_scheduler_t * scheduler, 
+                              servo_scheduler_task_t * task, 
+                              const servo_plan_t * plan, 
+                              void * data, 
+                              uint32_t period_us, 
+                              servo_scheduler_callback_t complete, 
+                              void * user_data);
+
+/**@brief Check if the tasks can be served on the bus.
+ *
+ * @param[in]  scheduler   Pointer to the scheduler.
+ * @param[out] utilization Pointer to store the bus utilization in per mille (may be NULL).
+ *
+ * @return Schedulability of the tasks.
+ */
+servo_scheduler_feasibility_t servo_scheduler_check(const servo_scheduler_t * scheduler, uint32_t * utilization);
+
+/**@brief Release all tasks at the current time and reset their statistics.
+ *
+ * @param[in] scheduler Pointer to the scheduler.
+ */
+void servo_scheduler_start(servo_scheduler_t * scheduler);
+
+/**@brief Run the most urgent due task, if any.
+ *
+ * @param[in] scheduler Pointer to the scheduler.
+ *
+ * @return Time until the next release in microseconds, 0 if there are more due tasks.
+ */
+uint32_t servo_scheduler_poll(servo_scheduler_t * scheduler);
+
+#endif
+
+/** @} */
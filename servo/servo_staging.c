@@ -0,0 +1,226 @@
+#include "servo_staging.h"
+#include "servo_driver.h"
+
+/**@brief Find staged write.
+ *
+ * @return Index of the write with the address or of the first write with a greater address.
+ */
+static uint16_t write_find(const servo_staging_t * staging, uint16_t address)
+{
+    uint16_t low = 0;
+    uint16_t high = staging->writes_num;
+    
+    while (low < high)
+    {
+        const uint16_t middle = (low + high) / 2;
+        if (staging->writes[middle].address < address)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    
+    return low;
+}
+
+/**@brief Check if the gap between the staged writes can be filled with the cached values.
+ */
+static bool gap_fillable(servo_staging_t * staging, uint16_t address, uint16_t count, uint32_t now_ms)
+{
+    uint16_t word;
+    
+    if (count == 0)
+    {
+        return true;
+    }
+    
+    if ((staging->cache == NULL) || (count > staging->gap_max))
+    {
+        return false;
+    }
+    
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (!servo_cache_word_get(staging->cache, address + i, &word, now_ms))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**@brief Store result of the written writes.
+ */
+static void writes_complete(servo_staging_t * staging, uint16_t first, uint16_t last, bool success)
+{
+    const modbus_exception_t exception = success ? MODBUS_EXCEPTION_NONE : servo_exception_get(staging->ctx);
+    
+    for (uint16_t i = first; i < last; i++)
+    {
+        staging->writes[i].exception = exception;
+        staging->writes[i].result = success ? SERVO_STAGING_RESULT_SUCCESS : 
+                                    (exception != MODBUS_EXCEPTION_NONE) ? SERVO_STAGING_RESULT_EXCEPTION : 
+                                                                          SERVO_STAGING_RESULT_FAILED;
+    }
+}
+
+/**@brief Write staged writes one by one.
+ */
+static void writes_separate(servo_staging_t * staging, uint16_t first, uint16_t last, uint32_t now_ms)
+{
+    for (uint16_t i = first; i < last; i++)
+    {
+        servo_staging_write_t * write = &staging->writes[i];
+        const bool success = servo_oneword_write(staging->ctx, staging->axis, write->address, write->word);
+        
+        staging->requests++;
+        writes_complete(staging, i, i + 1, success);
+        if (success && (staging->cache != NULL))
+        {
+            servo_cache_words_store(staging->cache, write->address, &write->word, 1, now_ms);
+        }
+    }
+}
+
+void servo_staging_initialize(servo_staging_t * staging, 
+                              modbus_ctx_t * ctx, 
+                              uint8_t axis, 
+                              servo_cache_t * cache, 
+                              uint16_t gap_max)
+{
+    staging->ctx = ctx;
+    staging->axis = axis;
+    staging->cache = cache;
+    staging->gap_max = gap_max;
+    
+    servo_staging_clear(staging);
+}
+
+bool servo_staging_oneword_write(servo_staging_t * staging, uint16_t address, uint16_t word)
+{
+    const uint16_t pos = write_find(staging, address);
+    
+    if ((pos == staging->writes_num) || (staging->writes[pos].address != address))
+    {
+        if (staging->writes_num >= SERVO_STAGING_WRITES_NUM)
+        {
+            return false;
+        }
+        
+        for (uint16_t i = staging->writes_num; i > pos; i--)
+        {
+            staging->writes[i] = staging->writes[i - 1];
+        }
+        staging->writes_num++;
+        staging->writes[pos].address = address;
+    }
+    
+    staging->writes[pos].word = word;
+    staging->writes[pos].result = SERVO_STAGING_RESULT_PENDING;
+    staging->writes[pos].exception = MODBUS_EXCEPTION_NONE;
+    
+    return true;
+}
+
+bool servo_staging_commit(servo_staging_t * staging, uint32_t now_ms)
+{
+    uint16_t words[SERVO_WRITE_WORDS_MAX];
+    bool success = true;
+    uint16_t i = 0;
+    
+    staging->requests = 0;
+    
+    while (i < staging->writes_num)
+    {
+        if (staging->writes[i].result == SERVO_STAGING_RESULT_SUCCESS)
+        {
+            i++;
+            continue;
+        }
+        
+        //Extend the range while it fits into one request
+        const uint16_t first = i;
+        const uint16_t address = staging->writes[first].address;
+        uint16_t words_num = 0;
+        do
+        {
+            const servo_staging_write_t * write = &staging->writes[i];
+            while (address + words_num < write->address)
+            {
+                servo_cache_word_get(staging->cache, address + words_num, &words[words_num], now_ms);
+                words_num++;
+            }
+            words[words_num++] = write->word;
+            i++;
+        } while ((i < staging->writes_num) && 
+                 (staging->writes[i].result != SERVO_STAGING_RESULT_SUCCESS) && 
+                 ((uint32_t)staging->writes[i].address - address < SERVO_WRITE_WORDS_MAX) && 
+                 gap_fillable(staging, address + words_num, staging->writes[i].address - address - words_num, now_ms));
+        
+        if (i - first == 1)
+        {
+            writes_separate(staging, first, i, now_ms);
+        }
+        else
+        {
+            const bool written = servo_nwords_write(staging->ctx, staging->axis, address, words, words_num);
+            staging->requests++;
+            
+            if (written && (staging->cache != NULL))
+            {
+                servo_cache_words_store(staging->cache, address, words, words_num, now_ms);
+            }
+            
+            if (!written && (servo_exception_get(staging->ctx) != MODBUS_EXCEPTION_NONE))
+            {
+                //Find the rejected registers
+                writes_separate(staging, first, i, now_ms);
+            }
+            else
+            {
+                writes_complete(staging, first, i, written);
+            }
+        }
+        
+        for (uint16_t j = first; j < i; j++)
+        {
+            if (staging->writes[j].result == SERVO_STAGING_RESULT_FAILED)
+            {
+                //Bus is not responding, the rest stay pending
+                return false;
+            }
+            success = success && (staging->writes[j].result == SERVO_STAGING_RESULT_SUCCESS);
+        }
+    }
+    
+    return success;
+}
+
+servo_staging_result_t servo_staging_result_get(const servo_staging_t * staging, 
+                                                uint16_t address, 
+                                                modbus_exception_t * exception)
+{
+    const uint16_t pos = write_find(staging, address);
+    
+    if ((pos == staging->writes_num) || (staging->writes[pos].address != address))
+    {
+        return SERVO_STAGING_RESULT_PENDING;
+    }
+    
+    if (exception != NULL)
+    {
+        *exception = staging->writes[pos].exception;
+    }
+    
+    return (servo_staging_result_t)staging->writes[pos].result;
+}
+
+void servo_staging_clear(servo_staging_t * staging)
+{
+    staging->writes_num = 0;
+    staging->requests = 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @ingroup servo_driver
+ *
+ * @defgroup servo_staging Servo write staging
+ *
+ * @brief Collects single register writes of the servo and commits them in the fewest requests.
+ *
+ * Staged writes are sorted by address and merged into multiple registers writes (0x10) of up to 
+ * SERVO_WRITE_WORDS_MAX words, a write which can't be merged is sent as a single register write (0x06). 
+ * If a register cache is attached, small gaps between the staged addresses are filled with 
+ * the cached values, so near-contiguous ranges are merged as well.
+ *
+ * The result is reported for every staged register. If the servo rejects a merged request with 
+ * an exception, its registers are written one by one to find the rejected ones. On communication 
+ * error the commit is stopped, the remaining writes stay pending and can be committed again.
+ *
+ * @{
+ */
+
+#ifndef _SERVO_STAGING_H_
+#define _SERVO_STAGING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+#include "servo_cache.h"
+
+#define SERVO_STAGING_WRITES_NUM    (64)                /**< Maximum number of staged writes. */
+
+/**@brief Staged write result. */
+typedef enum
+{
+    SERVO_STAGING_RESULT_PENDING,                       /**< Not committed yet. */
+    SERVO_STAGING_RESULT_SUCCESS,                       /**< Written to the servo. */
+    SERVO_STAGING_RESULT_EXCEPTION,                     /**< Rejected by the servo, @see servo_staging_write_t::exception. */
+    SERVO_STAGING_RESULT_FAILED                         /**< Not written due to communication error. */
+} servo_staging_result_t;
+
+/**@brief Staged write. */
+typedef struct
+{
+    uint16_t address;                                   /**< Register address. */
+    uint16_t word;                                      /**< Write word. */
+    uint8_t result;                                     /**< Write result, @see servo_staging_result_t. */
+    modbus_exception_t exception;                       /**< Exception code if the write was rejected by servo. */
+} servo_staging_write_t;
+
+/**@brief Write staging of the servo. */
+typedef struct
+{
+    modbus_ctx_t * ctx;                                 /**< Modbus context of the bus. */
+    uint8_t axis;                                       /**< Communication address. */
+    servo_cache_t * cache;                              /**< Register cache used to fill the gaps (may be NULL). */
+    uint16_t gap_max;                                   /**< Maximum number of registers filled between staged addresses. */
+    servo_staging_write_t writes[SERVO_STAGING_WRITES_NUM];     /**< Staged writes sorted by address. */
+    uint16_t writes_num;                                /**< Number of staged writes. */
+    uint16_t requests;                                  /**< Number of requests sent by the last commit. */
+} servo_staging_t;
+
+/**@brief Initialize write staging of the servo.
+ *
+ * @param[out] staging Pointer to the staging.
+ * @param[in]  ctx     Pointer to the modbus context of the bus.
+ * @param[in]  axis    Communication address (1-127).
+ * @param[in]  cache   Register cache of the same servo to fill the gaps and to update on commit (may be NULL).
+ * @param[in]  gap_max Maximum number of registers filled between staged addresses (used only with the cache).
+ */
+void servo_staging_initialize(servo_staging_t * staging, 
+                              modbus_ctx_t * ctx, 
+                              uint8_t axis, 
+                              servo_cache_t * cache, 
+                              uint16_t gap_max);
+
+/**@brief Stage write of 1 word. If the address is already staged, the word is replaced.
+ *
+ * @param[in] staging Pointer to the staging.
+ * @param[in] address Register address.
+ * @param[in] word    Write word.
+ *
+ * @retval true if staged, false if there are too many staged writes.
+ */
+bool servo_staging_oneword_write(servo_staging_t * staging, uint16_t address, uint16_t word);
+
+/**@brief Write staged words to the servo.
+ *
+ * Results are stored in the staged writes, which are kept until servo_staging_clear().
+ *
+ * @param[in] staging Pointer to the staging.
+ * @param[in] now_ms  Current time in milliseconds (used to check the cached values).
+ *
+ * @retval true if all the words are written, otherwise false.
+ */
+bool servo_staging_commit(servo_staging_t * staging, uint32_t now_ms);
+
+/**@brief Get result of the staged write.
+ *
+ * @param[in]  staging   Pointer to the staging.
+ * @param[in]  address   Register address.
+ * @param[out] exception Pointer to store the exception code (may be NULL).
+ *
+ * @return Write result, SERVO_STAGING_RESULT_PENDING if the address is not staged.
+ */
+servo_staging_result_t servo_staging_result_get(const servo_staging_t * staging, 
+                                                uint16_t address, 
+                                                modbus_exception_t * exception);
+
+/**@brief Discard staged writes and their results.
+ *
+ * @param[in] staging Pointer to the staging.
+ */
+void servo_staging_clear(servo_staging_t * staging);
+
+#endif
+
+/** @} */
@@ -0,0 +1,724 @@
+#include "servo_sim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#define SIM_COMMAND_READ         0x03
+#define SIM_COMMAND_WRITE_ONE    0x06
+#define SIM_COMMAND_WRITE        0x10
+#define SIM_COMMAND_READ_WRITE   0x17
+
+#define SIM_READ_WORDS_MAX       (125)
+#define SIM_WRITE_WORDS_MAX      (123)
+#define SIM_READ_WRITE_WORDS_MAX (121)
+
+#define SIM_RECEIVE_CHUNK_SIZE   (64)
+#define SIM_BAUD_RATE_DEFAULT    (19200)    /**< Baud rate of the RTU framing when answers are not throttled. */
+#define SIM_POLL_PERIOD_MS       (100)
+#define SIM_HANGUP_DELAY_US      (10000)
+
+/**@brief Get monotonic time in microseconds.
+ */
+static uint32_t time_us(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000);
+}
+
+/**@brief Sleep for the given time.
+ */
+static void sleep_us(uint32_t duration_us)
+{
+    struct timespec duration = 
+    {
+        .tv_sec = (time_t)(duration_us / 1000000),
+        .tv_nsec = (long)(duration_us % 1000000) * 1000
+    };
+    
+    while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+    {
+    }
+}
+
+/**@brief Get next value of the fault generator (xorshift32).
+ */
+static uint32_t random_next(servo_sim_t * sim)
+{
+    uint32_t x = sim->random;
+    
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->random = x;
+    
+    return x;
+}
+
+/**@brief Check event with the given probability.
+ */
+static bool random_permille(servo_sim_t * sim, uint16_t permille)
+{
+    return (permille != 0) && (random_next(sim) % 1000 < permille);
+}
+
+/**@brief Find simulated servo by its address.
+ */
+static servo_sim_axis_t * axis_find(servo_sim_t * sim, uint8_t axis)
+{
+    for (uint8_t i = 0; i < sim->axes_num; i++)
+    {
+        if (sim->axes[i].axis == axis)
+        {
+            return &sim->axes[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/**@brief Check access to the registers.
+ */
+static bool registers_accessible(const servo_sim_t * sim, uint16_t address, uint16_t count, uint8_t access)
+{
+    if ((uint32_t)address + count > SERVO_SIM_REGISTERS_NUM)
+    {
+        return false;
+    }
+    
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if ((sim->access[address + i] & access) != access)
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**@brief Write register of the servo, broadcast writes are applied to all servos.
+ */
+static void sim_value_write(servo_sim_t * sim, servo_sim_axis_t * axis, uint16_t address, uint16_t value)
+{
+    if (axis != NULL)
+    {
+        axis->registers[address] = value;
+        return;
+    }
+    
+    for (uint8_t i = 0; i < sim->axes_num; i++)
+    {
+        sim->axes[i].registers[address] = value;
+    }
+}
+
+static modbus_exception_t registers_read(servo_sim_t * sim, servo_sim_axis_t * axis, uint8_t * pdu, uint16_t pdu_length, uint16_t * answer_length)
+{
+    if (pdu_length != 6)
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    const uint16_t address = (pdu[2] << 8) | pdu[3];
+    const uint16_t count = (pdu[4] << 8) | pdu[5];
+    
+    if ((count == 0) || (count > SIM_READ_WORDS_MAX))
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    if (!registers_accessible(sim, address, count, SERVO_SIM_ACCESS_READ))
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    
+    pdu[2] = (uint8_t)(count * 2);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint16_t * value = &axis->registers[address + i];
+        if (sim->access[address + i] & SERVO_SIM_ACCESS_LIVE)
+        {
+            //Monitor values are changing while the servo is running
+            *value += 1 + ((address + i) & 0x0F);
+        }
+        pdu[3 + 2 * i] = (uint8_t)(*value >> 8);
+        pdu[4 + 2 * i] = (uint8_t)(*value & 0xFF);
+    }
+    
+    *answer_length = 3 + count * 2;
+    
+    return MODBUS_EXCEPTION_NONE;
+}
+
+static modbus_exception_t register_write(servo_sim_t * sim, servo_sim_axis_t * axis, uint8_t * pdu, uint16_t pdu_length, uint16_t * answer_length)
+{
+    if (pdu_length != 6)
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    const uint16_t address = (pdu[2] << 8) | pdu[3];
+    
+    if (!registers_accessible(sim, address, 1, SERVO_SIM_ACCESS_WRITE))
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    
+    sim_value_write(sim, axis, address, (pdu[4] << 8) | pdu[5]);
+    
+    //Answer is the echo of the request
+    *answer_length = 6;
+    
+    return MODBUS_EXCEPTION_NONE;
+}
+
+static modbus_exception_t registers_write(servo_sim_t * sim, servo_sim_axis_t * axis, uint8_t * pdu, uint16_t pdu_length, uint16_t * answer_length)
+{
+    if (pdu_length < 7)
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    const uint16_t address = (pdu[2] << 8) | pdu[3];
+    const uint16_t count = (pdu[4] << 8) | pdu[5];
+    
+    if ((count == 0) || (count > SIM_WRITE_WORDS_MAX) || (pdu[6] != count * 2) || (pdu_length != 7 + pdu[6]))
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    if (!registers_accessible(sim, address, count, SERVO_SIM_ACCESS_WRITE))
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    
+    for (uint16_t i = 0; i < count; i++)
+    {
+        sim_value_write(sim, axis, address + i, (pdu[7 + 2 * i] << 8) | pdu[8 + 2 * i]);
+    }
+    
+    //Answer is the head of the request
+    *answer_length = 6;
+    
+    return MODBUS_EXCEPTION_NONE;
+}
+
+static modbus_exception_t registers_read_write(servo_sim_t * sim, servo_sim_axis_t * axis, uint8_t * pdu, uint16_t pdu_length, uint16_t * answer_length)
+{
+    if (pdu_length < 11)
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    const uint16_t read_address = (pdu[2] << 8) | pdu[3];
+    const uint16_t read_count = (pdu[4] << 8) | pdu[5];
+    const uint16_t write_address = (pdu[6] << 8) | pdu[7];
+    const uint16_t write_count = (pdu[8] << 8) | pdu[9];
+    
+    if ((read_count == 0) || (read_count > SIM_READ_WORDS_MAX) || 
+        (write_count == 0) || (write_count > SIM_READ_WRITE_WORDS_MAX) || 
+        (pdu[10] != write_count * 2) || (pdu_length != 11 + pdu[10]))
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE;
+    }
+    
+    if (!registers_accessible(sim, read_address, read_count, SERVO_SIM_ACCESS_READ) || 
+        !registers_accessible(sim, write_address, write_count, SERVO_SIM_ACCESS_WRITE))
+    {
+        return MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+    
+    //Write is performed before read
+    for (uint16_t i = 0; i < write_count; i++)
+    {
+        sim_value_write(sim, axis, write_address + i, (pdu[11 + 2 * i] << 8) | pdu[12 + 2 * i]);
+    }
+    
+    //Answer is the same as of the read request
+    pdu[2] = (uint8_t)(read_address >> 8);
+    pdu[3] = (uint8_t)(read_address & 0xFF);
+    pdu[4] = (uint8_t)(read_count >> 8);
+    pdu[5] = (uint8_t)(read_count & 0xFF);
+    
+    return registers_read(sim, axis, pdu, 6, answer_length);
+}
+
+/**@brief Get baud rate of the RTU framing, there is no inter-frame timing on a TCP connection.
+ */
+static uint32_t receiver_baud_rate(const servo_sim_config_t * config)
+{
+    if (config->mode == MODBUS_PROTOCOL_MODE_RTU_OVER_TCP)
+    {
+        return 0;
+    }
+    
+    return (config->baud_rate != 0) ? config->baud_rate : SIM_BAUD_RATE_DEFAULT;
+}
+
+void servo_sim_initialize(servo_sim_t * sim, const servo_sim_config_t * config)
+{
+    memset(sim, 0, sizeof(*sim));
+    
+    sim->config = *config;
+    sim->random = (config->seed != 0) ? config->seed : 1;
+    
+    //EPS-B1 register layout: parameters and monitor values
+    servo_sim_registers_define(sim, 0x0000, 0x0400, SERVO_SIM_ACCESS_READ | SERVO_SIM_ACCESS_WRITE);
+    servo_sim_registers_define(sim, 0x0800, 0x0100, SERVO_SIM_ACCESS_READ | SERVO_SIM_ACCESS_LIVE);
+    
+    sim->frame.buffer = sim->buffer;
+    sim->frame.size = sizeof(sim->buffer);
+    modbus_protocol_rtu_receiver_initialize(&sim->receiver, 
+                                            &sim->frame, 
+                                            receiver_baud_rate(config), 
+                                            true);
+    modbus_protocol_ascii_receiver_initialize(&sim->ascii_receiver, &sim->frame, true);
+    modbus_protocol_tcp_receiver_initialize(&sim->tcp_receiver);
+}
+
+bool servo_sim_axis_add(servo_sim_t * sim, uint8_t axis)
+{
+    if ((axis == 0) || (axis > 127) || (sim->axes_num >= SERVO_SIM_AXES_NUM))
+    {
+        return false;
+    }
+    
+    if (axis_find(sim, axis) == NULL)
+    {
+        sim->axes[sim->axes_num++].axis = axis;
+    }
+    
+    return true;
+}
+
+void servo_sim_registers_define(servo_sim_t * sim, uint16_t address, uint16_t count, uint8_t access)
+{
+    for (uint32_t i = address; (i < (uint32_t)address + count) && (i < SERVO_SIM_REGISTERS_NUM); i++)
+    {
+        sim->access[i] = access;
+    }
+}
+
+uint16_t servo_sim_pdu_process(servo_sim_t * sim, uint8_t * pdu, uint16_t pdu_length)
+{
+    modbus_exception_t exception;
+    uint16_t answer_length = 0;
+    
+    if (pdu_length < 2)
+    {
+        return 0;
+    }
+    
+    const bool broadcast = (pdu[0] == 0);
+    servo_sim_axis_t * const axis = broadcast ? NULL : axis_find(sim, pdu[0]);
+    if (!broadcast && (axis == NULL))
+    {
+        return 0;
+    }
+    
+    switch (pdu[1])
+    {
+        case SIM_COMMAND_READ:
+            //Read can't be broadcast
+            exception = broadcast ? MODBUS_EXCEPTION_ILLEGAL_FUNCTION : 
+                                    registers_read(sim, axis, pdu, pdu_length, &answer_length);
+            break;
+            
+        case SIM_COMMAND_WRITE_ONE:
+            exception = register_write(sim, axis, pdu, pdu_length, &answer_length);
+            break;
+            
+        case SIM_COMMAND_WRITE:
+            exception = registers_write(sim, axis, pdu, pdu_length, &answer_length);
+            break;
+            
+        case SIM_COMMAND_READ_WRITE:
+            exception = (broadcast || sim->config.no_read_write) ? MODBUS_EXCEPTION_ILLEGAL_FUNCTION : 
+                        registers_read_write(sim, axis, pdu, pdu_length, &answer_length);
+            break;
+            
+        default:
+            exception = MODBUS_EXCEPTION_ILLEGAL_FUNCTION;
+            break;
+    }
+    
+    if (broadcast)
+    {
+        //Broadcast requests are never answered
+        sim->stats.broadcasts++;
+        return 0;
+    }
+    
+    sim->stats.requests++;
+    if (exception != MODBUS_EXCEPTION_NONE)
+    {
+        sim->stats.exceptions++;
+        pdu[1] |= 0x80;
+        pdu[2] = (uint8_t)exception;
+        answer_length = 3;
+    }
+    
+    return answer_length;
+}
+
+/**@brief Write all data to the file descriptor.
+ */
+static bool write_all(int fd, const uint8_t * data, uint16_t data_length)
+{
+    while (data_length != 0)
+    {
+        const ssize_t written = write(fd, data, data_length);
+        if (written < 0)
+        {
+            if (errno == EAGAIN)
+            {
+                struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+                poll(&pfd, 1, SIM_POLL_PERIOD_MS);
+                continue;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        
+        data += written;
+        data_length -= (uint16_t)written;
+    }
+    
+    return true;
+}
+
+/**@brief Handle received request frame and send the answer.
+ */
+static bool request_handle(servo_sim_t * sim, int fd, bool valid)
+{
+    modbus_frame_t * const frame = &sim->frame;
+    uint8_t * const pdu = MODBUS_FRAME_PDU(frame);
+    uint16_t length;
+    
+    if (!valid)
+    {
+        sim->stats.bad_frames++;
+        return true;
+    }
+    
+    if ((pdu[0] != 0) && (axis_find(sim, pdu[0]) == NULL))
+    {
+        return true;
+    }
+    
+    if (random_permille(sim, sim->config.drop_permille))
+    {
+        sim->stats.dropped++;
+        return true;
+    }
+    
+    const uint16_t request_pdu_length = frame->pdu_length;
+    frame->pdu_length = servo_sim_pdu_process(sim, pdu, frame->pdu_length);
+    if (frame->pdu_length == 0)
+    {
+        return true;
+    }
+    
+    //Serial line behind the TCP server is throttled as an RTU one
+    const bool rtu = (sim->config.mode != MODBUS_PROTOCOL_MODE_ASCII);
+    uint8_t * adu;
+    switch (sim->config.mode)
+    {
+        case MODBUS_PROTOCOL_MODE_ASCII:
+            adu = modbus_protocol_ascii_frame_encode(frame, &length);
+            break;
+            
+        case MODBUS_PROTOCOL_MODE_TCP:
+            //Answer repeats the transaction identifier of the request
+            adu = modbus_protocol_tcp_frame_encode(frame, modbus_protocol_tcp_receiver_id(&sim->tcp_receiver), &length);
+            break;
+            
+        default:
+            adu = modbus_protocol_rtu_frame_encode(frame, &length);
+            break;
+    }
+    if (adu == NULL)
+    {
+        return true;
+    }
+    
+    if (random_permille(sim, sim->config.corrupt_permille))
+    {
+        //TCP stream is not corrupted in transit, the server corrupts the PDU only
+        const uint16_t offset = (sim->config.mode == MODBUS_PROTOCOL_MODE_TCP) ? MODBUS_TCP_HEADER_SIZE : 0;
+        sim->stats.corrupted++;
+        adu[offset + random_next(sim) % (length - offset)] ^= (uint8_t)(1 << (random_next(sim) % 7));
+    }
+    
+    uint32_t delay_us = sim->config.latency_us;
+    if (sim->config.baud_rate != 0)
+    {
+        //The pseudo terminal passes the request instantly, so its transmission time is spent here as well.
+        //Answer is completely received by the driver after its transmission time
+        const uint32_t bits = rtu ? 11 : 10;
+        const uint32_t request_length = rtu ? request_pdu_length + 2 : request_pdu_length * 2 + 5;
+        delay_us += (uint32_t)((uint64_t)(request_length + length) * bits * 1000000 / sim->config.baud_rate);
+    }
+    if (delay_us != 0)
+    {
+        sleep_us(delay_us);
+    }
+    
+    if (!write_all(fd, adu, length))
+    {
+        return false;
+    }
+    sim->stats.answers++;
+    
+    return true;
+}
+
+/**@brief Feed received bytes to the request receiver.
+ */
+static bool received_handle(servo_sim_t * sim, int fd, const uint8_t * data, uint16_t data_length, uint32_t now_us)
+{
+    if (sim->config.mode == MODBUS_PROTOCOL_MODE_TCP)
+    {
+        uint16_t pos = 0;
+        while (pos < data_length)
+        {
+            uint16_t consumed;
+            const modbus_tcp_receiver_status_t status = 
+                    modbus_protocol_tcp_receiver_feed(&sim->tcp_receiver, &data[pos], data_length - pos, &consumed);
+            pos += consumed;
+            if (status == MODBUS_TCP_RECEIVER_STATUS_HEADER)
+            {
+                modbus_protocol_tcp_receiver_accept(&sim->tcp_receiver, &sim->frame);
+            }
+            else if (status == MODBUS_TCP_RECEIVER_STATUS_CORRUPTED)
+            {
+                sim->stats.bad_frames++;
+            }
+            else if ((status == MODBUS_TCP_RECEIVER_STATUS_COMPLETE) && !request_handle(sim, fd, true))
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    if (MODBUS_MODE_RTU_FRAMING(sim->config.mode))
+    {
+        uint16_t pos = 0;
+        while (pos < data_length)
+        {
+            uint16_t consumed;
+            const modbus_rtu_receiver_status_t status = 
+                    modbus_protocol_rtu_receiver_feed(&sim->receiver, &data[pos], data_length - pos, now_us, &consumed);
+            pos += consumed;
+            if ((status != MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE) && 
+                !request_handle(sim, fd, status == MODBUS_RTU_RECEIVER_STATUS_COMPLETE))
+            {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
+    uint16_t pos = 0;
+    while (pos < data_length)
+    {
+        uint16_t consumed;
+        const modbus_ascii_receiver_status_t status = 
+                modbus_protocol_ascii_receiver_feed(&sim->ascii_receiver, &data[pos], data_length - pos, &consumed);
+        pos += consumed;
+        if ((status != MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE) && 
+            !request_handle(sim, fd, status == MODBUS_ASCII_RECEIVER_STATUS_COMPLETE))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool servo_sim_serve(servo_sim_t * sim, int fd, const volatile bool * running)
+{
+    uint8_t chunk[SIM_RECEIVE_CHUNK_SIZE];
+    
+    while (*running)
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        const bool pending = (sim->config.mode == MODBUS_PROTOCOL_MODE_RTU) && (sim->receiver.length != 0);
+        
+        const int ready = poll(&pfd, 1, pending ? (int)(sim->receiver.t35_us / 1000 + 1) : SIM_POLL_PERIOD_MS);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        
+        const uint32_t now_us = time_us();
+        if (ready == 0)
+        {
+            //Request with unknown function code is completed by silence
+            const modbus_rtu_receiver_status_t status = pending ? 
+                    modbus_protocol_rtu_receiver_poll(&sim->receiver, now_us) : MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE;
+            if ((status != MODBUS_RTU_RECEIVER_STATUS_INCOMPLETE) && 
+                !request_handle(sim, fd, status == MODBUS_RTU_RECEIVER_STATUS_COMPLETE))
+            {
+                return false;
+            }
+            continue;
+        }
+        
+        if (!(pfd.revents & POLLIN))
+        {
+            //Slave side of the pseudo-terminal is not opened yet
+            sleep_us(SIM_HANGUP_DELAY_US);
+            continue;
+        }
+        
+        const ssize_t received = read(fd, chunk, sizeof(chunk));
+        if (received == 0)
+        {
+            return true;
+        }
+        if (received < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EINTR))
+            {
+                continue;
+            }
+            if (errno == EIO)
+            {
+                //Slave side of the pseudo-terminal was closed
+                sleep_us(SIM_HANGUP_DELAY_US);
+                continue;
+            }
+            return false;
+        }
+        
+        if (!received_handle(sim, fd, chunk, (uint16_t)received, now_us))
+        {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+int servo_sim_pty_open(char * name, uint16_t name_size)
+{
+    struct termios tty;
+    
+    const int fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    
+    if ((grantpt(fd) != 0) || (unlockpt(fd) != 0) || (ptsname_r(fd, name, name_size) != 0))
+    {
+        close(fd);
+        return -1;
+    }
+    
+    //Line discipline of the slave side must pass frames unchanged even before the driver configures it
+    const int slave = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave >= 0)
+    {
+        if (tcgetattr(slave, &tty) == 0)
+        {
+            cfmakeraw(&tty);
+            tcsetattr(slave, TCSANOW, &tty);
+        }
+        close(slave);
+    }
+    
+    return fd;
+}
+
+int servo_sim_tcp_listen(uint16_t * port)
+{
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(*port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t address_length = sizeof(address);
+    const int enable = 1;
+    
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if ((bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) || (listen(fd, 1) != 0) || 
+        (getsockname(fd, (struct sockaddr *)&address, &address_length) != 0))
+    {
+        close(fd);
+        return -1;
+    }
+    
+    *port = ntohs(address.sin_port);
+    
+    return fd;
+}
+
+int servo_sim_tcp_accept(servo_sim_t * sim, int fd, const volatile bool * running)
+{
+    const int enable = 1;
+    
+    while (*running)
+    {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        const int ready = poll(&pfd, 1, SIM_POLL_PERIOD_MS);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        if (ready == 0)
+        {
+            continue;
+        }
+        
+        const int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0)
+        {
+            if ((errno == EINTR) || (errno == ECONNABORTED))
+            {
+                continue;
+            }
+            return -1;
+        }
+        
+        //Answers leave as soon as they are written, frames of the previous client are discarded
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        modbus_protocol_rtu_receiver_reset(&sim->receiver);
+        modbus_protocol_tcp_receiver_initialize(&sim->tcp_receiver);
+        
+        return client;
+    }
+    
+    return -1;
+}
@@ -0,0 +1,166 @@
+/**
+ * @defgroup servo_sim Simulated EPS-B1 servo
+ *
+ * @brief Modbus server simulating EPS-B1 series servos, for load testing without hardware.
+ *
+ * The simulator serves Read Holding Registers (0x03), Write Single Register (0x06), Write 
+ * Multiple Registers (0x10) and Read/Write Multiple Registers (0x17) in RTU and ASCII modes, answers with exceptions for unsupported 
+ * functions, addresses and values, and applies broadcast writes without answering. Frames are 
+ * received and sent by the same RTU/ASCII framing code as used by the driver.
+ *
+ * In MODBUS_PROTOCOL_MODE_TCP and MODBUS_PROTOCOL_MODE_RTU_OVER_TCP the simulator acts as a Modbus TCP 
+ * server (or a serial gateway) on a loopback socket (@see servo_sim_tcp_listen()), answers repeat the 
+ * transaction identifiers of the requests, so pipelined requests can be matched by the client.
+ *
+ * By default the register map follows the EPS-B1 layout: parameters (read/write) at 0x0000-0x03FF 
+ * and monitor values (read only) at 0x0800-0x08FF. Accesses outside the defined registers are 
+ * rejected with MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS. The map can be redefined with 
+ * servo_sim_registers_define().
+ *
+ * To get repeatable throughput and latency figures, transactions can be throttled to the baud rate 
+ * and delayed, and frames can be corrupted or dropped with the given probabilities.
+ *
+ * @{
+ */
+
+#ifndef _SERVO_SIM_H_
+#define _SERVO_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+#include "modbus/modbus_protocol_rtu.h"
+#include "modbus/modbus_protocol_ascii.h"
+#include "modbus/modbus_protocol_tcp.h"
+
+#define SERVO_SIM_REGISTERS_NUM    (0x1000)                 /**< Size of the simulated address space in words. */
+#define SERVO_SIM_AXES_NUM         (16)                     /**< Maximum number of simulated servos. */
+#define SERVO_SIM_FRAME_SIZE       MODBUS_FRAME_SIZE(256)
+
+#define SERVO_SIM_ACCESS_READ      (0x01)                   /**< Register can be read. */
+#define SERVO_SIM_ACCESS_WRITE     (0x02)                   /**< Register can be written. */
+#define SERVO_SIM_ACCESS_LIVE      (0x04)                   /**< Register value changes on every read (monitor value). */
+
+/**@brief Simulator configuration. */
+typedef struct
+{
+    modbus_mode_t mode;                                 /**< Modbus mode. */
+    uint32_t baud_rate;                                 /**< Baud rate transactions are throttled to (0 - no throttling). */
+    uint32_t latency_us;                                /**< Delay between the request and the answer in microseconds. */
+    uint16_t corrupt_permille;                          /**< Probability to corrupt an answer, per mille. */
+    uint16_t drop_permille;                             /**< Probability to drop a request, per mille. */
+    uint32_t seed;                                      /**< Seed of the fault generator. */
+    bool no_read_write;                                 /**< Reject Read/Write Multiple Registers (0x17) as an illegal function. */
+} servo_sim_config_t;
+
+/**@brief Simulator statistics. */
+typedef struct
+{
+    uint32_t requests;                                  /**< Received requests addressed to the simulated servos. */
+    uint32_t answers;                                   /**< Sent answers. */
+    uint32_t exceptions;                                /**< Sent exception answers. */
+    uint32_t broadcasts;                                /**< Applied broadcast requests. */
+    uint32_t dropped;                                   /**< Requests dropped on purpose. */
+    uint32_t corrupted;                                 /**< Answers corrupted on purpose. */
+    uint32_t bad_frames;                                /**< Received corrupted frames. */
+} servo_sim_stats_t;
+
+/**@brief Simulated servo. */
+typedef struct
+{
+    uint8_t axis;                                       /**< Communication address. */
+    uint16_t registers[SERVO_SIM_REGISTERS_NUM];        /**< Register values. */
+} servo_sim_axis_t;
+
+/**@brief Simulator. */
+typedef struct
+{
+    servo_sim_config_t config;                          /**< Configuration. */
+    servo_sim_axis_t axes[SERVO_SIM_AXES_NUM];          /**< Simulated servos. */
+    uint8_t axes_num;                                   /**< Number of simulated servos. */
+    uint8_t access[SERVO_SIM_REGISTERS_NUM];            /**< Register access flags, common for all servos. */
+    servo_sim_stats_t stats;                            /**< Statistics. */
+    uint32_t random;                                    /**< Fault generator state. */
+    uint8_t buffer[SERVO_SIM_FRAME_SIZE];               /**< Frame storage. */
+    modbus_frame_t frame;                               /**< Received frame. */
+    modbus_rtu_receiver_t receiver;                     /**< Request receiver (MODBUS_PROTOCOL_MODE_RTU). */
+    modbus_ascii_receiver_t ascii_receiver;             /**< Request receiver (MODBUS_PROTOCOL_MODE_ASCII). */
+    modbus_tcp_receiver_t tcp_receiver;                 /**< Request receiver (MODBUS_PROTOCOL_MODE_TCP). */
+} servo_sim_t;
+
+/**@brief Initialize simulator with the default register map and no servos.
+ *
+ * @param[out] sim    Pointer to the simulator.
+ * @param[in]  config Pointer to the configuration.
+ */
+void servo_sim_initialize(servo_sim_t * sim, const servo_sim_config_t * config);
+
+/**@brief Add simulated servo.
+ *
+ * @param[in] sim  Pointer to the simulator.
+ * @param[in] axis Communication address (1-127).
+ *
+ * @retval true if the servo is added, false if the address is invalid or there are too many servos.
+ */
+bool servo_sim_axis_add(servo_sim_t * sim, uint8_t axis);
+
+/**@brief Define access to the registers.
+ *
+ * @param[in] sim     Pointer to the simulator.
+ * @param[in] address Starting address.
+ * @param[in] count   Number of registers.
+ * @param[in] access  Access flags (SERVO_SIM_ACCESS_*), 0 to undefine registers.
+ */
+void servo_sim_registers_define(servo_sim_t * sim, uint16_t address, uint16_t count, uint8_t access);
+
+/**@brief Process request PDU and build the answer PDU in its place.
+ *
+ * @param[in]     sim        Pointer to the simulator.
+ * @param[in,out] pdu        Pointer to the request PDU, the answer PDU is stored in place.
+ * @param[in]     pdu_length Length of the request PDU in bytes.
+ *
+ * @return Length of the answer PDU in bytes, 0 if there is no answer (other server or broadcast).
+ */
+uint16_t servo_sim_pdu_process(servo_sim_t * sim, uint8_t * pdu, uint16_t pdu_length);
+
+/**@brief Serve requests received from the file descriptor (pseudo-terminal, socket, pipe) 
+ *        until the running flag is cleared or the descriptor is closed.
+ *
+ * @param[in] sim     Pointer to the simulator.
+ * @param[in] fd      File descriptor to read requests from and write answers to.
+ * @param[in] running Pointer to the running flag.
+ *
+ * @retval true if stopped by the flag or end of file, false on I/O error.
+ */
+bool servo_sim_serve(servo_sim_t * sim, int fd, const volatile bool * running);
+
+/**@brief Open pseudo-terminal, the driver is connected to its slave side.
+ *
+ * @param[out] name      Buffer to store the path of the slave side.
+ * @param[in]  name_size Size of the buffer.
+ *
+ * @return File descriptor of the master side to serve, -1 on error.
+ */
+int servo_sim_pty_open(char * name, uint16_t name_size);
+
+/**@brief Open listening TCP socket on the loopback interface, clients are accepted by servo_sim_tcp_accept().
+ *
+ * @param[in,out] port TCP port to listen on (0 for any free port), the port actually used is stored.
+ *
+ * @return File descriptor of the listening socket, -1 on error.
+ */
+int servo_sim_tcp_listen(uint16_t * port);
+
+/**@brief Wait for the next client until the running flag is cleared.
+ *
+ * @param[in] sim      Pointer to the simulator, the request receivers are reset for the new connection.
+ * @param[in] fd       File descriptor of the listening socket.
+ * @param[in] running  Pointer to the running flag.
+ *
+ * @return File descriptor of the connection to serve by servo_sim_serve(), -1 if stopped or on error.
+ */
+int servo_sim_tcp_accept(servo_sim_t * sim, int fd, const volatile bool * running);
+
+#endif
+
+/** @} */
@@ -0,0 +1,210 @@
+/**
+ * @ingroup servo_sim
+ *
+ * @brief Simulator executable: serves the simulated servos on a pseudo-terminal or, in the TCP modes, 
+ * on a loopback TCP port.
+ *
+ * Usage: servo_sim [options]
+ *   -m, --mode MODE            Modbus mode: rtu, ascii, tcp or rtu-tcp (rtu).
+ *   -p, --port PORT            TCP port in the TCP modes (1502, 0 - any free port).
+ *   -a, --axes FIRST[-LAST]    Addresses of the simulated servos (1).
+ *   -b, --baud RATE            Throttle transactions to the baud rate (0 - no throttling).
+ *   -l, --latency US           Answer delay in microseconds.
+ *   -c, --corrupt PERMILLE     Probability to corrupt an answer.
+ *   -d, --drop PERMILLE        Probability to drop a request.
+ *   -s, --seed SEED            Seed of the fault generator.
+ *   -n, --no-read-write        Reject Read/Write Multiple Registers (0x17).
+ *
+ * The path of the pseudo-terminal to open by the driver (or the address to connect to) is printed 
+ * to stdout, statistics are printed to stderr on exit (SIGINT, SIGTERM). TCP clients are served 
+ * one at a time.
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "servo_sim.h"
+
+#define SIM_TCP_PORT_DEFAULT    (1502)  /**< Unprivileged alternative to MODBUS_TCP_PORT. */
+
+static volatile bool running = true;
+
+static void signal_handle(int signal_number)
+{
+    (void)signal_number;
+    running = false;
+}
+
+static void usage_print(const char * program)
+{
+    fprintf(stderr, 
+            "Usage: %s [-m rtu|ascii|tcp|rtu-tcp] [-p PORT] [-a FIRST[-LAST]] [-b BAUD] [-l LATENCY_US] "
+            "[-c CORRUPT_PERMILLE] [-d DROP_PERMILLE] [-s SEED] [-n]\n", 
+            program);
+}
+
+int main(int argc, char * argv[])
+{
+    static const struct option options[] = 
+    {
+        { "mode",          required_argument, NULL, 'm' },
+        { "port",          required_argument, NULL, 'p' },
+        { "axes",          required_argument, NULL, 'a' },
+        { "baud",          required_argument, NULL, 'b' },
+        { "latency",       required_argument, NULL, 'l' },
+        { "corrupt",       required_argument, NULL, 'c' },
+        { "drop",          required_argument, NULL, 'd' },
+        { "seed",          required_argument, NULL, 's' },
+        { "no-read-write", no_argument,       NULL, 'n' },
+        { NULL,            0,                 NULL, 0   }
+    };
+    static servo_sim_t sim;
+    servo_sim_config_t config = 
+    {
+        .mode = MODBUS_PROTOCOL_MODE_RTU,
+        .seed = 1
+    };
+    uint16_t port = SIM_TCP_PORT_DEFAULT;
+    unsigned long axis_first = 1;
+    unsigned long axis_last = 1;
+    char * end;
+    int option;
+    
+    while ((option = getopt_long(argc, argv, "m:p:a:b:l:c:d:s:n", options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'm':
+                if (strcmp(optarg, "rtu") == 0)
+                {
+                    config.mode = MODBUS_PROTOCOL_MODE_RTU;
+                }
+                else if (strcmp(optarg, "ascii") == 0)
+                {
+                    config.mode = MODBUS_PROTOCOL_MODE_ASCII;
+                }
+                else if (strcmp(optarg, "tcp") == 0)
+                {
+                    config.mode = MODBUS_PROTOCOL_MODE_TCP;
+                }
+                else if (strcmp(optarg, "rtu-tcp") == 0)
+                {
+                    config.mode = MODBUS_PROTOCOL_MODE_RTU_OVER_TCP;
+                }
+                else
+                {
+                    usage_print(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+                
+            case 'p':
+                port = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'a':
+                axis_first = strtoul(optarg, &end, 0);
+                axis_last = (*end == '-') ? strtoul(end + 1, NULL, 0) : axis_first;
+                break;
+                
+            case 'b':
+                config.baud_rate = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'l':
+                config.latency_us = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'c':
+                config.corrupt_permille = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'd':
+                config.drop_permille = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 's':
+                config.seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+                
+            case 'n':
+                config.no_read_write = true;
+                break;
+                
+            default:
+                usage_print(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    
+    if ((axis_first == 0) || (axis_last > 127) || (axis_first > axis_last))
+    {
+        usage_print(argv[0]);
+        return EXIT_FAILURE;
+    }
+    
+    servo_sim_initialize(&sim, &config);
+    for (unsigned long axis = axis_first; axis <= axis_last; axis++)
+    {
+        if (!servo_sim_axis_add(&sim, (uint8_t)axis))
+        {
+            fprintf(stderr, "At most %d servos can be simulated\n", SERVO_SIM_AXES_NUM);
+            return EXIT_FAILURE;
+        }
+    }
+    
+    signal(SIGINT, signal_handle);
+    signal(SIGTERM, signal_handle);
+    
+    bool success = true;
+    if (MODBUS_MODE_NETWORK(config.mode))
+    {
+        const int fd = servo_sim_tcp_listen(&port);
+        if (fd < 0)
+        {
+            perror("servo_sim_tcp_listen");
+            return EXIT_FAILURE;
+        }
+        
+        printf("127.0.0.1:%u\n", (unsigned)port);
+        fflush(stdout);
+        
+        //Client closing the connection while the answer is written must not stop the simulator
+        signal(SIGPIPE, SIG_IGN);
+        
+        int client;
+        while ((client = servo_sim_tcp_accept(&sim, fd, &running)) >= 0)
+        {
+            servo_sim_serve(&sim, client, &running);
+            close(client);
+        }
+        close(fd);
+    }
+    else
+    {
+        char name[64];
+        const int fd = servo_sim_pty_open(name, sizeof(name));
+        if (fd < 0)
+        {
+            perror("servo_sim_pty_open");
+            return EXIT_FAILURE;
+        }
+        
+        printf("%s\n", name);
+        fflush(stdout);
+        
+        success = servo_sim_serve(&sim, fd, &running);
+        close(fd);
+    }
+    
+    fprintf(stderr, 
+            "requests %u, answers %u, exceptions %u, broadcasts %u, dropped %u, corrupted %u, bad frames %u\n", 
+            (unsigned)sim.stats.requests, (unsigned)sim.stats.answers, (unsigned)sim.stats.exceptions, 
+            (unsigned)sim.stats.broadcasts, (unsigned)sim.stats.dropped, (unsigned)sim.stats.corrupted, 
+            (unsigned)sim.stats.bad_frames);
+    
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
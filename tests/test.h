@@ -0,0 +1,30 @@
+/**
+ * @defgroup tests Tests
+ *
+ * @brief Test executables run by CTest, each exits with a non-zero status if any check fails.
+ *
+ * @{
+ */
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+
+/**@brief Check the condition, print the failed condition and count the failure. */
+#define TEST_CHECK(CONDITION)                                                           \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(CONDITION))                                                               \
+        {                                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #CONDITION); \
+            test_failures++;                                                            \
+        }                                                                               \
+    } while (0)
+
+/**@brief Number of failed checks of the test executable. */
+extern unsigned int test_failures;
+
+#endif
+
+/** @} */
@@ -0,0 +1,205 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Modbus ASCII receiver (@see modbus_ascii_receiver_t): characters outside of a frame are skipped,
+ * the start character resynchronizes after noise or a truncated frame, frames split at any point or packed
+ * back to back are completed, corrupted frames are reported; the blocking read resynchronizes the same way.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "modbus/modbus_protocol_ascii.h"
+#include "test.h"
+
+#define TEST_PDU_SIZE     (64)
+#define TEST_CHARS_SIZE   (4 * MODBUS_FRAME_SIZE(TEST_PDU_SIZE))
+
+/**@brief Scripted bus: characters are read from the script, reads past its end time out. */
+typedef struct
+{
+    uint8_t chars[TEST_CHARS_SIZE];                     /**< Script. */
+    uint16_t length;                                    /**< Number of characters in the script. */
+    uint16_t offset;                                    /**< Number of characters already read. */
+} test_script_t;
+
+unsigned int test_failures;
+
+static test_script_t script;
+static const uint8_t answer[] = { 0x01, 0x03, 0x04, 0x12, 0x34, 0xAB, 0xCD };
+static const uint8_t exception[] = { 0x01, 0x83, 0x02 };
+
+/**@brief Append characters to the script.
+ */
+static void script_append(const void * chars, uint16_t length)
+{
+    memcpy(&script.chars[script.length], chars, length);
+    script.length += length;
+}
+
+/**@brief Append ASCII frame with the PDU to the script.
+ */
+static void script_frame_append(const uint8_t * pdu, uint16_t pdu_length)
+{
+    uint8_t buffer[MODBUS_FRAME_SIZE(TEST_PDU_SIZE)];
+    modbus_frame_t frame = { .buffer = buffer, .size = sizeof(buffer), .pdu_length = pdu_length };
+    uint16_t length;
+    
+    memcpy(MODBUS_FRAME_PDU(&frame), pdu, pdu_length);
+    const uint8_t * const adu = modbus_protocol_ascii_frame_encode(&frame, &length);
+    script_append(adu, length);
+}
+
+static modbus_callback_result_t script_read(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+{
+    (void)user_data;
+    (void)timeout_ms;
+    
+    if (script.length - script.offset < data_length)
+    {
+        script.offset = script.length;
+        return MODBUS_CALLBACK_RESULT_TIMEOUT;
+    }
+    
+    memcpy(data, &script.chars[script.offset], data_length);
+    script.offset += data_length;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Feed the script to a new receiver in chunks of the given length.
+ *
+ * @return Status of the first frame completed, MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE if none.
+ */
+static modbus_ascii_receiver_status_t script_feed(modbus_frame_t * frame, uint16_t chunk_length)
+{
+    modbus_ascii_receiver_t receiver;
+    modbus_ascii_receiver_status_t status = MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE;
+    uint16_t consumed;
+    
+    modbus_protocol_ascii_receiver_initialize(&receiver, frame, false);
+    script.offset = 0;
+    while ((status == MODBUS_ASCII_RECEIVER_STATUS_INCOMPLETE) && (script.offset < script.length))
+    {
+        const uint16_t left = script.length - script.offset;
+        const uint16_t length = (left < chunk_length) ? left : chunk_length;
+        status = modbus_protocol_ascii_receiver_feed(&receiver, &script.chars[script.offset], length, &consumed);
+        TEST_CHECK(consumed <= length);
+        script.offset += consumed;
+    }
+    
+    return status;
+}
+
+/**@brief Check that the frame holds the PDU.
+ */
+static void pdu_check(const modbus_frame_t * frame, const uint8_t * pdu, uint16_t pdu_length)
+{
+    TEST_CHECK(frame->pdu_length == pdu_length);
+    TEST_CHECK(memcmp(MODBUS_FRAME_PDU(frame), pdu, pdu_length) == 0);
+}
+
+/**@brief Receiver fed in chunks of any length.
+ */
+static void receiver_test(void)
+{
+    uint8_t buffer[MODBUS_FRAME_SIZE(TEST_PDU_SIZE)];
+    modbus_frame_t frame = { .buffer = buffer, .size = sizeof(buffer) };
+    
+    for (uint16_t chunk_length = 1; chunk_length <= 40; chunk_length++)
+    {
+        //Noise and a truncated frame before the answer
+        script.length = 0;
+        script_append("\x00\x55\r\nAB", 6);
+        script_append(":010304", 7);
+        script_frame_append(answer, sizeof(answer));
+        TEST_CHECK(script_feed(&frame, chunk_length) == MODBUS_ASCII_RECEIVER_STATUS_COMPLETE);
+        pdu_check(&frame, answer, sizeof(answer));
+        TEST_CHECK(script.offset == script.length);
+        
+        //Frames back to back: the rest of the chunk belongs to the next frame
+        script.length = 0;
+        script_frame_append(exception, sizeof(exception));
+        const uint16_t first_length = script.length;
+        script_frame_append(answer, sizeof(answer));
+        TEST_CHECK(script_feed(&frame, chunk_length) == MODBUS_ASCII_RECEIVER_STATUS_COMPLETE);
+        pdu_check(&frame, exception, sizeof(exception));
+        TEST_CHECK(script.offset == first_length);
+    }
+    
+    //Lowercase hex digits are accepted, the LRC is checked
+    script.length = 0;
+    script_append(":0183027a\r\n", 11);
+    TEST_CHECK(script_feed(&frame, 4) == MODBUS_ASCII_RECEIVER_STATUS_COMPLETE);
+    pdu_check(&frame, exception, sizeof(exception));
+    script.length = 0;
+    script_append(":01830279\r\n", 11);
+    TEST_CHECK(script_feed(&frame, 4) == MODBUS_ASCII_RECEIVER_STATUS_CORRUPTED);
+    
+    //Non-hex character, wrong terminator
+    script.length = 0;
+    script_append(":0183G27A\r\n", 11);
+    TEST_CHECK(script_feed(&frame, 3) == MODBUS_ASCII_RECEIVER_STATUS_CORRUPTED);
+    script.length = 0;
+    script_append(":0183027A\rX", 11);
+    TEST_CHECK(script_feed(&frame, 3) == MODBUS_ASCII_RECEIVER_STATUS_CORRUPTED);
+}
+
+/**@brief Blocking read of the answer through the bus read callback.
+ */
+static void read_test(void)
+{
+    const modbus_params_t params = 
+    {
+        .mode = MODBUS_PROTOCOL_MODE_ASCII,
+        .read = script_read,
+        .timeout_ms = 0
+    };
+    modbus_ctx_t ctx;
+    uint8_t buffer[MODBUS_FRAME_SIZE(TEST_PDU_SIZE)];
+    modbus_frame_t frame = { .buffer = buffer, .size = sizeof(buffer) };
+    uint8_t data[sizeof(answer)];
+    
+    modbus_protocol_initialize(&ctx, &params);
+    
+    //Truncated frame is dropped at the next start character
+    script.length = 0;
+    script.offset = 0;
+    script_append("\x55\x55", 2);
+    script_append(":01030412", 9);
+    script_frame_append(answer, sizeof(answer));
+    TEST_CHECK(modbus_protocol_ascii_frame_read(&ctx, &frame, sizeof(answer)) == MODBUS_PROTOCOL_RESULT_SUCCESS);
+    pdu_check(&frame, answer, sizeof(answer));
+    
+    //Exception is completed without waiting for the expected length, the next frame is not consumed
+    script.length = 0;
+    script.offset = 0;
+    script_frame_append(exception, sizeof(exception));
+    const uint16_t exception_length = script.length;
+    script_frame_append(answer, sizeof(answer));
+    TEST_CHECK(modbus_protocol_ascii_frame_read(&ctx, &frame, sizeof(answer)) == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+    pdu_check(&frame, exception, sizeof(exception));
+    TEST_CHECK(script.offset == exception_length);
+    
+    //Legacy read returns the exception with its code
+    TEST_CHECK(modbus_protocol_ascii_answer_read(&ctx, data, sizeof(answer)) == MODBUS_PROTOCOL_RESULT_SUCCESS);
+    TEST_CHECK(memcmp(data, answer, sizeof(answer)) == 0);
+    script.length = 0;
+    script.offset = 0;
+    script_frame_append(exception, sizeof(exception));
+    TEST_CHECK(modbus_protocol_ascii_answer_read(&ctx, data, sizeof(answer)) == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+    TEST_CHECK(data[2] == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+    
+    //Frame never completed
+    script.length = 0;
+    script.offset = 0;
+    script_append(":010304", 7);
+    TEST_CHECK(modbus_protocol_ascii_frame_read(&ctx, &frame, sizeof(answer)) == MODBUS_PROTOCOL_RESULT_TIMEOUT);
+}
+
+int main(void)
+{
+    receiver_test();
+    read_test();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
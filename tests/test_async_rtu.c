@@ -0,0 +1,283 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Asynchronous RTU transactions (@see modbus_async) over a scripted bus: answers of known length
+ * received in chunks far apart wait for all their bytes, only answers of unknown length end by the t3.5
+ * silence, bytes received before a request is sent are discarded.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "modbus/modbus_async.h"
+#include "modbus/modbus_protocol_rtu.h"
+#include "test.h"
+
+#define TEST_BAUD_RATE    (115200)
+#define TEST_T35_US       (1750)
+#define TEST_AXIS         (1)
+#define TEST_ADDRESS      (0x0010)
+#define TEST_WORDS_NUM    (4)
+#define TEST_PDU_SIZE     (64)
+
+/**@brief Scripted bus: the answer is queued to the receive buffer when the request is written. */
+typedef struct
+{
+    uint8_t answer[TEST_PDU_SIZE];                      /**< Answer PDU queued on the next write. */
+    uint16_t answer_length;                             /**< Length of the answer PDU (0 for no answer). */
+    uint16_t trailing_length;                           /**< Number of noise bytes following the answer. */
+    uint8_t rx[4 * TEST_PDU_SIZE];                      /**< Receive buffer. */
+    uint16_t rx_length;                                 /**< Number of bytes in the receive buffer. */
+    uint16_t rx_offset;                                 /**< Number of bytes already received. */
+    uint16_t chunk_length;                              /**< Maximum bytes per receive call (0 for no limit). */
+} test_bus_t;
+
+unsigned int test_failures;
+
+static test_bus_t bus;
+static modbus_ctx_t ctx;
+static modbus_async_t async;
+static modbus_transaction_t transaction;
+static uint8_t buffer[MODBUS_FRAME_SIZE(TEST_PDU_SIZE)];
+static modbus_protocol_result_t result;
+static unsigned int completions;
+
+/**@brief Append bytes to the receive buffer.
+ */
+static void rx_append(const uint8_t * data, uint16_t data_length)
+{
+    memcpy(&bus.rx[bus.rx_length], data, data_length);
+    bus.rx_length += data_length;
+}
+
+/**@brief Append RTU frame with the PDU to the receive buffer.
+ */
+static void rx_frame_append(const uint8_t * pdu, uint16_t pdu_length)
+{
+    uint8_t frame_buffer[MODBUS_FRAME_SIZE(TEST_PDU_SIZE)];
+    modbus_frame_t frame = { .buffer = frame_buffer, .size = sizeof(frame_buffer), .pdu_length = pdu_length };
+    uint16_t length;
+    
+    memcpy(MODBUS_FRAME_PDU(&frame), pdu, pdu_length);
+    const uint8_t * const adu = modbus_protocol_rtu_frame_encode(&frame, &length);
+    rx_append(adu, length);
+}
+
+static modbus_callback_result_t bus_write(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+{
+    (void)user_data;
+    (void)data;
+    (void)data_length;
+    (void)timeout_ms;
+    
+    if (bus.answer_length != 0)
+    {
+        rx_frame_append(bus.answer, bus.answer_length);
+    }
+    for (uint16_t i = 0; i < bus.trailing_length; i++)
+    {
+        bus.rx[bus.rx_length++] = 0x55;
+    }
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+static modbus_callback_result_t bus_receive(void * user_data, uint8_t * data, uint16_t data_length, uint16_t * received)
+{
+    (void)user_data;
+    
+    uint16_t length = bus.rx_length - bus.rx_offset;
+    if (length > data_length)
+    {
+        length = data_length;
+    }
+    if ((bus.chunk_length != 0) && (length > bus.chunk_length))
+    {
+        length = bus.chunk_length;
+    }
+    
+    memcpy(data, &bus.rx[bus.rx_offset], length);
+    bus.rx_offset += length;
+    *received = length;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+static void bus_idle(void * user_data, uint16_t data_length)
+{
+    (void)user_data;
+    (void)data_length;
+}
+
+/**@brief Completion callback: store the result.
+ */
+static void transaction_complete(modbus_transaction_t * completed, modbus_protocol_result_t completed_result)
+{
+    (void)completed;
+    result = completed_result;
+    completions++;
+}
+
+/**@brief Submit request PDU and send it at the given time. The answer is received by the same poll if 
+ *        it isn't split to chunks.
+ */
+static void request_send(const uint8_t * pdu, uint16_t pdu_length, uint16_t answer_length, uint32_t now_us)
+{
+    transaction.frame.buffer = buffer;
+    transaction.frame.size = sizeof(buffer);
+    transaction.frame.pdu_length = pdu_length;
+    transaction.answer_length = answer_length;
+    transaction.complete = transaction_complete;
+    memcpy(MODBUS_FRAME_PDU(&transaction.frame), pdu, pdu_length);
+    completions = 0;
+    
+    TEST_CHECK(modbus_async_submit(&async, &transaction));
+    modbus_async_poll(&async, now_us);
+}
+
+/**@brief Prepare the answer to the read of TEST_WORDS_NUM registers.
+ */
+static void read_answer_set(uint8_t first)
+{
+    bus.answer[0] = TEST_AXIS;
+    bus.answer[1] = 0x03;
+    bus.answer[2] = 2 * TEST_WORDS_NUM;
+    for (uint16_t i = 0; i < TEST_WORDS_NUM; i++)
+    {
+        bus.answer[3 + 2 * i] = 0xA0;
+        bus.answer[4 + 2 * i] = (uint8_t)(first + i);
+    }
+    bus.answer_length = 3 + 2 * TEST_WORDS_NUM;
+}
+
+/**@brief Check the answer to the read of TEST_WORDS_NUM registers.
+ */
+static void read_answer_check(uint8_t first)
+{
+    const uint8_t * const answer = MODBUS_FRAME_PDU(&transaction.frame);
+    
+    TEST_CHECK(completions == 1);
+    TEST_CHECK(result == MODBUS_PROTOCOL_RESULT_SUCCESS);
+    TEST_CHECK(transaction.frame.pdu_length == 3 + 2 * TEST_WORDS_NUM);
+    TEST_CHECK(answer[2] == 2 * TEST_WORDS_NUM);
+    for (uint16_t i = 0; i < TEST_WORDS_NUM; i++)
+    {
+        TEST_CHECK(answer[3 + 2 * i] == 0xA0 && answer[4 + 2 * i] == first + i);
+    }
+}
+
+/**@brief Answer of known length received in chunks far apart.
+ */
+static void known_length_test(void)
+{
+    const uint8_t pdu[] = { TEST_AXIS, 0x03, TEST_ADDRESS >> 8, TEST_ADDRESS & 0xFF, 0x00, TEST_WORDS_NUM };
+    
+    //Address, function code, byte count and data come in chunks 5 ms apart, much longer than t3.5
+    read_answer_set(0);
+    bus.chunk_length = 2;
+    request_send(pdu, sizeof(pdu), 3 + 2 * TEST_WORDS_NUM, 1000);
+    TEST_CHECK(completions == 0);
+    for (uint32_t now_us = 6000; bus.rx_offset < bus.rx_length; now_us += 5000)
+    {
+        TEST_CHECK(completions == 0);
+        modbus_async_poll(&async, now_us);
+        
+        //Rest of the answer is waited for until the deadline, not the t3.5 silence
+        TEST_CHECK((completions != 0) || (modbus_async_timeout_us(&async, now_us) > TEST_T35_US));
+    }
+    
+    read_answer_check(0);
+}
+
+/**@brief Answer of known length not completed before the deadline.
+ */
+static void deadline_test(void)
+{
+    const uint8_t pdu[] = { TEST_AXIS, 0x03, TEST_ADDRESS >> 8, TEST_ADDRESS & 0xFF, 0x00, TEST_WORDS_NUM };
+    
+    read_answer_set(0);
+    bus.chunk_length = 3;
+    request_send(pdu, sizeof(pdu), 3 + 2 * TEST_WORDS_NUM, 100000);
+    modbus_async_poll(&async, 101000);
+    
+    //Rest of the answer is lost
+    bus.rx_length = bus.rx_offset;
+    
+    const uint32_t timeout_us = modbus_async_timeout_us(&async, 101000);
+    TEST_CHECK(timeout_us > TEST_T35_US);
+    modbus_async_poll(&async, 101000 + timeout_us - 1);
+    TEST_CHECK(completions == 0);
+    modbus_async_poll(&async, 101000 + timeout_us);
+    TEST_CHECK(completions == 1);
+    TEST_CHECK(result == MODBUS_PROTOCOL_RESULT_TIMEOUT);
+}
+
+/**@brief Answer with unknown function code completed by the t3.5 silence.
+ */
+static void unknown_length_test(void)
+{
+    const uint8_t pdu[] = { TEST_AXIS, 0x41, 0x00 };
+    const uint8_t answer_pdu[] = { TEST_AXIS, 0x41, 0x12, 0x34 };
+    
+    memcpy(bus.answer, answer_pdu, sizeof(answer_pdu));
+    bus.answer_length = sizeof(answer_pdu);
+    bus.chunk_length = 0;
+    request_send(pdu, sizeof(pdu), sizeof(answer_pdu), 300000);
+    TEST_CHECK(completions == 0);
+    
+    modbus_async_poll(&async, 301000);
+    TEST_CHECK(completions == 0);
+    TEST_CHECK(modbus_async_timeout_us(&async, 301000) <= TEST_T35_US);
+    modbus_async_poll(&async, 301000 + TEST_T35_US + 1000);
+    TEST_CHECK(completions == 1);
+    TEST_CHECK(result == MODBUS_PROTOCOL_RESULT_SUCCESS);
+    TEST_CHECK(transaction.frame.pdu_length == sizeof(answer_pdu));
+    TEST_CHECK(memcmp(MODBUS_FRAME_PDU(&transaction.frame), answer_pdu, sizeof(answer_pdu)) == 0);
+}
+
+/**@brief Bytes received outside of a transaction don't corrupt the next answer.
+ */
+static void stale_input_test(void)
+{
+    const uint8_t pdu[] = { TEST_AXIS, 0x03, TEST_ADDRESS >> 8, TEST_ADDRESS & 0xFF, 0x00, TEST_WORDS_NUM };
+    
+    //Late answer to a timed out request is received before the request
+    read_answer_set(0x10);
+    rx_frame_append(bus.answer, bus.answer_length);
+    read_answer_set(0x20);
+    bus.chunk_length = 0;
+    bus.trailing_length = 3;
+    request_send(pdu, sizeof(pdu), 3 + 2 * TEST_WORDS_NUM, 500000);
+    read_answer_check(0x20);
+    
+    //Bytes following the answer in the same chunk are discarded before the next request
+    read_answer_set(0x30);
+    bus.trailing_length = 0;
+    request_send(pdu, sizeof(pdu), 3 + 2 * TEST_WORDS_NUM, 510000);
+    read_answer_check(0x30);
+}
+
+int main(void)
+{
+    const modbus_params_t params = 
+    {
+        .mode = MODBUS_PROTOCOL_MODE_RTU,
+        .write = bus_write,
+        .read = NULL,
+        .idle = bus_idle,
+        .writev = NULL,
+        .receive = bus_receive,
+        .user_data = NULL,
+        .timeout_ms = 0,
+        .baud_rate = TEST_BAUD_RATE
+    };
+    
+    modbus_protocol_initialize(&ctx, &params);
+    modbus_async_initialize(&async, &ctx);
+    
+    known_length_test();
+    deadline_test();
+    unknown_length_test();
+    stale_input_test();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
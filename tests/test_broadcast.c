@@ -0,0 +1,83 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Broadcast writes verification (@see servo_broadcast): servos are read back in a rotation,
+ * a limited budget per call continues from the first servo not verified by the previous call.
+ */
+
+#include <stdlib.h>
+#include "servo/servo_broadcast.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXES_NUM    (6)
+#define TEST_ADDRESS     (0x0010)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+
+/**@brief Check the servos read back since the last check.
+ */
+static void axes_check(const uint8_t * axes, uint16_t axes_num)
+{
+    TEST_CHECK(loopback.requests_num == axes_num);
+    for (uint16_t i = 0; (i < axes_num) && (i < loopback.requests_num); i++)
+    {
+        TEST_CHECK(loopback.axes[i] == axes[i]);
+    }
+    test_loopback_requests_clear(&loopback);
+}
+
+int main(void)
+{
+    servo_broadcast_t broadcast;
+    uint16_t words[] = { 0x1111, 0x2222, 0x3333 };
+    static const uint8_t first[] = { 1, 2 };
+    static const uint8_t second[] = { 3, 4 };
+    static const uint8_t third[] = { 5, 6 };
+    
+    test_loopback_initialize(&loopback, TEST_AXES_NUM, 0);
+    servo_broadcast_initialize(&broadcast, &loopback.ctx);
+    for (uint8_t axis = 1; axis <= TEST_AXES_NUM; axis++)
+    {
+        servo_broadcast_axis_add(&broadcast, axis);
+    }
+    
+    TEST_CHECK(servo_broadcast_nwords_write(&broadcast, TEST_ADDRESS, words, 3));
+    TEST_CHECK(loopback.requests_num == 1 && loopback.axes[0] == MODBUS_ADDRESS_BROADCAST);
+    test_loopback_requests_clear(&loopback);
+    
+    //Every call verifies the next servos in order, none is skipped or verified twice
+    TEST_CHECK(servo_broadcast_verify(&broadcast, 2) == 4);
+    axes_check(first, 2);
+    for (uint8_t axis = 1; axis <= TEST_AXES_NUM; axis++)
+    {
+        TEST_CHECK(servo_broadcast_state_get(&broadcast, axis) == 
+                   ((axis <= 2) ? SERVO_BROADCAST_STATE_VERIFIED : SERVO_BROADCAST_STATE_PENDING));
+    }
+    
+    TEST_CHECK(servo_broadcast_verify(&broadcast, 2) == 2);
+    axes_check(second, 2);
+    
+    TEST_CHECK(servo_broadcast_verify(&broadcast, 2) == 0);
+    axes_check(third, 2);
+    
+    TEST_CHECK(servo_broadcast_verify(&broadcast, 2) == 0);
+    axes_check(NULL, 0);
+    for (uint8_t axis = 1; axis <= TEST_AXES_NUM; axis++)
+    {
+        TEST_CHECK(servo_broadcast_state_get(&broadcast, axis) == SERVO_BROADCAST_STATE_VERIFIED);
+    }
+    
+    //Next write restarts the rotation from the first servo
+    TEST_CHECK(servo_broadcast_oneword_write(&broadcast, TEST_ADDRESS, 0x4444));
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_broadcast_verify(&broadcast, 5) == 1);
+    TEST_CHECK(loopback.requests_num == 5 && loopback.axes[4] == 5);
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_broadcast_verify(&broadcast, 5) == 0);
+    TEST_CHECK(loopback.requests_num == 1 && loopback.axes[0] == 6);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,229 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Bus owner queue (@see servo_bus) on the loopback bus polled by the test: lanes have strict priority,
+ * a critical job preempts a long read between its transactions, jobs of one lane are executed in the order
+ * of submission, failed jobs keep the result and the exception code, the lane statistics follow the jobs
+ * and the owner is woken only when it waits.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "servo/servo_bus.h"
+#include "servo/servo_driver.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS_CRITICAL    (1)
+#define TEST_AXIS_NORMAL      (2)
+#define TEST_AXIS_BACKGROUND  (3)
+#define TEST_ADDRESS          (0x0010)
+#define TEST_ADDRESS_INVALID  (0x0500)
+#define TEST_DUMP_WORDS_NUM   (2 * SERVO_READ_WORDS_MAX + 50)
+#define TEST_STEP_US          (100)
+#define TEST_JOBS_NUM         (8)
+#define TEST_POLLS_MAX        (100)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+static servo_bus_t bus;
+static servo_bus_job_t * completed[TEST_JOBS_NUM];
+static uint8_t completed_num;
+static uint8_t wakes_num;
+
+/**@brief Clock callback: every call takes TEST_STEP_US, so every job waits and runs for some time.
+ */
+static uint32_t stepping_clock(void * user_data)
+{
+    (void)user_data;
+    loopback.now_us += TEST_STEP_US;
+    
+    return loopback.now_us;
+}
+
+/**@brief Wake callback: count the wakes.
+ */
+static void wake(void * wake_data)
+{
+    (void)wake_data;
+    wakes_num++;
+}
+
+/**@brief Completion callback: record the order of completion.
+ */
+static void complete(servo_bus_job_t * job, bool success)
+{
+    (void)success;
+    if (completed_num < TEST_JOBS_NUM)
+    {
+        completed[completed_num++] = job;
+    }
+}
+
+/**@brief Poll the bus until all jobs are completed.
+ */
+static void bus_run(void)
+{
+    for (uint8_t i = 0; (i < TEST_POLLS_MAX) && servo_bus_poll(&bus); i++)
+    {
+    }
+    TEST_CHECK(!servo_bus_poll(&bus));
+}
+
+/**@brief Forget the recorded requests and completions.
+ */
+static void records_clear(void)
+{
+    test_loopback_requests_clear(&loopback);
+    completed_num = 0;
+}
+
+/**@brief Job function writing two words by separate requests, which are not interleaved with other jobs.
+ */
+static bool pair_write(modbus_ctx_t * ctx, servo_bus_job_t * job)
+{
+    return servo_oneword_write(ctx, job->axis, TEST_ADDRESS, 0x1111) && 
+           servo_oneword_write(ctx, job->axis, TEST_ADDRESS + 1, 0x2222);
+}
+
+/**@brief Critical job preempts the started read of the background lane, the normal lane waits for it.
+ */
+static void priority_test(void)
+{
+    static uint16_t dump[TEST_DUMP_WORDS_NUM];
+    uint16_t word = 0;
+    servo_bus_job_t background;
+    servo_bus_job_t normal;
+    servo_bus_job_t critical;
+    servo_bus_stats_t stats;
+    
+    records_clear();
+    TEST_CHECK(servo_bus_read_prepare(&background, TEST_AXIS_BACKGROUND, 0x0000, dump, TEST_DUMP_WORDS_NUM));
+    TEST_CHECK(servo_bus_read_prepare(&normal, TEST_AXIS_NORMAL, TEST_ADDRESS, &word, 1));
+    TEST_CHECK(servo_bus_oneword_write_prepare(&critical, TEST_AXIS_CRITICAL, TEST_ADDRESS, 0x1234));
+    
+    //First transaction of the dump is on the bus when the other jobs arrive
+    servo_bus_submit(&bus, SERVO_BUS_LANE_BACKGROUND, &background, complete, NULL);
+    TEST_CHECK(servo_bus_poll(&bus));
+    servo_bus_submit(&bus, SERVO_BUS_LANE_NORMAL, &normal, complete, NULL);
+    servo_bus_submit(&bus, SERVO_BUS_LANE_CRITICAL, &critical, complete, NULL);
+    bus_run();
+    
+    static const uint8_t axes[] = 
+    {
+        TEST_AXIS_BACKGROUND, TEST_AXIS_CRITICAL, TEST_AXIS_NORMAL, TEST_AXIS_BACKGROUND, TEST_AXIS_BACKGROUND
+    };
+    TEST_CHECK(loopback.requests_num == sizeof(axes));
+    TEST_CHECK(memcmp(loopback.axes, axes, sizeof(axes)) == 0);
+    TEST_CHECK((completed_num == 3) && (completed[0] == &critical) && (completed[1] == &normal));
+    TEST_CHECK((completed[2] == &background) && (background.done == TEST_DUMP_WORDS_NUM));
+    TEST_CHECK(background.result == MODBUS_PROTOCOL_RESULT_SUCCESS);
+    
+    servo_bus_stats_get(&bus, &stats);
+    const servo_bus_lane_stats_t * const lane = &stats.lanes[SERVO_BUS_LANE_BACKGROUND];
+    TEST_CHECK((lane->jobs == 1) && (lane->transactions == 3) && (lane->preemptions == 1));
+    TEST_CHECK(stats.lanes[SERVO_BUS_LANE_CRITICAL].preemptions == 0);
+    
+    //Waits of the jobs queued behind a transaction are recorded
+    for (uint8_t i = 0; i < SERVO_BUS_LANES_NUM; i++)
+    {
+        TEST_CHECK((stats.lanes[i].jobs == 1) && (stats.lanes[i].failures == 0));
+        TEST_CHECK((stats.lanes[i].wait.count == 1) && (stats.lanes[i].run.count == 1));
+    }
+    TEST_CHECK(stats.lanes[SERVO_BUS_LANE_CRITICAL].wait.max_us >= TEST_STEP_US);
+    TEST_CHECK(lane->run.max_us > stats.lanes[SERVO_BUS_LANE_CRITICAL].run.max_us);
+}
+
+/**@brief Jobs of one lane are executed in the order of submission, calls are not interleaved.
+ */
+static void order_test(void)
+{
+    servo_bus_job_t jobs[4];
+    uint16_t words[2];
+    
+    records_clear();
+    TEST_CHECK(servo_bus_read_prepare(&jobs[0], TEST_AXIS_NORMAL, TEST_ADDRESS, &words[0], 1));
+    servo_bus_call_prepare(&jobs[1], pair_write);
+    jobs[1].axis = TEST_AXIS_CRITICAL;
+    TEST_CHECK(servo_bus_read_prepare(&jobs[2], TEST_AXIS_BACKGROUND, TEST_ADDRESS, &words[1], 1));
+    TEST_CHECK(servo_bus_oneword_write_prepare(&jobs[3], TEST_AXIS_NORMAL, TEST_ADDRESS, 0x5678));
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        servo_bus_submit(&bus, SERVO_BUS_LANE_NORMAL, &jobs[i], complete, NULL);
+    }
+    
+    //Only the call has to be run to its end in one step
+    TEST_CHECK(servo_bus_poll(&bus) && servo_bus_poll(&bus));
+    TEST_CHECK(loopback.requests_num == 3);
+    TEST_CHECK((loopback.axes[1] == TEST_AXIS_CRITICAL) && (loopback.axes[2] == TEST_AXIS_CRITICAL));
+    bus_run();
+    
+    TEST_CHECK(completed_num == 4);
+    for (uint8_t i = 0; i < completed_num; i++)
+    {
+        TEST_CHECK(completed[i] == &jobs[i]);
+    }
+    TEST_CHECK(servo_nwords_read(&loopback.ctx, TEST_AXIS_CRITICAL, TEST_ADDRESS, words, 2));
+    TEST_CHECK((words[0] == 0x1111) && (words[1] == 0x2222));
+}
+
+/**@brief Failed job keeps the result and the exception code, the lane counts the failure.
+ */
+static void failure_test(void)
+{
+    uint16_t word;
+    servo_bus_job_t job;
+    servo_bus_stats_t before;
+    servo_bus_stats_t after;
+    
+    TEST_CHECK(!servo_bus_read_prepare(&job, 0, TEST_ADDRESS, &word, 1));
+    TEST_CHECK(!servo_bus_read_prepare(&job, TEST_AXIS_NORMAL, 0xFFFF, &word, 2));
+    
+    records_clear();
+    servo_bus_stats_get(&bus, &before);
+    TEST_CHECK(servo_bus_read_prepare(&job, TEST_AXIS_NORMAL, TEST_ADDRESS_INVALID, &word, 1));
+    servo_bus_submit(&bus, SERVO_BUS_LANE_CRITICAL, &job, complete, NULL);
+    bus_run();
+    servo_bus_stats_get(&bus, &after);
+    
+    TEST_CHECK((completed_num == 1) && (job.done == 0));
+    TEST_CHECK(job.result == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+    TEST_CHECK(job.exception == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+    TEST_CHECK(after.lanes[SERVO_BUS_LANE_CRITICAL].failures == before.lanes[SERVO_BUS_LANE_CRITICAL].failures + 1);
+}
+
+/**@brief Owner is woken by the first submission after it starts to wait, and does not wait with jobs queued.
+ */
+static void wake_test(void)
+{
+    uint16_t word;
+    servo_bus_job_t jobs[2];
+    
+    TEST_CHECK(servo_bus_read_prepare(&jobs[0], TEST_AXIS_NORMAL, TEST_ADDRESS, &word, 1));
+    TEST_CHECK(servo_bus_read_prepare(&jobs[1], TEST_AXIS_NORMAL, TEST_ADDRESS, &word, 1));
+    
+    wakes_num = 0;
+    servo_bus_submit(&bus, SERVO_BUS_LANE_NORMAL, &jobs[0], NULL, NULL);
+    TEST_CHECK((wakes_num == 0) && !servo_bus_idle_enter(&bus));
+    bus_run();
+    
+    TEST_CHECK(servo_bus_idle_enter(&bus));
+    servo_bus_submit(&bus, SERVO_BUS_LANE_BACKGROUND, &jobs[0], NULL, NULL);
+    servo_bus_submit(&bus, SERVO_BUS_LANE_BACKGROUND, &jobs[1], NULL, NULL);
+    TEST_CHECK(wakes_num == 1);
+    bus_run();
+}
+
+int main(void)
+{
+    test_loopback_initialize(&loopback, 3, 0);
+    servo_bus_initialize(&bus, &loopback.ctx, stepping_clock, NULL, wake, NULL);
+    
+    priority_test();
+    order_test();
+    failure_test();
+    wake_test();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,178 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Servo register cache (@see servo_cache) on the loopback bus: TTL and static registers are served
+ * without requests while fresh, invalidation and exceptions drop them, unchanged writes are skipped, dirty
+ * registers are flushed by coalesced writes and failed definitions leave the cache unchanged.
+ */
+
+#include <stdlib.h>
+#include "servo/servo_cache.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS           (1)
+#define TEST_TTL_ADDRESS    (0x0010)
+#define TEST_TTL_MS         (100)
+#define TEST_STATIC_ADDRESS (0x0020)
+#define TEST_DIRTY_ADDRESS  (0x0030)
+#define TEST_WORDS_NUM      (4)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+static servo_cache_t cache;
+static servo_cache_invalidate_t invalidate_reason;
+static unsigned int invalidations;
+
+/**@brief Invalidation callback: store the reason.
+ */
+static void cache_invalidated(servo_cache_t * invalidated, servo_cache_invalidate_t reason)
+{
+    TEST_CHECK(invalidated == &cache);
+    invalidate_reason = reason;
+    invalidations++;
+}
+
+/**@brief Read the words through the cache and check the number of requests it took.
+ */
+static void read_check(uint16_t address, uint16_t * words, uint32_t now_ms, uint16_t requests_num)
+{
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_cache_nwords_read(&cache, address, words, TEST_WORDS_NUM, now_ms));
+    TEST_CHECK(loopback.requests_num == requests_num);
+}
+
+/**@brief Definitions out of the address space or over the capacity are rejected as a whole.
+ */
+static void define_test(void)
+{
+    TEST_CHECK(!servo_cache_registers_define(&cache, 0xFFF0, 0x0020, SERVO_CACHE_POLICY_STATIC, 0));
+    TEST_CHECK(cache.registers_num == 0);
+    TEST_CHECK(servo_cache_registers_define(&cache, 0xFFF0, 0x0010, SERVO_CACHE_POLICY_STATIC, 0));
+    TEST_CHECK(cache.registers_num == 0x0010);
+    
+    //Registers already defined don't take more capacity
+    TEST_CHECK(servo_cache_registers_define(&cache, 0xFFE0, 0x0020, SERVO_CACHE_POLICY_LIVE, 0));
+    TEST_CHECK(cache.registers_num == 0x0020);
+    TEST_CHECK(!servo_cache_registers_define(&cache, 0x1000, SERVO_CACHE_REGISTERS_NUM, SERVO_CACHE_POLICY_STATIC, 0));
+    TEST_CHECK(cache.registers_num == 0x0020);
+    TEST_CHECK(cache.registers[0].address == 0xFFE0);
+    
+    servo_cache_initialize(&cache, &loopback.ctx, TEST_AXIS, cache_invalidated, NULL);
+}
+
+/**@brief TTL registers are read again once their time to live passes.
+ */
+static void ttl_test(void)
+{
+    uint16_t * const registers = &loopback.sim.axes[0].registers[TEST_TTL_ADDRESS];
+    uint16_t words[TEST_WORDS_NUM];
+    
+    TEST_CHECK(servo_cache_registers_define(&cache, TEST_TTL_ADDRESS, TEST_WORDS_NUM, SERVO_CACHE_POLICY_TTL, TEST_TTL_MS));
+    registers[0] = 0x1111;
+    read_check(TEST_TTL_ADDRESS, words, 1000, 1);
+    TEST_CHECK(words[0] == 0x1111);
+    
+    registers[0] = 0x2222;
+    read_check(TEST_TTL_ADDRESS, words, 1000 + TEST_TTL_MS - 1, 0);
+    TEST_CHECK(words[0] == 0x1111);
+    read_check(TEST_TTL_ADDRESS, words, 1000 + TEST_TTL_MS, 1);
+    TEST_CHECK(words[0] == 0x2222);
+    
+    //Range only partly cached is read from the servo
+    read_check(TEST_TTL_ADDRESS + 1, words, 1000 + TEST_TTL_MS, 1);
+}
+
+/**@brief Static registers stay cached until invalidation.
+ */
+static void invalidate_test(void)
+{
+    uint16_t * const registers = &loopback.sim.axes[0].registers[TEST_STATIC_ADDRESS];
+    uint16_t words[TEST_WORDS_NUM];
+    
+    TEST_CHECK(servo_cache_registers_define(&cache, TEST_STATIC_ADDRESS, TEST_WORDS_NUM, SERVO_CACHE_POLICY_STATIC, 0));
+    registers[1] = 0x3333;
+    read_check(TEST_STATIC_ADDRESS, words, 2000, 1);
+    registers[1] = 0x4444;
+    read_check(TEST_STATIC_ADDRESS, words, 1000000, 0);
+    TEST_CHECK(words[1] == 0x3333);
+    
+    servo_cache_invalidate(&cache, SERVO_CACHE_INVALIDATE_RESET);
+    TEST_CHECK((invalidations == 1) && (invalidate_reason == SERVO_CACHE_INVALIDATE_RESET));
+    read_check(TEST_STATIC_ADDRESS, words, 1000000, 1);
+    TEST_CHECK(words[1] == 0x4444);
+    
+    //Exception answer drops all cached values
+    TEST_CHECK(!servo_cache_nwords_read(&cache, 0x0500, words, 1, 1000000));
+    TEST_CHECK((invalidations == 2) && (invalidate_reason == SERVO_CACHE_INVALIDATE_EXCEPTION));
+    read_check(TEST_STATIC_ADDRESS, words, 1000000, 1);
+    TEST_CHECK(cache.stats.invalidations == 2);
+}
+
+/**@brief Writes of unchanged values are skipped or trimmed.
+ */
+static void write_test(void)
+{
+    uint16_t * const registers = &loopback.sim.axes[0].registers[TEST_STATIC_ADDRESS];
+    uint16_t words[TEST_WORDS_NUM];
+    
+    read_check(TEST_STATIC_ADDRESS, words, 3000, 0);
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_cache_oneword_write(&cache, TEST_STATIC_ADDRESS + 1, words[1], 3000));
+    TEST_CHECK(servo_cache_nwords_write(&cache, TEST_STATIC_ADDRESS, words, TEST_WORDS_NUM, 3000));
+    TEST_CHECK(loopback.requests_num == 0);
+    TEST_CHECK(cache.stats.writes_skipped == 2);
+    
+    //Only the changed middle words are written
+    words[1] = 0x5555;
+    words[2] = 0x6666;
+    registers[0] = 0x7777;
+    TEST_CHECK(servo_cache_nwords_write(&cache, TEST_STATIC_ADDRESS, words, TEST_WORDS_NUM, 3000));
+    TEST_CHECK(loopback.requests_num == 1);
+    TEST_CHECK((registers[0] == 0x7777) && (registers[1] == 0x5555) && (registers[2] == 0x6666));
+    read_check(TEST_STATIC_ADDRESS, words, 3000, 0);
+    TEST_CHECK((words[1] == 0x5555) && (words[2] == 0x6666));
+}
+
+/**@brief Dirty registers are served by reads and flushed by one write per adjacent run.
+ */
+static void flush_test(void)
+{
+    uint16_t * const registers = &loopback.sim.axes[0].registers[TEST_DIRTY_ADDRESS];
+    uint16_t words[TEST_WORDS_NUM];
+    
+    TEST_CHECK(servo_cache_registers_define(&cache, TEST_DIRTY_ADDRESS, TEST_WORDS_NUM, SERVO_CACHE_POLICY_STATIC, 0));
+    TEST_CHECK(!servo_cache_word_set(&cache, TEST_DIRTY_ADDRESS + TEST_WORDS_NUM, 0x0001));
+    TEST_CHECK(servo_cache_word_set(&cache, TEST_DIRTY_ADDRESS, 0x0A0A));
+    TEST_CHECK(servo_cache_word_set(&cache, TEST_DIRTY_ADDRESS + 1, 0x0B0B));
+    TEST_CHECK(servo_cache_word_set(&cache, TEST_DIRTY_ADDRESS + 3, 0x0D0D));
+    TEST_CHECK(servo_cache_dirty(&cache));
+    
+    //Dirty values supersede the servo registers
+    registers[2] = 0x0C0C;
+    read_check(TEST_DIRTY_ADDRESS, words, 4000, 1);
+    TEST_CHECK((words[0] == 0x0A0A) && (words[1] == 0x0B0B) && (words[2] == 0x0C0C) && (words[3] == 0x0D0D));
+    TEST_CHECK(registers[0] != 0x0A0A);
+    
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_cache_flush(&cache, 4000));
+    TEST_CHECK(loopback.requests_num == 2);
+    TEST_CHECK(!servo_cache_dirty(&cache));
+    TEST_CHECK((registers[0] == 0x0A0A) && (registers[1] == 0x0B0B) && (registers[3] == 0x0D0D));
+    read_check(TEST_DIRTY_ADDRESS, words, 4000, 0);
+}
+
+int main(void)
+{
+    test_loopback_initialize(&loopback, 1, 0);
+    servo_cache_initialize(&cache, &loopback.ctx, TEST_AXIS, cache_invalidated, NULL);
+    
+    define_test();
+    ttl_test();
+    invalidate_test();
+    write_test();
+    flush_test();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,202 @@
+/**
+ * @ingroup tests
+ *
+ * @brief C++ fixed-shape codecs (@see modbus_cxx) against the C protocol layer: CRC and LRC match the C
+ * implementations, requests of every function are encoded to the same bytes as by the C frame encoders
+ * in every mode, answers and exceptions encoded by the C frame encoders are decoded and parsed,
+ * corrupted answers are rejected.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include "modbus/modbus.hpp"
+#include "test.h"
+
+extern "C"
+{
+#include "modbus/modbus_protocol_ascii.h"
+#include "modbus/modbus_protocol_rtu.h"
+#include "modbus/modbus_protocol_tcp.h"
+}
+
+unsigned int test_failures;
+
+namespace
+{
+
+constexpr uint8_t test_unit = 0x11;
+constexpr uint16_t test_address = 0x0800;
+constexpr uint16_t test_transaction_id = 0x1234;
+constexpr std::size_t test_pdu_size = 64;
+
+/**@brief Encoded frame of the C protocol layer. */
+struct c_frame
+{
+    uint8_t buffer[MODBUS_FRAME_SIZE(test_pdu_size)];   /**< Frame storage. */
+    const uint8_t * adu;                                /**< Encoded frame inside the storage. */
+    uint16_t length;                                    /**< Length of the encoded frame. */
+};
+    
+/**@brief Encode the PDU by the C frame encoder of the mode. */
+template <modbus_mode_t Mode>
+void c_encode(c_frame & encoded, const uint8_t * pdu, std::size_t pdu_length)
+{
+    modbus_frame_t frame;
+    
+    frame.buffer = encoded.buffer;
+    frame.size = sizeof(encoded.buffer);
+    frame.pdu_length = (uint16_t)pdu_length;
+    std::memcpy(MODBUS_FRAME_PDU(&frame), pdu, pdu_length);
+    
+    if constexpr (Mode == MODBUS_PROTOCOL_MODE_ASCII)
+    {
+        encoded.adu = modbus_protocol_ascii_frame_encode(&frame, &encoded.length);
+    }
+    else if constexpr (Mode == MODBUS_PROTOCOL_MODE_TCP)
+    {
+        encoded.adu = modbus_protocol_tcp_frame_encode(&frame, test_transaction_id, &encoded.length);
+    }
+    else
+    {
+        encoded.adu = modbus_protocol_rtu_frame_encode(&frame, &encoded.length);
+    }
+}
+
+/**@brief Build the request by the C++ codec and compare it with the C encoding of the same PDU. */
+template <modbus_mode_t Mode, class Function, class Build>
+void request_check(Build build)
+{
+    using codec_type = modbus::codec<Mode, Function>;
+    typename codec_type::request_frame request;
+    c_frame encoded;
+    
+    uint8_t * const pdu = codec_type::request_pdu(request);
+    build(pdu);
+    c_encode<Mode>(encoded, pdu, Function::request_length);
+    codec_type::request_encode(request, test_transaction_id);
+    
+    TEST_CHECK(encoded.adu != nullptr);
+    TEST_CHECK(encoded.length == request.size());
+    TEST_CHECK((encoded.adu != nullptr) && (std::memcmp(encoded.adu, request.data(), request.size()) == 0));
+}
+
+/**@brief Decode the answer encoded by the C layer with the C++ codec.
+ *
+ * @param[in]  corrupt Byte of the encoded answer to flip (-1 to keep the answer intact).
+ * @param[out] pdu     Position of the decoded answer PDU.
+ */
+template <modbus_mode_t Mode, class Function>
+modbus_protocol_result_t answer_check(const uint8_t * answer, 
+                                      std::size_t answer_length, 
+                                      int corrupt, 
+                                      typename modbus::codec<Mode, Function>::answer_frame & frame, 
+                                      const uint8_t *& pdu)
+{
+    using codec_type = modbus::codec<Mode, Function>;
+    c_frame encoded;
+    
+    c_encode<Mode>(encoded, answer, answer_length);
+    if ((encoded.adu == nullptr) || (encoded.length > frame.size()))
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    std::memcpy(frame.data(), encoded.adu, encoded.length);
+    if (corrupt >= 0)
+    {
+        frame[corrupt] ^= 0x01;
+    }
+    
+    //Length is learnt from the first bytes, as by the client
+    const std::size_t length = codec_type::framing_type::answer_length(frame.data(), frame.size());
+    if (length != encoded.length)
+    {
+        return MODBUS_PROTOCOL_RESULT_CORRUPTED;
+    }
+    
+    return codec_type::answer_decode(frame, length, test_unit, test_transaction_id, pdu);
+}
+
+/**@brief Requests of every function, answers and exceptions to the read of Count registers in the mode. */
+template <modbus_mode_t Mode, uint16_t Count>
+void mode_test()
+{
+    using read = modbus::read_registers<Count>;
+    using write = modbus::write_registers<Count>;
+    using read_write = modbus::read_write_registers<Count, Count>;
+    std::array<uint16_t, Count> words;
+    std::array<uint16_t, Count> parsed{};
+    uint8_t answer[test_pdu_size];
+    typename modbus::codec<Mode, read>::answer_frame frame;
+    const uint8_t * pdu;
+    
+    for (uint16_t i = 0; i < Count; i++)
+    {
+        words[i] = (uint16_t)(0xA500 + 0x0101 * i);
+    }
+    
+    request_check<Mode, read>([&](uint8_t * request) { read::request_build(request, test_unit, test_address); });
+    request_check<Mode, write>([&](uint8_t * request) { write::request_build(request, test_unit, test_address, words); });
+    request_check<Mode, read_write>([&](uint8_t * request)
+                                    { read_write::request_build(request, test_unit, test_address, test_address + Count, words); });
+    request_check<Mode, modbus::write_register>([&](uint8_t * request)
+                                                { modbus::write_register::request_build(request, test_unit, test_address, words[0]); });
+                                                
+    //Answer to the read
+    answer[0] = test_unit;
+    answer[1] = read::function;
+    answer[2] = (uint8_t)(2 * Count);
+    for (uint16_t i = 0; i < Count; i++)
+    {
+        answer[3 + 2 * i] = (uint8_t)(words[i] >> 8);
+        answer[4 + 2 * i] = (uint8_t)(words[i] & 0xFF);
+    }
+    TEST_CHECK(((answer_check<Mode, read>(answer, read::answer_length, -1, frame, pdu)) == MODBUS_PROTOCOL_RESULT_SUCCESS) && 
+               read::answer_parse(pdu, parsed) && (parsed == words));
+    
+    //Corrupted checksum character or transaction identifier (TCP), answer of another server
+    const int corrupted = (Mode == MODBUS_PROTOCOL_MODE_TCP) ? 1 : (Mode == MODBUS_PROTOCOL_MODE_ASCII) ? 6 : 3;
+    TEST_CHECK((answer_check<Mode, read>(answer, read::answer_length, corrupted, frame, pdu)) == MODBUS_PROTOCOL_RESULT_CORRUPTED);
+    answer[0] = test_unit + 1;
+    TEST_CHECK((answer_check<Mode, read>(answer, read::answer_length, -1, frame, pdu)) == MODBUS_PROTOCOL_RESULT_CORRUPTED);
+    
+    //Exception answer is shorter than the expected answer
+    const uint8_t exception[] = { test_unit, read::function | 0x80, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS };
+    TEST_CHECK(((answer_check<Mode, read>(exception, sizeof(exception), -1, frame, pdu)) == MODBUS_PROTOCOL_RESULT_EXCEPTION) && 
+               (pdu[2] == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS));
+}
+
+/**@brief CRC and LRC of the C++ layer against the C implementations. */
+void checksum_test()
+{
+    uint8_t data[2 * modbus::crc_inline_max];
+    
+    for (std::size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)(0x5A * i + 7);
+    }
+    
+    //Lengths on both sides of the inlined table loop
+    for (std::size_t length = 0; length <= sizeof(data); length++)
+    {
+        TEST_CHECK(modbus::crc_calculate(data, length) == modbus_crc_update(MODBUS_CRC_INITIAL, data, length));
+        TEST_CHECK(modbus::lrc_calculate(data, length) == modbus_protocol_ascii_lrc_calculate(data, (uint16_t)length));
+    }
+}
+
+} //namespace
+
+int main()
+{
+    modbus_crc_initialize();
+    
+    checksum_test();
+    mode_test<MODBUS_PROTOCOL_MODE_RTU, 1>();
+    mode_test<MODBUS_PROTOCOL_MODE_RTU, 20>();
+    mode_test<MODBUS_PROTOCOL_MODE_ASCII, 1>();
+    mode_test<MODBUS_PROTOCOL_MODE_ASCII, 20>();
+    mode_test<MODBUS_PROTOCOL_MODE_TCP, 1>();
+    mode_test<MODBUS_PROTOCOL_MODE_TCP, 20>();
+    mode_test<MODBUS_PROTOCOL_MODE_RTU_OVER_TCP, 4>();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
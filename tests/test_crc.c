@@ -0,0 +1,92 @@
+/**
+ * @ingroup tests
+ *
+ * @brief CRC engine (@see modbus_crc): every kernel matches the reference implementation on whole 
+ * and split messages of any length and alignment, a message followed by its own CRC checks to zero.
+ */
+
+#include <stdlib.h>
+#include "modbus/modbus_crc.h"
+#include "test.h"
+
+#define TEST_DATA_SIZE    (600)
+
+unsigned int test_failures;
+
+static uint8_t data[TEST_DATA_SIZE + 16];
+
+/**@brief Check the selected kernel against the reference implementation.
+ */
+static void engine_check(void)
+{
+    for (uint16_t length = 0; length <= TEST_DATA_SIZE; length += (length < 200) ? 1 : 37)
+    {
+        for (uint8_t offset = 0; offset < 16; offset += 5)
+        {
+            const uint8_t * const message = &data[offset];
+            const uint16_t expected = modbus_crc_update_table(MODBUS_CRC_INITIAL, message, length);
+            
+            TEST_CHECK(modbus_crc_update(MODBUS_CRC_INITIAL, message, length) == expected);
+            
+            //Message fed in two parts at any split point
+            for (uint16_t split = 0; split <= length; split += (length < 80) ? 1 : 13)
+            {
+                const uint16_t crc = modbus_crc_update(MODBUS_CRC_INITIAL, message, split);
+                TEST_CHECK(modbus_crc_update(crc, &message[split], length - split) == expected);
+            }
+        }
+    }
+    
+    //CRC appended in place, low byte first, makes the CRC of the whole frame zero
+    uint8_t frame[260];
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        frame[i] = data[i];
+    }
+    const uint16_t crc = modbus_crc_update(MODBUS_CRC_INITIAL, frame, 256);
+    frame[256] = (uint8_t)(crc & 0xFF);
+    frame[257] = (uint8_t)(crc >> 8);
+    TEST_CHECK(modbus_crc_update(MODBUS_CRC_INITIAL, frame, 258) == 0);
+}
+
+int main(void)
+{
+    static const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    uint32_t seed = 0x2468ACE1;
+    
+    for (uint16_t i = 0; i < sizeof(data); i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = (uint8_t)(seed >> 24);
+    }
+    
+    //Selection builds the slicing tables itself, before the engine is initialized
+    TEST_CHECK(modbus_crc_engine_select(MODBUS_CRC_ENGINE_SLICE16));
+    TEST_CHECK(modbus_crc_engine_get() == MODBUS_CRC_ENGINE_SLICE16);
+    engine_check();
+    
+    modbus_crc_initialize();
+    const modbus_crc_engine_t best = modbus_crc_engine_get();
+    TEST_CHECK((best == MODBUS_CRC_ENGINE_CLMUL) || (best == MODBUS_CRC_ENGINE_SLICE16));
+    
+    //Check value of CRC-16/MODBUS
+    TEST_CHECK(modbus_crc_update_table(MODBUS_CRC_INITIAL, check, sizeof(check)) == 0x4B37);
+    
+    static const modbus_crc_engine_t engines[] = 
+    {
+        MODBUS_CRC_ENGINE_TABLE, MODBUS_CRC_ENGINE_SLICE8, MODBUS_CRC_ENGINE_SLICE16, MODBUS_CRC_ENGINE_CLMUL
+    };
+    for (uint8_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        if (!modbus_crc_engine_select(engines[i]))
+        {
+            //Only the carry-less multiplication kernel depends on the CPU
+            TEST_CHECK(engines[i] == MODBUS_CRC_ENGINE_CLMUL);
+            continue;
+        }
+        TEST_CHECK(modbus_crc_update(MODBUS_CRC_INITIAL, check, sizeof(check)) == 0x4B37);
+        engine_check();
+    }
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,223 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Gateway request handling (@see servo_gateway) on the loopback bus: identical reads queued by several
+ * clients go to the bus once and are served from the cache, a write stops sharing of the queued read and drops
+ * the cached answer, requests over the capacity of a client and requests beyond the bus are answered with
+ * the gateway exceptions at once.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "gateway/servo_gateway.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS           (1)
+#define TEST_ADDRESS        (0x0010)
+#define TEST_ADDRESS_OTHER  (0x0020)
+#define TEST_CACHE_TTL_MS   (50)
+#define TEST_STEP_US        (100)
+#define TEST_POLLS_MAX      (10000)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+static servo_gateway_t gateway;
+
+/**@brief Initialize client without a connection, the answers are taken from its output by the test.
+ */
+static void client_initialize(servo_gateway_client_t * client)
+{
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+    client->frame.buffer = client->buffer;
+    client->frame.size = sizeof(client->buffer);
+}
+
+/**@brief Handle client request with the PDU of the server address, function and two words.
+ */
+static void request_handle(servo_gateway_client_t * client, 
+                           uint16_t id, 
+                           uint8_t address, 
+                           uint8_t function, 
+                           uint16_t first, 
+                           uint16_t second)
+{
+    uint8_t buffer[SERVO_GATEWAY_FRAME_SIZE];
+    modbus_frame_t frame = { .buffer = buffer, .size = sizeof(buffer), .pdu_length = 6 };
+    uint8_t * const pdu = MODBUS_FRAME_PDU(&frame);
+    
+    pdu[0] = address;
+    pdu[1] = function;
+    pdu[2] = (uint8_t)(first >> 8);
+    pdu[3] = (uint8_t)first;
+    pdu[4] = (uint8_t)(second >> 8);
+    pdu[5] = (uint8_t)second;
+    servo_gateway_request_handle(&gateway, client, &frame, id, loopback.now_us);
+}
+
+/**@brief Poll the bus until all queued requests are completed.
+ */
+static void bus_run(void)
+{
+    for (uint16_t i = 0; (i < TEST_POLLS_MAX) && modbus_async_busy(&gateway.async); i++)
+    {
+        loopback.now_us += TEST_STEP_US;
+        modbus_async_poll(&gateway.async, loopback.now_us);
+    }
+    TEST_CHECK(!modbus_async_busy(&gateway.async));
+}
+
+/**@brief Take the first answer from the client output.
+ *
+ * @return Pointer to the answer PDU (valid until the next call), NULL if the output holds no answer
+ *         with the transaction identifier.
+ */
+static const uint8_t * answer_take(servo_gateway_client_t * client, uint16_t id)
+{
+    static uint8_t pdu[MODBUS_PDU_LENGTH_MAX];
+    
+    if (client->output_length < MODBUS_TCP_HEADER_SIZE)
+    {
+        return NULL;
+    }
+    
+    const uint8_t * const adu = client->output;
+    const uint16_t length = (uint16_t)(MODBUS_TCP_HEADER_SIZE + ((adu[4] << 8) | adu[5]));
+    if ((length > client->output_length) || (((adu[0] << 8) | adu[1]) != id))
+    {
+        return NULL;
+    }
+    
+    memcpy(pdu, &adu[MODBUS_TCP_HEADER_SIZE], length - MODBUS_TCP_HEADER_SIZE);
+    client->output_length -= length;
+    memmove(client->output, &client->output[length], client->output_length);
+    
+    return pdu;
+}
+
+/**@brief Take the answer to the read of one word and check the word.
+ */
+static void word_check(servo_gateway_client_t * client, uint16_t id, uint16_t word)
+{
+    const uint8_t * const pdu = answer_take(client, id);
+    
+    TEST_CHECK((pdu != NULL) && (pdu[1] == 0x03) && (pdu[2] == 2));
+    TEST_CHECK((pdu != NULL) && (((pdu[3] << 8) | pdu[4]) == word));
+}
+
+/**@brief Take the answer and check the exception.
+ */
+static void exception_check(servo_gateway_client_t * client, uint16_t id, uint8_t function, modbus_exception_t exception)
+{
+    const uint8_t * const pdu = answer_take(client, id);
+    
+    TEST_CHECK((pdu != NULL) && (pdu[1] == (function | 0x80)) && (pdu[2] == exception));
+}
+
+/**@brief Identical reads are sent to the bus once and served from the cache until it expires.
+ */
+static void deduplicate_test(servo_gateway_client_t * clients)
+{
+    request_handle(&clients[0], 1, TEST_AXIS, 0x06, TEST_ADDRESS, 0x1111);
+    bus_run();
+    TEST_CHECK(answer_take(&clients[0], 1) != NULL);
+    
+    test_loopback_requests_clear(&loopback);
+    request_handle(&clients[0], 2, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    request_handle(&clients[1], 7, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    TEST_CHECK(gateway.stats.deduplicated == 1);
+    bus_run();
+    TEST_CHECK(loopback.requests_num == 1);
+    word_check(&clients[0], 2, 0x1111);
+    word_check(&clients[1], 7, 0x1111);
+    
+    //Answer is served from the cache without the bus
+    request_handle(&clients[2], 3, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    TEST_CHECK(gateway.stats.cache_hits == 1);
+    TEST_CHECK(!modbus_async_busy(&gateway.async));
+    word_check(&clients[2], 3, 0x1111);
+    
+    //Expired answer is read from the bus again
+    loopback.now_us += TEST_CACHE_TTL_MS * 1000;
+    request_handle(&clients[2], 4, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    bus_run();
+    TEST_CHECK(loopback.requests_num == 2);
+    word_check(&clients[2], 4, 0x1111);
+}
+
+/**@brief Write stops sharing of the read queued before it and drops the cached answer.
+ */
+static void invalidate_test(servo_gateway_client_t * clients)
+{
+    //Read queued before the write gets the old value, the same read after the write waits for the new one
+    test_loopback_requests_clear(&loopback);
+    loopback.now_us += TEST_CACHE_TTL_MS * 1000;
+    request_handle(&clients[0], 10, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    request_handle(&clients[1], 11, TEST_AXIS, 0x06, TEST_ADDRESS, 0x2222);
+    request_handle(&clients[2], 12, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    bus_run();
+    TEST_CHECK(loopback.requests_num == 3);
+    word_check(&clients[0], 10, 0x1111);
+    TEST_CHECK(answer_take(&clients[1], 11) != NULL);
+    word_check(&clients[2], 12, 0x2222);
+    
+    //Answer of the read after the write is cached, the next write drops it
+    request_handle(&clients[0], 13, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    word_check(&clients[0], 13, 0x2222);
+    request_handle(&clients[1], 14, TEST_AXIS, 0x06, TEST_ADDRESS, 0x3333);
+    request_handle(&clients[0], 15, TEST_AXIS, 0x03, TEST_ADDRESS, 1);
+    bus_run();
+    TEST_CHECK(loopback.requests_num == 5);
+    TEST_CHECK(answer_take(&clients[1], 14) != NULL);
+    word_check(&clients[0], 15, 0x3333);
+}
+
+/**@brief Requests over the capacity of the client and beyond the bus are answered with exceptions at once.
+ */
+static void exception_test(servo_gateway_client_t * clients)
+{
+    const uint32_t bus_requests = gateway.stats.bus_requests;
+    
+    //Distinct reads which are not cached, so every one of them waits for the bus
+    for (uint16_t i = 0; i < SERVO_GATEWAY_PENDING_MAX; i++)
+    {
+        request_handle(&clients[0], (uint16_t)(20 + i), TEST_AXIS, 0x03, (uint16_t)(TEST_ADDRESS_OTHER + i), 1);
+    }
+    TEST_CHECK(clients[0].pending == SERVO_GATEWAY_PENDING_MAX);
+    request_handle(&clients[0], 40, TEST_AXIS, 0x03, TEST_ADDRESS_OTHER + SERVO_GATEWAY_PENDING_MAX, 1);
+    exception_check(&clients[0], 40, 0x03, MODBUS_EXCEPTION_SERVER_DEVICE_BUSY);
+    
+    //Address beyond the bus
+    request_handle(&clients[1], 41, 0xF8, 0x03, TEST_ADDRESS, 1);
+    exception_check(&clients[1], 41, 0x03, MODBUS_EXCEPTION_GATEWAY_PATH_UNAVAILABLE);
+    TEST_CHECK(gateway.stats.bus_requests == bus_requests + SERVO_GATEWAY_PENDING_MAX);
+    
+    bus_run();
+    TEST_CHECK(clients[0].pending == 0);
+    for (uint16_t i = 0; i < SERVO_GATEWAY_PENDING_MAX; i++)
+    {
+        TEST_CHECK(answer_take(&clients[0], (uint16_t)(20 + i)) != NULL);
+    }
+    TEST_CHECK(gateway.stats.failures == 2);
+}
+
+int main(void)
+{
+    static servo_gateway_client_t clients[3];
+    const servo_gateway_config_t config = { .cache_ttl_ms = TEST_CACHE_TTL_MS, .no_deduplicate = false };
+    
+    test_loopback_initialize(&loopback, 1, 0);
+    servo_gateway_initialize(&gateway, &loopback.ctx, &config);
+    for (uint8_t i = 0; i < sizeof(clients) / sizeof(clients[0]); i++)
+    {
+        client_initialize(&clients[i]);
+    }
+    
+    deduplicate_test(clients);
+    invalidate_test(clients);
+    exception_test(clients);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,101 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Hex codec (@see modbus_hex): every kernel matches the reference implementation on any length and
+ * alignment, in separate buffers and in place, accepts lowercase characters and rejects any non-hex
+ * character at any position.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "modbus/modbus_hex.h"
+#include "test.h"
+
+#define TEST_DATA_SIZE    (300)
+
+unsigned int test_failures;
+
+static uint8_t data[TEST_DATA_SIZE + 16];
+static uint8_t expected[2 * TEST_DATA_SIZE + 16];
+static uint8_t chars[2 * TEST_DATA_SIZE + 16];
+static uint8_t bytes[TEST_DATA_SIZE + 16];
+
+/**@brief Check the selected kernel against the reference implementation.
+ */
+static void engine_check(void)
+{
+    for (uint16_t length = 0; length <= TEST_DATA_SIZE; length += (length < 100) ? 1 : 29)
+    {
+        for (uint8_t offset = 0; offset < 16; offset += 5)
+        {
+            const uint8_t * const message = &data[offset];
+            
+            modbus_hex_encode_lut(expected, message, length);
+            modbus_hex_encode(&chars[offset], message, length);
+            TEST_CHECK(memcmp(&chars[offset], expected, 2 * length) == 0);
+            TEST_CHECK(modbus_hex_decode(&bytes[offset], &chars[offset], length));
+            TEST_CHECK(memcmp(&bytes[offset], message, length) == 0);
+            
+            //In place: bytes expand to characters from the end, characters shrink to bytes from the start
+            memcpy(&chars[offset], message, length);
+            modbus_hex_encode(&chars[offset], &chars[offset], length);
+            TEST_CHECK(memcmp(&chars[offset], expected, 2 * length) == 0);
+            TEST_CHECK(modbus_hex_decode(&chars[offset], &chars[offset], length));
+            TEST_CHECK(memcmp(&chars[offset], message, length) == 0);
+        }
+        
+        //Lowercase characters are accepted
+        modbus_hex_encode_lut(chars, data, length);
+        for (uint16_t i = 0; i < 2 * length; i++)
+        {
+            chars[i] = (chars[i] >= 'A') ? (uint8_t)(chars[i] + ('a' - 'A')) : chars[i];
+        }
+        TEST_CHECK(modbus_hex_decode(bytes, chars, length));
+        TEST_CHECK(memcmp(bytes, data, length) == 0);
+    }
+    
+    //Invalid character is found at any position of a long run
+    static const uint8_t invalid[] = { 0x00, '/', ':', '@', 'G', '`', 'g', 0xB0, 0xFF };
+    for (uint16_t pos = 0; pos < 2 * TEST_DATA_SIZE; pos += (pos < 70) ? 1 : 23)
+    {
+        modbus_hex_encode_lut(chars, data, TEST_DATA_SIZE);
+        chars[pos] = invalid[pos % sizeof(invalid)];
+        TEST_CHECK(!modbus_hex_decode(bytes, chars, TEST_DATA_SIZE));
+    }
+}
+
+int main(void)
+{
+    static const uint8_t check[] = { 0x01, 0x03, 0xAB, 0xCD, 0xEF };
+    uint32_t seed = 0x13579BDF;
+    
+    for (uint16_t i = 0; i < sizeof(data); i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        data[i] = (uint8_t)(seed >> 24);
+    }
+    
+    modbus_hex_initialize();
+    
+    //Reference encoding is uppercase
+    modbus_hex_encode_lut(chars, check, sizeof(check));
+    TEST_CHECK(memcmp(chars, "0103ABCDEF", 10) == 0);
+    
+    static const modbus_hex_engine_t engines[] = 
+    {
+        MODBUS_HEX_ENGINE_LUT, MODBUS_HEX_ENGINE_SSE2, MODBUS_HEX_ENGINE_AVX2, MODBUS_HEX_ENGINE_NEON
+    };
+    for (uint8_t i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        if (!modbus_hex_engine_select(engines[i]))
+        {
+            //Only the vector kernels depend on the CPU
+            TEST_CHECK(engines[i] != MODBUS_HEX_ENGINE_LUT);
+            continue;
+        }
+        TEST_CHECK(modbus_hex_engine_get() == engines[i]);
+        engine_check();
+    }
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,161 @@
+#include "test_loopback.h"
+
+#include <string.h>
+#include "modbus/modbus_protocol_rtu.h"
+
+/**@brief Write callback: the request is recorded, decoded and served by the simulator.
+ */
+static modbus_callback_result_t loopback_write(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+{
+    test_loopback_t * const loopback = (test_loopback_t *)user_data;
+    uint16_t length;
+    
+    (void)timeout_ms;
+    loopback->answer_offset = 0;
+    loopback->answer_length = 0;
+    if ((size_t)MODBUS_FRAME_RTU_OFFSET + data_length > sizeof(loopback->buffer))
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    memcpy(&loopback->buffer[MODBUS_FRAME_RTU_OFFSET], data, data_length);
+    
+    modbus_frame_t * const frame = &loopback->frame;
+    if (modbus_protocol_rtu_frame_decode(frame, data_length) != MODBUS_PROTOCOL_RESULT_SUCCESS)
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    
+    if (loopback->requests_num < TEST_LOOPBACK_REQUESTS_NUM)
+    {
+        loopback->axes[loopback->requests_num++] = MODBUS_FRAME_PDU(frame)[0];
+    }
+    
+    if (loopback->drops_num != 0)
+    {
+        //Request is lost on the bus, the servo doesn't answer
+        loopback->drops_num--;
+        return MODBUS_CALLBACK_RESULT_SUCCESS;
+    }
+    
+    frame->pdu_length = servo_sim_pdu_process(&loopback->sim, MODBUS_FRAME_PDU(frame), frame->pdu_length);
+    if (frame->pdu_length == 0)
+    {
+        //Broadcast request is not answered
+        return MODBUS_CALLBACK_RESULT_SUCCESS;
+    }
+    
+    const uint8_t * const adu = modbus_protocol_rtu_frame_encode(frame, &length);
+    if (adu == NULL)
+    {
+        return MODBUS_CALLBACK_RESULT_IO_ERROR;
+    }
+    memcpy(loopback->answer, adu, length);
+    loopback->answer_length = length;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Read callback: serves the answer to the last request.
+ */
+static modbus_callback_result_t loopback_read(void * user_data, uint8_t * data, uint16_t data_length, uint32_t timeout_ms)
+{
+    test_loopback_t * const loopback = (test_loopback_t *)user_data;
+    
+    (void)timeout_ms;
+    if (loopback->answer_length - loopback->answer_offset < data_length)
+    {
+        loopback->answer_offset = loopback->answer_length;
+        return MODBUS_CALLBACK_RESULT_TIMEOUT;
+    }
+    
+    memcpy(data, &loopback->answer[loopback->answer_offset], data_length);
+    loopback->answer_offset += data_length;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Receive callback: serves one chunk of the answer to the last request.
+ */
+static modbus_callback_result_t loopback_receive(void * user_data, uint8_t * data, uint16_t data_length, uint16_t * received)
+{
+    test_loopback_t * const loopback = (test_loopback_t *)user_data;
+    uint16_t length = loopback->answer_length - loopback->answer_offset;
+    
+    if ((loopback->chunk_length != 0) && (length > loopback->chunk_length))
+    {
+        length = loopback->chunk_length;
+    }
+    if (length > data_length)
+    {
+        length = data_length;
+    }
+    
+    memcpy(data, &loopback->answer[loopback->answer_offset], length);
+    loopback->answer_offset += length;
+    *received = length;
+    
+    return MODBUS_CALLBACK_RESULT_SUCCESS;
+}
+
+/**@brief Delay callback: broadcast requests are processed at once.
+ */
+static void loopback_delay(void * user_data, uint32_t delay_ms)
+{
+    (void)user_data;
+    (void)delay_ms;
+}
+
+/**@brief Clock callback: time is set by the test.
+ */
+static uint32_t loopback_clock(void * user_data)
+{
+    return ((const test_loopback_t *)user_data)->now_us;
+}
+
+/**@brief Idle callback: frames are delimited by the callbacks, no silent interval is needed.
+ */
+static void loopback_idle(void * user_data, uint16_t data_length)
+{
+    (void)user_data;
+    (void)data_length;
+}
+
+void test_loopback_initialize(test_loopback_t * loopback, uint8_t axes_num, uint32_t baud_rate)
+{
+    const servo_sim_config_t sim_config = 
+    {
+        .mode = MODBUS_PROTOCOL_MODE_RTU
+    };
+    const modbus_params_t modbus_params = 
+    {
+        .mode = MODBUS_PROTOCOL_MODE_RTU,
+        .write = loopback_write,
+        .read = loopback_read,
+        .idle = loopback_idle,
+        .writev = NULL,
+        .receive = loopback_receive,
+        .delay = loopback_delay,
+        .clock = loopback_clock,
+        .user_data = loopback,
+        .timeout_ms = MODBUS_PROTOCOL_BUS_TIMEOUT_MS,
+        .baud_rate = baud_rate,
+        .retries = 0
+    };
+    
+    memset(loopback, 0, sizeof(*loopback));
+    loopback->frame.buffer = loopback->buffer;
+    loopback->frame.size = sizeof(loopback->buffer);
+    
+    servo_sim_initialize(&loopback->sim, &sim_config);
+    for (uint8_t axis = 1; axis <= axes_num; axis++)
+    {
+        servo_sim_axis_add(&loopback->sim, axis);
+    }
+    
+    modbus_protocol_initialize(&loopback->ctx, &modbus_params);
+}
+
+void test_loopback_requests_clear(test_loopback_t * loopback)
+{
+    loopback->requests_num = 0;
+}
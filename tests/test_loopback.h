@@ -0,0 +1,59 @@
+/**
+ * @ingroup tests
+ *
+ * @defgroup test_loopback Loopback bus
+ *
+ * @brief In-memory bus for the tests: RTU requests are decoded and served by the simulated servos at once,
+ * every request is recorded, so the tests can check which servos were addressed and in which order.
+ * Requests can be lost on purpose to check retries and timeouts.
+ *
+ * Asynchronous transactions receive the answer in chunks of a set length, one chunk per receive call
+ * (@see modbus_async).
+ *
+ * @{
+ */
+
+#ifndef _TEST_LOOPBACK_H_
+#define _TEST_LOOPBACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "modbus/modbus_protocol.h"
+#include "sim/servo_sim.h"
+
+#define TEST_LOOPBACK_REQUESTS_NUM    (256)             /**< Maximum number of recorded requests. */
+
+/**@brief In-memory bus. */
+typedef struct
+{
+    modbus_ctx_t ctx;                                   /**< Modbus context on the bus. */
+    servo_sim_t sim;                                    /**< Simulated servos. */
+    uint8_t buffer[SERVO_SIM_FRAME_SIZE];               /**< Request frame storage. */
+    modbus_frame_t frame;                               /**< Request frame. */
+    uint8_t answer[SERVO_SIM_FRAME_SIZE];               /**< Encoded answer. */
+    uint16_t answer_length;                             /**< Length of the encoded answer. */
+    uint16_t answer_offset;                             /**< Bytes of the answer already read. */
+    uint16_t chunk_length;                              /**< Bytes served by one receive call (0 - all available). */
+    uint16_t drops_num;                                 /**< Number of the next requests lost on the bus (recorded, but not answered). */
+    uint32_t now_us;                                    /**< Time of the clock callback in microseconds. */
+    uint8_t axes[TEST_LOOPBACK_REQUESTS_NUM];           /**< Address of every request. */
+    uint16_t requests_num;                              /**< Number of recorded requests. */
+} test_loopback_t;
+
+/**@brief Initialize RTU bus with the simulated servos 1 to axes_num.
+ *
+ * @param[out] loopback  Pointer to the bus.
+ * @param[in]  axes_num  Number of simulated servos (1-SERVO_SIM_AXES_NUM).
+ * @param[in]  baud_rate Baud rate of the modbus context (0 if timing is not checked).
+ */
+void test_loopback_initialize(test_loopback_t * loopback, uint8_t axes_num, uint32_t baud_rate);
+
+/**@brief Forget the recorded requests.
+ *
+ * @param[in] loopback Pointer to the bus.
+ */
+void test_loopback_requests_clear(test_loopback_t * loopback);
+
+#endif
+
+/** @} */
@@ -0,0 +1,129 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Transaction metrics (@see modbus_metrics) on the loopback bus: counters of the bus and of every
+ * server follow the transaction results, answered transactions are recorded in the latency histograms
+ * and the percentiles are taken from the histogram buckets.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "modbus/modbus_metrics.h"
+#include "servo/servo_driver.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS        (1)
+#define TEST_ADDRESS     (0x0010)
+#define TEST_RETRIES     (1)
+#define TEST_STEP_US     (100)
+#define TEST_READ_TX     (8)                            /**< Bytes of the read request of one word. */
+#define TEST_READ_RX     (7)                            /**< Bytes of the answer to the read of one word. */
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+static modbus_metrics_t metrics;
+static uint32_t clock_us;
+
+/**@brief Clock callback: every call takes TEST_STEP_US, so every phase of the transaction takes time.
+ */
+static uint32_t stepping_clock(void * user_data)
+{
+    (void)user_data;
+    clock_us += TEST_STEP_US;
+    
+    return clock_us;
+}
+
+/**@brief Counters of the bus and of the server after a set of transactions.
+ */
+static void counters_test(void)
+{
+    modbus_metrics_data_t data;
+    uint16_t word = 0;
+    
+    TEST_CHECK(servo_nwords_read(&loopback.ctx, TEST_AXIS, TEST_ADDRESS, &word, 1));
+    TEST_CHECK(!servo_nwords_read(&loopback.ctx, TEST_AXIS, 0x0500, &word, 1));
+    loopback.drops_num = 1;
+    TEST_CHECK(servo_nwords_read(&loopback.ctx, TEST_AXIS, TEST_ADDRESS, &word, 1));
+    TEST_CHECK(servo_oneword_write(&loopback.ctx, MODBUS_ADDRESS_BROADCAST, TEST_ADDRESS, word));
+    
+    modbus_metrics_snapshot(&metrics, &data);
+    TEST_CHECK(memcmp(&data, &metrics.data, sizeof(data)) == 0);
+    
+    const modbus_counters_t * const unit = &data.units[TEST_AXIS];
+    TEST_CHECK((unit->transactions == 4) && (unit->retries == 1));
+    TEST_CHECK((unit->answers == 3) && (unit->exceptions == 1) && (unit->timeouts == 1));
+    TEST_CHECK((unit->checksum_errors == 0) && (unit->corrupted == 0) && (unit->io_errors == 0));
+    TEST_CHECK(unit->tx_bytes == 4 * TEST_READ_TX);
+    TEST_CHECK(unit->rx_bytes == 2 * TEST_READ_RX + 5);
+    
+    //Broadcast request is counted, but never answered
+    TEST_CHECK((data.units[0].transactions == 1) && (data.units[0].answers == 0) && (data.units[0].timeouts == 0));
+    TEST_CHECK(data.bus.transactions == unit->transactions + data.units[0].transactions);
+    TEST_CHECK(data.bus.rx_bytes == unit->rx_bytes);
+    
+    //Answered transactions only
+    for (uint8_t phase = 0; phase < MODBUS_METRICS_PHASES_NUM; phase++)
+    {
+        TEST_CHECK(data.latency[phase].count == 3);
+        TEST_CHECK(data.latency[phase].max_us >= TEST_STEP_US);
+    }
+}
+
+/**@brief Requests to an offline server are counted, but not sent.
+ */
+static void offline_test(void)
+{
+    uint16_t word;
+    
+    loopback.drops_num = MODBUS_UNIT_OFFLINE_FAILURES * (1 + TEST_RETRIES);
+    for (uint8_t i = 0; i < MODBUS_UNIT_OFFLINE_FAILURES; i++)
+    {
+        servo_nwords_read(&loopback.ctx, TEST_AXIS, TEST_ADDRESS, &word, 1);
+    }
+    const modbus_counters_t before = metrics.data.units[TEST_AXIS];
+    
+    TEST_CHECK(!servo_nwords_read(&loopback.ctx, TEST_AXIS, TEST_ADDRESS, &word, 1));
+    TEST_CHECK(metrics.data.units[TEST_AXIS].offline == before.offline + 1);
+    TEST_CHECK(metrics.data.units[TEST_AXIS].transactions == before.transactions);
+    
+    //Detached storage is not updated
+    modbus_metrics_attach(&loopback.ctx, NULL);
+    TEST_CHECK(!servo_nwords_read(&loopback.ctx, TEST_AXIS, TEST_ADDRESS, &word, 1));
+    TEST_CHECK(metrics.data.units[TEST_AXIS].offline == before.offline + 1);
+}
+
+/**@brief Percentiles are the upper bounds of the buckets, capped by the maximum.
+ */
+static void percentile_test(void)
+{
+    modbus_histogram_t histogram = { 0 };
+    
+    TEST_CHECK(modbus_histogram_percentile_us(&histogram, 50) == 0);
+    
+    //90 latencies in [64, 128) us and 10 in [1024, 2048) us with the maximum of 1500 us
+    histogram.count = 100;
+    histogram.max_us = 1500;
+    histogram.buckets[6] = 90;
+    histogram.buckets[10] = 10;
+    TEST_CHECK(modbus_histogram_percentile_us(&histogram, 50) == 127);
+    TEST_CHECK(modbus_histogram_percentile_us(&histogram, 90) == 127);
+    TEST_CHECK(modbus_histogram_percentile_us(&histogram, 91) == 1500);
+    TEST_CHECK(modbus_histogram_percentile_us(&histogram, 100) == 1500);
+}
+
+int main(void)
+{
+    test_loopback_initialize(&loopback, 1, 0);
+    loopback.ctx.clock = stepping_clock;
+    loopback.ctx.retries = TEST_RETRIES;
+    modbus_metrics_attach(&loopback.ctx, &metrics);
+    
+    counters_test();
+    offline_test();
+    percentile_test();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,61 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Read plan (@see servo_plan): the gap between registers is read along only if it takes less time
+ * than another request, including the servo turnaround when the context has no baud rate.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "servo/servo_plan.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS    (1)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+
+/**@brief Registers read by the plan. */
+typedef struct
+{
+    uint16_t status;
+    uint16_t speed;
+} test_monitor_t;
+
+static const servo_plan_item_t items[] = 
+{
+    { 0x0014, offsetof(test_monitor_t, speed) },
+    { 0x0000, offsetof(test_monitor_t, status) }
+};
+
+int main(void)
+{
+    servo_plan_t plan;
+    test_monitor_t monitor;
+    
+    //Context without baud rate: 19 words of the gap take about 22 ms at the assumed 19200 baud
+    test_loopback_initialize(&loopback, 1, 0);
+    loopback.sim.axes[0].registers[0x0000] = 0x1111;
+    loopback.sim.axes[0].registers[0x0014] = 0x2222;
+    
+    //Another request is cheaper than the gap without turnaround
+    TEST_CHECK(servo_plan_compile(&plan, &loopback.ctx, TEST_AXIS, items, 2, 0));
+    TEST_CHECK(plan.reads_num == 2);
+    TEST_CHECK(plan.words_num == 2);
+    
+    //Turnaround of 20 ms makes another request more expensive than the gap
+    TEST_CHECK(servo_plan_compile(&plan, &loopback.ctx, TEST_AXIS, items, 2, 20000));
+    TEST_CHECK(plan.reads_num == 1);
+    TEST_CHECK(plan.words_num == 0x15);
+    TEST_CHECK(plan.reads[0].address == 0x0000);
+    
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_plan_read(&plan, &monitor));
+    TEST_CHECK(loopback.requests_num == 1);
+    TEST_CHECK(monitor.status == 0x1111);
+    TEST_CHECK(monitor.speed == 0x2222);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,86 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Read/Write Multiple Registers (@see servo_nwords_read_write) on the loopback bus: one request writes
+ * before it reads, a servo rejecting the function with ILLEGAL_FUNCTION is remembered and served by separate
+ * write and read requests, other exceptions leave the function enabled.
+ */
+
+#include <stdlib.h>
+#include "servo/servo_driver.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS              (1)
+#define TEST_AXIS_OTHER        (2)
+#define TEST_ADDRESS           (0x0040)
+#define TEST_ADDRESS_INVALID   (0x0500)
+#define TEST_WORDS_NUM         (4)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+
+/**@brief Get function code of the last request.
+ */
+static uint8_t last_function_get(void)
+{
+    return MODBUS_FRAME_PDU(&loopback.frame)[1] & 0x7F;
+}
+
+/**@brief Write the words and read them back by one call, check the number of requests it took.
+ */
+static void read_write_check(uint8_t axis, uint16_t first, uint16_t requests_num)
+{
+    uint16_t written[TEST_WORDS_NUM];
+    uint16_t words[TEST_WORDS_NUM];
+    
+    for (uint16_t i = 0; i < TEST_WORDS_NUM; i++)
+    {
+        written[i] = (uint16_t)(first + i);
+    }
+    
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_nwords_read_write(&loopback.ctx, axis, TEST_ADDRESS, words, TEST_WORDS_NUM, 
+                                       TEST_ADDRESS, written, TEST_WORDS_NUM));
+    TEST_CHECK(loopback.requests_num == requests_num);
+    for (uint16_t i = 0; i < TEST_WORDS_NUM; i++)
+    {
+        TEST_CHECK(words[i] == written[i]);
+    }
+}
+
+int main(void)
+{
+    uint16_t words[TEST_WORDS_NUM] = { 0 };
+    
+    test_loopback_initialize(&loopback, 2, 0);
+    
+    //Servo supporting the function: the written words are read back by one request
+    read_write_check(TEST_AXIS, 0x1100, 1);
+    TEST_CHECK(last_function_get() == 0x17);
+    
+    //Exception other than ILLEGAL_FUNCTION keeps the function enabled
+    TEST_CHECK(!servo_nwords_read_write(&loopback.ctx, TEST_AXIS, TEST_ADDRESS_INVALID, words, 1, 
+                                        TEST_ADDRESS, words, 1));
+    TEST_CHECK(servo_exception_get(&loopback.ctx) == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+    TEST_CHECK((loopback.ctx.units[TEST_AXIS].flags & MODBUS_UNIT_FLAG_NO_READ_WRITE) == 0);
+    
+    //Servo without the function: rejected request is followed by a write and a read
+    loopback.sim.config.no_read_write = true;
+    read_write_check(TEST_AXIS, 0x2200, 3);
+    TEST_CHECK(last_function_get() == 0x03);
+    TEST_CHECK((loopback.ctx.units[TEST_AXIS].flags & MODBUS_UNIT_FLAG_NO_READ_WRITE) != 0);
+    TEST_CHECK(servo_exception_get(&loopback.ctx) == MODBUS_EXCEPTION_NONE);
+    
+    //Fallback is remembered for the axis only
+    read_write_check(TEST_AXIS, 0x3300, 2);
+    TEST_CHECK((loopback.ctx.units[TEST_AXIS_OTHER].flags & MODBUS_UNIT_FLAG_NO_READ_WRITE) == 0);
+    read_write_check(TEST_AXIS_OTHER, 0x4400, 3);
+    
+    //New context tries the function again
+    test_loopback_initialize(&loopback, 1, 0);
+    read_write_check(TEST_AXIS, 0x5500, 1);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
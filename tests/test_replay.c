@@ -0,0 +1,165 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Capture and replay (@see modbus_capture, serial_capture, serial_replay): a session on the loopback bus
+ * is recorded into a capture file, which is replayed to a new client in SERIAL_REPLAY_FAST and
+ * SERIAL_REPLAY_TIMED timing. The client gets the recorded answers and timeouts, the timed replay waits
+ * for the time of the client in real time.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "modbus/modbus_capture.h"
+#include "serial/serial_capture.h"
+#include "serial/serial_replay.h"
+#include "servo/servo_driver.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS          (1)
+#define TEST_ADDRESS       (0x0010)
+#define TEST_STEP_US       (100)
+#define TEST_TIMEOUT_MS    (20)
+#define TEST_RESULTS_NUM   (6)
+#define TEST_RING_SIZE     (8192)
+
+/**@brief Results of the transactions of a session. */
+typedef struct
+{
+    bool success[TEST_RESULTS_NUM];                     /**< Result of every transaction. */
+    uint16_t words[TEST_RESULTS_NUM];                   /**< Word read by every transaction. */
+} test_session_t;
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+static uint32_t clock_us;
+
+/**@brief Clock callback: every call takes TEST_STEP_US, so every record of the capture has its own time.
+ */
+static uint32_t stepping_clock(void * user_data)
+{
+    (void)user_data;
+    clock_us += TEST_STEP_US;
+    
+    return clock_us;
+}
+
+/**@brief Get monotonic time in microseconds.
+ */
+static uint64_t time_us(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+/**@brief Run the session: reads, a write, an exception and a lost request as the last transaction.
+ *
+ * @param[in]  ctx       Pointer to the modbus context.
+ * @param[in]  loopback  Pointer to the recorded bus (NULL on replay).
+ * @param[out] session   Pointer to store the results.
+ */
+static void session_run(modbus_ctx_t * ctx, test_loopback_t * loopback, test_session_t * session)
+{
+    memset(session, 0, sizeof(*session));
+    
+    session->success[0] = servo_nwords_read(ctx, TEST_AXIS, TEST_ADDRESS, &session->words[0], 1);
+    session->success[1] = servo_oneword_write(ctx, TEST_AXIS, TEST_ADDRESS, 0x1234);
+    session->success[2] = servo_nwords_read(ctx, TEST_AXIS, TEST_ADDRESS, &session->words[2], 1);
+    session->success[3] = servo_nwords_read(ctx, TEST_AXIS, 0x0500, &session->words[3], 1);
+    session->success[4] = servo_oneword_write(ctx, MODBUS_ADDRESS_BROADCAST, TEST_ADDRESS, 0x5678);
+    if (loopback != NULL)
+    {
+        loopback->drops_num = 1;
+    }
+    session->success[5] = servo_nwords_read(ctx, TEST_AXIS, TEST_ADDRESS, &session->words[5], 1);
+}
+
+/**@brief Replay the capture file to a new client and check that it gets the recorded results.
+ *
+ * @param[in] path     Path to the capture file.
+ * @param[in] timing   Replay timing.
+ * @param[in] recorded Pointer to the recorded results.
+ */
+static void replay_check(const char * path, serial_replay_timing_t timing, const test_session_t * recorded)
+{
+    serial_replay_t replay;
+    modbus_ctx_t ctx;
+    test_session_t session;
+    
+    TEST_CHECK(serial_replay_open(&replay, path, timing));
+    TEST_CHECK((replay.mode == MODBUS_PROTOCOL_MODE_RTU) && (replay.baud_rate == 0));
+    
+    const modbus_params_t params = 
+    {
+        .mode = replay.mode,
+        .write = serial_replay_write,
+        .read = serial_replay_read,
+        .idle = serial_replay_idle,
+        .writev = serial_replay_writev,
+        .receive = serial_replay_receive,
+        .delay = serial_replay_delay,
+        .clock = serial_replay_clock,
+        .user_data = &replay,
+        .timeout_ms = TEST_TIMEOUT_MS,
+        .baud_rate = replay.baud_rate,
+        .retries = 0
+    };
+    modbus_protocol_initialize(&ctx, &params);
+    
+    const uint64_t start_us = time_us();
+    session_run(&ctx, NULL, &session);
+    const uint64_t elapsed_us = time_us() - start_us;
+    
+    TEST_CHECK(memcmp(&session, recorded, sizeof(session)) == 0);
+    TEST_CHECK((replay.requests == loopback.requests_num) && (replay.mismatches == 0));
+    
+    //Lost request: the client waited for the answer until its timeout
+    const uint32_t waited_us = replay.clock_us - replay.request_us;
+    TEST_CHECK(waited_us >= 1000);
+    TEST_CHECK((timing == SERIAL_REPLAY_FAST) || (elapsed_us >= waited_us));
+    
+    serial_replay_close(&replay);
+}
+
+int main(void)
+{
+    static uint8_t storage[TEST_RING_SIZE];
+    char path[] = "/tmp/test_replay_XXXXXX";
+    modbus_capture_t capture;
+    serial_capture_t writer;
+    test_session_t recorded;
+    
+    const int fd = mkstemp(path);
+    TEST_CHECK(fd >= 0);
+    close(fd);
+    
+    test_loopback_initialize(&loopback, 1, 0);
+    loopback.ctx.clock = stepping_clock;
+    loopback.ctx.timeout_ms = TEST_TIMEOUT_MS;
+    
+    //Recorded session
+    TEST_CHECK(modbus_capture_initialize(&capture, storage, sizeof(storage)));
+    TEST_CHECK(serial_capture_start(&writer, &capture, path, MODBUS_PROTOCOL_MODE_RTU, 0));
+    modbus_capture_attach(&loopback.ctx, &capture);
+    session_run(&loopback.ctx, &loopback, &recorded);
+    modbus_capture_detach(&loopback.ctx, &capture);
+    TEST_CHECK(serial_capture_stop(&writer));
+    
+    TEST_CHECK(recorded.success[0] && recorded.success[1] && recorded.success[2] && recorded.success[4]);
+    TEST_CHECK(!recorded.success[3] && !recorded.success[5]);
+    TEST_CHECK(recorded.words[2] == 0x1234);
+    TEST_CHECK(loopback.requests_num == TEST_RESULTS_NUM);
+    
+    replay_check(path, SERIAL_REPLAY_FAST, &recorded);
+    replay_check(path, SERIAL_REPLAY_TIMED, &recorded);
+    
+    unlink(path);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
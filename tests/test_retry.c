@@ -0,0 +1,95 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Retries and offline servers (@see modbus_frame_transaction) on the loopback bus timed by the test:
+ * lost requests are retried, exceptions are not, a server left without answers is marked offline and only
+ * probed at a growing interval until it answers again.
+ */
+
+#include <stdlib.h>
+#include "servo/servo_driver.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS        (1)
+#define TEST_AXIS_OTHER  (2)
+#define TEST_ADDRESS     (0x0010)
+#define TEST_RETRIES     (2)
+#define TEST_START_US    (1000000)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+
+/**@brief Read one word at the given time and check the number of requests it took.
+ */
+static bool read_check(uint8_t axis, uint32_t now_us, uint16_t requests_num)
+{
+    uint16_t word;
+    
+    test_loopback_requests_clear(&loopback);
+    loopback.now_us = now_us;
+    
+    const bool success = servo_nwords_read(&loopback.ctx, axis, TEST_ADDRESS, &word, 1);
+    TEST_CHECK(loopback.requests_num == requests_num);
+    TEST_CHECK(servo_exception_get(&loopback.ctx) == MODBUS_EXCEPTION_NONE);
+    
+    return success;
+}
+
+/**@brief Lost requests are retried up to the number of retries.
+ */
+static void retry_test(void)
+{
+    uint16_t word;
+    
+    loopback.drops_num = TEST_RETRIES;
+    TEST_CHECK(read_check(TEST_AXIS, TEST_START_US, 1 + TEST_RETRIES));
+    TEST_CHECK(modbus_unit_online(&loopback.ctx, TEST_AXIS));
+    
+    //Exception is a valid answer
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(!servo_nwords_read(&loopback.ctx, TEST_AXIS, 0x0500, &word, 1));
+    TEST_CHECK(servo_exception_get(&loopback.ctx) == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+    TEST_CHECK(loopback.requests_num == 1);
+}
+
+/**@brief Server without answers is probed at a growing interval.
+ */
+static void offline_test(void)
+{
+    uint32_t now_us = TEST_START_US;
+    
+    //Every unanswered attempt counts
+    loopback.drops_num = 1 + TEST_RETRIES;
+    TEST_CHECK(!read_check(TEST_AXIS, now_us, 1 + TEST_RETRIES));
+    TEST_CHECK(!modbus_unit_online(&loopback.ctx, TEST_AXIS));
+    TEST_CHECK(modbus_unit_online(&loopback.ctx, TEST_AXIS_OTHER));
+    
+    //Requests fail at once until the probe is due
+    TEST_CHECK(!read_check(TEST_AXIS, now_us + MODBUS_UNIT_PROBE_MIN_MS * 1000 - 1, 0));
+    TEST_CHECK(read_check(TEST_AXIS_OTHER, now_us, 1));
+    
+    //Failed probe is not retried and doubles the interval
+    now_us += MODBUS_UNIT_PROBE_MIN_MS * 1000;
+    loopback.drops_num = 1;
+    TEST_CHECK(!read_check(TEST_AXIS, now_us, 1));
+    TEST_CHECK(!read_check(TEST_AXIS, now_us + 2 * MODBUS_UNIT_PROBE_MIN_MS * 1000 - 1, 0));
+    
+    //Answered probe brings the server online
+    now_us += 2 * MODBUS_UNIT_PROBE_MIN_MS * 1000;
+    TEST_CHECK(read_check(TEST_AXIS, now_us, 1));
+    TEST_CHECK(modbus_unit_online(&loopback.ctx, TEST_AXIS));
+    TEST_CHECK(read_check(TEST_AXIS, now_us, 1));
+}
+
+int main(void)
+{
+    test_loopback_initialize(&loopback, 2, 0);
+    loopback.ctx.retries = TEST_RETRIES;
+    
+    retry_test();
+    offline_test();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
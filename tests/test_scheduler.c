@@ -0,0 +1,114 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Polling scheduler (@see servo_scheduler) on the loopback bus timed by the test: the context clock
+ * is required, the due task with the shortest period runs first, overruns are counted as deadline misses
+ * and the bus utilization is checked against the bus capacity.
+ */
+
+#include <stdlib.h>
+#include "servo/servo_scheduler.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_BAUD_RATE       (115200)
+#define TEST_AXIS_FAST       (1)
+#define TEST_AXIS_SLOW       (2)
+#define TEST_FAST_PERIOD_US  (10000)
+#define TEST_SLOW_PERIOD_US  (20000)
+#define TEST_START_US        (1000000)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+static servo_scheduler_t scheduler;
+
+/**@brief Registers read by the tasks. */
+typedef struct
+{
+    uint16_t status;
+} test_monitor_t;
+
+static const servo_plan_item_t items[] = 
+{
+    { 0x0000, 0 }
+};
+
+/**@brief Poll the scheduler at the given time and check which servo was read.
+ */
+static uint32_t poll_check(uint32_t now_us, uint8_t axis)
+{
+    test_loopback_requests_clear(&loopback);
+    loopback.now_us = now_us;
+    
+    const uint32_t delay_us = servo_scheduler_poll(&scheduler);
+    TEST_CHECK(loopback.requests_num == ((axis != 0) ? 1 : 0));
+    TEST_CHECK((axis == 0) || (loopback.axes[0] == axis));
+    
+    return delay_us;
+}
+
+/**@brief Context without clock is rejected.
+ */
+static void clock_test(void)
+{
+    const modbus_params_t params = 
+    {
+        .mode = MODBUS_PROTOCOL_MODE_RTU,
+        .write = loopback.ctx.write,
+        .read = loopback.ctx.read,
+        .idle = loopback.ctx.idle,
+        .user_data = &loopback
+    };
+    modbus_ctx_t ctx;
+    
+    modbus_protocol_initialize(&ctx, &params);
+    TEST_CHECK(!servo_scheduler_initialize(&scheduler, &ctx, 0));
+}
+
+int main(void)
+{
+    servo_plan_t fast_plan;
+    servo_plan_t slow_plan;
+    servo_scheduler_task_t fast_task;
+    servo_scheduler_task_t slow_task;
+    servo_scheduler_task_t overload_task;
+    test_monitor_t fast_monitor;
+    test_monitor_t slow_monitor;
+    uint32_t utilization;
+    
+    test_loopback_initialize(&loopback, 2, TEST_BAUD_RATE);
+    clock_test();
+    
+    loopback.now_us = TEST_START_US;
+    TEST_CHECK(servo_scheduler_initialize(&scheduler, &loopback.ctx, 0));
+    TEST_CHECK(servo_plan_compile(&fast_plan, &loopback.ctx, TEST_AXIS_FAST, items, 1, 0));
+    TEST_CHECK(servo_plan_compile(&slow_plan, &loopback.ctx, TEST_AXIS_SLOW, items, 1, 0));
+    
+    //Added in any order, the tasks run rate-monotonically
+    TEST_CHECK(servo_scheduler_task_add(&scheduler, &slow_task, &slow_plan, &slow_monitor, TEST_SLOW_PERIOD_US, NULL, NULL));
+    TEST_CHECK(servo_scheduler_task_add(&scheduler, &fast_task, &fast_plan, &fast_monitor, TEST_FAST_PERIOD_US, NULL, NULL));
+    TEST_CHECK(!servo_scheduler_task_add(&scheduler, &overload_task, &fast_plan, &fast_monitor, 0, NULL, NULL));
+    TEST_CHECK(servo_scheduler_check(&scheduler, &utilization) == SERVO_SCHEDULER_FEASIBLE);
+    TEST_CHECK((utilization > 0) && (utilization < 1000));
+    
+    servo_scheduler_start(&scheduler);
+    TEST_CHECK(poll_check(TEST_START_US, TEST_AXIS_FAST) == 0);
+    TEST_CHECK(poll_check(TEST_START_US, TEST_AXIS_SLOW) == TEST_FAST_PERIOD_US);
+    TEST_CHECK(poll_check(TEST_START_US + TEST_FAST_PERIOD_US - 1, 0) == 1);
+    TEST_CHECK(poll_check(TEST_START_US + TEST_FAST_PERIOD_US, TEST_AXIS_FAST) == TEST_FAST_PERIOD_US);
+    TEST_CHECK((fast_task.stats.runs == 2) && (slow_task.stats.runs == 1));
+    TEST_CHECK(fast_task.stats.misses == 0);
+    
+    //Late poll: the overrun skips the passed releases
+    poll_check(TEST_START_US + 4 * TEST_FAST_PERIOD_US + TEST_FAST_PERIOD_US / 2, TEST_AXIS_FAST);
+    TEST_CHECK((fast_task.stats.misses == 1) && (fast_task.stats.skipped == 1));
+    TEST_CHECK(fast_task.stats.jitter_max_us == 2 * TEST_FAST_PERIOD_US + TEST_FAST_PERIOD_US / 2);
+    TEST_CHECK(fast_task.release_us == TEST_START_US + 4 * TEST_FAST_PERIOD_US);
+    
+    //Period shorter than the bus time of the task
+    TEST_CHECK(servo_scheduler_task_add(&scheduler, &overload_task, &fast_plan, &fast_monitor, 100, NULL, NULL));
+    TEST_CHECK(servo_scheduler_check(&scheduler, NULL) == SERVO_SCHEDULER_OVERLOADED);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
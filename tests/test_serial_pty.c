@@ -0,0 +1,254 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Serial port backend (@see serial_linux) over a pseudo-terminal pair: a minimal servo answers on the
+ * master side from a thread, the driver transactions go through the slave side in RTU and ASCII modes.
+ */
+
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "modbus/modbus_protocol_ascii.h"
+#include "modbus/modbus_protocol_rtu.h"
+#include "serial/serial_linux.h"
+#include "servo/servo_driver.h"
+#include "test.h"
+
+#define TEST_BAUD_RATE        (115200)
+#define TEST_AXIS             (1)
+#define TEST_AXIS_ABSENT      (5)
+#define TEST_ADDRESS          (0x0020)
+#define TEST_WORDS_NUM        (8)
+#define TEST_REGISTERS_NUM    (0x0100)
+#define TEST_PDU_SIZE         (64)
+#define TEST_POLL_PERIOD_MS   (10)
+
+unsigned int test_failures;
+
+static uint16_t registers[TEST_REGISTERS_NUM];
+static modbus_mode_t servo_mode;
+static int master_fd;
+static volatile bool running;
+
+/**@brief Handle the request of the servo with holding registers only (0x03, 0x06 and 0x10).
+ *
+ * @param[in,out] pdu Pointer to the request PDU, replaced by the answer PDU.
+ *
+ * @return Length of the answer PDU, 0 if the request is not addressed to the servo.
+ */
+static uint16_t request_handle(uint8_t * pdu)
+{
+    if (pdu[0] != TEST_AXIS)
+    {
+        return 0;
+    }
+    
+    const uint16_t address = (uint16_t)((pdu[2] << 8) | pdu[3]);
+    const uint16_t count = (pdu[1] == 0x06) ? 1 : (uint16_t)((pdu[4] << 8) | pdu[5]);
+    if ((uint32_t)address + count > TEST_REGISTERS_NUM)
+    {
+        pdu[1] |= 0x80;
+        pdu[2] = MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+        return 3;
+    }
+    
+    switch (pdu[1])
+    {
+        case 0x03:
+            pdu[2] = (uint8_t)(2 * count);
+            for (uint16_t i = 0; i < count; i++)
+            {
+                pdu[3 + 2 * i] = (uint8_t)(registers[address + i] >> 8);
+                pdu[4 + 2 * i] = (uint8_t)(registers[address + i] & 0xFF);
+            }
+            return 3 + 2 * count;
+        case 0x06:
+            registers[address] = (uint16_t)((pdu[4] << 8) | pdu[5]);
+            return 6;
+        case 0x10:
+            for (uint16_t i = 0; i < count; i++)
+            {
+                registers[address + i] = (uint16_t)((pdu[7 + 2 * i] << 8) | pdu[8 + 2 * i]);
+            }
+            return 6;
+        default:
+            pdu[1] |= 0x80;
+            pdu[2] = MODBUS_EXCEPTION_ILLEGAL_FUNCTION;
+            return 3;
+    }
+}
+
+/**@brief Check if the received request frame is complete.
+ */
+static bool request_complete(const uint8_t * adu, uint16_t received)
+{
+    if (servo_mode == MODBUS_PROTOCOL_MODE_ASCII)
+    {
+        return (received != 0) && (adu[received - 1] == '\n');
+    }
+    
+    const uint16_t pdu_length = modbus_pdu_length(adu, received, true);
+    return (pdu_length != 0) && (received >= pdu_length + 2);
+}
+
+/**@brief Servo thread: receive requests on the master side and answer them.
+ */
+static void * servo_thread(void * arg)
+{
+    uint8_t buffer[MODBUS_FRAME_SIZE(TEST_PDU_SIZE)];
+    modbus_frame_t frame = { .buffer = buffer, .size = sizeof(buffer) };
+    const bool ascii = (servo_mode == MODBUS_PROTOCOL_MODE_ASCII);
+    uint8_t * const adu = &buffer[ascii ? MODBUS_FRAME_ASCII_OFFSET : MODBUS_FRAME_RTU_OFFSET];
+    const uint16_t capacity = sizeof(buffer) - (ascii ? MODBUS_FRAME_ASCII_OFFSET : MODBUS_FRAME_RTU_OFFSET);
+    uint16_t received = 0;
+    uint16_t length;
+    
+    (void)arg;
+    while (running)
+    {
+        struct pollfd pfd = { .fd = master_fd, .events = POLLIN };
+        if ((poll(&pfd, 1, TEST_POLL_PERIOD_MS) <= 0) || !(pfd.revents & POLLIN))
+        {
+            continue;
+        }
+        
+        const ssize_t count = read(master_fd, &adu[received], capacity - received);
+        if (count <= 0)
+        {
+            continue;
+        }
+        if (ascii && (received == 0) && (adu[0] != ':'))
+        {
+            //Wait for the start of the frame
+            continue;
+        }
+        received += (uint16_t)count;
+        if (!request_complete(adu, received) && (received < capacity))
+        {
+            continue;
+        }
+        
+        const modbus_protocol_result_t protocol_result = ascii ? 
+                modbus_protocol_ascii_frame_decode(&frame, received) :
+                modbus_protocol_rtu_frame_decode(&frame, received);
+        received = 0;
+        if (protocol_result != MODBUS_PROTOCOL_RESULT_SUCCESS)
+        {
+            continue;
+        }
+        
+        frame.pdu_length = request_handle(MODBUS_FRAME_PDU(&frame));
+        if (frame.pdu_length == 0)
+        {
+            continue;
+        }
+        
+        const uint8_t * const answer = ascii ? 
+                modbus_protocol_ascii_frame_encode(&frame, &length) :
+                modbus_protocol_rtu_frame_encode(&frame, &length);
+        TEST_CHECK(write(master_fd, answer, length) == length);
+    }
+    
+    return NULL;
+}
+
+/**@brief Servo transactions through the serial port.
+ */
+static void transactions_test(modbus_ctx_t * ctx)
+{
+    uint16_t written[TEST_WORDS_NUM];
+    uint16_t words[TEST_WORDS_NUM];
+    
+    for (uint16_t i = 0; i < TEST_WORDS_NUM; i++)
+    {
+        written[i] = (uint16_t)(0x5A00 + i);
+    }
+    
+    //Write Multiple Registers (0x10) and Read Holding Registers (0x03)
+    TEST_CHECK(servo_nwords_write(ctx, TEST_AXIS, TEST_ADDRESS, written, TEST_WORDS_NUM));
+    TEST_CHECK(servo_nwords_read(ctx, TEST_AXIS, TEST_ADDRESS, words, TEST_WORDS_NUM));
+    for (uint16_t i = 0; i < TEST_WORDS_NUM; i++)
+    {
+        TEST_CHECK(words[i] == written[i]);
+    }
+    
+    //Write Single Register (0x06)
+    TEST_CHECK(servo_oneword_write(ctx, TEST_AXIS, TEST_ADDRESS, 0x1234));
+    TEST_CHECK(servo_nwords_read(ctx, TEST_AXIS, TEST_ADDRESS, words, 1) && (words[0] == 0x1234));
+    TEST_CHECK(registers[TEST_ADDRESS] == 0x1234);
+    
+    //Exception: address outside the register map
+    TEST_CHECK(!servo_nwords_read(ctx, TEST_AXIS, 0x0500, words, 1));
+    TEST_CHECK(servo_exception_get(ctx) == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+    
+    //Timeout: servo is not on the bus
+    TEST_CHECK(!servo_nwords_read(ctx, TEST_AXIS_ABSENT, TEST_ADDRESS, words, 1));
+    TEST_CHECK(servo_exception_get(ctx) == MODBUS_EXCEPTION_NONE);
+    
+    //Bus is usable after the timeout
+    TEST_CHECK(servo_nwords_read(ctx, TEST_AXIS, TEST_ADDRESS, words, 1) && (words[0] == 0x1234));
+}
+
+/**@brief Run the transactions in the Modbus mode over a new pseudo-terminal pair.
+ */
+static void mode_test(modbus_mode_t mode)
+{
+    serial_port_t port;
+    modbus_ctx_t ctx;
+    pthread_t thread;
+    char name[64];
+    int slave_fd;
+    
+    if (openpty(&master_fd, &slave_fd, name, NULL, NULL) != 0)
+    {
+        perror("openpty");
+        test_failures++;
+        return;
+    }
+    
+    const bool opened = serial_port_open(&port, name, TEST_BAUD_RATE, SERIAL_PARITY_EVEN, mode, false);
+    
+    //The port keeps the slave side open
+    close(slave_fd);
+    if (!opened)
+    {
+        perror("serial_port_open");
+        close(master_fd);
+        test_failures++;
+        return;
+    }
+    
+    const modbus_params_t modbus_params = 
+    {
+        .mode = mode,
+        .write = serial_port_write,
+        .read = serial_port_read,
+        .idle = serial_port_idle,
+        .writev = serial_port_writev,
+        .receive = serial_port_receive,
+        .user_data = &port,
+        .timeout_ms = MODBUS_PROTOCOL_BUS_TIMEOUT_MS,
+        .baud_rate = TEST_BAUD_RATE
+    };
+    modbus_protocol_initialize(&ctx, &modbus_params);
+    
+    servo_mode = mode;
+    running = true;
+    TEST_CHECK(pthread_create(&thread, NULL, servo_thread, NULL) == 0);
+    transactions_test(&ctx);
+    
+    running = false;
+    pthread_join(thread, NULL);
+    serial_port_close(&port);
+    close(master_fd);
+}
+
+int main(void)
+{
+    mode_test(MODBUS_PROTOCOL_MODE_RTU);
+    mode_test(MODBUS_PROTOCOL_MODE_ASCII);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,178 @@
+/**
+ * @ingroup tests
+ *
+ * @brief Servo write staging (@see servo_staging) on the loopback bus: adjacent writes are coalesced into
+ * multiple registers writes, gaps are filled from the cache, a rejected merged write is retried register
+ * by register and a communication error leaves the rest pending.
+ */
+
+#include <stdlib.h>
+#include "servo/servo_driver.h"
+#include "servo/servo_staging.h"
+#include "test.h"
+#include "test_loopback.h"
+
+#define TEST_AXIS           (1)
+#define TEST_AXIS_ABSENT    (2)
+#define TEST_ADDRESS        (0x0040)
+#define TEST_GAP_ADDRESS    (0x0080)
+#define TEST_GAP_MAX        (2)
+
+unsigned int test_failures;
+
+static test_loopback_t loopback;
+static servo_staging_t staging;
+static servo_cache_t cache;
+
+/**@brief Get function code of the last request.
+ */
+static uint8_t last_function_get(void)
+{
+    return MODBUS_FRAME_PDU(&loopback.frame)[1] & 0x7F;
+}
+
+/**@brief Commit the staged writes and check the number of requests it took.
+ */
+static void commit_check(bool success, uint16_t requests_num)
+{
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_staging_commit(&staging, 0) == success);
+    TEST_CHECK(staging.requests == requests_num);
+    TEST_CHECK(loopback.requests_num == requests_num);
+}
+
+/**@brief Adjacent writes are merged up to SERVO_WRITE_WORDS_MAX words, a single write uses 0x06.
+ */
+static void coalesce_test(void)
+{
+    const uint16_t * const registers = loopback.sim.axes[0].registers;
+    
+    servo_staging_initialize(&staging, &loopback.ctx, TEST_AXIS, NULL, 0);
+    
+    //Staged in any order, the word of a repeated address is replaced
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS + 2, 0x0002));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS, 0x0000));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS + 1, 0xFFFF));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS + 1, 0x0001));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS + 0x10, 0x0010));
+    TEST_CHECK(staging.writes_num == 4);
+    TEST_CHECK(servo_staging_result_get(&staging, TEST_ADDRESS, NULL) == SERVO_STAGING_RESULT_PENDING);
+    
+    commit_check(true, 2);
+    TEST_CHECK(last_function_get() == 0x06);
+    for (uint16_t i = 0; i < 3; i++)
+    {
+        TEST_CHECK(registers[TEST_ADDRESS + i] == i);
+        TEST_CHECK(servo_staging_result_get(&staging, TEST_ADDRESS + i, NULL) == SERVO_STAGING_RESULT_SUCCESS);
+    }
+    TEST_CHECK(registers[TEST_ADDRESS + 0x10] == 0x0010);
+    
+    //Written registers are not sent again
+    commit_check(true, 0);
+    
+    //Contiguous range of all staged writes fits one request
+    servo_staging_clear(&staging);
+    for (uint16_t i = 0; i < SERVO_STAGING_WRITES_NUM; i++)
+    {
+        TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS + i, (uint16_t)(0x0100 + i)));
+    }
+    TEST_CHECK(!servo_staging_oneword_write(&staging, TEST_ADDRESS + SERVO_STAGING_WRITES_NUM, 0x0000));
+    commit_check(true, 1);
+    TEST_CHECK(last_function_get() == 0x10);
+    TEST_CHECK(registers[TEST_ADDRESS + SERVO_STAGING_WRITES_NUM - 1] == 0x0100 + SERVO_STAGING_WRITES_NUM - 1);
+}
+
+/**@brief Gaps up to the maximum are filled with the fresh cached values.
+ */
+static void gap_test(void)
+{
+    uint16_t * const registers = loopback.sim.axes[0].registers;
+    uint16_t words[8];
+    
+    for (uint16_t i = 0; i < 8; i++)
+    {
+        registers[TEST_GAP_ADDRESS + i] = (uint16_t)(0x0A00 + i);
+    }
+    servo_cache_initialize(&cache, &loopback.ctx, TEST_AXIS, NULL, NULL);
+    TEST_CHECK(servo_cache_registers_define(&cache, TEST_GAP_ADDRESS, 8, SERVO_CACHE_POLICY_STATIC, 0));
+    servo_staging_initialize(&staging, &loopback.ctx, TEST_AXIS, &cache, TEST_GAP_MAX);
+    
+    //Gap is not cached yet
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_GAP_ADDRESS, 0x0B00));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_GAP_ADDRESS + 3, 0x0B03));
+    commit_check(true, 2);
+    
+    TEST_CHECK(servo_cache_nwords_read(&cache, TEST_GAP_ADDRESS, words, 8, 0));
+    servo_staging_clear(&staging);
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_GAP_ADDRESS, 0x0C00));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_GAP_ADDRESS + 3, 0x0C03));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_GAP_ADDRESS + 7, 0x0C07));
+    commit_check(true, 2);
+    TEST_CHECK((registers[TEST_GAP_ADDRESS] == 0x0C00) && (registers[TEST_GAP_ADDRESS + 3] == 0x0C03));
+    TEST_CHECK((registers[TEST_GAP_ADDRESS + 1] == 0x0A01) && (registers[TEST_GAP_ADDRESS + 2] == 0x0A02));
+    TEST_CHECK(registers[TEST_GAP_ADDRESS + 7] == 0x0C07);
+    
+    //Cache is updated with the written values
+    test_loopback_requests_clear(&loopback);
+    TEST_CHECK(servo_cache_nwords_read(&cache, TEST_GAP_ADDRESS, words, 8, 0));
+    TEST_CHECK(loopback.requests_num == 0);
+    TEST_CHECK((words[0] == 0x0C00) && (words[3] == 0x0C03) && (words[7] == 0x0C07));
+}
+
+/**@brief Merged write rejected by the servo is retried register by register.
+ */
+static void retry_test(void)
+{
+    const uint16_t * const registers = loopback.sim.axes[0].registers;
+    modbus_exception_t exception;
+    
+    servo_sim_registers_define(&loopback.sim, TEST_ADDRESS + 2, 1, SERVO_SIM_ACCESS_READ);
+    servo_staging_initialize(&staging, &loopback.ctx, TEST_AXIS, NULL, 0);
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS + i, (uint16_t)(0x0D00 + i)));
+    }
+    
+    commit_check(false, 1 + 4);
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        const servo_staging_result_t result = servo_staging_result_get(&staging, TEST_ADDRESS + i, &exception);
+        if (i == 2)
+        {
+            TEST_CHECK(result == SERVO_STAGING_RESULT_EXCEPTION);
+            TEST_CHECK(exception != MODBUS_EXCEPTION_NONE);
+        }
+        else
+        {
+            TEST_CHECK(result == SERVO_STAGING_RESULT_SUCCESS);
+            TEST_CHECK(exception == MODBUS_EXCEPTION_NONE);
+            TEST_CHECK(registers[TEST_ADDRESS + i] == 0x0D00 + i);
+        }
+    }
+    servo_sim_registers_define(&loopback.sim, TEST_ADDRESS + 2, 1, SERVO_SIM_ACCESS_READ | SERVO_SIM_ACCESS_WRITE);
+}
+
+/**@brief Communication error stops the commit, the rest stays pending.
+ */
+static void failure_test(void)
+{
+    servo_staging_initialize(&staging, &loopback.ctx, TEST_AXIS_ABSENT, NULL, 0);
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS, 0x0E00));
+    TEST_CHECK(servo_staging_oneword_write(&staging, TEST_ADDRESS + 0x10, 0x0E10));
+    
+    commit_check(false, 1);
+    TEST_CHECK(servo_staging_result_get(&staging, TEST_ADDRESS, NULL) == SERVO_STAGING_RESULT_FAILED);
+    TEST_CHECK(servo_staging_result_get(&staging, TEST_ADDRESS + 0x10, NULL) == SERVO_STAGING_RESULT_PENDING);
+}
+
+int main(void)
+{
+    test_loopback_initialize(&loopback, 1, 0);
+    
+    coalesce_test();
+    gap_test();
+    retry_test();
+    failure_test();
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
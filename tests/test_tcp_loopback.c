@@ -0,0 +1,352 @@
+/**
+ * @ingroup tests
+ *
+ * @brief TCP client backend (@see tcp_linux) against the simulated servos on a loopback port:
+ * blocking and pipelined transactions, answers sent out of order and late answers to timed out requests.
+ *
+ * The first connection is served by servo_sim_serve(). The second one by a scripted server which collects
+ * a batch of requests, lets the simulated servos process them and sends the answers in a set order, so
+ * the client sees out-of-order transaction identifiers and answers arriving after their requests timed out.
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "modbus/modbus_async.h"
+#include "modbus/modbus_protocol_tcp.h"
+#include "serial/tcp_linux.h"
+#include "servo/servo_driver.h"
+#include "sim/servo_sim.h"
+#include "test.h"
+
+#define TEST_AXIS            (1)
+#define TEST_ADDRESS         (0x0040)
+#define TEST_WORDS_NUM       (8)
+#define TEST_PIPELINED_NUM   (6)
+#define TEST_BATCH_MAX       (4)
+#define TEST_RUN_MAX_US      (2000000)
+
+unsigned int test_failures;
+
+static servo_sim_t sim;
+static int listen_fd;
+static volatile bool running;
+static atomic_uint script_batch;
+static atomic_bool script_reverse;
+
+/**@brief Asynchronous read of one word. */
+typedef struct
+{
+    servo_transaction_t transaction;                    /**< Servo transaction. */
+    uint16_t word;                                      /**< Read word. */
+    bool completed;                                     /**< Transaction is completed. */
+    bool success;                                       /**< Transaction succeeded. */
+} test_read_t;
+
+static uint8_t completion_order[TEST_PIPELINED_NUM];
+static uint8_t completions;
+
+/**@brief Expected value of the register. */
+static uint16_t register_value(uint16_t address)
+{
+    return (uint16_t)(0xB000 + address);
+}
+
+/**@brief Simulator thread serving one connection.
+ */
+static void * sim_thread(void * arg)
+{
+    (void)arg;
+    const int fd = servo_sim_tcp_accept(&sim, listen_fd, &running);
+    if (fd >= 0)
+    {
+        servo_sim_serve(&sim, fd, &running);
+        close(fd);
+    }
+    
+    return NULL;
+}
+
+/**@brief Receive exactly the length.
+ *
+ * @retval true if received, false if the connection is closed.
+ */
+static bool socket_receive(int fd, uint8_t * data, uint16_t length)
+{
+    return (length == 0) || (recv(fd, data, length, MSG_WAITALL) == (ssize_t)length);
+}
+
+/**@brief Receive request frame.
+ */
+static bool request_receive(int fd, modbus_frame_t * frame, uint16_t * id)
+{
+    uint8_t * const adu = &frame->buffer[MODBUS_FRAME_TCP_OFFSET];
+    
+    if (!socket_receive(fd, adu, MODBUS_TCP_HEADER_SIZE))
+    {
+        return false;
+    }
+    
+    //Length field counts the PDU from the unit identifier on
+    const uint16_t length = (uint16_t)((adu[4] << 8) | adu[5]);
+    if ((MODBUS_FRAME_TCP_OFFSET + MODBUS_TCP_HEADER_SIZE + length > frame->size) || 
+        !socket_receive(fd, &adu[MODBUS_TCP_HEADER_SIZE], length))
+    {
+        return false;
+    }
+    
+    return modbus_protocol_tcp_frame_decode(frame, MODBUS_TCP_HEADER_SIZE + length, id) == 
+           MODBUS_PROTOCOL_RESULT_SUCCESS;
+}
+
+/**@brief Scripted server thread: answers batches of requests in the set order.
+ */
+static void * script_thread(void * arg)
+{
+    uint8_t buffers[TEST_BATCH_MAX][SERVO_SIM_FRAME_SIZE];
+    modbus_frame_t frames[TEST_BATCH_MAX];
+    uint16_t ids[TEST_BATCH_MAX];
+    uint16_t length;
+    
+    (void)arg;
+    const int fd = servo_sim_tcp_accept(&sim, listen_fd, &running);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    
+    for (uint8_t i = 0; i < TEST_BATCH_MAX; i++)
+    {
+        frames[i].buffer = buffers[i];
+        frames[i].size = sizeof(buffers[i]);
+    }
+    
+    while (request_receive(fd, &frames[0], &ids[0]))
+    {
+        //Script is set before the first request of the batch is sent
+        const unsigned int batch = atomic_load(&script_batch);
+        const bool reverse = atomic_load(&script_reverse);
+        bool received = true;
+        for (unsigned int i = 1; (i < batch) && received; i++)
+        {
+            received = request_receive(fd, &frames[i], &ids[i]);
+        }
+        if (!received)
+        {
+            break;
+        }
+        
+        for (unsigned int i = 0; i < batch; i++)
+        {
+            modbus_frame_t * const frame = &frames[reverse ? batch - 1 - i : i];
+            const uint16_t id = ids[reverse ? batch - 1 - i : i];
+            frame->pdu_length = servo_sim_pdu_process(&sim, MODBUS_FRAME_PDU(frame), frame->pdu_length);
+            const uint8_t * const adu = modbus_protocol_tcp_frame_encode(frame, id, &length);
+            if ((adu == NULL) || (send(fd, adu, length, MSG_NOSIGNAL) != (ssize_t)length))
+            {
+                break;
+            }
+        }
+    }
+    close(fd);
+    
+    return NULL;
+}
+
+/**@brief Completion callback: record the order of completions.
+ */
+static void read_complete(servo_transaction_t * transaction, bool success)
+{
+    test_read_t * const read = (test_read_t *)transaction->user_data;
+    
+    read->completed = true;
+    read->success = success;
+    if (completions < TEST_PIPELINED_NUM)
+    {
+        completion_order[completions] = (uint8_t)(transaction->address - TEST_ADDRESS);
+    }
+    completions++;
+}
+
+/**@brief Submit reads of one word from the consecutive registers.
+ */
+static void reads_submit(modbus_async_t * async, test_read_t * reads, uint8_t reads_num, uint16_t address)
+{
+    completions = 0;
+    for (uint8_t i = 0; i < reads_num; i++)
+    {
+        reads[i].completed = false;
+        TEST_CHECK(servo_nwords_read_submit(async, &reads[i].transaction, TEST_AXIS, (uint16_t)(address + i), 
+                                            &reads[i].word, 1, read_complete, &reads[i]));
+    }
+}
+
+/**@brief Poll the queue until it is empty.
+ */
+static void async_run(modbus_async_t * async)
+{
+    const uint32_t start_us = tcp_client_clock(NULL);
+    
+    while (modbus_async_busy(async) && (tcp_client_clock(NULL) - start_us < TEST_RUN_MAX_US))
+    {
+        modbus_async_poll(async, tcp_client_clock(NULL));
+        usleep(200);
+    }
+    TEST_CHECK(!modbus_async_busy(async));
+}
+
+/**@brief Connect the client to the server thread.
+ */
+static bool client_connect(tcp_client_t * client, modbus_ctx_t * ctx, modbus_async_t * async, uint16_t port)
+{
+    if (!tcp_client_connect(client, "127.0.0.1", port, 1000))
+    {
+        perror("tcp_client_connect");
+        return false;
+    }
+    
+    servo_tcp_initialize(ctx, client, MODBUS_PROTOCOL_MODE_TCP);
+    ctx->retries = 0;
+    modbus_async_initialize(async, ctx);
+    
+    return true;
+}
+
+/**@brief Blocking and pipelined transactions served by the simulator.
+ */
+static void sim_test(uint16_t port)
+{
+    tcp_client_t client;
+    modbus_ctx_t ctx;
+    modbus_async_t async;
+    test_read_t reads[TEST_PIPELINED_NUM];
+    uint16_t written[TEST_WORDS_NUM];
+    uint16_t words[TEST_WORDS_NUM];
+    pthread_t thread;
+    
+    running = true;
+    TEST_CHECK(pthread_create(&thread, NULL, sim_thread, NULL) == 0);
+    if (client_connect(&client, &ctx, &async, port))
+    {
+        for (uint16_t i = 0; i < TEST_WORDS_NUM; i++)
+        {
+            written[i] = (uint16_t)(0x3C00 + i);
+        }
+        TEST_CHECK(servo_nwords_write(&ctx, TEST_AXIS, 0x0030, written, TEST_WORDS_NUM));
+        TEST_CHECK(servo_nwords_read(&ctx, TEST_AXIS, 0x0030, words, TEST_WORDS_NUM));
+        TEST_CHECK(memcmp(words, written, sizeof(words)) == 0);
+        
+        TEST_CHECK(!servo_nwords_read(&ctx, TEST_AXIS, 0x0500, words, 1));
+        TEST_CHECK(servo_result_get(&ctx) == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+        TEST_CHECK(servo_exception_get(&ctx) == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
+        
+        //Legacy read returns the exception with its code
+        uint8_t request[] = { TEST_AXIS, 0x03, 0x05, 0x00, 0x00, 0x01 };
+        uint8_t answer[5];
+        TEST_CHECK(modbus_request_write(&ctx, request, sizeof(request)) == MODBUS_PROTOCOL_RESULT_SUCCESS);
+        TEST_CHECK(modbus_answer_read(&ctx, answer, sizeof(answer)) == MODBUS_PROTOCOL_RESULT_EXCEPTION);
+        TEST_CHECK((answer[1] == 0x83) && (answer[2] == MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS));
+        
+        //All requests are in flight before the first answer is received
+        reads_submit(&async, reads, TEST_PIPELINED_NUM, TEST_ADDRESS);
+        modbus_async_poll(&async, tcp_client_clock(NULL));
+        TEST_CHECK(async.in_flight + completions == TEST_PIPELINED_NUM);
+        async_run(&async);
+        for (uint8_t i = 0; i < TEST_PIPELINED_NUM; i++)
+        {
+            TEST_CHECK(reads[i].completed && reads[i].success);
+            TEST_CHECK(reads[i].word == register_value(TEST_ADDRESS + i));
+        }
+        
+        tcp_client_close(&client);
+    }
+    
+    running = false;
+    pthread_join(thread, NULL);
+}
+
+/**@brief Out-of-order and late answers sent by the scripted server.
+ */
+static void script_test(uint16_t port)
+{
+    tcp_client_t client;
+    modbus_ctx_t ctx;
+    modbus_async_t async;
+    test_read_t reads[TEST_PIPELINED_NUM];
+    uint16_t word;
+    pthread_t thread;
+    
+    running = true;
+    TEST_CHECK(pthread_create(&thread, NULL, script_thread, NULL) == 0);
+    if (client_connect(&client, &ctx, &async, port))
+    {
+        //Answers in reverse order are matched to their requests by the transaction identifier
+        atomic_store(&script_batch, 4);
+        atomic_store(&script_reverse, true);
+        reads_submit(&async, reads, 4, TEST_ADDRESS);
+        async_run(&async);
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            TEST_CHECK(reads[i].completed && reads[i].success);
+            TEST_CHECK(reads[i].word == register_value(TEST_ADDRESS + i));
+            TEST_CHECK(completion_order[i] == 3 - i);
+        }
+        
+        //Two requests time out, their late answers arrive ahead of the answer to the third one
+        atomic_store(&script_batch, 3);
+        atomic_store(&script_reverse, false);
+        reads_submit(&async, reads, 2, TEST_ADDRESS);
+        async_run(&async);
+        TEST_CHECK(reads[0].completed && !reads[0].success);
+        TEST_CHECK(reads[0].transaction.result == MODBUS_PROTOCOL_RESULT_TIMEOUT);
+        TEST_CHECK(reads[1].completed && !reads[1].success);
+        reads_submit(&async, &reads[2], 1, TEST_ADDRESS + 2);
+        async_run(&async);
+        TEST_CHECK(reads[2].completed && reads[2].success);
+        TEST_CHECK(reads[2].word == register_value(TEST_ADDRESS + 2));
+        
+        //Blocking transactions skip the late answer in frame_receive()
+        atomic_store(&script_batch, 2);
+        TEST_CHECK(!servo_nwords_read(&ctx, TEST_AXIS, TEST_ADDRESS + 4, &word, 1));
+        TEST_CHECK(servo_result_get(&ctx) == MODBUS_PROTOCOL_RESULT_TIMEOUT);
+        TEST_CHECK(servo_nwords_read(&ctx, TEST_AXIS, TEST_ADDRESS + 5, &word, 1));
+        TEST_CHECK(word == register_value(TEST_ADDRESS + 5));
+        
+        tcp_client_close(&client);
+    }
+    
+    running = false;
+    pthread_join(thread, NULL);
+}
+
+int main(void)
+{
+    const servo_sim_config_t sim_config = 
+    {
+        .mode = MODBUS_PROTOCOL_MODE_TCP
+    };
+    uint16_t port = 0;
+    
+    servo_sim_initialize(&sim, &sim_config);
+    servo_sim_axis_add(&sim, TEST_AXIS);
+    for (uint16_t i = 0; i < TEST_PIPELINED_NUM; i++)
+    {
+        sim.axes[0].registers[TEST_ADDRESS + i] = register_value(TEST_ADDRESS + i);
+    }
+    
+    listen_fd = servo_sim_tcp_listen(&port);
+    if (listen_fd < 0)
+    {
+        perror("servo_sim_tcp_listen");
+        return EXIT_FAILURE;
+    }
+    
+    sim_test(port);
+    script_test(port);
+    close(listen_fd);
+    
+    return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}